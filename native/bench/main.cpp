@@ -0,0 +1,2419 @@
+// ============================================================================
+// main.cpp (native bench)
+// Host harness for the player core. Builds a synthetic music tree on disk,
+// mounts it through the fake SD and times the operations that matter on the
+// device: playlist scan, track switch, loop() and the HTTP route handlers.
+//
+//   pio run -e native && .pio/build/native/program [tracks] [indexTracks]
+// ============================================================================
+#include <Arduino.h>
+#include <SD.h>
+#include <ESPAsyncWebServer.h>
+#include <chrono>
+#include <functional>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <new>
+#include <cstddef>
+#include <string>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
+#include "Audio/AudioPlayer.h"
+#include "Server/Server.h"
+#include "Server/WebUi.h"
+#include "Server/StatePublisher.h"
+#include "Server/WsProtocol.h"
+#include "Server/PlaylistStream.h"
+#include "Audio/SearchIndex.h"
+#include "Audio/ShuffleOrder.h"
+#include "Audio/PlaylistStore.h"
+#include "Audio/FolderWalker.h"
+#include "Sync/SyncLeader.h"
+#include "Sync/SyncFollower.h"
+#include <WiFiUdp.h>
+#include <Wire.h>
+#include <esp_timer.h>
+
+extern AsyncWebServer server;
+
+// ----------------------------------------------------------------------------
+// Allocation accounting
+// Counts C++ operator new traffic (String, std::string, vectors, JSON
+// documents). Raw malloc/strdup calls are not seen here.
+// ----------------------------------------------------------------------------
+struct AllocStats {
+    size_t count = 0;
+    size_t bytes = 0;
+};
+
+static AllocStats allocStats;
+
+// Every form below allocates with malloc (or posix_memalign, which free()
+// also releases), so each new pairs with the delete the compiler picks.
+static void* countedAlloc(size_t size, size_t alignment = 0) {
+    allocStats.count++;
+    allocStats.bytes += size;
+    if (size == 0) size = 1;
+    if (alignment <= alignof(std::max_align_t)) return malloc(size);
+    void* p = nullptr;
+    return posix_memalign(&p, alignment, size) == 0 ? p : nullptr;
+}
+
+static void* countedAllocOrThrow(size_t size, size_t alignment = 0) {
+    if (void* p = countedAlloc(size, alignment)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size) { return countedAllocOrThrow(size); }
+void* operator new[](size_t size) { return countedAllocOrThrow(size); }
+void* operator new(size_t size, std::align_val_t al) { return countedAllocOrThrow(size, (size_t)al); }
+void* operator new[](size_t size, std::align_val_t al) { return countedAllocOrThrow(size, (size_t)al); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+void* operator new(size_t size, std::align_val_t al, const std::nothrow_t&) noexcept {
+    return countedAlloc(size, (size_t)al);
+}
+void* operator new[](size_t size, std::align_val_t al, const std::nothrow_t&) noexcept {
+    return countedAlloc(size, (size_t)al);
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { free(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { free(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { free(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { free(p); }
+
+// ----------------------------------------------------------------------------
+// Helpers
+// ----------------------------------------------------------------------------
+struct Sample {
+    double usPerOp;
+    double allocsPerOp;
+    double bytesPerOp;
+};
+
+static Sample measure(int iterations, const std::function<void()>& fn) {
+    AllocStats before = allocStats;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        fn();
+    }
+    auto end = std::chrono::steady_clock::now();
+    double us = std::chrono::duration<double, std::micro>(end - start).count();
+    return {
+        us / iterations,
+        double(allocStats.count - before.count) / iterations,
+        double(allocStats.bytes - before.bytes) / iterations,
+    };
+}
+
+static void report(const char* name, const Sample& s) {
+    printf("%-28s %12.2f us %10.1f allocs %12.0f bytes\n", name, s.usPerOp, s.allocsPerOp, s.bytesPerOp);
+}
+
+// Correctness checks made along the way. A failure is reported where it
+// happens and makes the bench exit non-zero once everything has run.
+static int checksFailed = 0;
+
+static void check(bool ok, const char* what) {
+    if (ok) return;
+    checksFailed++;
+    printf("CHECK FAILED: %s\n", what);
+}
+
+static std::string makeTree(int tracks, size_t bytesPerTrack) {
+    char root[] = "/tmp/musicbox-bench-XXXXXX";
+    if (!mkdtemp(root)) {
+        perror("mkdtemp");
+        exit(1);
+    }
+    std::string music = std::string(root) + "/Music";
+    mkdir(music.c_str(), 0755);
+
+    std::string payload(bytesPerTrack, '\x55');
+    for (int i = 0; i < tracks; i++) {
+        char name[64];
+        snprintf(name, sizeof(name), "/%05d - Synthetic Holiday Track.mp3", i);
+        FILE* f = fopen((music + name).c_str(), "wb");
+        if (!f) continue;
+        fwrite(payload.data(), 1, payload.size(), f);
+        fclose(f);
+    }
+    return root;
+}
+
+static void removeTree(const std::string& root) {
+    std::string cmd = "rm -rf '" + root + "'";
+    if (system(cmd.c_str()) != 0) {
+        fprintf(stderr, "warning: could not remove %s\n", root.c_str());
+    }
+}
+
+// ----------------------------------------------------------------------------
+// Benchmarks
+// ----------------------------------------------------------------------------
+// Cold scan (no index on the card) against a boot that validates and loads
+// the on-card index, over a large synthetic tree.
+static void benchIndexedBoot(int tracks) {
+    std::string root = makeTree(tracks, 64);
+    SD.setHostRoot(root.c_str());
+    SDPlaylist playlist;
+
+    Serial.quiet = true;
+    Sample cold = measure(3, [&] {
+        playlist.invalidateIndex();
+        playlist.begin();
+    });
+    int scanned = playlist.getTrackCount();
+    Sample indexed = measure(3, [&] {
+        playlist.begin();
+    });
+    Serial.quiet = false;
+
+    printf("\nBoot scan over %d files (%d tracks kept)\n", tracks, playlist.getTrackCount());
+    check(scanned == tracks && playlist.getTrackCount() == scanned, "an indexed boot loads what the scan found");
+    report("cold scan + index write", cold);
+    report("indexed boot", indexed);
+    printf("%-28s %12u bytes used %8u bytes reserved\n", "playlist storage",
+           (unsigned)playlist.getBytesUsed(), (unsigned)playlist.getBytesReserved());
+
+    // Built before PSRAM is up, as the global player is on the device.
+    SDPlaylist early;
+    fake_psram_set_found(true);
+    Serial.quiet = true;
+    early.begin();
+    Serial.quiet = false;
+    fake_psram_set_found(false);
+    check(early.inPSRAM(), "a playlist built before PSRAM init still stores the list there");
+    removeTree(root);
+}
+
+// Decoder thread feeding the real AudioOutput (whose I2S task is paced by
+// the fake driver) while being stalled periodically, as web and SD traffic
+// would stall the decode task on the device.
+static void benchRingBuffer() {
+    // Leaked on purpose: its writer thread runs until the process exits.
+    AudioOutput& output = *new AudioOutput();
+    output.begin();
+
+    printf("\nDecoder stalls vs. %u-frame ring (44.1 kHz)\n", (unsigned)PCM_RING_FRAMES);
+    printf("%-28s %12s %12s\n", "stall every 250 ms", "underruns", "silence ms");
+
+    const int stallsMs[] = { 0, 50, 150, 300 };
+    for (int stallMs : stallsMs) {
+        AudioOutputStats before = output.getStats();
+
+        std::thread decoder([&] {
+            int16_t frame[1152 * 2] = {};
+            output.write(frame, 1152, 2);
+            output.setPlaying(true);
+            auto start = std::chrono::steady_clock::now();
+            auto nextStall = start + std::chrono::milliseconds(250);
+            while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(1500)) {
+                output.write(frame, 1152, 2);
+                if (stallMs > 0 && std::chrono::steady_clock::now() >= nextStall) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(stallMs));
+                    nextStall += std::chrono::milliseconds(250 + stallMs);
+                }
+            }
+        });
+        decoder.join();
+        output.setPlaying(false);
+
+        AudioOutputStats after = output.getStats();
+        char label[32];
+        snprintf(label, sizeof(label), "  %d ms stall", stallMs);
+        printf("%-28s %12u %12.1f\n", label,
+               after.underrunEvents - before.underrunEvents,
+               (after.underrunFrames - before.underrunFrames) / 44.1);
+
+        // Let the ring drain before the next run.
+        output.discard();
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+}
+
+// Command to visible state change over both control paths: REST POST plus
+// SSE, and a 6-byte WebSocket frame plus binary STATE. Everything runs
+// in-process, so this is the box's share of the round trip; the network
+// share scales with the bytes each path puts on the air.
+static void benchControlRoundTrip(AudioPlayer* player) {
+    using Clock = std::chrono::steady_clock;
+    const int rounds = 20;
+
+    AsyncEventSourceClient* sse = events.connectClient();
+    AsyncWebSocketClient* client = ws.connectClient();
+
+    Clock::time_point sent, acked, stated;
+    client->onFrame = [&](const uint8_t* data, size_t len) {
+        (void)len;
+        if (data[0] == WS_OP_ACK) acked = Clock::now();
+        if (data[0] == WS_OP_STATE) stated = Clock::now();
+    };
+
+    double wsAckUs = 0, wsStateUs = 0, restUs = 0, pingUs = 0;
+    size_t restBytes = 0, sseBytes = 0, wsBytes = 0;
+
+    for (int i = 0; i < rounds; i++) {
+        // Past the publisher's coalescing window, so each change goes out.
+        std::this_thread::sleep_for(std::chrono::milliseconds(STATE_COALESCE_MS + 5));
+
+        uint8_t frame[WS_COMMAND_SIZE];
+        wsEncodeCommand(frame, WsCommand{ WS_OP_PING, (uint8_t)i, 0 });
+        auto start = Clock::now();
+        ws.receive(client, frame, sizeof(frame));
+        pingUs += std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+        size_t before = client->frames.size();
+        wsEncodeCommand(frame, WsCommand{ WS_OP_NEXT, (uint8_t)i, 0 });
+        sent = Clock::now();
+        ws.receive(client, frame, sizeof(frame));
+        player->loop();
+        serverLoop();
+        wsAckUs += std::chrono::duration<double, std::micro>(acked - sent).count();
+        wsStateUs += std::chrono::duration<double, std::micro>(stated - sent).count();
+        wsBytes += sizeof(frame);
+        for (size_t f = before; f < client->frames.size(); f++) wsBytes += client->frames[f].size();
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(STATE_COALESCE_MS + 5));
+
+        uint32_t sseBefore = sse->messagesSent;
+        size_t sseBytesBefore = sse->bytesSent;
+        start = Clock::now();
+        AsyncWebServerRequest request(HTTP_POST, "/api/control");
+        request.addParam("action", "next", true);
+        server.handle(&request);
+        player->loop();
+        serverLoop();
+        if (sse->messagesSent != sseBefore) {
+            restUs += std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+        }
+        restBytes += strlen("action=next") + request.responseBody().size();
+        sseBytes += sse->bytesSent - sseBytesBefore;
+    }
+
+    Serial.quiet = false;
+    printf("\nControl round trip, in-process (%d rounds)\n", rounds);
+    printf("%-28s %12.2f us\n", "WS ping -> pong", pingUs / rounds);
+    printf("%-28s %12.2f us\n", "WS next -> ack", wsAckUs / rounds);
+    printf("%-28s %12.2f us\n", "WS next -> state frame", wsStateUs / rounds);
+    printf("%-28s %12.2f us\n", "REST next -> SSE event", restUs / rounds);
+    printf("%-28s %12.1f bytes (frames, before WS headers)\n", "WS payload per action", double(wsBytes) / rounds);
+    printf("%-28s %12.1f bytes (bodies only, before HTTP headers)\n", "REST + SSE per action",
+           double(restBytes + sseBytes) / rounds);
+    Serial.quiet = true;
+}
+
+// Codec bring-up against the recording bus, then a read-back of what the
+// part was left holding.
+static void benchDacBringUp() {
+    static const RegisterValue output[] = {
+        { 0, 63, 0xD4 }, { 0, 64, 0x00 }, { 0, 65, 0x0A }, { 0, 66, 0x0A },
+        { 1, 32, 0x86 }, { 1, 35, 0x44 }, { 1, 38, 0x80 }, { 1, 42, 0x04 }, { 8, 1, 0x04 },
+    };
+    DacClockPlan plan;
+    DACClockPlanner::plan(44100, 16, plan);
+    RegisterValue clocks[DAC_CLOCK_REGISTERS];
+    DACClockPlanner::toRegisters(plan, true, clocks);
+    std::vector<RegisterValue> expected(output, output + sizeof(output) / sizeof(output[0]));
+    expected.insert(expected.end(), clocks, clocks + DAC_CLOCK_REGISTERS);
+
+    fake_wire_clear_log();
+    DACController dac;
+    Sample sample = measure(1, [&] { dac.begin(); });
+    FakeWireStats bus = fake_wire_stats();
+
+    int mismatches = 0;
+    for (const RegisterValue& v : expected) {
+        if (fake_wire_register(DAC_I2C_ADDR, v.page, v.reg) != v.value) mismatches++;
+    }
+    size_t largest = 0;
+    for (const FakeWireTransaction& t : fake_wire_log()) largest = std::max(largest, t.bytes.size());
+
+    Serial.quiet = false;
+    printf("\nDAC bring-up over a %u kHz bus\n", (unsigned)(DAC_I2C_CLOCK_HZ / 1000));
+    printf("%-28s %12.2f ms\n", "begin()", sample.usPerOp / 1e3);
+    printf("%-28s %12u\n", "I2C transactions", (unsigned)bus.transactions);
+    printf("%-28s %12u\n", "bytes on the bus", (unsigned)bus.bytes);
+    printf("%-28s %12u us\n", "modeled bus time", (unsigned)bus.busUs);
+    printf("%-28s %12u\n", "largest burst", (unsigned)largest);
+    printf("%-28s %12u\n", "writes skipped", (unsigned)dac.getBusStats().skipped);
+    printf("%-28s %12d of %d\n", "register mismatches", mismatches, (int)expected.size());
+    check(mismatches == 0, "the codec holds every register bring-up wrote");
+    Serial.quiet = true;
+}
+
+// Every rate and I2S word length against the datasheet limits, what each
+// plan costs to compute, and what switching rates costs on the bus.
+static void benchClockPlanner() {
+    static const uint32_t rates[] = { 8000, 11025, 12000, 16000, 22050, 24000, 32000,
+                                      44100, 48000, 64000, 88200, 96000, 176400, 192000 };
+    static const uint8_t words[] = { 16, 20, 24, 32 };
+
+    Serial.quiet = false;
+    printf("\nDAC clock plans (16-bit words)\n");
+    printf("%-10s %8s %4s %4s %4s %6s %6s %6s\n", "rate", "PLL MHz", "P", "R", "J", "NDAC", "MDAC", "DOSR");
+
+    int planned = 0, invalid = 0, impossible = 0;
+    double planUs = 0;
+    for (uint32_t rate : rates) {
+        for (uint8_t bits : words) {
+            DacClockPlan plan;
+            auto start = std::chrono::steady_clock::now();
+            bool ok = DACClockPlanner::plan(rate, bits, plan);
+            planUs += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+            if (!ok) {
+                impossible++;
+                if (bits == 16) printf("%-10u %8s\n", (unsigned)rate, "none");
+                continue;
+            }
+            planned++;
+            const char* error = DACClockPlanner::check(plan);
+            if (error) {
+                invalid++;
+                printf("  %u Hz %u-bit: %s\n", (unsigned)rate, (unsigned)bits, error);
+            }
+            if (bits == 16) {
+                printf("%-10u %8.2f %4u %4u %4u %6u %6u %6u\n", (unsigned)rate, plan.codecClkHz() / 1e6,
+                       (unsigned)plan.pllP, (unsigned)plan.pllR, (unsigned)plan.pllJ,
+                       (unsigned)plan.ndac, (unsigned)plan.mdac, (unsigned)plan.dosr);
+            }
+        }
+    }
+    int total = (int)(sizeof(rates) / sizeof(rates[0]) * sizeof(words));
+    printf("%-28s %5d of %d planned, %d failing check(), %d with no plan\n", "rate x word length",
+           planned, total, invalid, impossible);
+    printf("%-28s %12.2f us\n", "plan()", planUs / total);
+    check(invalid == 0, "every clock plan passes DACClockPlanner::check()");
+
+    // The old hard-coded tree, for reference.
+    DacClockPlan legacy = { 44100, 16, 1, 1, 8, 0, 8, 2, 128 };
+    const char* legacyError = DACClockPlanner::check(legacy);
+    printf("%-28s %s\n", "previous fixed clocks", legacyError ? legacyError : "valid");
+
+    Serial.quiet = true;
+    DACController dac;
+    dac.begin();
+    uint32_t before = dac.getBusStats().transactions;
+    dac.setSampleRate(44100, 16);
+    uint32_t same = dac.getBusStats().transactions - before;
+    before = dac.getBusStats().transactions;
+    dac.setSampleRate(48000, 16);
+    uint32_t changed = dac.getBusStats().transactions - before;
+    dac.prepareSampleRate(22050, 16);
+    auto start = std::chrono::steady_clock::now();
+    dac.setSampleRate(22050, 16);
+    double preparedUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    Serial.quiet = false;
+    printf("%-28s %12u transactions\n", "44.1 kHz -> 44.1 kHz", (unsigned)same);
+    printf("%-28s %12u transactions\n", "44.1 kHz -> 48 kHz", (unsigned)changed);
+    printf("%-28s %12.2f us (register writes only)\n", "48 kHz -> 22.05 kHz, prepared", preparedUs);
+    check(same == 0, "setting the current rate again stays off the bus");
+    check(changed > 0, "a new rate is written to the codec");
+
+    // 16-bit slots leave BCLK under the PLL minimum here: 32-bit slots instead.
+    int lowClocked = 0;
+    for (uint32_t rate : { 8000u, 11025u, 12000u }) {
+        Serial.quiet = true;
+        if (rate == 11025) dac.prepareSampleRate(rate, 16);
+        dac.setSampleRate(rate, 16);
+        Serial.quiet = false;
+        const DacClockPlan& plan = dac.getClockPlan();
+        bool ok = plan.sampleRate == rate && dac.slotBits() == DAC_WIDE_SLOT_BITS;
+        printf("%-10u %8.2f MHz PLL, %u-bit slots%s\n", (unsigned)rate, plan.codecClkHz() / 1e6,
+               (unsigned)dac.slotBits(), ok ? "" : " (NOT CLOCKED)");
+        lowClocked += ok;
+    }
+    dac.setSampleRate(44100, 16);
+    check(lowClocked == 3 && dac.slotBits() == 16, "8 to 12 kHz are clocked from 32-bit slots");
+    Serial.quiet = true;
+}
+
+// A one-second volume drag (a step every 5 ms, loop() in between) and an
+// EQ change, both now landing in the codec. Counted in I2C transactions.
+static void benchDacOffload(AudioPlayer* player) {
+    using Clock = std::chrono::steady_clock;
+    const int steps = 200;
+
+    player->post(PlayerCommand::VOLUME, 20);
+    for (int i = 0; i < 300; i++) {
+        player->loop();
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+
+    uint32_t writes = player->getDacBusStats().transactions;
+    auto start = Clock::now();
+    for (int i = 0; i < steps; i++) {
+        player->post(PlayerCommand::VOLUME, 20 + i * 60 / steps);
+        player->loop();
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    double dragMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    uint32_t dragWrites = player->getDacBusStats().transactions - writes;
+    for (int i = 0; i < 300; i++) {
+        player->loop();
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    uint32_t settleWrites = player->getDacBusStats().transactions - writes - dragWrites;
+
+    writes = player->getDacBusStats().transactions;
+    double eqUs = 0;
+    const int eqRounds = 20;
+    for (int i = 0; i < eqRounds; i++) {
+        AsyncWebServerRequest request(HTTP_POST, "/api/eq");
+        request.addParam("bass", i % 2 ? "6" : "-3", true);
+        request.addParam("treble", "2", true);
+        start = Clock::now();
+        server.handle(&request);
+        player->loop();
+        eqUs += std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+    }
+    uint32_t eqWrites = player->getDacBusStats().transactions - writes;
+
+    // An unchanged EQ costs nothing on the bus.
+    writes = player->getDacBusStats().transactions;
+    player->post(PlayerCommand::VOLUME, 20 + (steps - 1) * 60 / steps);
+    player->loop();
+    player->setEq(player->getEq());
+    player->loop();
+    uint32_t idleWrites = player->getDacBusStats().transactions - writes;
+
+    Serial.quiet = false;
+    printf("\nCodec volume and EQ (%d volume steps over %.0f ms)\n", steps, dragMs);
+    printf("%-28s %12u transactions\n", "I2C during drag", (unsigned)dragWrites);
+    printf("%-28s %12u transactions\n", "I2C while ramp settles", (unsigned)settleWrites);
+    printf("%-28s %12.1f transactions\n", "I2C per EQ change", double(eqWrites) / eqRounds);
+    printf("%-28s %12.2f us\n", "POST /api/eq -> codec", eqUs / eqRounds);
+    printf("%-28s %12u transactions\n", "I2C for a repeated setting", (unsigned)idleWrites);
+    check(idleWrites == 0, "repeating the volume and EQ stays off the bus");
+    Serial.quiet = true;
+}
+
+// A one-second volume drag (a step every 5 ms) with three SSE clients,
+// then clients reconnecting with various Last-Event-IDs.
+static void benchStatePublisher() {
+    AsyncEventSource source("/bench-events");
+    StatePublisher publisher(source);
+    PlayerState state{ 3, true, 10, {}, false, REPEAT_ALL };
+    source.onConnect([&](AsyncEventSourceClient* client) { publisher.onConnect(client); });
+
+    publisher.update(state, 0);
+    AsyncEventSourceClient* clients[3];
+    for (auto& client : clients) client = source.connectClient();
+    uint32_t baseline = clients[0]->messagesSent;
+    size_t baselineBytes = clients[0]->bytesSent;
+
+    Sample drag = measure(200, [&] {
+        static uint32_t nowMs = 0;
+        nowMs += 5;
+        state.volume = (state.volume + 1) % 101;
+        publisher.update(state, nowMs);
+    });
+    publisher.update(state, 10000);   // Flush the tail of the window
+
+    printf("\nState publisher, 200 volume steps in 1 s (%u ms window)\n", (unsigned)STATE_COALESCE_MS);
+    report("update()", drag);
+    printf("%-28s %12u events %8u bytes per client\n", "sent",
+           (unsigned)(clients[0]->messagesSent - baseline),
+           (unsigned)(clients[0]->bytesSent - baselineBytes));
+    printf("%-28s %12u\n", "updates coalesced", (unsigned)publisher.updatesCoalesced());
+
+    // Ten seconds of playback polled every 10 ms, with one seek in the middle.
+    uint32_t beforePlayback = clients[0]->messagesSent;
+    for (uint32_t t = 0; t < 10000; t += 10) {
+        state.progress.positionMs = t < 5000 ? t : t + 60000;
+        state.progress.durationMs = 180000;
+        state.progress.bitrate = 128000;
+        publisher.update(state, 11000 + t);
+    }
+    printf("%-28s %12u events\n", "10 s playback + 1 seek",
+           (unsigned)(clients[0]->messagesSent - beforePlayback));
+
+    uint32_t lastId = publisher.lastEventId();
+    AsyncEventSourceClient* upToDate = source.connectClient(lastId);
+    uint32_t upToDateMessages = upToDate->messagesSent;
+    state.trackIndex++;
+    publisher.update(state, 30000);
+    AsyncEventSourceClient* oneBehind = source.connectClient(lastId);
+    AsyncEventSourceClient* fresh = source.connectClient(0);
+
+    printf("%-28s %12u messages\n", "reconnect, up to date", (unsigned)upToDateMessages);
+    printf("%-28s %s\n", "reconnect, one event behind", oneBehind->lastMessage.c_str());
+    printf("%-28s %s\n", "new client", fresh->lastMessage.c_str());
+}
+
+// Progress snapshot written as fast as possible on one thread while two
+// others read it; every read must be one consistent write.
+static void benchSeqlock() {
+    Seqlock<PlaybackProgress> progress;
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> reads{0};
+    std::atomic<uint64_t> torn{0};
+
+    std::thread writer([&] {
+        for (uint32_t i = 1; !stop.load(std::memory_order_relaxed); i++) {
+            progress.write(PlaybackProgress{ i, i * 2, i * 3 });
+        }
+    });
+    auto reader = [&] {
+        uint64_t n = 0, bad = 0;
+        while (!stop.load(std::memory_order_relaxed)) {
+            PlaybackProgress p = progress.read();
+            if (p.durationMs != p.positionMs * 2 || p.bitrate != p.positionMs * 3) bad++;
+            n++;
+        }
+        reads += n;
+        torn += bad;
+    };
+    std::thread r1(reader), r2(reader);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    stop = true;
+    writer.join();
+    r1.join();
+    r2.join();
+
+    printf("\nProgress seqlock, writer flat out, 2 readers, 300 ms\n");
+    printf("%-28s %12.1f ns\n", "read under contention", 2 * 300e6 / reads.load());
+    printf("%-28s %12llu\n", "torn reads", (unsigned long long)torn.load());
+    check(torn == 0, "seqlock reads are never torn");
+}
+
+// Frame-aligned lookups into a synthetic MP3 with mixed padded and
+// unpadded frames, checked against the offsets it was written with.
+static void benchSeekTable() {
+    char path[] = "/tmp/musicbox-seek-XXXXXX";
+    if (!mkdtemp(path)) {
+        perror("mkdtemp");
+        exit(1);
+    }
+    std::string root = path;
+
+    // 128 kbit/s, 44.1 kHz: 417 bytes, 418 with the padding bit set.
+    const int frames = 10000;
+    std::vector<uint32_t> offsets;
+    std::string data("ID3\x04\x00\x00\x00\x00\x08\x00", 10);
+    data.append(1024, '\0');
+    for (int i = 0; i < frames; i++) {
+        bool padded = (i % 3) != 0;
+        offsets.push_back(data.size());
+        std::string frame(padded ? 418 : 417, '\x55');
+        frame.replace(0, 4, padded ? "\xFF\xFB\x92\x64" : "\xFF\xFB\x90\x64", 4);
+        data += frame;
+    }
+    FILE* f = fopen((root + "/track.mp3").c_str(), "wb");
+    fwrite(data.data(), 1, data.size(), f);
+    fclose(f);
+    SD.setHostRoot(root.c_str());
+
+    FrameSeekTable table;
+    std::mt19937 rng(7);
+    int wrong = 0;
+    uint32_t offset = 0, skip = 0;
+
+    Sample cold = measure(1, [&] {
+        table.open(SD, "/track.mp3");
+        table.locate(SD, uint64_t(frames - 1) * 1152, offset, skip);
+    });
+    Sample warm = measure(1000, [&] {
+        uint64_t sample = rng() % (uint64_t(frames) * 1152);
+        uint32_t target = sample / 1152;
+        if (!table.locate(SD, sample, offset, skip) ||
+            offset != offsets[target ? target - 1 : 0] ||
+            skip != sample % 1152 + (target ? 1152 : 0)) {
+            wrong++;
+        }
+    });
+
+    printf("\nFrame seek table over %d frames (%u entries)\n", frames, (unsigned)table.entries());
+    report("first locate (walks file)", cold);
+    report("random locate", warm);
+    printf("%-28s %12d\n", "misaligned results", wrong);
+    check(wrong == 0, "seek table lookups land on frame boundaries");
+    removeTree(root);
+}
+
+// Plays a handful of one-second tracks through the real decode and I2S
+// tasks and reports the silence the output had to insert at each boundary.
+static void benchGapless(uint16_t openLatencyMs) {
+    char root[] = "/tmp/musicbox-gapless-XXXXXX";
+    if (!mkdtemp(root)) {
+        perror("mkdtemp");
+        exit(1);
+    }
+    std::string music = std::string(root) + "/Music";
+    mkdir(music.c_str(), 0755);
+
+    // One second at 128 kbit/s, starting with an MPEG-1 Layer III header.
+    std::string payload(16000, '\x55');
+    payload.replace(0, 4, "\xFF\xFB\x90\x64", 4);
+    const int tracks = 5;
+    for (int i = 0; i < tracks; i++) {
+        char name[64];
+        snprintf(name, sizeof(name), "/%d - Gapless.mp3", i);
+        FILE* f = fopen((music + name).c_str(), "wb");
+        if (!f) continue;
+        fwrite(payload.data(), 1, payload.size(), f);
+        fclose(f);
+    }
+    SD.setHostRoot(root);
+    Audio::openLatencyMs = openLatencyMs;
+
+    // Leaked on purpose, like the ring bench: its tasks outlive this call.
+    Serial.quiet = true;
+    AudioPlayer* player = new AudioPlayer();
+    player->begin();
+    player->startTasks();
+    player->post(PlayerCommand::PLAY);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1000 * (tracks - 1) + 500));
+    AudioOutputStats stats = player->getOutputStats();
+    player->post(PlayerCommand::PAUSE);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    Serial.quiet = false;
+
+    printf("\nTrack transitions with %u ms open latency\n", (unsigned)openLatencyMs);
+    printf("%-28s %12u\n", "transitions", (unsigned)stats.trackTransitions);
+    printf("%-28s %12.1f ms\n", "last gap", stats.lastGapUs / 1000.0);
+    printf("%-28s %12.1f ms\n", "max gap", stats.maxGapUs / 1000.0);
+    printf("%-28s %12u us\n", "decoder switch", (unsigned)player->getLastSwitchMicros());
+
+    Audio::openLatencyMs = 0;
+    removeTree(root);
+}
+
+// Hashes what the player hands the output, up to one pass of the track.
+class PcmHasher : public PcmListener {
+public:
+    explicit PcmHasher(uint64_t limit) : _limit(limit) {}
+
+    void onPcm(const int16_t* samples, size_t frames, uint8_t channels,
+               uint32_t sampleRate, int64_t playAtUs) override {
+        (void)sampleRate; (void)playAtUs;
+        for (size_t i = 0; i < frames * channels && _frames < _limit; i++) {
+            _hash = (_hash ^ (uint16_t)samples[i]) * 1099511628211ULL;
+            if ((i + 1) % channels == 0) _frames++;
+        }
+    }
+    void onDiscard() override {}
+
+    uint64_t frames() const { return _frames; }
+    uint64_t hash() const { return _hash; }
+
+private:
+    uint64_t _limit;
+    std::atomic<uint64_t> _frames{0};
+    uint64_t _hash = 1469598103934665603ULL;
+};
+
+static void writeWav(const std::string& path, uint32_t rate, uint16_t channels, uint16_t bits,
+                     uint32_t frames) {
+    std::vector<uint8_t> data((size_t)frames * channels * bits / 8);
+    std::mt19937 rng(rate + channels * 7 + bits);
+    for (auto& b : data) b = (uint8_t)rng();
+
+    auto le = [](std::vector<uint8_t>& v, uint32_t x, int n) {
+        for (int i = 0; i < n; i++) v.push_back((uint8_t)(x >> (8 * i)));
+    };
+    std::vector<uint8_t> h;
+    h.insert(h.end(), { 'R', 'I', 'F', 'F' });
+    le(h, 36 + (uint32_t)data.size(), 4);
+    h.insert(h.end(), { 'W', 'A', 'V', 'E', 'f', 'm', 't', ' ' });
+    le(h, 16, 4);
+    le(h, 1, 2);
+    le(h, channels, 2);
+    le(h, rate, 4);
+    le(h, rate * channels * bits / 8, 4);
+    le(h, channels * bits / 8, 2);
+    le(h, bits, 2);
+    h.insert(h.end(), { 'd', 'a', 't', 'a' });
+    le(h, (uint32_t)data.size(), 4);
+
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return;
+    fwrite(h.data(), 1, h.size(), f);
+    fwrite(data.data(), 1, data.size(), f);
+    fclose(f);
+}
+
+// Card to ring the way the decoder does it: file into the input buffer,
+// converted sample by sample into an output buffer, copied into the ring.
+// The same per-chunk work as the fake library plus AudioPlayer::onPcm().
+static size_t decoderPass(File& file, uint32_t dataOffset, uint16_t channels, uint16_t bits,
+                          PcmRingBuffer& ring) {
+    static uint8_t in[1152 * 6];
+    static int16_t pcm[1152 * 2];
+    static int16_t drain[1152 * 2];
+    uint16_t frameBytes = channels * bits / 8;
+    uint16_t sampleBytes = bits / 8;
+    // The library applies its volume per sample; full scale here.
+    static volatile int volume = 21;
+    int gain = volume;
+    size_t total = 0;
+
+    file.seek(dataOffset);
+    for (;;) {
+        size_t n = file.read(in, 1152 * frameBytes) / frameBytes;
+        if (n == 0) break;
+        for (size_t i = 0; i < n; i++) {
+            for (int ch = 0; ch < 2; ch++) {
+                const uint8_t* s = in + i * frameBytes + (channels == 2 ? ch * sampleBytes : 0);
+                int32_t sample = (int16_t)(s[sampleBytes - 2] | (s[sampleBytes - 1] << 8));
+                pcm[i * 2 + ch] = (int16_t)(sample * gain / 21);
+            }
+        }
+        ring.write(pcm, n);
+        ring.read(drain, n);
+        total += n;
+    }
+    return total;
+}
+
+// The direct path: WavReader fills the ring's free run in place.
+static size_t directPass(WavReader& wav, PcmRingBuffer& ring) {
+    static int16_t drain[1024 * 2];
+    size_t total = 0;
+
+    wav.seek(0);
+    for (;;) {
+        size_t frames;
+        int16_t* region = ring.writeRegion(frames);
+        if (frames > 1024) frames = 1024;
+        size_t n = wav.read(region, frames);
+        if (n == 0) break;
+        ring.commit(n);
+        ring.read(drain, n);
+        total += n;
+    }
+    return total;
+}
+
+// Per PCM layout: the cost of moving one second of audio from the card into
+// the ring on each path (single-threaded, best of five passes), and whether
+// the player hands the output the same samples on both.
+static void benchWavFastPath() {
+    struct Layout {
+        const char* name;
+        uint16_t channels;
+        uint16_t bits;
+    };
+    static const Layout layouts[] = {
+        { "16-bit stereo", 2, 16 }, { "16-bit mono", 1, 16 },
+        { "24-bit stereo", 2, 24 }, { "24-bit mono", 1, 24 },
+    };
+    const uint32_t rate = 44100;
+    const uint32_t frames = rate * 10;
+    const uint32_t compareFrames = rate * 3 / 2;
+
+    printf("\nWAV card-to-ring, per second of audio\n");
+    printf("%-16s %14s %14s %10s\n", "layout", "decoder", "direct", "same PCM");
+
+    for (const Layout& layout : layouts) {
+        char root[] = "/tmp/musicbox-wav-XXXXXX";
+        if (!mkdtemp(root)) {
+            perror("mkdtemp");
+            exit(1);
+        }
+        std::string music = std::string(root) + "/Music";
+        mkdir(music.c_str(), 0755);
+        writeWav(music + "/track.wav", rate, layout.channels, layout.bits, frames);
+        SD.setHostRoot(root);
+
+        PcmRingBuffer ring;
+        ring.begin(PCM_RING_FRAMES);
+        WavReader wav;
+        wav.open(SD, "/Music/track.wav");
+        File file = SD.open("/Music/track.wav");
+        double usPerSecond[2] = { 1e18, 1e18 };
+        for (int pass = 0; pass < 5; pass++) {
+            for (int direct = 0; direct < 2; direct++) {
+                auto start = std::chrono::steady_clock::now();
+                size_t n = direct ? directPass(wav, ring)
+                                  : decoderPass(file, wav.format().dataOffset, layout.channels,
+                                                layout.bits, ring);
+                double us = std::chrono::duration<double, std::micro>(
+                    std::chrono::steady_clock::now() - start).count();
+                if (n == frames && us < usPerSecond[direct]) usPerSecond[direct] = us / 10;
+            }
+        }
+        file.close();
+        wav.close();
+
+        uint64_t hashes[2];
+        for (int direct = 0; direct < 2; direct++) {
+            // Leaked on purpose, like the gapless bench: its tasks outlive this call.
+            Serial.quiet = true;
+            PcmHasher* hasher = new PcmHasher(compareFrames);
+            AudioPlayer* player = new AudioPlayer();
+            player->begin();
+            player->setWavFastPath(direct);
+            player->setPcmListener(hasher);
+            player->startTasks();
+            player->post(PlayerCommand::PLAY);
+
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+            while (hasher->frames() < compareFrames && std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+            player->post(PlayerCommand::PAUSE);
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            Serial.quiet = false;
+            hashes[direct] = hasher->frames() == compareFrames ? hasher->hash() : 0;
+        }
+        printf("%-16s %11.1f us %11.1f us %10s\n", layout.name, usPerSecond[0], usPerSecond[1],
+               hashes[0] != 0 && hashes[0] == hashes[1] ? "yes" : "NO");
+        check(hashes[0] != 0 && hashes[0] == hashes[1], "the WAV fast path plays the decoder's samples");
+        removeTree(root);
+    }
+}
+
+// A gapless advance into a track at another rate: the end of the first
+// track has to play out before I2S and the codec are reclocked for the
+// second, so the ring must be empty whenever the I2S rate changes. The
+// last track is at 8 kHz, which needs 32-bit slots on both sides.
+static void benchRateChange() {
+    char root[] = "/tmp/musicbox-rate-XXXXXX";
+    if (!mkdtemp(root)) {
+        perror("mkdtemp");
+        exit(1);
+    }
+    std::string music = std::string(root) + "/Music";
+    mkdir(music.c_str(), 0755);
+    writeWav(music + "/1 - 44k.wav", 44100, 2, 16, 44100);
+    writeWav(music + "/2 - 48k.wav", 48000, 2, 16, 48000);
+    writeWav(music + "/3 - 8k.wav", 8000, 2, 16, 8000);
+    SD.setHostRoot(root);
+
+    // Leaked on purpose, like the gapless bench: its tasks outlive this call.
+    Serial.quiet = true;
+    AudioPlayer* player = new AudioPlayer();
+    player->begin();
+    player->startTasks();
+    std::atomic<int> changes{ 0 };
+    std::atomic<size_t> maxBuffered{ 0 };
+    fake_i2s_on_rate_change([&](i2s_port_t, uint32_t) {
+        size_t buffered = player->getOutputStats().bufferedFrames;
+        if (buffered > maxBuffered) maxBuffered = buffered;
+        changes++;
+    });
+    player->post(PlayerCommand::PLAY);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2700));
+    fake_i2s_on_rate_change(nullptr);
+    AudioOutputStats stats = player->getOutputStats();
+    DacClockPlan lowPlan = player->getDacClockPlan();
+    uint32_t lowSlots = fake_i2s_slot_bits(I2S_NUM_0);
+    player->post(PlayerCommand::PAUSE);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    Serial.quiet = false;
+
+    printf("\nTrack transitions 44.1 -> 48 -> 8 kHz (WAV)\n");
+    printf("%-28s %12d\n", "I2S rate changes", changes.load());
+    printf("%-28s %12u frames (%s)\n", "  ring at reclock, max", (unsigned)maxBuffered.load(),
+           maxBuffered == 0 ? "drained" : "WRONG");
+    printf("%-28s %12.1f ms over %u transition(s)\n", "gap for the drain", stats.lastGapUs / 1000.0,
+           (unsigned)stats.trackTransitions);
+    printf("%-28s %12u-bit slots, codec %u Hz %u-bit\n", "  8 kHz track", (unsigned)lowSlots,
+           (unsigned)lowPlan.sampleRate, (unsigned)lowPlan.wordBits);
+    check(changes > 0 && maxBuffered == 0, "the ring is empty whenever I2S is reclocked");
+    check(lowPlan.sampleRate == 8000 && lowPlan.wordBits == 32 && lowSlots == 32,
+          "an 8 kHz track runs I2S and the codec on 32-bit slots");
+    removeTree(root);
+}
+
+// A follower lends the output from loopTask while the decode task is
+// playing and the web server keeps posting controls: once lendOutput()
+// returns, nothing but the borrower may feed the ring.
+static void benchLendOutput() {
+    char root[] = "/tmp/musicbox-lend-XXXXXX";
+    if (!mkdtemp(root)) {
+        perror("mkdtemp");
+        exit(1);
+    }
+    std::string music = std::string(root) + "/Music";
+    mkdir(music.c_str(), 0755);
+    writeWav(music + "/1 - One.wav", 44100, 2, 16, 5 * 44100);
+    writeWav(music + "/2 - Two.wav", 44100, 2, 16, 5 * 44100);
+    SD.setHostRoot(root);
+
+    // Leaked on purpose, like the gapless bench: its tasks outlive this call.
+    Serial.quiet = true;
+    AudioPlayer* player = new AudioPlayer();
+    player->begin();
+    player->startTasks();
+    player->post(PlayerCommand::PLAY);
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    size_t before = player->getOutputStats().bufferedFrames;
+
+    std::atomic<bool> stop{ false };
+    std::thread web([&] {
+        while (!stop) {
+            player->post(PlayerCommand::NEXT);
+            player->post(PlayerCommand::PLAY);
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    });
+    AudioOutput& output = player->lendOutput();
+    size_t maxBuffered = 0;
+    for (int i = 0; i < 50; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        size_t buffered = output.getStats().bufferedFrames;
+        if (buffered > maxBuffered) maxBuffered = buffered;
+    }
+    stop = true;
+    web.join();
+    bool playing = player->getState().isPlaying;
+    Serial.quiet = false;
+
+    printf("\nLending the output mid-track\n");
+    printf("%-28s %12u frames\n", "ring before", (unsigned)before);
+    printf("%-28s %12u frames (%s)\n", "ring after, max", (unsigned)maxBuffered,
+           maxBuffered == 0 && !playing ? "let go" : "WRONG");
+    check(maxBuffered == 0 && !playing, "a lent output is fed by nothing else");
+    removeTree(root);
+}
+
+// Card bus time per second of 44.1 kHz 16-bit stereo WAV under the fake's
+// SPI model, for small unaligned reads (a decoder refill) against the
+// read-ahead's 16 KB blocks; then playback through the read-ahead while
+// another task serves a file off the same card in TCP-sized reads.
+static void benchSdReadAhead() {
+    char root[] = "/tmp/musicbox-sd-XXXXXX";
+    if (!mkdtemp(root)) {
+        perror("mkdtemp");
+        exit(1);
+    }
+    std::string music = std::string(root) + "/Music";
+    mkdir(music.c_str(), 0755);
+    const uint32_t rate = 44100;
+    const uint32_t seconds = 4;
+    writeWav(music + "/track.wav", rate, 2, 16, rate * seconds);
+    std::string payload(2 * 1024 * 1024, '\x55');
+    FILE* f = fopen((std::string(root) + "/served.bin").c_str(), "wb");
+    if (f) {
+        fwrite(payload.data(), 1, payload.size(), f);
+        fclose(f);
+    }
+    SD.setHostRoot(root);
+    fake_sd_set_command_us(300);
+
+    printf("\nSD reads for 1 s of 16-bit stereo WAV (300 us per command)\n");
+    printf("%-24s %8s %10s %12s %10s\n", "reads", "SPI", "commands", "bus time", "headroom");
+    size_t totals[2] = {};
+    for (uint32_t hz : { 4000000u, 20000000u }) {
+        SD.begin(45, SPI, hz);
+        for (int readAhead = 0; readAhead < 2; readAhead++) {
+            fake_sd_clear_stats();
+            size_t total = 0;
+            if (readAhead) {
+                SDReadAhead source;
+                source.open(SD, "/Music/track.wav");
+                static uint8_t buf[4096];
+                while (size_t n = source.read(buf, sizeof(buf))) total += n;
+                source.close();
+            } else {
+                File file = SD.open("/Music/track.wav");
+                static uint8_t buf[1600];
+                while (size_t n = file.read(buf, sizeof(buf))) total += n;
+            }
+            totals[readAhead] = total;
+            FakeSdStats sd = fake_sd_stats();
+            double perSecond = (double)total / (rate * 4);
+            double busMs = sd.busUs / 1000.0 / perSecond;
+            printf("%-24s %5u MHz %10.0f %9.1f ms %9.1fx\n",
+                   readAhead ? "read-ahead 16 KB blocks" : "1600-byte reads",
+                   (unsigned)(hz / 1000000), sd.commands / perSecond, busMs, 1000.0 / busMs);
+        }
+        check(totals[0] > 0 && totals[1] == totals[0], "the read-ahead returns the whole file");
+    }
+
+    // Leaked on purpose, like the gapless bench: its tasks outlive this call.
+    SD.begin(45, SPI, MUSICBOX_SD_SPI_HZ);
+    Serial.quiet = true;
+    AudioPlayer* player = new AudioPlayer();
+    player->begin();
+    player->startTasks();
+    AudioOutputStats before = player->getOutputStats();
+    player->post(PlayerCommand::PLAY);
+
+    std::atomic<bool> serving{true};
+    std::atomic<uint64_t> served{0};
+    std::thread http([&] {
+        File file = SD.open("/served.bin");
+        static uint8_t buf[1436];
+        while (serving) {
+            size_t n = file.read(buf, sizeof(buf));
+            if (n == 0) file.seek(0);
+            served += n;
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1000 * (seconds - 1)));
+    serving = false;
+    http.join();
+    AudioOutputStats after = player->getOutputStats();
+    SDReadStats sd = player->getSdReadStats();
+    player->post(PlayerCommand::PAUSE);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    Serial.quiet = false;
+
+    printf("\nWAV playback at %u MHz while serving a file\n", (unsigned)(MUSICBOX_SD_SPI_HZ / 1000000));
+    printf("%-28s %12.0f KB/s\n", "file served alongside", served / 1024.0 / (seconds - 1));
+    printf("%-28s %12u\n", "underruns", (unsigned)(after.underrunEvents - before.underrunEvents));
+    printf("%-28s %12u\n", "block reads", (unsigned)sd.blockReads);
+    printf("%-28s %12u (%.1f ms)\n", "read-ahead stalls", (unsigned)sd.stalls, sd.stallUs / 1000.0);
+    printf("%-28s %12.1f ms\n", "slowest block", sd.maxReadUs / 1000.0);
+    printf("%-28s", "block latency <1..<64,+ ms");
+    for (uint32_t bucket : sd.latency) printf(" %u", (unsigned)bucket);
+    printf("\n");
+
+    fake_sd_set_command_us(0);
+    removeTree(root);
+}
+
+// ----------------------------------------------------------------------------
+// Tagged files. Just enough ID3 and MPEG framing for TagReader; frame
+// bodies are zeros.
+// ----------------------------------------------------------------------------
+static void putBe(std::vector<uint8_t>& v, uint32_t x, int n) {
+    for (int i = n - 1; i >= 0; i--) v.push_back((uint8_t)(x >> (8 * i)));
+}
+
+static void putSyncsafe(std::vector<uint8_t>& v, uint32_t x) {
+    for (int i = 3; i >= 0; i--) v.push_back((uint8_t)((x >> (7 * i)) & 0x7F));
+}
+
+static std::vector<uint8_t> id3Frame(int version, const char* id, uint8_t encoding,
+                                     const std::string& text) {
+    std::vector<uint8_t> f(id, id + (version == 2 ? 3 : 4));
+    uint32_t size = (uint32_t)text.size() + 1;
+    if (version == 2) putBe(f, size, 3);
+    else if (version == 3) putBe(f, size, 4);
+    else putSyncsafe(f, size);
+    if (version != 2) f.insert(f.end(), { 0, 0 });
+    f.push_back(encoding);
+    f.insert(f.end(), text.begin(), text.end());
+    return f;
+}
+
+static std::vector<uint8_t> id3Tag(int version, const std::vector<std::vector<uint8_t>>& frames) {
+    std::vector<uint8_t> body;
+    for (const auto& f : frames) body.insert(body.end(), f.begin(), f.end());
+    body.resize(body.size() + 64);     // Padding
+    std::vector<uint8_t> tag = { 'I', 'D', '3', (uint8_t)version, 0, 0 };
+    putSyncsafe(tag, (uint32_t)body.size());
+    tag.insert(tag.end(), body.begin(), body.end());
+    return tag;
+}
+
+// MPEG1 Layer III 44.1 kHz joint stereo; b2 carries bitrate and padding:
+// 0x50 64 kbit/s (208 B), 0x90 128 kbit/s (417 B), 0xB0 192 kbit/s (626 B).
+static void mp3Frame(std::vector<uint8_t>& v, uint8_t b2) {
+    static const std::pair<uint8_t, size_t> lengths[] = { { 0x50, 208 }, { 0x90, 417 }, { 0xB0, 626 } };
+    size_t length = 0;
+    for (auto& l : lengths) {
+        if (l.first == (b2 & 0xF0)) length = l.second + ((b2 >> 1) & 1);
+    }
+    size_t at = v.size();
+    v.resize(at + length);
+    v[at] = 0xFF;
+    v[at + 1] = 0xFB;
+    v[at + 2] = b2;
+    v[at + 3] = 0x64;
+}
+
+static void writeBytes(const std::string& path, const std::vector<uint8_t>& data) {
+    FILE* f = fopen(path.c_str(), "wb");
+    if (!f) return;
+    fwrite(data.data(), 1, data.size(), f);
+    fclose(f);
+}
+
+struct TagCase {
+    const char* name;
+    const char* title;
+    const char* artist;
+    const char* album;
+    uint32_t durationMs;
+};
+
+// One file per tag flavour TagReader handles, under dir. Returns what each
+// should read as.
+static std::vector<TagCase> writeTaggedFiles(const std::string& dir, int copy) {
+    std::vector<TagCase> cases;
+    char name[96];
+    auto path = [&](const char* stem, const char* ext) {
+        snprintf(name, sizeof(name), "%s/%03d %s.%s", dir.c_str(), copy, stem, ext);
+        return std::string(name);
+    };
+
+    // ID3v2.3, Latin-1, Xing header counting 1000 frames.
+    {
+        std::vector<uint8_t> f = id3Tag(3, { id3Frame(3, "TIT2", 0, "Caf\xE9 Song"),
+                                             id3Frame(3, "TPE1", 0, "The Artists"),
+                                             id3Frame(3, "TALB", 0, "First Album") });
+        size_t xing = f.size() + 36;
+        mp3Frame(f, 0x90);
+        memcpy(&f[xing], "Xing", 4);
+        f[xing + 7] = 0x0F;
+        f[xing + 10] = 1000 >> 8;
+        f[xing + 11] = 1000 & 0xFF;
+        for (int i = 0; i < 50; i++) mp3Frame(f, 0x92);
+        writeBytes(path("xing", "mp3"), f);
+        cases.push_back({ "ID3v2.3 Latin-1 + Xing", "Caf\xC3\xA9 Song", "The Artists", "First Album", 26122 });
+    }
+    // ID3v2.4, UTF-8, CBR without a header: 128 kbit/s with the padding
+    // pattern of a real encoder.
+    {
+        std::vector<uint8_t> f = id3Tag(4, { id3Frame(4, "TIT2", 3, "\xC3\x9Cnic\xC3\xB6" "de \xE2\x9C\x93"),
+                                             id3Frame(4, "TPE1", 3, "The Artists"),
+                                             id3Frame(4, "TALB", 3, "First Album") });
+        for (int i = 0; i < 2000; i++) mp3Frame(f, i % 24 == 0 ? 0x90 : 0x92);
+        writeBytes(path("cbr", "mp3"), f);
+        cases.push_back({ "ID3v2.4 UTF-8, CBR scan", "\xC3\x9Cnic\xC3\xB6" "de \xE2\x9C\x93", "The Artists",
+                          "First Album", 52245 });
+    }
+    // ID3v2.3 UTF-16 with a surrogate pair, album from ID3v1, VBR without a
+    // header.
+    {
+        std::string utf16 = { '\xFF', '\xFE', 'N', 0, 'o', 0, 't', 0, 'e', 0, ' ', 0,
+                              '\x3C', '\xD8', '\xB5', '\xDF' };
+        std::string artist = { '\xFF', '\xFE', 'V', 0, 'B', 0, 'R', 0 };
+        std::vector<uint8_t> f = id3Tag(3, { id3Frame(3, "TIT2", 1, utf16),
+                                             id3Frame(3, "TPE1", 1, artist) });
+        const uint8_t rates[] = { 0x90, 0xB0, 0x50, 0x92, 0xB2 };
+        for (int i = 0; i < 300; i++) mp3Frame(f, rates[i % 5]);
+        std::vector<uint8_t> v1(128, 0);
+        memcpy(&v1[0], "TAG", 3);
+        memcpy(&v1[3], "Ignored Title", 13);
+        memcpy(&v1[63], "Old Album", 9);
+        f.insert(f.end(), v1.begin(), v1.end());
+        writeBytes(path("vbr", "mp3"), f);
+        cases.push_back({ "ID3v2.3 UTF-16 + v1, VBR", "Note \xF0\x9F\x8E\xB5", "VBR", "Old Album", 7836 });
+    }
+    // ID3v2.2 with a VBRI header counting 500 frames.
+    {
+        std::vector<uint8_t> f = id3Tag(2, { id3Frame(2, "TT2", 0, "Old Tag"),
+                                             id3Frame(2, "TP1", 0, "Someone"),
+                                             id3Frame(2, "TAL", 0, "Second Album") });
+        size_t vbri = f.size() + 36;
+        mp3Frame(f, 0x90);
+        memcpy(&f[vbri], "VBRI", 4);
+        f[vbri + 5] = 1;
+        f[vbri + 16] = 500 >> 8;
+        f[vbri + 17] = 500 & 0xFF;
+        for (int i = 0; i < 20; i++) mp3Frame(f, 0xB0);
+        writeBytes(path("vbri", "mp3"), f);
+        cases.push_back({ "ID3v2.2 + VBRI", "Old Tag", "Someone", "Second Album", 13061 });
+    }
+    // WAV with LIST/INFO after the data.
+    {
+        std::string wav = path("info", "wav");
+        writeWav(wav, 44100, 2, 16, 44100 * 2);
+        std::vector<uint8_t> info = { 'L', 'I', 'S', 'T', 0, 0, 0, 0, 'I', 'N', 'F', 'O' };
+        auto sub = [&](const char* id, const char* text) {
+            uint32_t n = (uint32_t)strlen(text) + 1;
+            info.insert(info.end(), id, id + 4);
+            for (int i = 0; i < 4; i++) info.push_back((uint8_t)(n >> (8 * i)));
+            info.insert(info.end(), text, text + n);
+            if (n & 1) info.push_back(0);
+        };
+        sub("INAM", "Wave Title");
+        sub("IART", "Wave Artist");
+        sub("IPRD", "Wave Album");
+        uint32_t listSize = (uint32_t)info.size() - 8;
+        for (int i = 0; i < 4; i++) info[4 + i] = (uint8_t)(listSize >> (8 * i));
+        FILE* fp = fopen(wav.c_str(), "ab");
+        if (fp) {
+            fwrite(info.data(), 1, info.size(), fp);
+            fclose(fp);
+        }
+        cases.push_back({ "WAV LIST/INFO", "Wave Title", "Wave Artist", "Wave Album", 2000 });
+    }
+    // No tag at all, CBR 64 kbit/s.
+    {
+        std::vector<uint8_t> f;
+        for (int i = 0; i < 100; i++) mp3Frame(f, 0x50);
+        writeBytes(path("plain", "mp3"), f);
+        cases.push_back({ "untagged CBR", "", "", "", 2612 });
+    }
+    return cases;
+}
+
+// Tag parsing against the expected values, then the indexer over a library
+// under the SD bus model: first pass, a reboot that reads the card cache,
+// and the metadata listing the API serves.
+static void benchMetadataIndex(int copies) {
+    char root[] = "/tmp/musicbox-meta-XXXXXX";
+    if (!mkdtemp(root)) {
+        perror("mkdtemp");
+        exit(1);
+    }
+    std::string music = std::string(root) + "/Music";
+    mkdir(music.c_str(), 0755);
+    std::vector<TagCase> cases;
+    for (int i = 0; i < copies; i++) cases = writeTaggedFiles(music, i);
+    SD.setHostRoot(root);
+
+    printf("\nTag reading (%s)\n", "TagReader::read");
+    int wrong = 0;
+    for (size_t i = 0; i < cases.size(); i++) {
+        const TagCase& c = cases[i];
+        static const char* stems[] = { "xing.mp3", "cbr.mp3", "vbr.mp3", "vbri.mp3", "info.wav", "plain.mp3" };
+        char path[96];
+        snprintf(path, sizeof(path), "/Music/000 %s", stems[i]);
+        TrackTags tags;
+        bool ok = TagReader::read(SD, path, tags);
+        uint32_t tolerance = c.durationMs / 100;
+        uint32_t error = tags.durationMs > c.durationMs ? tags.durationMs - c.durationMs
+                                                        : c.durationMs - tags.durationMs;
+        ok = ok && strcmp(tags.title, c.title) == 0 && strcmp(tags.artist, c.artist) == 0 &&
+             strcmp(tags.album, c.album) == 0 && error <= tolerance;
+        if (!ok) wrong++;
+        printf("%-28s %-4s %6u ms (want %u) \"%s\" / \"%s\" / \"%s\"\n", c.name, ok ? "ok" : "FAIL",
+               (unsigned)tags.durationMs, (unsigned)c.durationMs, tags.title, tags.artist, tags.album);
+    }
+    printf("%-28s %12d\n", "mismatches", wrong);
+    check(wrong == 0, "tags and durations match what was written");
+
+    // Sizes that wrap a 32-bit offset back onto the same frame or item.
+    std::vector<uint8_t> badId3 = { 'I', 'D', '3', 3, 0, 0, 0, 0, 0, 100,
+                                    'T', 'X', 'X', 'X', 0xFF, 0xFF, 0xFF, 0xF6, 0, 0 };
+    badId3.resize(200);
+    std::vector<uint8_t> badInfo = { 'R', 'I', 'F', 'F', 192, 0, 0, 0, 'W', 'A', 'V', 'E',
+                                     'L', 'I', 'S', 'T', 100, 0, 0, 0, 'I', 'N', 'F', 'O',
+                                     'I', 'S', 'F', 'T', 0xF8, 0xFF, 0xFF, 0xFF };
+    badInfo.resize(200);
+    writeBytes(std::string(root) + "/wrap id3.mp3", badId3);
+    writeBytes(std::string(root) + "/wrap info.wav", badInfo);
+    std::atomic<bool> corruptDone{ false };
+    std::thread([&corruptDone] {
+        TrackTags tags;
+        TagReader::read(SD, "/wrap id3.mp3", tags);
+        TagReader::read(SD, "/wrap info.wav", tags);
+        corruptDone = true;
+    }).detach();
+    for (int ms = 0; ms < 2000 && !corruptDone; ms++) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    printf("%-28s %12s\n", "wrapping sizes", corruptDone ? "stopped" : "HANG");
+    if (!corruptDone) exit(1);
+    unlink((std::string(root) + "/wrap id3.mp3").c_str());
+    unlink((std::string(root) + "/wrap info.wav").c_str());
+
+    fake_sd_set_command_us(300);
+    Serial.quiet = true;
+    SDPlaylist playlist;
+    playlist.begin();
+    int tracks = playlist.getTrackCount();
+
+    // Leaked on purpose: the indexer task may outlive a stack object.
+    MetadataIndex* index = new MetadataIndex();
+    fake_sd_clear_stats();
+    auto start = std::chrono::steady_clock::now();
+    index->begin(&playlist);
+    index->startIndexer();
+    while (!index->isComplete() || index->isIndexing()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    double firstMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    FakeSdStats firstSd = fake_sd_stats();
+
+    MetadataIndex* reboot = new MetadataIndex();
+    fake_sd_clear_stats();
+    start = std::chrono::steady_clock::now();
+    reboot->begin(&playlist);
+    double cacheMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    FakeSdStats cacheSd = fake_sd_stats();
+    int cached = reboot->indexedCount();
+
+    int same = 0;
+    for (int i = 0; i < tracks; i++) {
+        const TrackMeta* a = index->get(i);
+        const TrackMeta* b = reboot->get(i);
+        same += a && b && strcmp(a->title, b->title) == 0 && strcmp(a->artist, b->artist) == 0 &&
+                strcmp(a->album, b->album) == 0 && a->durationMs == b->durationMs;
+    }
+
+    // The listing itself opens nothing.
+    fake_sd_clear_stats();
+    std::string body;
+    Sample listing = measure(50, [&] {
+        body.clear();
+        PlaylistJsonStream stream(playlist.getTitles(), tracks, 0, playlist.getVersion(), reboot);
+        uint8_t buf[1436];
+        while (size_t n = stream.fill(buf, sizeof(buf))) body.append((const char*)buf, n);
+    });
+    FakeSdStats listingSd = fake_sd_stats();
+    Sample titles = measure(50, [&] {
+        PlaylistJsonStream stream(playlist.getTitles(), tracks, 0, playlist.getVersion());
+        uint8_t buf[1436];
+        while (stream.fill(buf, sizeof(buf)) > 0) {}
+    });
+
+    // Tag fields rank too: "caf" is the first title word, "artists" the artist.
+    SearchIndex search;
+    search.build(playlist.getTitles(), reboot);
+    SearchHit hits[SEARCH_MAX_RESULTS];
+    int tagHits = search.search("artists caf", hits, SEARCH_MAX_RESULTS);
+    int tagScore = tagHits > 0 ? hits[0].score : 0;
+
+    // One file edited in place: the index still matches by name, so only
+    // the refreshing load behind POST /api/library notices it, and then
+    // only that file is read again.
+    std::string edited = music + "/000 cbr.mp3";
+    FILE* f = fopen(edited.c_str(), "ab");
+    if (f) {
+        fputc(0, f);
+        fclose(f);
+    }
+    playlist.load(true);
+    MetadataIndex* touched = new MetadataIndex();
+    touched->begin(&playlist);
+    int stale = playlist.getTrackCount() - touched->indexedCount();
+    Serial.quiet = false;
+
+    printf("\nMetadata index over %d files (300 us per SD command)\n", tracks);
+    printf("%-28s %10.0f ms %8.1f ms/file (incl. %u ms gap)\n", "first pass, background",
+           firstMs, firstMs / tracks, (unsigned)10);
+    printf("%-28s %10.1f cmds %6.1f ms bus per file\n", "  card traffic",
+           (double)firstSd.commands / tracks, firstSd.busUs / 1000.0 / tracks);
+    printf("%-28s %10.1f ms %8u commands, %d/%d entries\n", "reboot from cache", cacheMs,
+           (unsigned)cacheSd.commands, cached, tracks);
+    printf("%-28s %12d of %d\n", "  identical to first pass", same, tracks);
+    printf("%-28s %12d\n", "  stale after 1 file edit", stale);
+    printf("%-28s %12u bytes (%.1f per track)\n", "index memory", (unsigned)reboot->bytesUsed(),
+           (double)reboot->bytesUsed() / tracks);
+    report("playlist JSON + metadata", listing);
+    report("playlist JSON titles only", titles);
+    printf("%-28s %12d hits, top score %d\n", "search \"artists caf\"", tagHits, tagScore);
+    printf("%-28s %12u commands, %u bytes\n", "  card traffic, body", (unsigned)listingSd.commands,
+           (unsigned)body.size());
+    size_t item = body.find("{\"title\"");
+    printf("  %s\n", body.substr(item, body.find('}', item) + 1 - item).c_str());
+    check(cached == tracks && same == tracks, "a reboot reads the same metadata back from the card cache");
+    check(stale == 1, "an edited file is the only one read again");
+    check(listingSd.commands == 0, "the metadata listing stays off the card");
+    check(tagHits > 0, "search matches tag fields");
+
+    fake_sd_set_command_us(0);
+    removeTree(root);
+}
+
+// Titles in the "Artist - Title" form most rips use, from a skewed word
+// list so that some words are everywhere and most are rare.
+static void makeTitleCorpus(TrackArena& arena, int tracks) {
+    static const char* words[] = {
+        "love", "night", "heart", "baby", "time", "christmas", "snow", "winter", "home", "dream",
+        "light", "fire", "rain", "blue", "dance", "holy", "silent", "bells", "jingle", "merry",
+        "little", "star", "angel", "song", "road", "river", "summer", "girl", "boy", "world",
+        "white", "deck", "halls", "sleigh", "ride", "rock", "around", "tree", "frosty", "rudolph",
+        "santa", "coming", "town", "wonderful", "feliz", "navidad", "caf\xC3\xA9", "d\xC3\xA9j\xC3\xA0", "vu", "don't",
+        "stop", "believing", "hotel", "california", "yesterday", "imagine", "purple", "haze", "smells",
+        "teen", "spirit", "billie", "jean", "thriller", "bohemian", "rhapsody", "hey", "jude", "let",
+        "it", "be", "help", "wonderwall", "creep", "zombie", "torn", "iris", "clocks", "yellow",
+    };
+    static const char* artists[] = {
+        "The Beatles", "Mariah Carey", "Wham!", "Bing Crosby", "Nat King Cole", "Queen",
+        "Michael Jackson", "Nirvana", "Oasis", "Radiohead", "The Cranberries", "Coldplay",
+        "Jos\xC3\xA9 Feliciano", "Brenda Lee", "Bobby Helms", "Andy Williams", "Band Aid",
+        "The Pogues", "Ella Fitzgerald", "Frank Sinatra",
+    };
+    std::mt19937 rng(42);
+    const int wordCount = sizeof(words) / sizeof(words[0]);
+    auto pickWord = [&] {
+        // Squaring skews the choice toward the front of the list.
+        double u = std::uniform_real_distribution<double>(0, 1)(rng);
+        return words[(int)(u * u * wordCount)];
+    };
+
+    for (int i = 0; i < tracks; i++) {
+        std::string path = "/Music/";
+        path += artists[rng() % (sizeof(artists) / sizeof(artists[0]))];
+        path += " - ";
+        int n = 2 + (int)(rng() % 4);
+        for (int w = 0; w < n; w++) {
+            if (w) path += ' ';
+            std::string word = pickWord();
+            if (w == 0) word[0] = (char)toupper(word[0]);
+            path += word;
+        }
+        char suffix[16];
+        snprintf(suffix, sizeof(suffix), " %d.mp3", i);
+        path += suffix;
+        arena.add(path.c_str(), TrackInfo{ 0, 0 });
+    }
+}
+
+// Case-folded substring test per title: what a search without an index
+// would do.
+static int linearSearch(const TrackArena& arena, const char* query, SearchHit* hits, int maxHits) {
+    std::string q(query);
+    for (char& c : q) c = (char)tolower((uint8_t)c);
+    int total = 0;
+    char folded[256];
+    for (int i = 0; i < arena.count(); i++) {
+        std::string_view title = arena.title(i);
+        size_t n = title.size() < sizeof(folded) - 1 ? title.size() : sizeof(folded) - 1;
+        for (size_t j = 0; j < n; j++) folded[j] = (char)tolower((uint8_t)title[j]);
+        folded[n] = '\0';
+        if (strstr(folded, q.c_str()) != nullptr) {
+            if (total < maxHits) hits[total] = SearchHit{ i, 1 };
+            total++;
+        }
+    }
+    return total;
+}
+
+static void benchSearch(int tracks) {
+    TrackArena arena;
+    makeTitleCorpus(arena, tracks);
+
+    SearchIndex index;
+    index.build(arena.titles(), nullptr);
+    printf("\nSearch over %d synthetic titles\n", tracks);
+    printf("%-28s %12.2f ms\n", "index build", index.buildMicros() / 1000.0);
+    printf("%-28s %12u bytes (%.1f per track), %d words, %u postings\n", "index memory",
+           (unsigned)index.bytesUsed(), (double)index.bytesUsed() / tracks, index.wordCount(),
+           (unsigned)index.postingCount());
+    printf("%-28s %12u bytes\n", "  playlist itself", (unsigned)arena.bytesUsed());
+
+    SearchHit hits[SEARCH_MAX_RESULTS];
+    for (const char* query : { "s", "chr", "love", "the beatles", "silent night", "cafe", "deja vu",
+                               "dont", "jose feliciano", "xyzzy" }) {
+        int total = 0;
+        Sample indexed = measure(200, [&] { total = index.search(query, hits, 20); });
+        int linearTotal = 0;
+        Sample linear = measure(20, [&] { linearTotal = linearSearch(arena, query, hits, 20); });
+        char label[40];
+        snprintf(label, sizeof(label), "  \"%s\"", query);
+        printf("%-28s %9.1f us %6d hits   linear scan %9.1f us %6d hits\n", label, indexed.usPerOp,
+               total, linear.usPerOp, linearTotal);
+    }
+
+    // Ranking and normalization on a handful of known titles.
+    TrackArena small;
+    for (const char* path : { "/Music/Night Train.mp3", "/Music/Silent Night.mp3",
+                              "/Music/Nightingale.mp3", "/Music/Caf\xC3\xA9 del Mar.mp3",
+                              "/Music/Don't Stop Me Now.mp3", "/Music/Stop.mp3" }) {
+        small.add(path, TrackInfo{ 0, 0 });
+    }
+    SearchIndex ranked;
+    ranked.build(small.titles(), nullptr);
+    struct Expect { const char* query; std::vector<int> order; };
+    int wrong = 0;
+    for (const Expect& e : { Expect{ "night", { 0, 2, 1 } }, Expect{ "NIGHT si", { 1 } },
+                             Expect{ "cafe", { 3 } }, Expect{ "don", { 4 } },
+                             Expect{ "stop", { 5, 4 } }, Expect{ "trains", {} } }) {
+        int total = ranked.search(e.query, hits, SEARCH_MAX_RESULTS);
+        bool ok = total == (int)e.order.size();
+        for (int i = 0; ok && i < total; i++) ok = hits[i].index == e.order[i];
+        if (!ok) {
+            wrong++;
+            printf("  ranking \"%s\": got", e.query);
+            for (int i = 0; i < total; i++) printf(" %d", hits[i].index);
+            printf("\n");
+        }
+    }
+    printf("%-28s %12d\n", "ranking mismatches", wrong);
+    check(wrong == 0, "search ranks and normalizes known titles as expected");
+}
+
+// Shuffle order checks: every cycle of a 10k-track order plays each track
+// once, previous() walks the exact history back across a cycle boundary,
+// and no track plays twice in a row where cycles meet.
+static void benchShuffle(uint32_t tracks, int cycles) {
+    printf("\nShuffle order over %u tracks, %d cycles x 8 seeds\n", (unsigned)tracks, cycles);
+
+    int repeats = 0;
+    int missing = 0;
+    int backToBack = 0;
+    int historyWrong = 0;
+    int startWrong = 0;
+    int sequential = 0;
+    std::vector<uint32_t> seen(tracks);
+    std::vector<uint32_t> played;
+    for (uint32_t seed = 1; seed <= 8; seed++) {
+        ShuffleOrder order;
+        uint32_t first = (seed * 7919) % tracks;
+        order.reset(tracks, seed * 0x6F4F2A35u, first);
+        if (order.current() != first) startWrong++;
+
+        std::fill(seen.begin(), seen.end(), 0);
+        played.clear();
+        uint32_t last = UINT32_MAX;
+        for (int c = 1; c <= cycles; c++) {
+            for (uint32_t i = 0; i < tracks; i++) {
+                uint32_t track = i == 0 && c == 1 ? order.current() : order.next();
+                if (track == last) backToBack++;
+                if (track == last + 1) sequential++;
+                if (seen[track] == (uint32_t)c) repeats++;
+                seen[track] = c;
+                played.push_back(track);
+                last = track;
+            }
+            for (uint32_t t = 0; t < tracks; t++) {
+                if (seen[t] != (uint32_t)c) missing++;
+            }
+        }
+
+        // Back through the end of the last cycle and into the one before.
+        for (size_t i = played.size() - 1; i > played.size() - tracks - 10; i--) {
+            if (order.current() != played[i]) historyWrong++;
+            order.previous();
+        }
+        // And forward again over the same tracks.
+        for (size_t i = played.size() - tracks - 10; i < played.size(); i++) {
+            if (order.current() != played[i]) historyWrong++;
+            if (i + 1 < played.size() && order.peekNext() != played[i + 1]) historyWrong++;
+            order.next();
+        }
+    }
+    printf("%-28s %12d\n", "repeats within a cycle", repeats);
+    printf("%-28s %12d\n", "tracks missing from a cycle", missing);
+    printf("%-28s %12d\n", "same track twice in a row", backToBack);
+    printf("%-28s %12d\n", "history mismatches", historyWrong);
+    printf("%-28s %12d\n", "wrong first track", startWrong);
+    // A fair shuffle steps to the next track up about once per cycle.
+    printf("%-28s %12.2f\n", "in-order steps per cycle", (double)sequential / (8 * cycles));
+    check(repeats == 0 && missing == 0, "every shuffle cycle plays each track once");
+    check(backToBack == 0, "no track plays twice in a row where cycles meet");
+    check(historyWrong == 0, "previous() and next() retrace the shuffle history");
+    check(startWrong == 0, "a shuffle starts at the requested track");
+
+    // Tiny and odd sizes, where the Feistel domain is mostly cycle-walked.
+    int smallWrong = 0;
+    for (uint32_t n : { 1u, 2u, 3u, 5u, 17u, 1000u, 65537u }) {
+        ShuffleOrder order;
+        order.reset(n, n * 31u, n - 1);
+        std::vector<uint8_t> hit(n);
+        for (int c = 0; c < 3; c++) {
+            std::fill(hit.begin(), hit.end(), 0);
+            for (uint32_t i = 0; i < n; i++) {
+                uint32_t track = i == 0 && c == 0 ? order.current() : order.next();
+                if (track >= n || hit[track]) smallWrong++;
+                else hit[track] = 1;
+            }
+        }
+    }
+    printf("%-28s %12d\n", "small-size mismatches", smallWrong);
+    check(smallWrong == 0, "small shuffle orders are permutations");
+
+    ShuffleOrder order;
+    order.reset(tracks, 12345, 0);
+    volatile uint32_t sink = 0;
+    report("ShuffleOrder::next()", measure(100000, [&] { sink = sink + order.next(); }));
+    report("ShuffleOrder::previous()", measure(100000, [&] { sink = sink + order.previous(); }));
+    printf("%-28s %12u bytes\n", "order memory", (unsigned)sizeof(ShuffleOrder));
+}
+
+// Saved playlists: a 1000-entry playlist loads without per-entry
+// allocation, survives the library changing under it, and an M3U with
+// the usual variations resolves to the right tracks.
+static void benchPlaylists(int tracks) {
+    std::string root = makeTree(tracks, 64);
+    SD.setHostRoot(root.c_str());
+    Serial.quiet = true;
+    SDPlaylist library;
+    library.begin();
+    PlaylistStore store;
+    store.begin(&library);
+    printf("\nSaved playlists over a %d-track library\n", library.getTrackCount());
+
+    std::mt19937 rng(7);
+    std::vector<uint32_t> saved(1000);
+    for (uint32_t& track : saved) track = rng() % library.getTrackCount();
+    std::vector<std::string> savedPaths;
+    for (uint32_t track : saved) savedPaths.push_back(library.getTrack(track));
+
+    report("save 1000 entries", measure(20, [&] { store.save("Party Mix", saved.data(), saved.size()); }));
+    struct stat st;
+    stat((root + "/.playlists/Party Mix.mbpl").c_str(), &st);
+    printf("%-28s %12ld bytes\n", "  file size", (long)st.st_size);
+
+    TrackList list;
+    report("load 1000 entries", measure(100, [&] { store.load("Party Mix", list); }));
+    // File handles cost the same few allocations whatever the length.
+    store.save("Short", saved.data(), 10);
+    report("load 10 entries", measure(100, [&] { store.load("Short", list); }));
+    store.remove("Short");
+    store.load("Party Mix", list);
+    int wrong = list.count() != (int)saved.size();
+    for (int i = 0; !wrong && i < list.count(); i++) wrong += list[i] != saved[i];
+
+    // Drop every tenth file, add new ones and rescan: indices move.
+    int removed = 0;
+    for (int i = 0; i < tracks; i += 10) {
+        char name[96];
+        snprintf(name, sizeof(name), "%s/Music/%05d - Synthetic Holiday Track.mp3", root.c_str(), i);
+        removed += unlink(name) == 0;
+    }
+    for (int i = 0; i < 50; i++) {
+        char name[96];
+        snprintf(name, sizeof(name), "%s/Music/%05d - Added Later.mp3", root.c_str(), i);
+        FILE* f = fopen(name, "wb");
+        if (f) fclose(f);
+    }
+    library.begin();
+    int missing = 0;
+    int expectMissing = 0;
+    for (const std::string& path : savedPaths) {
+        struct stat ps;
+        expectMissing += stat((root + path).c_str(), &ps) != 0;
+    }
+    Sample remap = measure(20, [&] { store.load("Party Mix", list, &missing); });
+    int remapWrong = missing != expectMissing || list.count() != (int)saved.size() - expectMissing;
+    for (int i = 0, j = 0; !remapWrong && i < (int)saved.size(); i++) {
+        struct stat ps;
+        if (stat((root + savedPaths[i]).c_str(), &ps) != 0) continue;
+        remapWrong += savedPaths[i] != library.getTrack(list[j++]);
+    }
+    report("load after library change", remap);
+    printf("%-28s %12d (%d files removed, %d entries gone)\n", "wrong entries", wrong + remapWrong,
+           removed, missing);
+    check(wrong == 0, "a saved playlist loads back as saved");
+    check(remapWrong == 0, "a saved playlist follows its files through a rescan");
+
+    // M3U: absolute, relative, Windows separators, other case, comments,
+    // a BOM, CRLF, one missing file and one line too long.
+    std::string m3u = "\xEF\xBB\xBF#EXTM3U\r\n"
+                      "#EXTINF:123,Artist - Title\r\n"
+                      "/Music/00001 - Synthetic Holiday Track.mp3\r\n"
+                      "00002 - Synthetic Holiday Track.mp3\r\n"
+                      "..\\Music\\00003 - synthetic holiday track.MP3\r\n"
+                      "\r\n"
+                      "./00004 - Synthetic Holiday Track.mp3\r\n"
+                      "file:///Music/00005 - Synthetic Holiday Track.mp3\r\n"
+                      "/Music/Not There.mp3\r\n" + std::string(300, 'x') + "\r\n"
+                      "00001 - Added Later.mp3";
+    writeBytes(root + "/Music/party.m3u", std::vector<uint8_t>(m3u.begin(), m3u.end()));
+    int m3uMissing = 0;
+    bool imported = store.importM3u("/Music/party.m3u", "Imported", list, &m3uMissing);
+    const char* want[] = { "/Music/00001 - Synthetic Holiday Track.mp3", "/Music/00002 - Synthetic Holiday Track.mp3",
+                           "/Music/00003 - Synthetic Holiday Track.mp3", "/Music/00004 - Synthetic Holiday Track.mp3",
+                           "/Music/00005 - Synthetic Holiday Track.mp3", "/Music/00001 - Added Later.mp3" };
+    int m3uWrong = !imported || list.count() != 6 || m3uMissing != 2;
+    for (int i = 0; !m3uWrong && i < 6; i++) m3uWrong += strcmp(library.getTrack(list[i]), want[i]) != 0;
+    TrackList reloaded;
+    m3uWrong += !store.load("Imported", reloaded) || reloaded.count() != list.count();
+    printf("%-28s %12d (%d tracks, %d unresolved lines)\n", "M3U import mismatches", m3uWrong, list.count(),
+           m3uMissing);
+    check(m3uWrong == 0, "M3U import resolves the expected tracks");
+
+    PlaylistSummary summaries[8];
+    int listed = store.list(summaries, 8);
+    printf("%-28s %12d", "saved playlists", listed);
+    for (int i = 0; i < listed; i++) printf(" \"%s\":%d", summaries[i].name, summaries[i].count);
+    printf("\n");
+
+    PlayQueue queue;
+    report("queue 1000 + drain", measure(100, [&] {
+        queue.append(saved.data(), saved.size());
+        uint32_t track;
+        while (queue.pop(track)) {}
+    }));
+    removeTree(root);
+}
+
+// Reference walk for benchFolderWalk(): plain recursion over the host
+// tree, same order and rules as FolderWalker.
+static void referenceWalk(const std::string& hostRoot, const std::string& folder, int depth,
+                          const std::vector<std::string>& excludeNames, const std::vector<std::string>& excludePaths,
+                          std::vector<std::string>& out) {
+    DIR* dir = opendir((hostRoot + folder).c_str());
+    if (dir == nullptr) return;
+    std::vector<std::string> folders;
+    while (struct dirent* ent = readdir(dir)) {
+        std::string name = ent->d_name;
+        if (name == "." || name == "..") continue;
+        std::string path = (folder == "/" ? "" : folder) + "/" + name;
+        struct stat st;
+        stat((hostRoot + path).c_str(), &st);
+        if (S_ISDIR(st.st_mode)) {
+            bool skip = name[0] == '.' || depth + 1 > SCAN_MAX_DEPTH;
+            for (const std::string& e : excludeNames) skip |= strcasecmp(e.c_str(), name.c_str()) == 0;
+            for (const std::string& e : excludePaths) skip |= strcasecmp(e.c_str(), path.c_str()) == 0;
+            if (!skip) folders.push_back(path);
+        } else if (name[0] != '.' && name.size() >= 4 &&
+                   (strcasecmp(name.c_str() + name.size() - 4, ".mp3") == 0 ||
+                    strcasecmp(name.c_str() + name.size() - 4, ".wav") == 0)) {
+            out.push_back(path);
+        }
+    }
+    closedir(dir);
+    for (const std::string& f : folders) referenceWalk(hostRoot, f, depth + 1, excludeNames, excludePaths, out);
+}
+
+class ScanProgressCounter : public LibraryListener {
+public:
+    int events = 0;
+    int whileReading = 0;
+    ScanProgress last = {};
+    void onScanProgress(const ScanProgress& progress) override {
+        events++;
+        whileReading += progress.scanning && progress.reading;
+        last = progress;
+    }
+};
+
+// Library scan over a wide and deep card: 600 artist folders, a folder
+// chain deeper than the walker goes, hidden and excluded folders. The
+// track list must match a plain recursive walk, with one handle open at a
+// time and progress reported along the way.
+static void benchFolderWalk() {
+    char rootBuf[] = "/tmp/musicbox-walk-XXXXXX";
+    if (!mkdtemp(rootBuf)) {
+        perror("mkdtemp");
+        exit(1);
+    }
+    std::string root = rootBuf;
+    auto touch = [&](const std::string& path) {
+        FILE* f = fopen((root + path).c_str(), "wb");
+        if (f) fclose(f);
+    };
+    auto folder = [&](const std::string& path) { mkdir((root + path).c_str(), 0755); };
+
+    touch("/Root Song.mp3");
+    touch("/notes.txt");
+    folder("/Music");
+    for (int a = 0; a < 600; a++) {
+        char artist[64];
+        snprintf(artist, sizeof(artist), "/Music/Artist %03d", a);
+        folder(artist);
+        for (int b = 0; b < 2; b++) {
+            std::string album = std::string(artist) + "/Album " + std::to_string(b);
+            folder(album);
+            for (int t = 0; t < 3; t++) touch(album + "/Track " + std::to_string(t) + (t == 2 ? ".WAV" : ".mp3"));
+            touch(album + "/cover.jpg");
+        }
+    }
+    std::string deep = "/Deep";
+    folder(deep);
+    for (int level = 1; level <= 20; level++) {
+        deep += "/L" + std::to_string(level);
+        folder(deep);
+        touch(deep + "/level.mp3");
+    }
+    folder("/.hidden");
+    touch("/.hidden/hidden.mp3");
+    folder("/System Volume Information");
+    touch("/System Volume Information/x.mp3");
+    folder("/Podcasts");
+    touch("/Podcasts/p.mp3");
+    folder("/Podcasts/Old");
+    touch("/Podcasts/Old/o.mp3");
+
+    SD.setHostRoot(root.c_str());
+    fake_sd_set_command_us(0);
+    Serial.quiet = true;
+    printf("\nLibrary scan: 600 artist folders, a 20-level chain, hidden/excluded folders\n");
+
+    struct Case { const char* include; const char* exclude; };
+    for (const Case& c : { Case{ MUSICBOX_SCAN_INCLUDE, MUSICBOX_SCAN_EXCLUDE },
+                           Case{ "/Music/Artist 007, /Podcasts", "/Podcasts/Old" },
+                           Case{ "/Music, /Music/Artist 001", "Album 1" } }) {
+        SDPlaylist library;
+        library.setScanFolders(c.include, c.exclude);
+        ScanProgressCounter progress;
+        library.setListener(&progress);
+        library.invalidateIndex();
+        fake_sd_clear_stats();
+        uint32_t alreadyOpen = fake_sd_stats().openFiles;
+        auto start = std::chrono::steady_clock::now();
+        library.begin();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        FakeSdStats sd = fake_sd_stats();
+
+        std::vector<std::string> excludeNames, excludePaths, expected;
+        for (const char* list = c.exclude; *list; ) {
+            const char* end = strchr(list, ',');
+            if (end == nullptr) end = list + strlen(list);
+            std::string e(list, end - list);
+            e.erase(0, e.find_first_not_of(' '));
+            (e[0] == '/' ? excludePaths : excludeNames).push_back(e);
+            list = *end ? end + 1 : end;
+        }
+        std::vector<std::string> roots;
+        for (const char* list = c.include; *list; ) {
+            const char* end = strchr(list, ',');
+            if (end == nullptr) end = list + strlen(list);
+            std::string r(list, end - list);
+            r.erase(0, r.find_first_not_of(' '));
+            bool nested = false;
+            for (const std::string& other : roots) nested |= r.compare(0, other.size(), other) == 0;
+            if (!nested) referenceWalk(root, r, 0, excludeNames, excludePaths, expected);
+            roots.push_back(r);
+            list = *end ? end + 1 : end;
+        }
+
+        int wrong = library.getTrackCount() != (int)expected.size();
+        for (int i = 0; !wrong && i < library.getTrackCount(); i++) wrong += expected[i] != library.getTrack(i);
+        int unsized = 0;
+        for (int i = 0; i < library.getTrackCount(); i++) unsized += library.getTrackInfo(i)->mtime == 0;
+
+        printf("  include \"%s\"\n  exclude \"%s\"\n", c.include, c.exclude);
+        printf("%-28s %12.2f ms, %d tracks in %u folders (%u entries)\n", "    full scan", ms,
+               library.getTrackCount(), (unsigned)progress.last.folders, (unsigned)progress.last.files);
+        printf("%-28s %12d (of %zu expected), %d without size/date\n", "    order mismatches", wrong,
+               expected.size(), unsized);
+        printf("%-28s %12u\n", "    peak open handles", (unsigned)(sd.peakOpenFiles - alreadyOpen));
+        printf("%-28s %12d (%d while reading), final %s\n", "    progress events", progress.events,
+               progress.whileReading, progress.last.scanning ? "still scanning" : "done");
+        check(wrong == 0 && unsized == 0, "the walk finds the reference tracks in order, with size and date");
+        check(sd.peakOpenFiles - alreadyOpen <= 1, "the walk holds one directory open at a time");
+        check(!progress.last.scanning, "the last progress event reports the scan done");
+        int scanned = library.getTrackCount();
+
+        // Boot with the index: names only, same folders.
+        fake_sd_clear_stats();
+        start = std::chrono::steady_clock::now();
+        library.begin();
+        ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        printf("%-28s %12.2f ms, %d tracks, peak %u open\n", "    indexed boot", ms, library.getTrackCount(),
+               (unsigned)(fake_sd_stats().peakOpenFiles - alreadyOpen));
+        check(library.getTrackCount() == scanned, "an indexed boot keeps the scanned tracks");
+    }
+
+    // Changing the folder settings forces a rescan instead of reusing
+    // the index built for the old ones.
+    SDPlaylist library;
+    library.begin();
+    int before = library.getTrackCount();
+    library.setScanFolders("/Podcasts", "");
+    library.begin();
+    printf("%-28s %12s (%d -> %d tracks)\n", "  settings change rescans", library.getTrackCount() == 2 ? "yes" : "NO",
+           before, library.getTrackCount());
+    check(library.getTrackCount() == 2, "changing the scan folders forces a rescan");
+    removeTree(root);
+}
+
+// Pulls the card from under the main player and puts it back with files
+// added and removed. The monitor must stop playback, reload by reading only
+// the new files, and send clients edits that turn the old list into the
+// new one. Ends with the card pulled again, which also stops the indexer.
+static void benchHotPlug(AudioPlayer* player, const std::string& root, int tracks) {
+    if (tracks < 16) return;
+    SDPlaylist& library = player->_playlist;
+    std::mutex sentLock;
+    std::vector<std::pair<std::string, std::string>> sent;
+    AsyncEventSourceClient* sse = events.connectClient();
+    sse->onMessage = [&](const char* event, const char* message) {
+        std::lock_guard<std::mutex> guard(sentLock);
+        sent.emplace_back(event, message);
+    };
+    auto lastSent = [&](const char* event) {
+        std::lock_guard<std::mutex> guard(sentLock);
+        for (auto it = sent.rbegin(); it != sent.rend(); ++it) {
+            if (it->first == event) return it->second;
+        }
+        return std::string();
+    };
+
+    // poll() blocks until the decode side has acted; here that is loop().
+    // Its events go out from serverLoop(), as loopTask sends them.
+    CardMonitor monitor(*player);
+    auto poll = [&] {
+        std::atomic<bool> done{ false };
+        auto start = std::chrono::steady_clock::now();
+        std::thread poller([&] {
+            monitor.poll();
+            done = true;
+        });
+        while (!done) {
+            player->loop();
+            serverLoop();
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        poller.join();
+        serverLoop();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+    auto listNames = [&] {
+        std::vector<std::string> names;
+        for (int i = 0; i < library.getTrackCount(); i++) names.push_back(library.getTrack(i));
+        return names;
+    };
+
+    std::vector<std::string> before = listNames();
+    player->getQueue().clear();
+    player->playTrack(8);
+    bool wasPlaying = player->getState().isPlaying;
+
+    // The short tracks may run out and advance while the eject is on its
+    // way, so the track to follow is the one current once it is done.
+    fake_sd_set_inserted(false);
+    double ejectMs = poll();
+    bool offline = !player->isLibraryOnline() && !library.isMounted() && !player->getState().isPlaying &&
+                   lastSent("card") == "{\"present\":false}";
+    int current = player->getCurrentTrackIndex();
+    std::string playing = before[current];
+    player->post(PlayerCommand::NEXT);
+    player->loop();
+    bool held = player->getCurrentTrackIndex() == current && library.getTrackCount() == tracks;
+
+    // Tracks queued from the list still on screen: one of them leaves.
+    int gone = current == 3 ? 4 : 3;
+    player->getQueue().push(gone);
+    player->getQueue().push(14);
+    std::string queued = before[14];
+
+    // While it is out: four tracks go, six come.
+    for (int i : { gone, 10, 11, 12 }) unlink((root + before[i]).c_str());
+    std::vector<uint8_t> payload(4096, 0x55);
+    writeBytes(root + "/Music/Bonus Track.mp3", payload);
+    for (int i = 0; i < 5; i++) writeBytes(root + "/Music/New Track " + std::to_string(i) + ".mp3", payload);
+
+    fake_sd_set_inserted(true);
+    fake_sd_clear_stats();
+    double reloadMs = poll();
+    player->loop();     // Takes the RELOAD the monitor posted last
+    uint32_t opens = fake_sd_stats().opens;
+    std::vector<std::string> after = listNames();
+
+    // Apply the announced edits to the old list, as the web UI does.
+    std::string change = lastSent("playlist_changed");
+    std::vector<std::string> patched = before;
+    int edits = 0;
+    bool full = change.find("\"full\":true") != std::string::npos;
+    for (size_t at = change.find("\"edits\":[") + 9; !full && change[at] == '['; ) {
+        unsigned from, removed, added;
+        if (sscanf(change.c_str() + at, "[%u,%u,%u]", &from, &removed, &added) != 3) break;
+        patched.erase(patched.begin() + from, patched.begin() + from + removed);
+        patched.insert(patched.begin() + from, after.begin() + from, after.begin() + from + added);
+        edits++;
+        at = change.find(']', at) + 1;
+        if (change[at] == ',') at++;
+    }
+
+    uint32_t next = 0;
+    bool queueRemapped = player->getQueue().size() == 1 && player->getQueue().peek(next) &&
+                         after[next] == queued;
+    bool followed = player->isLibraryOnline() && after[player->getCurrentTrackIndex()] == playing &&
+                    !player->getState().isPlaying;
+
+    // What a scan that reads every track would have opened.
+    SDPlaylist cold;
+    cold.invalidateIndex();
+    fake_sd_clear_stats();
+    cold.begin();
+    uint32_t coldOpens = fake_sd_stats().opens;
+
+    printf("\nSD card hot-plug (%d tracks; 4 removed, 6 added while out)\n", tracks);
+    printf("%-28s %12.2f ms, %s\n", "  removal", ejectMs,
+           wasPlaying && offline && held ? "stopped, offline, list kept" : "WRONG");
+    printf("%-28s %12.2f ms, %d -> %d tracks, %u opens (cold scan %u)\n", "  insertion + rescan", reloadMs,
+           (int)before.size(), (int)after.size(), (unsigned)opens, (unsigned)coldOpens);
+    printf("%-28s %12d edit(s), old list + edits %s new list\n", "  playlist_changed", edits,
+           patched == after ? "==" : "!=");
+    printf("%-28s %12s (queue %s)\n", "  current track followed", followed ? "yes" : "NO",
+           queueRemapped ? "remapped, removed track dropped" : "WRONG");
+    printf("%-28s %12u / %u\n", "  removals / insertions", (unsigned)monitor.removals(),
+           (unsigned)monitor.insertions());
+    check(wasPlaying && offline && held, "pulling the card stops playback and keeps the list");
+    check((int)after.size() == tracks + 2 && opens < coldOpens, "reinserting reloads without a cold scan");
+    check(!full && patched == after, "playlist_changed edits turn the old list into the new one");
+    check(followed && queueRemapped, "the current track and the queue follow the reload");
+    check(monitor.removals() == 1 && monitor.insertions() == 1, "one removal and one insertion are seen");
+
+    // A track re-tagged in place keeps its name, so only a rescan sees it.
+    std::string edited = root + after[1];
+    FILE* f = fopen(edited.c_str(), "ab");
+    if (f) {
+        fwrite(payload.data(), 1, 512, f);
+        fclose(f);
+    }
+    struct stat st;
+    stat(edited.c_str(), &st);
+    uint32_t staleSize = library.getTrackInfo(1)->size;
+    {
+        AsyncWebServerRequest request(HTTP_POST, "/api/library");
+        request.addParam("action", "rescan", true);
+        server.handle(&request);
+    }
+    fake_sd_clear_stats();
+    double rescanMs = poll();
+    player->loop();
+    uint32_t rescanOpens = fake_sd_stats().opens;
+    TrackInfo info = *library.getTrackInfo(1);
+    bool refreshed = info.size == (uint32_t)st.st_size && info.mtime == (uint32_t)st.st_mtime &&
+                     library.getTrackCount() == (int)after.size();
+    printf("%-28s %12.2f ms, %u opens, size %u -> %u\n", "  rescan after in-place edit", rescanMs,
+           (unsigned)rescanOpens, (unsigned)staleSize, (unsigned)info.size);
+    check(staleSize != (uint32_t)st.st_size && refreshed, "a rescan refreshes the size and date of an edited file");
+
+    // Leave the player offline; the tree goes away after this.
+    fake_sd_set_inserted(false);
+    poll();
+    fake_sd_set_inserted(true);
+    sse->onMessage = nullptr;
+}
+
+// The follower box's clock: started 1.234 s apart from the leader's and
+// running 40 ppm fast.
+static constexpr double FOLLOWER_CLOCK_OFFSET_US = 1234000.0;
+static constexpr double FOLLOWER_CLOCK_SKEW = 40e-6;
+
+static int64_t followerClock() {
+    double real = (double)esp_timer_get_time();
+    return (int64_t)(real + FOLLOWER_CLOCK_OFFSET_US + real * FOLLOWER_CLOCK_SKEW);
+}
+
+// Leader minus follower clock at follower time t, as the follower should
+// estimate it.
+static double trueFollowerOffset(int64_t localUs) {
+    double real = ((double)localUs - FOLLOWER_CLOCK_OFFSET_US) / (1.0 + FOLLOWER_CLOCK_SKEW);
+    return real - (double)localUs;
+}
+
+// A leader player and a follower output in one process, over loopback UDP
+// with delay, jitter and loss on every path. Rooms are apart by the
+// follower's clock estimate error plus what its scheduler left uncorrected.
+static void benchSync(uint32_t delayUs, uint32_t jitterUs, float loss) {
+    char root[] = "/tmp/musicbox-sync-XXXXXX";
+    if (!mkdtemp(root)) {
+        perror("mkdtemp");
+        exit(1);
+    }
+    std::string music = std::string(root) + "/Music";
+    mkdir(music.c_str(), 0755);
+
+    // Four seconds per track at 128 kbit/s.
+    std::string payload(64000, '\x55');
+    payload.replace(0, 4, "\xFF\xFB\x90\x64", 4);
+    for (int i = 0; i < 3; i++) {
+        char name[64];
+        snprintf(name, sizeof(name), "/%d - Room.mp3", i);
+        FILE* f = fopen((music + name).c_str(), "wb");
+        if (!f) continue;
+        fwrite(payload.data(), 1, payload.size(), f);
+        fclose(f);
+    }
+    SD.setHostRoot(root);
+
+    fake_udp_set_impairment(SYNC_AUDIO_PORT, delayUs, jitterUs, loss);
+    fake_udp_set_impairment(SYNC_CLOCK_PORT, delayUs, jitterUs, loss);
+    fake_udp_set_impairment(SYNC_CLOCK_REPLY_PORT, delayUs, jitterUs, loss);
+
+    // Leaked on purpose: their tasks outlive this call.
+    Serial.quiet = true;
+    AudioPlayer* player = new AudioPlayer();
+    SyncLeader* leader = new SyncLeader();
+    player->begin();
+    player->setPcmListener(leader);
+    player->startTasks();
+    leader->begin();
+
+    AudioOutput* output = new AudioOutput();
+    output->begin(I2S_NUM_1);
+    SyncFollower* follower = new SyncFollower(*output, followerClock);
+    follower->begin();
+
+    player->post(PlayerCommand::PLAY);
+
+    // Skip a track half way through, so the follower has to flush.
+    std::vector<double> clockErrors;
+    std::vector<double> totalErrors;
+    int64_t lockedAt = -1;
+    for (int tick = 0; tick < 1000; tick++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        if (tick == 500) player->post(PlayerCommand::NEXT);
+
+        SyncFollowerStats stats = follower->getStats();
+        if (!stats.locked || stats.packetsPlayed == 0) continue;
+        if (lockedAt < 0) lockedAt = tick;
+
+        double clockError = (double)stats.offsetUs - trueFollowerOffset(stats.sampledAtUs);
+        clockErrors.push_back(fabs(clockError));
+        totalErrors.push_back(fabs(clockError + stats.lastErrorUs));
+    }
+
+    SyncFollowerStats stats = follower->getStats();
+    SyncLeaderStats leaderStats = leader->getStats();
+    player->post(PlayerCommand::PAUSE);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    Serial.quiet = false;
+
+    auto percentile = [](std::vector<double> v, double p) {
+        if (v.empty()) return 0.0;
+        std::sort(v.begin(), v.end());
+        return v[std::min(v.size() - 1, (size_t)(p * v.size()))];
+    };
+
+    printf("\nMulti-room sync over loopback: %u us +/- %u us, %.0f%% loss, "
+           "follower clock %+.0f us / %+.0f ppm\n",
+           (unsigned)delayUs, (unsigned)jitterUs, loss * 100,
+           FOLLOWER_CLOCK_OFFSET_US, FOLLOWER_CLOCK_SKEW * 1e6);
+    printf("%-28s %12d ms\n", "locked and playing after", (int)lockedAt * 10);
+    printf("%-28s %12u us\n", "best clock rtt", (unsigned)stats.rttUs);
+    printf("%-28s %12.1f ppm\n", "estimated skew", stats.skewPpm);
+    printf("%-28s %9.0f / %.0f / %.0f us\n", "clock error p50/p99/max",
+           percentile(clockErrors, 0.5), percentile(clockErrors, 0.99), percentile(clockErrors, 1.0));
+    printf("%-28s %9.0f / %.0f / %.0f us\n", "room offset p50/p99/max",
+           percentile(totalErrors, 0.5), percentile(totalErrors, 0.99), percentile(totalErrors, 1.0));
+    printf("%-28s %12u\n", "packets sent", (unsigned)leaderStats.packetsSent);
+    printf("%-28s %12u\n", "packets played", (unsigned)stats.packetsPlayed);
+    printf("%-28s %4u late, %u dup, %u reordered, %u lost, %u overflow\n", "jitter buffer",
+           (unsigned)stats.jitter.late, (unsigned)stats.jitter.duplicate,
+           (unsigned)stats.jitter.reordered, (unsigned)stats.jitter.lost,
+           (unsigned)stats.jitter.overflow);
+    printf("%-28s %4u slipped, %u padded, %u concealed\n", "correction frames",
+           (unsigned)stats.slipFrames, (unsigned)stats.padFrames, (unsigned)stats.concealedFrames);
+    printf("%-28s %12u\n", "stream changes", (unsigned)stats.streamChanges);
+
+    removeTree(root);
+}
+
+int main(int argc, char** argv) {
+    int tracks = argc > 1 ? atoi(argv[1]) : 100;
+    int indexTracks = argc > 2 ? atoi(argv[2]) : 10000;
+    std::string root = makeTree(tracks, 16 * 1024);
+    SD.setHostRoot(root.c_str());
+
+    printf("Synthetic library: %d tracks under %s\n\n", tracks, root.c_str());
+    printf("%-28s %15s %17s %18s\n", "operation", "time/op", "heap allocs/op", "heap bytes/op");
+
+    Serial.quiet = true;
+
+    AudioPlayer* player = nullptr;
+    report("boot (DAC + SD scan)", measure(1, [&] {
+        player = new AudioPlayer();
+        player->begin();
+    }));
+    initServer(player);
+
+    report("playlist rescan", measure(5, [&] {
+        SDPlaylist playlist;
+        playlist.begin();
+    }));
+
+    int next = 0;
+    report("track switch", measure(200, [&] {
+        player->playTrack(next++);
+    }));
+
+    report("loop()", measure(2000, [&] {
+        player->loop();
+    }));
+
+    // Files open with the fake's default open latency of zero, so the
+    // reconnect numbers are a lower bound for the card.
+    player->playTrack(0);
+    report("pause + play (held)", measure(200, [&] {
+        player->pause();
+        player->play();
+    }));
+
+    player->setPauseKeepAliveMinHeap(UINT32_MAX);
+    report("pause + play (released)", measure(200, [&] {
+        player->pause();
+        player->play();
+    }));
+    player->setPauseKeepAliveMinHeap(PAUSE_KEEP_ALIVE_MIN_HEAP);
+
+    report("getCurrentStateJSON()", measure(1000, [&] {
+        String json = player->getCurrentStateJSON();
+    }));
+
+    volatile size_t sink = 0;
+    Sample titleWalk = measure(100, [&] {
+        size_t bytes = 0;
+        for (std::string_view title : player->getPlaylist()) {
+            bytes += title.size();
+        }
+        sink = sink + bytes;
+    });
+    report("walk playlist titles", titleWalk);
+    check(titleWalk.allocsPerOp == 0, "walking the playlist titles allocates nothing");
+
+    Sample playlistJson = measure(50, [&] {
+        AsyncWebServerRequest request(HTTP_GET, "/api/playlist");
+        server.handle(&request);
+    });
+    report("GET /api/playlist", playlistJson);
+    // One track against all of them: the difference is what a track costs.
+    auto playlistPage = [&](int limit) {
+        std::string value = std::to_string(limit);
+        return measure(50, [&] {
+            AsyncWebServerRequest request(HTTP_GET, "/api/playlist");
+            request.addParam("offset", "0");
+            request.addParam("limit", value.c_str());
+            server.handle(&request);
+        });
+    };
+    if (tracks > 1) {
+        double perTrack = (playlistPage(tracks).allocsPerOp - playlistPage(1).allocsPerOp) / (tracks - 1);
+        printf("%-28s %12.3f allocs per track\n", "  steady state", perTrack);
+        check(perTrack < 0.5, "GET /api/playlist allocates nothing per track");
+    }
+
+    report("GET /api/playlist page", measure(50, [&] {
+        AsyncWebServerRequest request(HTTP_GET, "/api/playlist");
+        request.addParam("offset", "20");
+        request.addParam("limit", "50");
+        server.handle(&request);
+    }));
+
+    report("GET /api/playlist?meta=1", measure(50, [&] {
+        AsyncWebServerRequest request(HTTP_GET, "/api/playlist");
+        request.addParam("meta", "1");
+        server.handle(&request);
+    }));
+
+    report("GET /api/search?q=holi", measure(50, [&] {
+        AsyncWebServerRequest request(HTTP_GET, "/api/search");
+        request.addParam("q", "holi");
+        server.handle(&request);
+    }));
+
+    report("GET /", measure(50, [&] {
+        AsyncWebServerRequest request(HTTP_GET, "/");
+        server.handle(&request);
+    }));
+
+    report("GET / (If-None-Match)", measure(50, [&] {
+        AsyncWebServerRequest request(HTTP_GET, "/");
+        request.addHeader("If-None-Match", WEB_UI_ETAG);
+        server.handle(&request);
+    }));
+
+    // The handler only enqueues; the switch itself happens in loop().
+    report("POST /api/control next", measure(200, [&] {
+        AsyncWebServerRequest request(HTTP_POST, "/api/control");
+        request.addParam("action", "next", true);
+        server.handle(&request);
+        player->loop();
+    }));
+
+    // A burst of presses between two loop() iterations is one track change.
+    int before = player->getCurrentTrackIndex();
+    uint32_t version = player->getStateVersion();
+    for (int i = 0; i < 10; i++) {
+        AsyncWebServerRequest request(HTTP_POST, "/api/control");
+        request.addParam("action", "next", true);
+        server.handle(&request);
+    }
+    player->loop();
+    int after = player->getCurrentTrackIndex();
+    uint32_t changes = player->getStateVersion() - version;
+    Serial.quiet = false;
+    Serial.printf("burst of 10 next: track %d -> %d, %u state change(s)\n", before, after, (unsigned)changes);
+    Serial.quiet = true;
+    check(after == (before + 10) % tracks && changes == 1, "a burst of next presses is one track change");
+
+    // Shuffle through the mode API: the next presses walk one cycle without
+    // repeats, previous presses retrace them.
+    {
+        AsyncWebServerRequest request(HTTP_POST, "/api/mode");
+        request.addParam("shuffle", "1", true);
+        request.addParam("repeat", "off", true);
+        server.handle(&request);
+        player->loop();
+    }
+    PlayerState modeState = player->getState();
+    std::vector<int> shuffled{ player->getCurrentTrackIndex() };
+    std::vector<uint8_t> shuffledSeen(tracks);
+    shuffledSeen[shuffled[0]] = 1;
+    int shuffleRepeats = 0;
+    for (int i = 1; i < tracks; i++) {
+        player->post(PlayerCommand::NEXT);
+        player->loop();
+        int index = player->getCurrentTrackIndex();
+        if (shuffledSeen[index]) shuffleRepeats++;
+        shuffledSeen[index] = 1;
+        shuffled.push_back(index);
+    }
+    int shuffleBackWrong = 0;
+    for (int i = tracks - 2; i >= 0; i--) {
+        player->post(PlayerCommand::PREVIOUS);
+        player->loop();
+        if (player->getCurrentTrackIndex() != shuffled[i]) shuffleBackWrong++;
+    }
+    Serial.quiet = false;
+    Serial.printf("shuffle via /api/mode: shuffle=%d repeat=%s, %d repeats over %d nexts, "
+                  "%d wrong on the way back\n", modeState.shuffle, repeatModeName(modeState.repeat),
+                  shuffleRepeats, tracks - 1, shuffleBackWrong);
+    Serial.quiet = true;
+    check(modeState.shuffle && modeState.repeat == REPEAT_OFF, "/api/mode sets shuffle and repeat");
+    check(shuffleRepeats == 0 && shuffleBackWrong == 0, "player skips walk and retrace one shuffle cycle");
+    {
+        AsyncWebServerRequest request(HTTP_POST, "/api/mode");
+        request.addParam("shuffle", "0", true);
+        request.addParam("repeat", "all", true);
+        server.handle(&request);
+        player->loop();
+    }
+
+    // Up next: queued tracks come first, then the list carries on from
+    // where the queue cut in; a saved playlist plays its first track and
+    // queues the rest.
+    auto postForm = [&](const char* url, std::initializer_list<std::pair<const char*, const char*>> params) {
+        AsyncWebServerRequest request(HTTP_POST, url);
+        for (auto& param : params) request.addParam(param.first, param.second, true);
+        server.handle(&request);
+        player->loop();
+    };
+    auto press = [&](PlayerCommand::Type type) {
+        player->post(type);
+        player->loop();
+        return player->getCurrentTrackIndex();
+    };
+    player->playTrack(2);
+    postForm("/api/selectTrack", { { "index", "9" }, { "queue", "1" } });
+    postForm("/api/selectTrack", { { "index", "5" }, { "queue", "1" } });
+    std::vector<int> queuedOrder;
+    for (int i = 0; i < 3; i++) queuedOrder.push_back(press(PlayerCommand::NEXT));
+    queuedOrder.push_back(press(PlayerCommand::PREVIOUS));
+    postForm("/api/playlists", { { "action", "save" }, { "name", "Bench" }, { "tracks", "7,1,4" } });
+    postForm("/api/playlists", { { "action", "play" }, { "name", "Bench" } });
+    queuedOrder.push_back(player->getCurrentTrackIndex());
+    for (int i = 0; i < 3; i++) queuedOrder.push_back(press(PlayerCommand::NEXT));
+    const std::vector<int> wantOrder = { 9, 5, 3, 2, 7, 1, 4, 8 };
+    Serial.quiet = false;
+    Serial.printf("queue and playlist play order:");
+    for (int index : queuedOrder) Serial.printf(" %d", index);
+    Serial.printf(" (%s)\n", queuedOrder == wantOrder ? "as expected" : "WRONG");
+    Serial.quiet = true;
+    check(queuedOrder == wantOrder, "queued and playlist tracks play in order");
+
+    benchControlRoundTrip(player);
+    benchDacOffload(player);
+    benchDacBringUp();
+    benchClockPlanner();
+    benchHotPlug(player, root, tracks);
+
+    Serial.quiet = false;
+    removeTree(root);
+
+    benchIndexedBoot(indexTracks);
+    benchStatePublisher();
+    benchSeqlock();
+    benchSeekTable();
+    benchRingBuffer();
+    benchGapless(60);
+    benchWavFastPath();
+    benchRateChange();
+    benchLendOutput();
+    benchSdReadAhead();
+    benchMetadataIndex(20);
+    benchSearch(5000);
+    benchShuffle(10000, 3);
+    benchPlaylists(1500);
+    benchFolderWalk();
+    benchSync(3000, 2000, 0.02f);
+
+    if (checksFailed > 0) {
+        printf("\n%d check(s) failed\n", checksFailed);
+        return 1;
+    }
+    return 0;
+}
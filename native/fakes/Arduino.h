@@ -0,0 +1,100 @@
+// ============================================================================
+// Arduino.h (native fake)
+// Just enough of the Arduino-ESP32 core to compile the player on the host.
+// ============================================================================
+#ifndef FAKE_ARDUINO_H
+#define FAKE_ARDUINO_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cstdarg>
+#include <cmath>
+#include "WString.h"
+
+#define PROGMEM
+#define PGM_P const char*
+#define F(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define IRAM_ATTR
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+long map(long x, long in_min, long in_max, long out_min, long out_max);
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+uint32_t esp_random();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define LOW 0x0
+#define HIGH 0x1
+
+// PSRAM helpers from esp32-hal-psram.h. The host has no PSRAM, so these
+// fall through to the normal heap and psramFound() reports false, as it
+// does on the device before initArduino() (during global construction).
+// fake_psram_set_found(true) plays a board whose PSRAM is up.
+bool psramFound();
+void* ps_malloc(size_t size);
+void* ps_realloc(void* ptr, size_t size);
+void fake_psram_set_found(bool found);
+
+class Printable {
+public:
+    virtual ~Printable() {}
+    virtual String toString() const = 0;
+};
+
+class HardwareSerial {
+public:
+    void begin(unsigned long baud) { (void)baud; }
+    size_t print(const char* s) { if (quiet) return 0; ::fputs(s, stdout); return strlen(s); }
+    size_t print(const String& s) { return print(s.c_str()); }
+    size_t print(char c) { if (quiet) return 0; ::putchar(c); return 1; }
+    size_t print(int v) { return printf("%d", v); }
+    size_t print(unsigned int v) { return printf("%u", v); }
+    size_t print(long v) { return printf("%ld", v); }
+    size_t print(unsigned long v) { return printf("%lu", v); }
+    size_t print(double v) { return printf("%.2f", v); }
+    size_t print(const Printable& p) { return print(p.toString()); }
+    size_t println() { return print("\n"); }
+    template <typename T>
+    size_t println(const T& v) { size_t n = print(v); return n + println(); }
+    size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+        if (quiet) return 0;
+        va_list args;
+        va_start(args, fmt);
+        int n = vprintf(fmt, args);
+        va_end(args);
+        return n < 0 ? 0 : (size_t)n;
+    }
+
+    // Host-only: silence logging while benchmarks run.
+    bool quiet = false;
+};
+
+extern HardwareSerial Serial;
+
+class EspClass {
+public:
+    uint32_t getFreeHeap();
+    uint32_t getMaxAllocHeap();
+    uint32_t getFreePsram() { return 0; }
+};
+
+extern EspClass ESP;
+
+#endif
@@ -0,0 +1,63 @@
+// ============================================================================
+// AsyncEventSource.h (native fake)
+// ============================================================================
+#ifndef FAKE_ASYNC_EVENT_SOURCE_H
+#define FAKE_ASYNC_EVENT_SOURCE_H
+
+#include <Arduino.h>
+#include <functional>
+#include <memory>
+#include <vector>
+
+class AsyncWebServerRequest;
+
+class AsyncWebHandler {
+public:
+    virtual ~AsyncWebHandler() {}
+    virtual bool canHandle(AsyncWebServerRequest* request) { (void)request; return false; }
+    virtual void handleRequest(AsyncWebServerRequest* request) { (void)request; }
+};
+
+class AsyncEventSourceClient {
+public:
+    explicit AsyncEventSourceClient(uint32_t lastId = 0) : _lastId(lastId) {}
+
+    void send(const char* message, const char* event = nullptr, uint32_t id = 0, uint32_t reconnect = 0);
+    uint32_t lastId() const { return _lastId; }
+    bool connected() const { return true; }
+
+    // Host-only traffic counters.
+    uint32_t messagesSent = 0;
+    size_t bytesSent = 0;
+    String lastMessage;
+    String lastEvent;
+    // Host-only: sees every message, for tests that need more than the last.
+    std::function<void(const char* event, const char* message)> onMessage;
+
+private:
+    uint32_t _lastId;
+};
+
+typedef std::function<void(AsyncEventSourceClient* client)> ArEventHandlerFunction;
+
+class AsyncEventSource : public AsyncWebHandler {
+public:
+    explicit AsyncEventSource(const String& url) : _url(url) {}
+
+    const char* url() const { return _url.c_str(); }
+    void onConnect(ArEventHandlerFunction cb) { _connectcb = cb; }
+    void send(const char* message, const char* event = nullptr, uint32_t id = 0, uint32_t reconnect = 0);
+    size_t count() const { return _clients.size(); }
+    size_t avgPacketsWaiting() const { return 0; }
+
+    // Host-only: attach a client as if it had (re)connected with Last-Event-ID.
+    AsyncEventSourceClient* connectClient(uint32_t lastId = 0);
+    void disconnectAll() { _clients.clear(); }
+
+private:
+    String _url;
+    ArEventHandlerFunction _connectcb;
+    std::vector<std::unique_ptr<AsyncEventSourceClient>> _clients;
+};
+
+#endif
@@ -0,0 +1,83 @@
+// ============================================================================
+// AsyncWebSocket.h (native fake)
+// Clients are plain objects that record what the server sent them; a host
+// program delivers frames to the server's event handler with receive().
+// ============================================================================
+#ifndef FAKE_ASYNC_WEB_SOCKET_H
+#define FAKE_ASYNC_WEB_SOCKET_H
+
+#include <Arduino.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "AsyncEventSource.h"
+
+#define WS_CONTINUATION 0x00
+#define WS_TEXT 0x01
+#define WS_BINARY 0x02
+#define WS_DISCONNECT 0x08
+#define WS_PING 0x09
+#define WS_PONG 0x0A
+
+typedef enum { WS_EVT_CONNECT, WS_EVT_DISCONNECT, WS_EVT_PONG, WS_EVT_ERROR, WS_EVT_DATA } AwsEventType;
+
+typedef struct {
+    uint8_t message_opcode;
+    uint32_t num;
+    uint8_t final;
+    uint8_t masked;
+    uint8_t opcode;
+    uint64_t len;
+    uint8_t mask[4];
+    uint64_t index;
+} AwsFrameInfo;
+
+class AsyncWebSocket;
+
+class AsyncWebSocketClient {
+public:
+    AsyncWebSocketClient(AsyncWebSocket* server, uint32_t id) : _server(server), _id(id) {}
+
+    uint32_t id() const { return _id; }
+    AsyncWebSocket* server() { return _server; }
+    void binary(const uint8_t* message, size_t len);
+    void binary(const char* message, size_t len) { binary((const uint8_t*)message, len); }
+    void text(const char* message) { (void)message; }
+    bool canSend() const { return true; }
+
+    // Host-only: everything sent to this client, one entry per frame.
+    std::vector<std::string> frames;
+    std::function<void(const uint8_t* data, size_t len)> onFrame;
+
+private:
+    AsyncWebSocket* _server;
+    uint32_t _id;
+};
+
+typedef std::function<void(AsyncWebSocket* server, AsyncWebSocketClient* client, AwsEventType type,
+                           void* arg, uint8_t* data, size_t len)> AwsEventHandler;
+
+class AsyncWebSocket : public AsyncWebHandler {
+public:
+    explicit AsyncWebSocket(const String& url) : _url(url) {}
+
+    const char* url() const { return _url.c_str(); }
+    void onEvent(AwsEventHandler handler) { _handler = handler; }
+    size_t count() const { return _clients.size(); }
+    void binaryAll(const uint8_t* message, size_t len);
+    void binaryAll(const char* message, size_t len) { binaryAll((const uint8_t*)message, len); }
+    void cleanupClients(uint16_t maxClients = 8) { (void)maxClients; }
+
+    // Host-only: open a connection and deliver one complete binary frame.
+    AsyncWebSocketClient* connectClient();
+    void receive(AsyncWebSocketClient* client, const uint8_t* data, size_t len);
+
+private:
+    String _url;
+    AwsEventHandler _handler;
+    std::vector<std::unique_ptr<AsyncWebSocketClient>> _clients;
+    uint32_t _nextId = 1;
+};
+
+#endif
@@ -0,0 +1,82 @@
+// ============================================================================
+// Audio.h (native fake)
+// Stand-in for schreibfaul1/ESP32-audioI2S. "Decoding" reads the file in
+// MP3-frame sized chunks and emits one frame of synthetic PCM per chunk, so
+// file I/O and callback traffic look like the real library to the player.
+// PCM WAV is played for real, the way the library does it: file into the
+// input buffer, then converted and volume-scaled sample by sample into the
+// output buffer.
+// ============================================================================
+#ifndef FAKE_AUDIO_H
+#define FAKE_AUDIO_H
+
+#include <Arduino.h>
+#include <FS.h>
+
+extern __attribute__((weak)) void audio_info(const char*);
+extern __attribute__((weak)) void audio_id3data(const char*);
+extern __attribute__((weak)) void audio_eof_mp3(const char*);
+extern __attribute__((weak)) void audio_showstation(const char*);
+extern __attribute__((weak)) void audio_showstreamtitle(const char*);
+extern __attribute__((weak)) void audio_process_i2s(int16_t* outBuff, uint16_t validSamples,
+                                                    uint8_t bitsPerSample, uint8_t channels,
+                                                    bool* continueI2S);
+
+class Audio {
+public:
+    Audio(bool internalDAC = false, uint8_t channelEnabled = 3, uint8_t i2sPort = 0);
+
+    bool setPinout(uint8_t BCLK, uint8_t LRC, uint8_t DOUT, int8_t MCLK = -1);
+    void setVolume(uint8_t vol, uint8_t curve = 0);
+    uint8_t getVolume() { return _volume; }
+    uint8_t maxVolume() { return 21; }
+
+    bool connecttoFS(fs::FS& fs, const char* path, int32_t fileStartPos = -1);
+    uint32_t stopSong();
+    bool pauseResume();
+    bool isRunning() { return _running; }
+    void loop();
+
+    uint32_t getFilePos();
+    uint32_t getFileSize();
+    bool setFilePos(uint32_t pos);
+    bool setAudioPlayPosition(uint16_t sec);
+    uint32_t getAudioCurrentTime();
+    uint32_t getAudioFileDuration();
+    uint32_t getBitRate(bool avg = false);
+    uint32_t getSampleRate() { return _wavRate ? _wavRate : SAMPLE_RATE; }
+    uint8_t getBitsPerSample() { return 16; }
+    uint8_t getChannels() { return 2; }
+    uint32_t inBufferFilled() { return 0; }
+    uint32_t inBufferFree() { return 0; }
+
+    // Host-only: scale how many frames loop() decodes per call.
+    static uint8_t framesPerLoop;
+    // Host-only: time connecttoFS() spends "opening" (SD latency, tag parse).
+    static uint16_t openLatencyMs;
+
+private:
+    static constexpr uint32_t BITRATE = 128000;
+    static constexpr uint32_t SAMPLE_RATE = 44100;
+    static constexpr uint16_t FRAME_BYTES = 418;     // 128 kbit/s @ 44.1 kHz
+    static constexpr uint16_t FRAME_SAMPLES = 1152;
+
+    fs::File _file;
+    bool _running = false;
+    uint8_t _volume = 21;
+    int16_t _pcm[FRAME_SAMPLES * 2];
+
+    // Set while a WAV file is open; 0 for the synthetic MP3 stream.
+    uint32_t _wavRate = 0;
+    uint8_t _wavChannels = 0;
+    uint8_t _wavBits = 0;
+    uint32_t _wavDataOffset = 0;
+    uint32_t _wavDataEnd = 0;
+    uint8_t _inBuff[FRAME_SAMPLES * 6];
+
+    bool parseWav();
+    bool loopWav();
+    uint32_t bytesPerSecond();
+};
+
+#endif
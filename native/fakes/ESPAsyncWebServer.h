@@ -0,0 +1,154 @@
+// ============================================================================
+// ESPAsyncWebServer.h (native fake)
+// Routes are stored by path and run synchronously through handle(), so a
+// host program can drive the real handlers in Server.cpp and inspect the
+// response without a network stack.
+// ============================================================================
+#ifndef FAKE_ESP_ASYNC_WEB_SERVER_H
+#define FAKE_ESP_ASYNC_WEB_SERVER_H
+
+#include <Arduino.h>
+#include <functional>
+#include <vector>
+#include "AsyncEventSource.h"
+#include "AsyncWebSocket.h"
+
+typedef enum {
+    HTTP_GET     = 0b00000001,
+    HTTP_POST    = 0b00000010,
+    HTTP_DELETE  = 0b00000100,
+    HTTP_PUT     = 0b00001000,
+    HTTP_PATCH   = 0b00010000,
+    HTTP_HEAD    = 0b00100000,
+    HTTP_OPTIONS = 0b01000000,
+    HTTP_ANY     = 0b01111111,
+} WebRequestMethod;
+
+typedef uint8_t WebRequestMethodComposite;
+
+class AsyncWebParameter {
+public:
+    AsyncWebParameter(const String& name, const String& value, bool form = false)
+        : _name(name), _value(value), _form(form) {}
+    const String& name() const { return _name; }
+    const String& value() const { return _value; }
+    bool isPost() const { return _form; }
+
+private:
+    String _name;
+    String _value;
+    bool _form;
+};
+
+class AsyncWebHeader {
+public:
+    AsyncWebHeader(const String& name, const String& value) : _name(name), _value(value) {}
+    const String& name() const { return _name; }
+    const String& value() const { return _value; }
+
+private:
+    String _name;
+    String _value;
+};
+
+typedef std::function<size_t(uint8_t* buffer, size_t maxLen, size_t index)> AwsResponseFiller;
+typedef std::function<String(const String&)> AwsTemplateProcessor;
+
+class AsyncWebServerResponse {
+public:
+    AsyncWebServerResponse(int code, const String& contentType) : _code(code), _contentType(contentType) {}
+    virtual ~AsyncWebServerResponse() {}
+
+    void setCode(int code) { _code = code; }
+    void setContentLength(size_t len) { (void)len; }
+    void setContentType(const String& type) { _contentType = type; }
+    void addHeader(const String& name, const String& value) { _headers.emplace_back(name, value); }
+
+    int code() const { return _code; }
+    const String& contentType() const { return _contentType; }
+    const std::vector<AsyncWebHeader>& headers() const { return _headers; }
+
+    // Host-only: produce the full body the way the TCP layer would pull it.
+    virtual void drain(std::string& out, size_t chunkSize) { (void)out; (void)chunkSize; }
+
+protected:
+    int _code;
+    String _contentType;
+    std::vector<AsyncWebHeader> _headers;
+};
+
+class AsyncWebServerRequest {
+public:
+    AsyncWebServerRequest(WebRequestMethod method, const String& url) : _method(method), _url(url) {}
+    ~AsyncWebServerRequest();
+
+    WebRequestMethod method() const { return _method; }
+    const String& url() const { return _url; }
+
+    bool hasParam(const String& name, bool post = false, bool file = false) const;
+    AsyncWebParameter* getParam(const String& name, bool post = false, bool file = false) const;
+    bool hasArg(const char* name) const;
+    const String& arg(const String& name) const;
+    bool hasHeader(const String& name) const;
+    AsyncWebHeader* getHeader(const String& name) const;
+
+    void send(int code, const String& contentType = String(), const String& content = String());
+    void send_P(int code, const String& contentType, const char* content);
+    void send_P(int code, const String& contentType, const uint8_t* content, size_t len);
+    void send(AsyncWebServerResponse* response);
+
+    AsyncWebServerResponse* beginResponse(int code, const String& contentType = String(),
+                                          const String& content = String());
+    AsyncWebServerResponse* beginResponse_P(int code, const String& contentType,
+                                            const uint8_t* content, size_t len);
+    AsyncWebServerResponse* beginChunkedResponse(const String& contentType, AwsResponseFiller callback);
+
+    // Host-only: request construction and response inspection.
+    void addParam(const String& name, const String& value, bool post = false) {
+        _params.emplace_back(name, value, post);
+    }
+    void addHeader(const String& name, const String& value) { _headers.emplace_back(name, value); }
+    void setChunkSize(size_t chunkSize) { _chunkSize = chunkSize; }
+    int responseCode() const { return _responseCode; }
+    const std::string& responseBody() const { return _responseBody; }
+    const AsyncWebServerResponse* response() const { return _response; }
+
+private:
+    WebRequestMethod _method;
+    String _url;
+    mutable std::vector<AsyncWebParameter> _params;
+    mutable std::vector<AsyncWebHeader> _headers;
+    AsyncWebServerResponse* _response = nullptr;
+    int _responseCode = 0;
+    std::string _responseBody;
+    size_t _chunkSize = 1436;  // One TCP MSS, like the real async response.
+};
+
+typedef std::function<void(AsyncWebServerRequest* request)> ArRequestHandlerFunction;
+
+class AsyncWebServer {
+public:
+    explicit AsyncWebServer(uint16_t port) { (void)port; }
+
+    void begin() {}
+    void end() {}
+    void on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest);
+    void onNotFound(ArRequestHandlerFunction fn) { _notFound = fn; }
+    AsyncWebHandler& addHandler(AsyncWebHandler* handler) { _handlers.push_back(handler); return *handler; }
+
+    // Host-only: run the matching route synchronously.
+    void handle(AsyncWebServerRequest* request);
+
+private:
+    struct Route {
+        String uri;
+        WebRequestMethodComposite method;
+        ArRequestHandlerFunction fn;
+    };
+
+    std::vector<Route> _routes;
+    std::vector<AsyncWebHandler*> _handlers;
+    ArRequestHandlerFunction _notFound;
+};
+
+#endif
@@ -0,0 +1,19 @@
+// ============================================================================
+// ESPmDNS.h (native fake)
+// ============================================================================
+#ifndef FAKE_ESPMDNS_H
+#define FAKE_ESPMDNS_H
+
+#include <Arduino.h>
+
+class MDNSResponder {
+public:
+    bool begin(const char* hostName) { (void)hostName; return true; }
+    void addService(const char* service, const char* proto, uint16_t port) {
+        (void)service; (void)proto; (void)port;
+    }
+};
+
+extern MDNSResponder MDNS;
+
+#endif
@@ -0,0 +1,198 @@
+// ============================================================================
+// FakeAudio.cpp (native fake)
+// ============================================================================
+#include <Audio.h>
+#include <strings.h>
+
+uint8_t Audio::framesPerLoop = 1;
+uint16_t Audio::openLatencyMs = 0;
+
+Audio::Audio(bool internalDAC, uint8_t channelEnabled, uint8_t i2sPort) {
+    (void)internalDAC; (void)channelEnabled; (void)i2sPort;
+    memset(_pcm, 0, sizeof(_pcm));
+}
+
+bool Audio::setPinout(uint8_t BCLK, uint8_t LRC, uint8_t DOUT, int8_t MCLK) {
+    (void)BCLK; (void)LRC; (void)DOUT; (void)MCLK;
+    return true;
+}
+
+void Audio::setVolume(uint8_t vol, uint8_t curve) {
+    (void)curve;
+    _volume = vol > 21 ? 21 : vol;
+}
+
+bool Audio::connecttoFS(fs::FS& fs, const char* path, int32_t fileStartPos) {
+    if (_running) stopSong();
+    if (openLatencyMs > 0) delay(openLatencyMs);
+    _file = fs.open(path);
+    if (!_file || _file.isDirectory()) {
+        _file.close();
+        if (audio_info) audio_info("file not found");
+        return false;
+    }
+    _wavRate = 0;
+    size_t len = strlen(path);
+    if (len >= 4 && strcasecmp(path + len - 4, ".wav") == 0 && !parseWav()) {
+        _file.close();
+        if (audio_info) audio_info("unsupported WAV");
+        return false;
+    }
+    if (fileStartPos > 0) {
+        _file.seek((uint32_t)fileStartPos);
+    } else if (_wavRate) {
+        _file.seek(_wavDataOffset);
+    }
+    _running = true;
+    if (audio_info) audio_info(_wavRate ? "format is wav" : "SampleRate=44100");
+    return true;
+}
+
+// 16/24-bit integer PCM, mono or stereo; the chunk walk stops at "data".
+bool Audio::parseWav() {
+    uint8_t riff[12];
+    if (_file.read(riff, 12) != 12 || memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+    uint32_t pos = 12;
+    for (int chunk = 0; chunk < 16; chunk++) {
+        uint8_t header[8];
+        if (_file.read(header, 8) != 8) return false;
+        uint32_t size = header[4] | (header[5] << 8) | (header[6] << 16) | ((uint32_t)header[7] << 24);
+        pos += 8;
+        if (memcmp(header, "fmt ", 4) == 0) {
+            uint8_t fmt[16];
+            if (size < 16 || _file.read(fmt, 16) != 16) return false;
+            _wavChannels = fmt[2];
+            _wavRate = fmt[4] | (fmt[5] << 8) | (fmt[6] << 16) | ((uint32_t)fmt[7] << 24);
+            _wavBits = fmt[14];
+        } else if (memcmp(header, "data", 4) == 0) {
+            if (_wavRate == 0 || (_wavChannels != 1 && _wavChannels != 2) ||
+                (_wavBits != 16 && _wavBits != 24)) {
+                _wavRate = 0;
+                return false;
+            }
+            _wavDataOffset = pos;
+            uint32_t end = (uint32_t)_file.size();
+            _wavDataEnd = size == 0 || pos + size > end ? end : pos + size;
+            return true;
+        }
+        pos += size + (size & 1);
+        if (!_file.seek(pos)) return false;
+    }
+    _wavRate = 0;
+    return false;
+}
+
+uint32_t Audio::bytesPerSecond() {
+    return _wavRate ? _wavRate * _wavChannels * _wavBits / 8 : BITRATE / 8;
+}
+
+uint32_t Audio::getBitRate(bool avg) {
+    (void)avg;
+    if (!_running) return 0;
+    return bytesPerSecond() * 8;
+}
+
+uint32_t Audio::stopSong() {
+    uint32_t pos = getFilePos();
+    _file.close();
+    _running = false;
+    return pos;
+}
+
+bool Audio::pauseResume() {
+    if (!_file) return false;
+    _running = !_running;
+    return true;
+}
+
+void Audio::loop() {
+    if (!_running) return;
+
+    for (uint8_t f = 0; f < framesPerLoop; f++) {
+        if (_wavRate) {
+            if (!loopWav()) return;
+            continue;
+        }
+        uint8_t frame[FRAME_BYTES];
+        size_t n = _file.read(frame, sizeof(frame));
+        if (n == 0) {
+            String path = _file.path();
+            _file.close();
+            _running = false;
+            if (audio_eof_mp3) audio_eof_mp3(path.c_str());
+            return;
+        }
+
+        // Spread the compressed bytes over the frame so the PCM is not all
+        // zeros; consumers only care that the sample count is realistic.
+        for (uint16_t i = 0; i < FRAME_SAMPLES * 2; i++) {
+            _pcm[i] = (int16_t)((frame[i % n] - 128) * _volume);
+        }
+
+        bool continueI2S = true;
+        if (audio_process_i2s) {
+            audio_process_i2s(_pcm, FRAME_SAMPLES, 16, 2, &continueI2S);
+        }
+    }
+}
+
+// False once the data runs out (after the EOF callback).
+bool Audio::loopWav() {
+    uint32_t frameBytes = _wavChannels * _wavBits / 8;
+    uint32_t pos = (uint32_t)_file.position();
+    uint32_t left = pos < _wavDataEnd ? (_wavDataEnd - pos) / frameBytes : 0;
+    uint32_t frames = left < FRAME_SAMPLES ? left : FRAME_SAMPLES;
+    size_t n = frames ? _file.read(_inBuff, frames * frameBytes) : 0;
+    if (n == 0) {
+        String path = _file.path();
+        _file.close();
+        _running = false;
+        if (audio_eof_mp3) audio_eof_mp3(path.c_str());
+        return false;
+    }
+    frames = n / frameBytes;
+
+    uint32_t bytesPerSample = _wavBits / 8;
+    for (uint32_t i = 0; i < frames; i++) {
+        for (uint8_t ch = 0; ch < 2; ch++) {
+            const uint8_t* in = _inBuff + i * frameBytes + (_wavChannels == 2 ? ch * bytesPerSample : 0);
+            int32_t sample = (int16_t)(in[bytesPerSample - 2] | (in[bytesPerSample - 1] << 8));
+            _pcm[i * 2 + ch] = (int16_t)(sample * _volume / 21);
+        }
+    }
+
+    bool continueI2S = true;
+    if (audio_process_i2s) {
+        audio_process_i2s(_pcm, frames, 16, 2, &continueI2S);
+    }
+    return true;
+}
+
+uint32_t Audio::getFilePos() {
+    return _file ? (uint32_t)_file.position() : 0;
+}
+
+uint32_t Audio::getFileSize() {
+    return _file ? (uint32_t)_file.size() : 0;
+}
+
+bool Audio::setFilePos(uint32_t pos) {
+    return _file && _file.seek(pos);
+}
+
+bool Audio::setAudioPlayPosition(uint16_t sec) {
+    return setFilePos((_wavRate ? _wavDataOffset : 0) + sec * bytesPerSecond());
+}
+
+uint32_t Audio::getAudioCurrentTime() {
+    uint32_t pos = getFilePos();
+    if (_wavRate) pos = pos > _wavDataOffset ? pos - _wavDataOffset : 0;
+    return pos / bytesPerSecond();
+}
+
+uint32_t Audio::getAudioFileDuration() {
+    if (_wavRate) return (_wavDataEnd - _wavDataOffset) / bytesPerSecond();
+    return getFileSize() / bytesPerSecond();
+}
@@ -0,0 +1,316 @@
+// ============================================================================
+// FakeFS.cpp (native fake)
+// Host-directory implementation of fs::File, fs::FS and the SD global.
+// ============================================================================
+#include <FS.h>
+#include <SD.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+fs::SDFS SD;
+
+namespace {
+
+constexpr size_t SECTOR = 512;
+// Start token, data, CRC and the gap before the next block, in bytes.
+constexpr size_t SECTOR_WIRE_BYTES = SECTOR + 4;
+
+std::mutex busMutex;
+uint32_t commandUs = 0;
+FakeSdStats sdStats = {};
+std::atomic<bool> cardInserted{true};
+
+// Holds the bus for one command moving `sectors` sectors.
+void holdBus(size_t sectors) {
+    uint32_t frequency = SD.frequency() ? SD.frequency() : 4000000;
+    uint64_t us = commandUs + sectors * SECTOR_WIRE_BYTES * 8 * 1000000ull / frequency;
+    sdStats.commands++;
+    sdStats.sectors += sectors;
+    sdStats.busUs += us;
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+}
+
+void fake_sd_set_command_us(uint32_t us) {
+    std::lock_guard<std::mutex> lock(busMutex);
+    commandUs = us;
+}
+
+FakeSdStats fake_sd_stats() {
+    std::lock_guard<std::mutex> lock(busMutex);
+    return sdStats;
+}
+
+void fake_sd_clear_stats() {
+    std::lock_guard<std::mutex> lock(busMutex);
+    uint32_t open = sdStats.openFiles;
+    sdStats = {};
+    sdStats.openFiles = open;
+    sdStats.peakOpenFiles = open;
+}
+
+void fake_sd_set_inserted(bool inserted) {
+    cardInserted = inserted;
+}
+
+static void countOpen(int delta) {
+    std::lock_guard<std::mutex> lock(busMutex);
+    sdStats.openFiles += delta;
+    if (delta > 0) sdStats.opens++;
+    if (sdStats.openFiles > sdStats.peakOpenFiles) sdStats.peakOpenFiles = sdStats.openFiles;
+}
+
+namespace fs {
+
+struct FileImpl {
+    std::string path;      // Card-absolute path, as returned by File::path()
+    std::string hostPath;
+    FILE* fp = nullptr;
+    DIR* dir = nullptr;
+    std::string nextName;  // Scratch for getNextFileName() results
+    int64_t window = -1;   // Sector in the FATFS window cache
+
+    FileImpl() { countOpen(1); }
+    ~FileImpl() {
+        if (fp) fclose(fp);
+        if (dir) closedir(dir);
+        countOpen(-1);
+    }
+};
+
+static std::string joinPath(const std::string& dir, const char* name) {
+    if (dir.empty() || dir.back() != '/') return dir + "/" + name;
+    return dir + name;
+}
+
+size_t File::write(uint8_t c) { return write(&c, 1); }
+
+size_t File::write(const uint8_t* buf, size_t size) {
+    if (!_impl || !_impl->fp || !cardInserted) return 0;
+    return fwrite(buf, 1, size, _impl->fp);
+}
+
+int File::available() {
+    if (!_impl || !_impl->fp) return 0;
+    return (int)(size() - position());
+}
+
+int File::read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+// Replays FATFS's f_read() against the bus model.
+static void modelRead(FileImpl& impl, size_t pos, size_t len) {
+    std::lock_guard<std::mutex> lock(busMutex);
+    if (commandUs == 0) return;
+    size_t end = pos + len;
+    while (pos < end) {
+        if (pos % SECTOR == 0 && end - pos >= SECTOR) {
+            size_t sectors = (end - pos) / SECTOR;
+            holdBus(sectors);
+            pos += sectors * SECTOR;
+            continue;
+        }
+        int64_t sector = (int64_t)(pos / SECTOR);
+        if (impl.window != sector) {
+            holdBus(1);
+            impl.window = sector;
+        }
+        pos = (size_t)(sector + 1) * SECTOR < end ? (size_t)(sector + 1) * SECTOR : end;
+    }
+}
+
+size_t File::read(uint8_t* buf, size_t size) {
+    if (!_impl || !_impl->fp || !cardInserted) return 0;
+    size_t pos = position();
+    size_t n = fread(buf, 1, size, _impl->fp);
+    if (n > 0) modelRead(*_impl, pos, n);
+    return n;
+}
+
+int File::peek() {
+    if (!_impl || !_impl->fp) return -1;
+    int c = fgetc(_impl->fp);
+    if (c != EOF) ungetc(c, _impl->fp);
+    return c == EOF ? -1 : c;
+}
+
+void File::flush() {
+    if (_impl && _impl->fp) fflush(_impl->fp);
+}
+
+bool File::seek(uint32_t pos, SeekMode mode) {
+    if (!_impl || !_impl->fp) return false;
+    int whence = mode == SeekCur ? SEEK_CUR : (mode == SeekEnd ? SEEK_END : SEEK_SET);
+    return fseek(_impl->fp, (long)pos, whence) == 0;
+}
+
+size_t File::position() const {
+    if (!_impl || !_impl->fp) return 0;
+    long pos = ftell(_impl->fp);
+    return pos < 0 ? 0 : (size_t)pos;
+}
+
+size_t File::size() const {
+    if (!_impl) return 0;
+    struct stat st;
+    if (_impl->fp) {
+        fflush(_impl->fp);
+        if (fstat(fileno(_impl->fp), &st) == 0) return (size_t)st.st_size;
+    }
+    return stat(_impl->hostPath.c_str(), &st) == 0 && !S_ISDIR(st.st_mode) ? (size_t)st.st_size : 0;
+}
+
+void File::close() {
+    _impl.reset();
+}
+
+File::operator bool() const {
+    return _impl && (_impl->fp || _impl->dir);
+}
+
+time_t File::getLastWrite() {
+    struct stat st;
+    if (!_impl || stat(_impl->hostPath.c_str(), &st) != 0) return 0;
+    return st.st_mtime;
+}
+
+const char* File::path() const {
+    return _impl ? _impl->path.c_str() : nullptr;
+}
+
+const char* File::name() const {
+    if (!_impl) return nullptr;
+    size_t slash = _impl->path.find_last_of('/');
+    return _impl->path.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+}
+
+bool File::isDirectory() {
+    return _impl && _impl->dir;
+}
+
+File File::openNextFile(const char* mode) {
+    if (!_impl || !_impl->dir) return File();
+    struct dirent* ent;
+    while ((ent = readdir(_impl->dir)) != nullptr) {
+        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) continue;
+        return SD.open(joinPath(_impl->path, ent->d_name).c_str(), mode);
+    }
+    return File();
+}
+
+String File::getNextFileName() {
+    return getNextFileName(nullptr);
+}
+
+String File::getNextFileName(bool* isDir) {
+    if (!_impl || !_impl->dir) return String();
+    struct dirent* ent;
+    while ((ent = readdir(_impl->dir)) != nullptr) {
+        if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0) continue;
+        if (isDir) {
+            bool dir = ent->d_type == DT_DIR;
+            if (ent->d_type == DT_UNKNOWN) {
+                struct stat st;
+                std::string host = joinPath(_impl->hostPath, ent->d_name);
+                dir = stat(host.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+            }
+            *isDir = dir;
+        }
+        return String(joinPath(_impl->path, ent->d_name).c_str());
+    }
+    return String();
+}
+
+void File::rewindDirectory() {
+    if (_impl && _impl->dir) rewinddir(_impl->dir);
+}
+
+std::string FS::_hostPath(const char* path) const {
+    std::string p = path ? path : "/";
+    if (p.empty() || p[0] != '/') p = "/" + p;
+    return _root + p;
+}
+
+File FS::open(const char* path, const char* mode, const bool create) {
+    (void)create;
+    if (!_ready()) return File();
+
+    auto impl = std::make_shared<FileImpl>();
+    impl->path = path && path[0] == '/' ? path : std::string("/") + (path ? path : "");
+    if (impl->path.size() > 1 && impl->path.back() == '/') impl->path.pop_back();
+    impl->hostPath = _hostPath(impl->path.c_str());
+
+    struct stat st;
+    if (stat(impl->hostPath.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+        impl->dir = opendir(impl->hostPath.c_str());
+    } else {
+        const char* m = strcmp(mode, FILE_WRITE) == 0 ? "wb" : (strcmp(mode, FILE_APPEND) == 0 ? "ab" : "rb");
+        impl->fp = fopen(impl->hostPath.c_str(), m);
+    }
+    return (impl->fp || impl->dir) ? File(impl) : File();
+}
+
+bool FS::exists(const char* path) {
+    struct stat st;
+    return _ready() && stat(_hostPath(path).c_str(), &st) == 0;
+}
+
+bool FS::remove(const char* path) {
+    return _ready() && ::unlink(_hostPath(path).c_str()) == 0;
+}
+
+bool FS::rename(const char* pathFrom, const char* pathTo) {
+    return _ready() && ::rename(_hostPath(pathFrom).c_str(), _hostPath(pathTo).c_str()) == 0;
+}
+
+bool FS::mkdir(const char* path) {
+    return _ready() && ::mkdir(_hostPath(path).c_str(), 0755) == 0;
+}
+
+bool FS::rmdir(const char* path) {
+    return _ready() && ::rmdir(_hostPath(path).c_str()) == 0;
+}
+
+bool FS::_ready() const {
+    return _mounted && cardInserted;
+}
+
+bool SDFS::begin(uint8_t ssPin, SPIClass& spi, uint32_t frequency,
+                 const char* mountpoint, uint8_t max_files, bool format_if_empty) {
+    (void)ssPin; (void)spi; (void)mountpoint; (void)max_files; (void)format_if_empty;
+    struct stat st;
+    _frequency = frequency;
+    _mounted = cardInserted && !_root.empty() && stat(_root.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+    return _mounted;
+}
+
+void SDFS::end() {
+    _mounted = false;
+}
+
+sdcard_type_t SDFS::cardType() {
+    return _mounted ? CARD_SDHC : CARD_NONE;
+}
+
+uint64_t SDFS::cardSize() { return _mounted ? 32ULL << 30 : 0; }
+uint64_t SDFS::totalBytes() { return cardSize(); }
+uint64_t SDFS::usedBytes() { return 0; }
+
+bool SDFS::readRAW(uint8_t* buffer, uint32_t sector) {
+    (void)sector;
+    if (!_ready()) return false;
+    memset(buffer, 0, SECTOR);
+    std::lock_guard<std::mutex> lock(busMutex);
+    if (commandUs > 0) holdBus(1);
+    return true;
+}
+
+} // namespace fs
@@ -0,0 +1,93 @@
+// ============================================================================
+// FakeFreeRTOS.cpp (native fake)
+// FreeRTOS task API and the I2S driver on top of std::thread and sleeps.
+// ============================================================================
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <driver/i2s.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stackDepth,
+                                   void* param, UBaseType_t priority, TaskHandle_t* handle,
+                                   BaseType_t coreId) {
+    (void)name; (void)stackDepth; (void)priority; (void)coreId;
+    std::thread(fn, param).detach();
+    if (handle) *handle = reinterpret_cast<TaskHandle_t>(fn);
+    return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+void vTaskDelete(TaskHandle_t task) {
+    // Host threads simply return from their entry function instead.
+    (void)task;
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t)millis();
+}
+
+void taskYIELD() {
+    std::this_thread::yield();
+}
+
+static uint32_t i2sRate[I2S_NUM_MAX] = { 44100, 44100 };
+static std::atomic<uint64_t> i2sBytes[I2S_NUM_MAX];
+static std::atomic<uint32_t> i2sSlotBits[I2S_NUM_MAX] = { { 16 }, { 16 } };
+static std::function<void(i2s_port_t, uint32_t)> i2sRateHook;
+
+esp_err_t i2s_write(i2s_port_t port, const void* src, size_t size, size_t* bytesWritten, TickType_t ticksToWait) {
+    (void)src; (void)ticksToWait;
+    // 16-bit stereo: four bytes per frame.
+    uint64_t us = (uint64_t)size * 1000000ULL / (i2sRate[port] * 4ULL);
+    // Pace against a running deadline, like the DMA clock, so sleep
+    // overshoot does not make the fake DAC run slow. A writer later than
+    // the DMA queue could cover means it ran dry; the clock restarts from
+    // now. Per writer thread, as the benches leave several outputs
+    // running on one port.
+    static thread_local std::chrono::steady_clock::time_point due;
+    auto now = std::chrono::steady_clock::now();
+    if (now - due > std::chrono::milliseconds(20)) due = now;
+    due += std::chrono::microseconds(us);
+    std::this_thread::sleep_until(due);
+    i2sBytes[port] += size;
+    if (bytesWritten) *bytesWritten = size;
+    return ESP_OK;
+}
+
+esp_err_t i2s_zero_dma_buffer(i2s_port_t port) {
+    (void)port;
+    return ESP_OK;
+}
+
+esp_err_t i2s_set_sample_rates(i2s_port_t port, uint32_t rate) {
+    i2sRate[port] = rate;
+    if (i2sRateHook) i2sRateHook(port, rate);
+    return ESP_OK;
+}
+
+esp_err_t i2s_set_clk(i2s_port_t port, uint32_t rate, uint32_t bits, i2s_channel_t ch) {
+    (void)ch;
+    // High half: bits per slot, when wider than the samples.
+    i2sSlotBits[port] = (bits >> 16) ? (bits >> 16) : (bits & 0xFFFF);
+    i2sRate[port] = rate;
+    if (i2sRateHook) i2sRateHook(port, rate);
+    return ESP_OK;
+}
+
+void fake_i2s_on_rate_change(std::function<void(i2s_port_t port, uint32_t rate)> hook) {
+    i2sRateHook = hook;
+}
+
+uint64_t fake_i2s_bytes_written(i2s_port_t port) {
+    return i2sBytes[port];
+}
+
+uint32_t fake_i2s_slot_bits(i2s_port_t port) {
+    return i2sSlotBits[port];
+}
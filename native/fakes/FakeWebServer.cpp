@@ -0,0 +1,188 @@
+// ============================================================================
+// FakeWebServer.cpp (native fake)
+// ============================================================================
+#include <ESPAsyncWebServer.h>
+
+namespace {
+
+class BasicResponse : public AsyncWebServerResponse {
+public:
+    BasicResponse(int code, const String& contentType, const char* data, size_t len)
+        : AsyncWebServerResponse(code, contentType), _body(data, len) {}
+
+    void drain(std::string& out, size_t chunkSize) override {
+        (void)chunkSize;
+        out = _body;
+    }
+
+private:
+    std::string _body;
+};
+
+class ChunkedResponse : public AsyncWebServerResponse {
+public:
+    ChunkedResponse(const String& contentType, AwsResponseFiller filler)
+        : AsyncWebServerResponse(200, contentType), _filler(filler) {}
+
+    void drain(std::string& out, size_t chunkSize) override {
+        // Pull into a fixed window the way AsyncTCP fills its send buffer.
+        uint8_t buf[4096];
+        if (chunkSize > sizeof(buf)) chunkSize = sizeof(buf);
+        out.clear();
+        size_t index = 0;
+        for (;;) {
+            size_t n = _filler(buf, chunkSize, index);
+            if (n == 0) break;
+            out.append((const char*)buf, n);
+            index += n;
+        }
+    }
+
+private:
+    AwsResponseFiller _filler;
+};
+
+} // namespace
+
+void AsyncEventSourceClient::send(const char* message, const char* event, uint32_t id, uint32_t reconnect) {
+    (void)reconnect;
+    if (id) _lastId = id;
+    messagesSent++;
+    bytesSent += strlen(message);
+    lastMessage = message;
+    lastEvent = event ? event : "";
+    if (onMessage) onMessage(lastEvent.c_str(), message);
+}
+
+void AsyncEventSource::send(const char* message, const char* event, uint32_t id, uint32_t reconnect) {
+    for (auto& client : _clients) {
+        client->send(message, event, id, reconnect);
+    }
+}
+
+AsyncEventSourceClient* AsyncEventSource::connectClient(uint32_t lastId) {
+    _clients.emplace_back(new AsyncEventSourceClient(lastId));
+    AsyncEventSourceClient* client = _clients.back().get();
+    if (_connectcb) _connectcb(client);
+    return client;
+}
+
+AsyncWebServerRequest::~AsyncWebServerRequest() {
+    delete _response;
+}
+
+bool AsyncWebServerRequest::hasParam(const String& name, bool post, bool file) const {
+    return getParam(name, post, file) != nullptr;
+}
+
+AsyncWebParameter* AsyncWebServerRequest::getParam(const String& name, bool post, bool file) const {
+    (void)file;
+    for (auto& p : _params) {
+        if (p.name() == name && p.isPost() == post) return &p;
+    }
+    return nullptr;
+}
+
+bool AsyncWebServerRequest::hasArg(const char* name) const {
+    for (auto& p : _params) {
+        if (p.name() == name) return true;
+    }
+    return false;
+}
+
+const String& AsyncWebServerRequest::arg(const String& name) const {
+    static const String empty;
+    for (auto& p : _params) {
+        if (p.name() == name) return p.value();
+    }
+    return empty;
+}
+
+bool AsyncWebServerRequest::hasHeader(const String& name) const {
+    return getHeader(name) != nullptr;
+}
+
+AsyncWebHeader* AsyncWebServerRequest::getHeader(const String& name) const {
+    for (auto& h : _headers) {
+        if (h.name() == name) return &h;
+    }
+    return nullptr;
+}
+
+void AsyncWebServerRequest::send(int code, const String& contentType, const String& content) {
+    send(beginResponse(code, contentType, content));
+}
+
+void AsyncWebServerRequest::send_P(int code, const String& contentType, const char* content) {
+    send(new BasicResponse(code, contentType, content, strlen(content)));
+}
+
+void AsyncWebServerRequest::send_P(int code, const String& contentType, const uint8_t* content, size_t len) {
+    send(beginResponse_P(code, contentType, content, len));
+}
+
+void AsyncWebServerRequest::send(AsyncWebServerResponse* response) {
+    delete _response;
+    _response = response;
+    _responseCode = response->code();
+    response->drain(_responseBody, _chunkSize);
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginResponse(int code, const String& contentType,
+                                                             const String& content) {
+    return new BasicResponse(code, contentType, content.c_str(), content.length());
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginResponse_P(int code, const String& contentType,
+                                                               const uint8_t* content, size_t len) {
+    return new BasicResponse(code, contentType, (const char*)content, len);
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginChunkedResponse(const String& contentType,
+                                                                    AwsResponseFiller callback) {
+    return new ChunkedResponse(contentType, callback);
+}
+
+void AsyncWebServer::on(const char* uri, WebRequestMethodComposite method, ArRequestHandlerFunction onRequest) {
+    _routes.push_back({String(uri), method, onRequest});
+}
+
+void AsyncWebServer::handle(AsyncWebServerRequest* request) {
+    for (auto& route : _routes) {
+        if ((route.method & request->method()) && route.uri == request->url()) {
+            route.fn(request);
+            return;
+        }
+    }
+    if (_notFound) _notFound(request);
+}
+
+void AsyncWebSocketClient::binary(const uint8_t* message, size_t len) {
+    frames.emplace_back((const char*)message, len);
+    if (onFrame) onFrame(message, len);
+}
+
+void AsyncWebSocket::binaryAll(const uint8_t* message, size_t len) {
+    for (auto& client : _clients) {
+        client->binary(message, len);
+    }
+}
+
+AsyncWebSocketClient* AsyncWebSocket::connectClient() {
+    _clients.emplace_back(new AsyncWebSocketClient(this, _nextId++));
+    AsyncWebSocketClient* client = _clients.back().get();
+    if (_handler) _handler(this, client, WS_EVT_CONNECT, nullptr, nullptr, 0);
+    return client;
+}
+
+void AsyncWebSocket::receive(AsyncWebSocketClient* client, const uint8_t* data, size_t len) {
+    AwsFrameInfo info = {};
+    info.message_opcode = WS_BINARY;
+    info.final = 1;
+    info.masked = 1;
+    info.opcode = WS_BINARY;
+    info.len = len;
+    info.index = 0;
+    std::vector<uint8_t> copy(data, data + len);
+    if (_handler) _handler(this, client, WS_EVT_DATA, &info, copy.data(), len);
+}
@@ -0,0 +1,164 @@
+// ============================================================================
+// FakeWiFiUdp.cpp (native fake)
+// ============================================================================
+#include <WiFiUdp.h>
+#include <esp_timer.h>
+#include <algorithm>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <map>
+#include <mutex>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+struct Impairment {
+    uint32_t delayUs = 0;
+    uint32_t jitterUs = 0;
+    float lossRate = 0;
+    uint32_t dropped = 0;
+};
+
+static std::mutex impairmentMutex;
+static std::map<uint16_t, Impairment> impairments;
+
+void fake_udp_set_impairment(uint16_t port, uint32_t delayUs, uint32_t jitterUs, float lossRate) {
+    std::lock_guard<std::mutex> lock(impairmentMutex);
+    Impairment& i = impairments[port];
+    i.delayUs = delayUs;
+    i.jitterUs = jitterUs;
+    i.lossRate = lossRate;
+    i.dropped = 0;
+}
+
+uint32_t fake_udp_dropped(uint16_t port) {
+    std::lock_guard<std::mutex> lock(impairmentMutex);
+    auto it = impairments.find(port);
+    return it == impairments.end() ? 0 : it->second.dropped;
+}
+
+WiFiUDP::WiFiUDP()
+    : _fd(-1), _port(0), _outPort(0), _readPos(0), _remotePort(0), _rng(1234) {
+}
+
+WiFiUDP::~WiFiUDP() {
+    stop();
+}
+
+bool WiFiUDP::ensureSocket() {
+    if (_fd >= 0) return true;
+    _fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (_fd < 0) return false;
+    fcntl(_fd, F_SETFL, O_NONBLOCK);
+    int size = 1 << 20;
+    setsockopt(_fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    return true;
+}
+
+uint8_t WiFiUDP::begin(uint16_t port) {
+    stop();
+    if (!ensureSocket()) return 0;
+
+    int one = 1;
+    setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (bind(_fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        stop();
+        return 0;
+    }
+    _port = port;
+    return 1;
+}
+
+uint8_t WiFiUDP::beginMulticast(IPAddress multicast, uint16_t port) {
+    (void)multicast;
+    return begin(port);
+}
+
+void WiFiUDP::stop() {
+    if (_fd >= 0) close(_fd);
+    _fd = -1;
+    _port = 0;
+    _held.clear();
+}
+
+int WiFiUDP::beginPacket(IPAddress ip, uint16_t port) {
+    if (!ensureSocket()) return 0;
+    _out.clear();
+    _outIP = ip;
+    _outPort = port;
+    return 1;
+}
+
+size_t WiFiUDP::write(const uint8_t* buffer, size_t size) {
+    _out.append((const char*)buffer, size);
+    return size;
+}
+
+int WiFiUDP::endPacket() {
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);   // Every address is this host
+    addr.sin_port = htons(_outPort);
+    ssize_t n = sendto(_fd, _out.data(), _out.size(), 0, (sockaddr*)&addr, sizeof(addr));
+    return n == (ssize_t)_out.size() ? 1 : 0;
+}
+
+int WiFiUDP::parsePacket() {
+    if (_fd < 0) return 0;
+
+    uint64_t now = esp_timer_get_time();
+    Impairment net;
+    {
+        std::lock_guard<std::mutex> lock(impairmentMutex);
+        auto it = impairments.find(_port);
+        if (it != impairments.end()) net = it->second;
+    }
+    uint32_t dropped = 0;
+    char buffer[2048];
+    sockaddr_in from = {};
+    socklen_t fromLen = sizeof(from);
+    ssize_t n;
+
+    while ((n = recvfrom(_fd, buffer, sizeof(buffer), 0, (sockaddr*)&from, &fromLen)) > 0) {
+        fromLen = sizeof(from);
+        if (net.lossRate > 0 && std::uniform_real_distribution<float>(0, 1)(_rng) < net.lossRate) {
+            dropped++;
+            continue;
+        }
+        int64_t jitter = net.jitterUs
+            ? std::uniform_int_distribution<int64_t>(-(int64_t)net.jitterUs, net.jitterUs)(_rng) : 0;
+        uint64_t release = now + net.delayUs + jitter;
+        uint32_t ip = ntohl(from.sin_addr.s_addr);
+        Datagram d{ release, std::string(buffer, n),
+                    IPAddress(ip >> 24, ip >> 16, ip >> 8, ip), ntohs(from.sin_port) };
+        auto at = std::upper_bound(_held.begin(), _held.end(), d,
+                                   [](const Datagram& a, const Datagram& b) { return a.releaseUs < b.releaseUs; });
+        _held.insert(at, std::move(d));
+    }
+
+    if (dropped > 0) {
+        std::lock_guard<std::mutex> lock(impairmentMutex);
+        impairments[_port].dropped += dropped;
+    }
+
+    if (_held.empty() || _held.front().releaseUs > now) return 0;
+
+    _current = std::move(_held.front().data);
+    _remoteIP = _held.front().ip;
+    _remotePort = _held.front().port;
+    _held.pop_front();
+    _readPos = 0;
+    return (int)_current.size();
+}
+
+int WiFiUDP::read(uint8_t* buffer, size_t len) {
+    size_t n = std::min(len, _current.size() - _readPos);
+    memcpy(buffer, _current.data() + _readPos, n);
+    _readPos += n;
+    return (int)n;
+}
@@ -0,0 +1,112 @@
+// ============================================================================
+// FakeWire.cpp (native fake)
+// ============================================================================
+#include <Wire.h>
+#include <chrono>
+#include <map>
+#include <mutex>
+
+TwoWire Wire;
+
+namespace {
+
+struct Device {
+    uint8_t page = 0;
+    uint8_t pointer = 0;
+    uint8_t registers[256][128] = {};
+};
+
+std::mutex busMutex;
+std::map<uint8_t, Device> devices;
+std::vector<FakeWireTransaction> transactionLog;
+FakeWireStats stats = {};
+
+// Start, 9 clocks per byte (address included), stop.
+void holdBus(size_t bytes, uint32_t frequency) {
+    uint64_t bits = 2 + 9 * (bytes + 1);
+    auto until = std::chrono::steady_clock::now() +
+                 std::chrono::nanoseconds(bits * 1000000000ull / (frequency ? frequency : 100000));
+    while (std::chrono::steady_clock::now() < until) {
+    }
+    stats.busUs += bits * 1000000ull / (frequency ? frequency : 100000);
+}
+
+}
+
+bool TwoWire::begin(int sda, int scl, uint32_t frequency) {
+    (void)sda; (void)scl;
+    if (frequency) _frequency = frequency;
+    return true;
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+    _address = address;
+    _tx.clear();
+}
+
+size_t TwoWire::write(uint8_t data) {
+    _tx.push_back(data);
+    return 1;
+}
+
+size_t TwoWire::write(const uint8_t* data, size_t len) {
+    _tx.insert(_tx.end(), data, data + len);
+    return len;
+}
+
+uint8_t TwoWire::endTransmission(bool sendStop) {
+    (void)sendStop;
+    std::lock_guard<std::mutex> lock(busMutex);
+    Device& device = devices[_address];
+    if (!_tx.empty()) {
+        device.pointer = _tx[0] & 0x7F;
+        for (size_t i = 1; i < _tx.size(); i++) {
+            if (device.pointer == 0) device.page = _tx[i];
+            device.registers[device.page][device.pointer] = _tx[i];
+            device.pointer = (device.pointer + 1) & 0x7F;
+        }
+    }
+    holdBus(_tx.size(), _frequency);
+    stats.transactions++;
+    stats.bytes += (uint32_t)_tx.size();
+    transactionLog.push_back(FakeWireTransaction{ _address, _tx });
+    return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t len, bool sendStop) {
+    (void)sendStop;
+    std::lock_guard<std::mutex> lock(busMutex);
+    Device& device = devices[address];
+    _rx.clear();
+    _rxPos = 0;
+    for (uint8_t i = 0; i < len; i++) {
+        _rx.push_back(device.registers[device.page][device.pointer]);
+        device.pointer = (device.pointer + 1) & 0x7F;
+    }
+    holdBus(len, _frequency);
+    return len;
+}
+
+int TwoWire::available() { return (int)(_rx.size() - _rxPos); }
+
+int TwoWire::read() { return _rxPos < _rx.size() ? _rx[_rxPos++] : -1; }
+
+FakeWireStats fake_wire_stats() {
+    std::lock_guard<std::mutex> lock(busMutex);
+    return stats;
+}
+
+const std::vector<FakeWireTransaction>& fake_wire_log() {
+    return transactionLog;
+}
+
+void fake_wire_clear_log() {
+    std::lock_guard<std::mutex> lock(busMutex);
+    transactionLog.clear();
+    stats = {};
+}
+
+uint8_t fake_wire_register(uint8_t address, uint8_t page, uint8_t reg) {
+    std::lock_guard<std::mutex> lock(busMutex);
+    return devices[address].registers[page][reg & 0x7F];
+}
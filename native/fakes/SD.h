@@ -0,0 +1,67 @@
+// ============================================================================
+// SD.h (native fake)
+// ============================================================================
+#ifndef FAKE_SD_H
+#define FAKE_SD_H
+
+#include <FS.h>
+#include <SPI.h>
+
+typedef enum {
+    CARD_NONE,
+    CARD_MMC,
+    CARD_SD,
+    CARD_SDHC,
+    CARD_UNKNOWN
+} sdcard_type_t;
+
+namespace fs {
+
+class SDFS : public FS {
+public:
+    bool begin(uint8_t ssPin = 5, SPIClass& spi = SPI, uint32_t frequency = 4000000,
+               const char* mountpoint = "/sd", uint8_t max_files = 5, bool format_if_empty = false);
+    void end();
+    sdcard_type_t cardType();
+    uint64_t cardSize();
+    uint64_t totalBytes();
+    uint64_t usedBytes();
+    bool readRAW(uint8_t* buffer, uint32_t sector);
+
+    // Host-only: the SPI clock most recently requested through begin().
+    uint32_t frequency() const { return _frequency; }
+
+private:
+    uint32_t _frequency = 0;
+};
+
+} // namespace fs
+
+extern fs::SDFS SD;
+
+// Host-only SPI bus model, off until a command cost is set. Reads then hold
+// the caller, one at a time on the shared bus, the way FATFS drives the
+// card: a sector only partly read goes through the one-sector window cache
+// (a single-block read unless the window already holds it); whole aligned
+// sectors go as one multi-block read. Each command costs `commandUs` plus
+// its sectors at the clock SD.begin() was given.
+struct FakeSdStats {
+    uint32_t commands;
+    uint64_t sectors;
+    uint64_t busUs;
+    uint32_t openFiles;    // Files and directories open right now
+    uint32_t peakOpenFiles;
+    uint32_t opens;        // Files and directories opened
+};
+
+void fake_sd_set_command_us(uint32_t us);
+FakeSdStats fake_sd_stats();
+void fake_sd_clear_stats();
+
+// Host-only: pulls the card (or puts it back). A pulled card fails every
+// call, mounted or not, until it is back and mounted again.
+void fake_sd_set_inserted(bool inserted);
+
+using namespace fs;
+
+#endif
@@ -0,0 +1,19 @@
+// ============================================================================
+// SPI.h (native fake)
+// ============================================================================
+#ifndef FAKE_SPI_H
+#define FAKE_SPI_H
+
+#include <Arduino.h>
+
+class SPIClass {
+public:
+    void begin(int8_t sck = -1, int8_t miso = -1, int8_t mosi = -1, int8_t ss = -1) {
+        (void)sck; (void)miso; (void)mosi; (void)ss;
+    }
+    void end() {}
+};
+
+extern SPIClass SPI;
+
+#endif
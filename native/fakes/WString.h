@@ -0,0 +1,115 @@
+// ============================================================================
+// WString.h (native fake)
+// Minimal Arduino String backed by std::string for the host build.
+// ============================================================================
+#ifndef FAKE_WSTRING_H
+#define FAKE_WSTRING_H
+
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+
+class StringSumHelper;
+
+class String {
+public:
+    String() {}
+    String(const char* s) : _s(s ? s : "") {}
+    String(const std::string& s) : _s(s) {}
+    String(char c) : _s(1, c) {}
+    String(int v) : _s(std::to_string(v)) {}
+    String(unsigned int v) : _s(std::to_string(v)) {}
+    String(long v) : _s(std::to_string(v)) {}
+    String(unsigned long v) : _s(std::to_string(v)) {}
+    String(float v, unsigned int decimals = 2) : _s(_fmt(v, decimals)) {}
+    String(double v, unsigned int decimals = 2) : _s(_fmt(v, decimals)) {}
+
+    const char* c_str() const { return _s.c_str(); }
+    unsigned int length() const { return (unsigned int)_s.length(); }
+    bool reserve(unsigned int size) { _s.reserve(size); return true; }
+    bool isEmpty() const { return _s.empty(); }
+
+    bool concat(const String& s) { _s += s._s; return true; }
+    bool concat(const char* s) { if (s) _s += s; return true; }
+    bool concat(const char* s, unsigned int len) { if (s) _s.append(s, len); return true; }
+    bool concat(char c) { _s += c; return true; }
+    bool concat(int v) { _s += std::to_string(v); return true; }
+    bool concat(unsigned int v) { _s += std::to_string(v); return true; }
+    bool concat(long v) { _s += std::to_string(v); return true; }
+    bool concat(unsigned long v) { _s += std::to_string(v); return true; }
+    bool concat(double v) { _s += _fmt(v, 2); return true; }
+
+    template <typename T>
+    String& operator+=(const T& v) { concat(v); return *this; }
+
+    char operator[](unsigned int i) const { return i < _s.size() ? _s[i] : 0; }
+    char& operator[](unsigned int i) { return _s[i]; }
+    char charAt(unsigned int i) const { return (*this)[i]; }
+
+    bool equals(const String& s) const { return _s == s._s; }
+    bool operator==(const String& s) const { return _s == s._s; }
+    bool operator==(const char* s) const { return _s == (s ? s : ""); }
+    bool operator!=(const String& s) const { return !(*this == s); }
+    bool operator!=(const char* s) const { return !(*this == s); }
+    bool operator<(const String& s) const { return _s < s._s; }
+
+    bool startsWith(const String& p) const { return _s.compare(0, p._s.size(), p._s) == 0; }
+    bool endsWith(const String& p) const {
+        return _s.size() >= p._s.size() &&
+               _s.compare(_s.size() - p._s.size(), p._s.size(), p._s) == 0;
+    }
+    int indexOf(char c, unsigned int from = 0) const {
+        size_t i = _s.find(c, from); return i == std::string::npos ? -1 : (int)i;
+    }
+    int indexOf(const String& s, unsigned int from = 0) const {
+        size_t i = _s.find(s._s, from); return i == std::string::npos ? -1 : (int)i;
+    }
+    int lastIndexOf(char c) const {
+        size_t i = _s.rfind(c); return i == std::string::npos ? -1 : (int)i;
+    }
+    String substring(unsigned int from) const { return from < _s.size() ? String(_s.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const {
+        if (from > to) std::swap(from, to);
+        return from < _s.size() ? String(_s.substr(from, to - from)) : String();
+    }
+    void replace(const String& find, const String& with) {
+        if (find._s.empty()) return;
+        size_t pos = 0;
+        while ((pos = _s.find(find._s, pos)) != std::string::npos) {
+            _s.replace(pos, find._s.size(), with._s);
+            pos += with._s.size();
+        }
+    }
+    void toLowerCase() { for (auto& c : _s) c = (char)tolower((unsigned char)c); }
+    void toUpperCase() { for (auto& c : _s) c = (char)toupper((unsigned char)c); }
+    void trim() {
+        size_t b = _s.find_first_not_of(" \t\r\n");
+        size_t e = _s.find_last_not_of(" \t\r\n");
+        _s = b == std::string::npos ? std::string() : _s.substr(b, e - b + 1);
+    }
+    long toInt() const { return strtol(_s.c_str(), nullptr, 10); }
+    float toFloat() const { return strtof(_s.c_str(), nullptr); }
+
+private:
+    std::string _s;
+
+    static std::string _fmt(double v, unsigned int decimals) {
+        char buf[64];
+        snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+        return buf;
+    }
+};
+
+class StringSumHelper : public String {
+public:
+    StringSumHelper(const String& s) : String(s) {}
+    StringSumHelper(const char* s) : String(s) {}
+};
+
+inline StringSumHelper operator+(const String& a, const String& b) { String r(a); r.concat(b); return r; }
+inline StringSumHelper operator+(const String& a, const char* b) { String r(a); r.concat(b); return r; }
+inline StringSumHelper operator+(const char* a, const String& b) { String r(a); r.concat(b); return r; }
+inline bool operator==(const char* a, const String& b) { return b == a; }
+
+#endif
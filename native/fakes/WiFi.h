@@ -0,0 +1,33 @@
+// ============================================================================
+// WiFi.h (native fake)
+// ============================================================================
+#ifndef FAKE_WIFI_H
+#define FAKE_WIFI_H
+
+#include <Arduino.h>
+
+typedef enum { WL_IDLE_STATUS = 0, WL_CONNECTED = 3, WL_DISCONNECTED = 6 } wl_status_t;
+
+class IPAddress : public Printable {
+public:
+    IPAddress(uint8_t a = 0, uint8_t b = 0, uint8_t c = 0, uint8_t d = 0) : _addr{a, b, c, d} {}
+    uint8_t operator[](int i) const { return _addr[i]; }
+    bool operator==(const IPAddress& other) const { return memcmp(_addr, other._addr, 4) == 0; }
+    String toString() const override;
+
+private:
+    uint8_t _addr[4];
+};
+
+class WiFiClass {
+public:
+    wl_status_t begin(const char* ssid, const char* passphrase = nullptr) {
+        (void)ssid; (void)passphrase; return WL_CONNECTED;
+    }
+    wl_status_t status() { return WL_CONNECTED; }
+    IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+};
+
+extern WiFiClass WiFi;
+
+#endif
@@ -0,0 +1,68 @@
+// ============================================================================
+// WiFiUdp.h (native fake)
+// Real UDP sockets on the loopback interface. Multicast is folded onto
+// 127.0.0.1 (one listener per port), which is enough for a leader and a
+// follower in one process.
+//
+// Host-only impairments, set per local port, apply on the receive side:
+// each datagram is held for delay +/- jitter before parsePacket() sees it
+// (so jitter reorders), and a fraction is dropped.
+// ============================================================================
+#ifndef FAKE_WIFI_UDP_H
+#define FAKE_WIFI_UDP_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <deque>
+#include <random>
+#include <string>
+
+class WiFiUDP {
+public:
+    WiFiUDP();
+    ~WiFiUDP();
+
+    uint8_t begin(uint16_t port);
+    uint8_t beginMulticast(IPAddress multicast, uint16_t port);
+    void stop();
+
+    int beginPacket(IPAddress ip, uint16_t port);
+    size_t write(const uint8_t* buffer, size_t size);
+    int endPacket();
+
+    int parsePacket();
+    int available() { return (int)(_current.size() - _readPos); }
+    int read(uint8_t* buffer, size_t len);
+    IPAddress remoteIP() { return _remoteIP; }
+    uint16_t remotePort() { return _remotePort; }
+
+private:
+    struct Datagram {
+        uint64_t releaseUs;
+        std::string data;
+        IPAddress ip;
+        uint16_t port;
+    };
+
+    int _fd;
+    uint16_t _port;
+    std::string _out;
+    IPAddress _outIP;
+    uint16_t _outPort;
+
+    std::string _current;
+    size_t _readPos;
+    IPAddress _remoteIP;
+    uint16_t _remotePort;
+
+    std::mt19937 _rng;
+    std::deque<Datagram> _held;
+
+    bool ensureSocket();
+};
+
+// Host-only: network conditions for datagrams arriving on a local port.
+void fake_udp_set_impairment(uint16_t port, uint32_t delayUs, uint32_t jitterUs, float lossRate);
+uint32_t fake_udp_dropped(uint16_t port);
+
+#endif
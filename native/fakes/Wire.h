@@ -0,0 +1,54 @@
+// ============================================================================
+// Wire.h (native fake)
+// A recording bus. Every device on it behaves like a TI codec: the first
+// byte of a write sets the register pointer, following bytes auto-increment
+// it, and register 0 of any page selects the page. Each transaction holds
+// the caller for as long as it would occupy a real bus at the set clock.
+// ============================================================================
+#ifndef FAKE_WIRE_H
+#define FAKE_WIRE_H
+
+#include <Arduino.h>
+#include <vector>
+
+class TwoWire {
+public:
+    bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0);
+    bool setClock(uint32_t frequency) { _frequency = frequency; return true; }
+    void beginTransmission(uint8_t address);
+    size_t write(uint8_t data);
+    size_t write(const uint8_t* data, size_t len);
+    uint8_t endTransmission(bool sendStop = true);
+    uint8_t requestFrom(uint8_t address, uint8_t len, bool sendStop = true);
+    int available();
+    int read();
+
+private:
+    uint32_t _frequency = 100000;
+    uint8_t _address = 0;
+    std::vector<uint8_t> _tx;
+    std::vector<uint8_t> _rx;
+    size_t _rxPos = 0;
+};
+
+extern TwoWire Wire;
+
+// Host-only view of the traffic.
+struct FakeWireTransaction {
+    uint8_t address;
+    std::vector<uint8_t> bytes;     // Register pointer first
+};
+
+struct FakeWireStats {
+    uint32_t transactions;
+    uint32_t bytes;                 // After the address byte
+    uint64_t busUs;                 // Modeled at the clock in use
+};
+
+FakeWireStats fake_wire_stats();
+const std::vector<FakeWireTransaction>& fake_wire_log();
+// Clears the log and stats; register contents stay.
+void fake_wire_clear_log();
+uint8_t fake_wire_register(uint8_t address, uint8_t page, uint8_t reg);
+
+#endif
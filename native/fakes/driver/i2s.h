@@ -0,0 +1,34 @@
+// ============================================================================
+// driver/i2s.h (native fake)
+// i2s_write() blocks for as long as the DMA would take to clock the data out
+// at the configured rate, so consumers are paced like on the device.
+// ============================================================================
+#ifndef FAKE_DRIVER_I2S_H
+#define FAKE_DRIVER_I2S_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include "freertos/FreeRTOS.h"
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+typedef enum { I2S_NUM_0 = 0, I2S_NUM_1 = 1, I2S_NUM_MAX } i2s_port_t;
+typedef enum { I2S_BITS_PER_SAMPLE_16BIT = 16, I2S_BITS_PER_SAMPLE_24BIT = 24, I2S_BITS_PER_SAMPLE_32BIT = 32 } i2s_bits_per_sample_t;
+typedef enum { I2S_CHANNEL_MONO = 1, I2S_CHANNEL_STEREO = 2 } i2s_channel_t;
+
+esp_err_t i2s_write(i2s_port_t port, const void* src, size_t size, size_t* bytesWritten, TickType_t ticksToWait);
+esp_err_t i2s_zero_dma_buffer(i2s_port_t port);
+esp_err_t i2s_set_sample_rates(i2s_port_t port, uint32_t rate);
+esp_err_t i2s_set_clk(i2s_port_t port, uint32_t rate, uint32_t bits, i2s_channel_t ch);
+
+// Host-only: total bytes clocked out per port.
+uint64_t fake_i2s_bytes_written(i2s_port_t port);
+// Host-only: slot width last set with i2s_set_clk().
+uint32_t fake_i2s_slot_bits(i2s_port_t port);
+// Host-only: called on the setter's thread whenever a port's rate is set.
+void fake_i2s_on_rate_change(std::function<void(i2s_port_t port, uint32_t rate)> hook);
+
+#endif
@@ -0,0 +1,12 @@
+// ============================================================================
+// esp_timer.h (native fake)
+// ============================================================================
+#ifndef FAKE_ESP_TIMER_H
+#define FAKE_ESP_TIMER_H
+
+#include <cstdint>
+
+// Microseconds since boot, like the ESP-IDF high-resolution timer.
+int64_t esp_timer_get_time();
+
+#endif
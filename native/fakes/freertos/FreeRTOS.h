@@ -0,0 +1,23 @@
+// ============================================================================
+// freertos/FreeRTOS.h (native fake)
+// Tasks map onto std::thread; one tick is one millisecond.
+// ============================================================================
+#ifndef FAKE_FREERTOS_H
+#define FAKE_FREERTOS_H
+
+#include <cstdint>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define configMAX_PRIORITIES 25
+
+#endif
@@ -0,0 +1,79 @@
+# Pre-build step: merges src/Server/Index.h and src/Server/Script.h into one
+# page, gzips it and writes src/Server/WebUi.h with the compressed bytes in
+# PROGMEM plus a strong ETag derived from the content. The header is only
+# rewritten when the page changes, so incremental builds stay incremental.
+#
+# Runs automatically via extra_scripts; can also be run by hand:
+#   python3 scripts/build_web_ui.py
+
+import gzip
+import hashlib
+import os
+import re
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO/SCons
+    PROJECT_DIR = env["PROJECT_DIR"]  # noqa: F821
+except NameError:
+    PROJECT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+SERVER_DIR = os.path.join(PROJECT_DIR, "src", "Server")
+OUTPUT = os.path.join(SERVER_DIR, "WebUi.h")
+
+RAW_LITERAL = re.compile(r'R"rawliteral\((.*)\)rawliteral"', re.S)
+
+
+def read_raw_literal(name):
+    with open(os.path.join(SERVER_DIR, name), encoding="utf-8") as f:
+        match = RAW_LITERAL.search(f.read())
+    if not match:
+        raise RuntimeError("no rawliteral block in " + name)
+    return match.group(1)
+
+
+def render_header(page):
+    # mtime=0 keeps the output byte-identical for identical input.
+    compressed = gzip.compress(page.encode("utf-8"), compresslevel=9, mtime=0)
+    etag = hashlib.sha1(page.encode("utf-8")).hexdigest()[:16]
+
+    lines = []
+    for i in range(0, len(compressed), 16):
+        chunk = compressed[i:i + 16]
+        lines.append("    " + ", ".join("0x%02x" % b for b in chunk) + ",")
+
+    return "\n".join([
+        "// Generated by scripts/build_web_ui.py from Index.h and Script.h.",
+        "// Do not edit; changes are overwritten on the next build.",
+        "#ifndef WEB_UI_H",
+        "#define WEB_UI_H",
+        "",
+        "#include <Arduino.h>",
+        "",
+        "// %d bytes of HTML+JS, %d bytes gzipped" % (len(page.encode("utf-8")), len(compressed)),
+        'static const char WEB_UI_ETAG[] = "\\"%s\\"";' % etag,
+        "",
+        "const uint8_t web_ui_gz[] PROGMEM = {",
+        *lines,
+        "};",
+        "",
+        "#endif",
+        "",
+    ])
+
+
+def main():
+    html = read_raw_literal("Index.h")
+    script = read_raw_literal("Script.h")
+    header = render_header(html.replace("{{SCRIPT_CONTENT}}", script))
+
+    if os.path.exists(OUTPUT):
+        with open(OUTPUT, encoding="utf-8") as f:
+            if f.read() == header:
+                return
+
+    with open(OUTPUT, "w", encoding="utf-8") as f:
+        f.write(header)
+    print("build_web_ui: wrote " + os.path.relpath(OUTPUT, PROJECT_DIR))
+
+
+main()
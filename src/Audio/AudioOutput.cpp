@@ -0,0 +1,159 @@
+// ============================================================================
+// AudioOutput.cpp
+// ============================================================================
+#include "AudioOutput.h"
+
+AudioOutput::AudioOutput()
+    : _port(I2S_NUM_0), _task(nullptr), _running(false), _sampleRate(0), _slotBits(I2S_WORD_BITS),
+      _playing(false), _hold(false), _framesPlayed(0), _underrunEvents(0), _underrunFrames(0),
+      _boundary(0), _boundaryPending(false), _gapStartUs(0),
+      _trackTransitions(0), _lastGapUs(0), _maxGapUs(0),
+      _chunkSeq(0), _chunkFrames(0), _chunkStartUs(0) {
+}
+
+bool AudioOutput::begin(i2s_port_t port, size_t frames) {
+    if (_running) return true;
+
+    if (!_ring.begin(frames)) {
+        Serial.println("ERROR: Not enough memory for the PCM ring buffer!");
+        return false;
+    }
+    _port = port;
+
+    if (xTaskCreatePinnedToCore(taskEntry, "i2s_out", 3072, this, I2S_TASK_PRIORITY,
+                                &_task, AUDIO_TASK_CORE) != pdPASS) {
+        Serial.println("ERROR: Failed to start I2S output task!");
+        return false;
+    }
+
+    _running = true;
+    Serial.printf("✓ PCM ring: %u frames, I2S task on core %d\n",
+                  (unsigned)_ring.capacity(), (int)AUDIO_TASK_CORE);
+    return true;
+}
+
+void AudioOutput::write(const int16_t* samples, size_t frames, uint8_t channels) {
+    while (frames > 0) {
+        size_t n = channels == 1 ? _ring.writeMono(samples, frames)
+                                 : _ring.write(samples, frames);
+        samples += n * channels;
+        frames -= n;
+        if (frames > 0) {
+            vTaskDelay(1);
+        }
+    }
+}
+
+void AudioOutput::waitForSpace(size_t frames) {
+    if (frames > _ring.capacity()) frames = _ring.capacity();
+    while (_ring.space() < frames) {
+        vTaskDelay(1);
+    }
+}
+
+void AudioOutput::markTrackBoundary() {
+    _boundary.store(_ring.writePosition(), std::memory_order_relaxed);
+    _boundaryPending.store(true, std::memory_order_release);
+}
+
+void AudioOutput::drain(uint32_t sampleRate) {
+    uint32_t start = millis();
+    while (_running && latencyUs(sampleRate) > 0 && millis() - start < PCM_DRAIN_TIMEOUT_MS) {
+        vTaskDelay(1);
+    }
+}
+
+void AudioOutput::taskEntry(void* param) {
+    static_cast<AudioOutput*>(param)->run();
+}
+
+void AudioOutput::run() {
+    bool starved = false;
+
+    for (;;) {
+        if (_hold.load(std::memory_order_relaxed)) {
+            _chunkFrames.store(0, std::memory_order_relaxed);
+            memset(_chunk, 0, sizeof(_chunk));
+            size_t written = 0;
+            i2s_write(_port, _chunk, sizeof(_chunk), &written, portMAX_DELAY);
+            continue;
+        }
+
+        _chunkSeq.fetch_add(1, std::memory_order_acq_rel);
+        size_t frames = _ring.read(_chunk, I2S_CHUNK_FRAMES);
+        int64_t chunkStartUs = esp_timer_get_time();
+
+        if (frames == 0) {
+            // Keep the DMA clocked with silence so the DAC PLL stays locked.
+            memset(_chunk, 0, sizeof(_chunk));
+            frames = I2S_CHUNK_FRAMES;
+
+            if (_playing.load(std::memory_order_relaxed)) {
+                if (!starved) _underrunEvents++;
+                starved = true;
+                _underrunFrames += frames;
+
+                if (_boundaryPending.load(std::memory_order_relaxed) && _gapStartUs == 0) {
+                    _gapStartUs = chunkStartUs;
+                }
+            }
+        } else {
+            starved = false;
+            _framesPlayed += frames;
+
+            // First audio past the boundary: the transition is complete.
+            if (_boundaryPending.load(std::memory_order_acquire) &&
+                (ptrdiff_t)(_ring.readPosition() - _boundary.load(std::memory_order_relaxed)) > 0) {
+                _boundaryPending.store(false, std::memory_order_relaxed);
+                uint32_t gapUs = _gapStartUs ? (uint32_t)(chunkStartUs - _gapStartUs) : 0;
+                _lastGapUs = gapUs;
+                if (gapUs > _maxGapUs) _maxGapUs = gapUs;
+                _trackTransitions++;
+                _gapStartUs = 0;
+            } else if (!_boundaryPending.load(std::memory_order_relaxed)) {
+                _gapStartUs = 0;    // Boundary dropped by a discard()
+            }
+        }
+
+        _chunkFrames.store(frames, std::memory_order_relaxed);
+        _chunkStartUs.store(chunkStartUs, std::memory_order_relaxed);
+        _chunkSeq.fetch_add(1, std::memory_order_release);
+
+        size_t written = 0;
+        i2s_write(_port, _chunk, frames * PcmRingBuffer::CHANNELS * sizeof(int16_t),
+                  &written, portMAX_DELAY);
+    }
+}
+
+uint32_t AudioOutput::latencyUs(uint32_t sampleRate) const {
+    if (sampleRate == 0) return 0;
+
+    size_t buffered;
+    uint32_t chunkFrames, before;
+    int64_t chunkStart;
+    do {
+        before = _chunkSeq.load(std::memory_order_acquire);
+        buffered = _ring.available();
+        chunkFrames = _chunkFrames.load(std::memory_order_relaxed);
+        chunkStart = _chunkStartUs.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((before & 1) || before != _chunkSeq.load(std::memory_order_relaxed));
+
+    int64_t chunkUs = (int64_t)chunkFrames * 1000000 / sampleRate;
+    int64_t left = chunkUs - (esp_timer_get_time() - chunkStart);
+    if (left < 0) left = 0;
+    return (uint32_t)((uint64_t)buffered * 1000000 / sampleRate + left);
+}
+
+AudioOutputStats AudioOutput::getStats() const {
+    AudioOutputStats stats;
+    stats.framesPlayed = _framesPlayed.load();
+    stats.underrunEvents = _underrunEvents.load();
+    stats.underrunFrames = _underrunFrames.load();
+    stats.bufferedFrames = _ring.available();
+    stats.capacityFrames = _ring.capacity();
+    stats.trackTransitions = _trackTransitions.load();
+    stats.lastGapUs = _lastGapUs.load();
+    stats.maxGapUs = _maxGapUs.load();
+    return stats;
+}
@@ -0,0 +1,159 @@
+// ============================================================================
+// AudioOutput.h
+// Owns the decoded-PCM ring buffer and the task that feeds I2S from it.
+// The decoder side calls write(); a dedicated high-priority task drains the
+// ring into the I2S DMA, so slow web or SD work on other tasks only shrinks
+// the buffer instead of starving the DAC.
+// ============================================================================
+#ifndef AUDIO_OUTPUT_H
+#define AUDIO_OUTPUT_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <driver/i2s.h>
+#include <esp_timer.h>
+#include "PcmRingBuffer.h"
+
+// ~186 ms at 44.1 kHz: enough to ride out a burst of HTTP requests.
+static constexpr size_t PCM_RING_FRAMES = 8192;
+
+// Frames handed to i2s_write() per call (~5.8 ms at 44.1 kHz).
+static constexpr size_t I2S_CHUNK_FRAMES = 256;
+
+// drain() gives up after this long; a full ring at 8 kHz takes ~1 s.
+static constexpr uint32_t PCM_DRAIN_TIMEOUT_MS = 1500;
+
+// The output path only takes 16-bit PCM, so I2S samples are 16 bits
+// whatever the source depth. Slots are too, except at rates the codec can
+// only be clocked for with wider ones (see DACController::slotBits()).
+static constexpr uint8_t I2S_WORD_BITS = 16;
+
+// Core and priority for the audio tasks. Arduino's loopTask and the WiFi
+// stack keep their defaults; the audio tasks sit above both.
+static constexpr BaseType_t AUDIO_TASK_CORE = 1;
+static constexpr UBaseType_t I2S_TASK_PRIORITY = 20;
+
+struct AudioOutputStats {
+    uint64_t framesPlayed;     // Real audio clocked out
+    uint32_t underrunEvents;   // Times the ring ran dry while playing
+    uint32_t underrunFrames;   // Silence inserted because of those
+    size_t bufferedFrames;
+    size_t capacityFrames;
+    uint32_t trackTransitions;  // Automatic track changes measured below
+    uint32_t lastGapUs;         // Silence between the last two tracks
+    uint32_t maxGapUs;
+};
+
+class AudioOutput {
+public:
+    AudioOutput();
+
+    // Allocates the ring and starts the I2S writer task.
+    bool begin(i2s_port_t port = I2S_NUM_0, size_t frames = PCM_RING_FRAMES);
+    bool isRunning() const { return _running; }
+
+    // Producer side (decoder task). Blocks, one tick at a time, until all
+    // frames fit; the I2S task frees space at the playback rate.
+    void write(const int16_t* samples, size_t frames, uint8_t channels);
+
+    // Producer side, zero-copy: wait until `frames` fit (as write() does),
+    // fill the ring's free run in place, then commit what was written.
+    void waitForSpace(size_t frames);
+    int16_t* writeRegion(size_t& frames) { return _ring.writeRegion(frames); }
+    void commit(size_t frames) { _ring.commit(frames); }
+
+    // Drops whatever is buffered, e.g. when the user skips a track.
+    void discard() {
+        _boundaryPending.store(false, std::memory_order_relaxed);
+        _ring.discardAll();
+    }
+
+    // Producer side: everything written so far belongs to the outgoing
+    // track. The I2S task measures the silence it has to insert between
+    // that last frame and the next one written.
+    void markTrackBoundary();
+
+    // Producer side: waits until everything written so far has been
+    // clocked out at `sampleRate`, so I2S and the codec can be reclocked
+    // without catching the end of it.
+    void drain(uint32_t sampleRate);
+
+    // Holds the ring where it is and clocks out silence instead, so a pause
+    // resumes on the very next buffered frame.
+    void setHold(bool hold) { _hold.store(hold, std::memory_order_relaxed); }
+
+    // While not playing, an empty ring is expected and not an underrun.
+    void setPlaying(bool playing) { _playing.store(playing, std::memory_order_relaxed); }
+
+    size_t buffered() const { return _ring.available(); }
+
+    // Microseconds until a frame written now is clocked out: the ring plus
+    // what is left of the chunk in i2s_write(). The DMA queue behind that
+    // is the same on every box, so sync peers can leave it out.
+    uint32_t latencyUs(uint32_t sampleRate) const;
+
+    // Sync followers and the WAV path set the rate of their stream;
+    // otherwise the decoder configures I2S itself. Setting the rate I2S
+    // already runs at does nothing, as reprogramming it would restart
+    // the DMA mid-stream.
+    void setSampleRate(uint32_t sampleRate) {
+        if (sampleRate == _sampleRate.load(std::memory_order_relaxed)) return;
+        i2s_set_sample_rates(_port, sampleRate);
+        _sampleRate.store(sampleRate, std::memory_order_relaxed);
+    }
+    // The decoder takes I2S over (and may set any rate on it).
+    void releaseSampleRate() { _sampleRate.store(0, std::memory_order_relaxed); }
+    // Last rate set above; 0 if the decoder owns I2S.
+    uint32_t getSampleRate() const { return _sampleRate.load(std::memory_order_relaxed); }
+
+    // Sends the 16-bit samples in slots this wide, to match the codec's
+    // clock plan; the data written stays the same. Decode task only, and
+    // I2S is reprogrammed only when the width changes.
+    void setSlotBits(uint32_t sampleRate, uint8_t slotBits) {
+        if (sampleRate == 0 || slotBits == _slotBits) return;
+        i2s_set_clk(_port, sampleRate, ((uint32_t)slotBits << 16) | I2S_WORD_BITS, I2S_CHANNEL_STEREO);
+        _slotBits = slotBits;
+    }
+    uint8_t getSlotBits() const { return _slotBits; }
+
+    AudioOutputStats getStats() const;
+
+private:
+    PcmRingBuffer _ring;
+    i2s_port_t _port;
+    TaskHandle_t _task;
+    bool _running;
+
+    std::atomic<uint32_t> _sampleRate;
+    uint8_t _slotBits;
+    std::atomic<bool> _playing;
+    std::atomic<bool> _hold;
+    std::atomic<uint64_t> _framesPlayed;
+    std::atomic<uint32_t> _underrunEvents;
+    std::atomic<uint32_t> _underrunFrames;
+
+    std::atomic<size_t> _boundary;
+    std::atomic<bool> _boundaryPending;
+    // Gaps are timed on the I2S task's own clock: from the first silent
+    // chunk to the first audio of the new track. The rate may differ on
+    // each side of the boundary, so frames would not say how long it was.
+    int64_t _gapStartUs;    // I2S task only; 0 while no silence is counted
+    std::atomic<uint32_t> _trackTransitions;
+    std::atomic<uint32_t> _lastGapUs;
+    std::atomic<uint32_t> _maxGapUs;
+
+    // Chunk being clocked out; _chunkSeq is odd while it and the ring
+    // disagree, so latencyUs() never sees a chunk counted twice or not at all.
+    std::atomic<uint32_t> _chunkSeq;
+    std::atomic<uint32_t> _chunkFrames;
+    std::atomic<int64_t> _chunkStartUs;
+
+    int16_t _chunk[I2S_CHUNK_FRAMES * PcmRingBuffer::CHANNELS];
+
+    static void taskEntry(void* param);
+    void run();
+};
+
+#endif
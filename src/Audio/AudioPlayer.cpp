@@ -30,6 +30,13 @@ void audio_showstreamtitle(const char *info) {
   Serial.print("Stream Title: "); Serial.println(info);
 }
 
+void audio_process_i2s(int16_t* outBuff, uint16_t validSamples, uint8_t bitsPerSample,
+                       uint8_t channels, bool* continueI2S) {
+  if (audioPlayerInstance) {
+      audioPlayerInstance->onPcm(outBuff, validSamples, bitsPerSample, channels, continueI2S);
+  }
+}
+
 AudioPlayer::AudioPlayer() {
     audioPlayerInstance = this;
 }
@@ -43,37 +50,229 @@ bool AudioPlayer::begin() {
     }
     
     Serial.println("\n--- Initializing SD Card and Playlist ---");
-    if (!_playlist.begin()) { 
-        Serial.println("FATAL: Failed to initialize SD card or find music!");
-        return false;
+    // The web server may be up already; its handlers wait out the load.
+    _playlist.lockReaders();
+    if (_playlist.begin()) {
+        _playlist.printPlaylist();
+        Serial.printf("Total tracks found: %d\n", _playlist.getTrackCount());
+
+        if (!_metadata.begin(&_playlist)) {
+            Serial.println("WARNING: Track metadata unavailable, listing file names only");
+        }
+        _playlists.begin(&_playlist);
+    } else {
+        // Not fatal: the card monitor loads the library once a card is in.
+        Serial.println("WARNING: No SD card; playback waits for one.");
+        _libraryOffline.store(true);
     }
-    
-    _playlist.printPlaylist();
-    Serial.printf("Total tracks found: %d\n", _playlist.getTrackCount());
+    _libraryVersion = _playlist.getVersion();
+    _playlist.unlockReaders();
     
     audio.setPinout(BCLK_PIN, LRCK_PIN, DOUT_PIN);
-    audio.setVolume(_currentVolume);
+    // Decoder gain stays at unity; the level is set in the codec.
+    audio.setVolume(audio.maxVolume());
+    setVolume(_currentVolume);
+    // Readers see the starting state before the first loop().
+    _updateStateVersion();
     
     Serial.println("=== Audio System Ready ===\n");
 
     return true;
 }
 
+// Decode priority sits below the I2S writer (which only copies) and above
+// loopTask, so decoding is only ever preempted by the output it feeds.
+static constexpr UBaseType_t DECODE_TASK_PRIORITY = 10;
+
+// Upper bound on the back-to-back decoding after a track switch; well under
+// the ring's lead so a stuck file cannot hog the core.
+static constexpr uint32_t PREROLL_BUDGET_US = 100000;
+
+bool AudioPlayer::startTasks() {
+    if (_decodeTask != nullptr) return true;
+
+    if (!_output.begin()) {
+        return false;
+    }
+    if (!_wav.begin()) {
+        return false;
+    }
+
+    if (xTaskCreatePinnedToCore(_decodeTaskEntry, "audio_decode", 8192, this,
+                                DECODE_TASK_PRIORITY, &_decodeTask, AUDIO_TASK_CORE) != pdPASS) {
+        Serial.println("ERROR: Failed to start audio decode task!");
+        return false;
+    }
+
+    Serial.printf("✓ Audio decode task on core %d\n", (int)AUDIO_TASK_CORE);
+
+    // Not fatal: without it the playlist just shows file names.
+    _metadata.startIndexer();
+    return true;
+}
+
+void AudioPlayer::_decodeTaskEntry(void* param) {
+    AudioPlayer* player = static_cast<AudioPlayer*>(param);
+    for (;;) {
+        player->loop();
+        // Back-pressure from the ring paces decoding while playing; this
+        // just keeps an idle player from spinning.
+        vTaskDelay(1);
+    }
+}
+
+void AudioPlayer::ejectLibrary() {
+    _metadata.stopIndexer();
+    _ejected.store(false);
+    while (!post(PlayerCommand::EJECT)) vTaskDelay(pdMS_TO_TICKS(10));
+    while (!_ejected.load()) vTaskDelay(pdMS_TO_TICKS(10));
+    _playlist.unmount();
+}
+
+bool AudioPlayer::reloadLibrary(bool refresh) {
+    _metadata.stopIndexer();
+    _playlist.lockReaders();
+    bool loaded = _playlist.load(refresh);
+    if (loaded) {
+        if (!_metadata.begin(&_playlist)) {
+            Serial.println("WARNING: Track metadata unavailable, listing file names only");
+        }
+        _playlists.begin(&_playlist);
+
+        // Nothing takes from the queue while the decode task is offline.
+        const LibraryChange& change = _playlist.getLastChange();
+        int dropped = _queue.remap([&](int track) { return change.mapIndex(track); });
+        if (dropped > 0) Serial.printf("%d queued track(s) left the library.\n", dropped);
+    }
+    _playlist.unlockReaders();
+    if (!loaded) return false;
+
+    while (!post(PlayerCommand::RELOAD, (int32_t)_playlist.getVersion())) vTaskDelay(pdMS_TO_TICKS(10));
+    _metadata.startIndexer();
+    return true;
+}
+
+// Decode task. The card is going (or gone): drop everything read from it.
+void AudioPlayer::_ejectLibrary() {
+    if (audio.isRunning()) {
+        audio.stopSong();
+    }
+    _wav.close();
+    if (!_outputLent) _discardOutput();
+    _prefetch.reset();
+    _finished = false;
+    _paused = false;
+    _released = false;
+    _libraryOffline.store(true, std::memory_order_release);
+    _ejected.store(true);
+    Serial.println("Library offline; playback stopped.");
+}
+
+// Decode task. A new list is loaded: find the current track in it, and
+// start the play order over from there. Playback stays stopped.
+void AudioPlayer::_reloadLibrary(uint32_t version) {
+    const LibraryChange& change = _playlist.getLastChange();
+    // Indices can only be carried across the one load they saw.
+    bool follows = change.version == version && change.previousVersion == _libraryVersion;
+    int index = follows ? change.mapIndex(_currentTrackIndex) : -1;
+    _orderIndex = follows && _orderIndex >= 0 ? change.mapIndex(_orderIndex) : -1;
+    _currentTrackIndex = index >= 0 ? index : 0;
+
+    int trackCount = _playlist.getTrackCount();
+    if (_shuffle && trackCount > 0) {
+        _shuffleOrder.reset(trackCount, esp_random(), _currentTrackIndex);
+    }
+    _libraryVersion = change.version;
+    _libraryOffline.store(false, std::memory_order_release);
+    Serial.printf("Library online: %d tracks, at track %d%s.\n", trackCount, _currentTrackIndex,
+                  index >= 0 ? "" : " (previous track gone)");
+}
+
+void AudioPlayer::onPcm(int16_t* samples, uint16_t frames, uint8_t bitsPerSample,
+                        uint8_t channels, bool* continueI2S) {
+    _prerolling = false;
+
+    // Until the output task runs (or for formats it does not take), let the
+    // library write I2S itself as before.
+    if (!_output.isRunning() || bitsPerSample != 16 || channels == 0 || channels > 2) {
+        return;
+    }
+
+    *continueI2S = false;
+
+    // After a frame-aligned reconnect, drop up to the exact resume sample.
+    if (_skipFrames > 0) {
+        uint16_t skip = _skipFrames < frames ? _skipFrames : frames;
+        _skipFrames -= skip;
+        samples += skip * channels;
+        frames -= skip;
+    }
+
+    if (_pcmListener) {
+        uint32_t rate = audio.getSampleRate();
+        if (rate > 0) {
+            _pcmListener->onPcm(samples, frames, channels, rate,
+                                esp_timer_get_time() + _output.latencyUs(rate));
+        }
+    }
+
+    _output.write(samples, frames, channels);
+    _trackFrames += frames;
+}
+
+void AudioPlayer::_discardOutput() {
+    _output.discard();
+    if (_pcmListener) _pcmListener->onDiscard();
+}
+
+AudioOutput& AudioPlayer::lendOutput() {
+    if (_decodeTask == nullptr) {
+        _lendOutput();
+    } else {
+        while (!post(PlayerCommand::LEND)) vTaskDelay(pdMS_TO_TICKS(10));
+        while (!_outputLent.load(std::memory_order_acquire)) vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    return _output;
+}
+
+// Decode task (or before it starts): the decoder, the WAV reader and the
+// ring's producer side are all let go here.
+void AudioPlayer::_lendOutput() {
+    if (audio.isRunning()) audio.stopSong();
+    _wav.close();
+    _discardOutput();
+    _finished = false;
+    _outputLent.store(true, std::memory_order_release);
+}
+
 void AudioPlayer::playTrack(int index) {
+    if (!isLibraryOnline()) return;
     if (_playlist.getTrackCount() == 0) {
         Serial.println("ERROR: Cannot set track, playlist is empty.");
         return;
     }
 
+    int trackCount = _playlist.getTrackCount();
+    index = (index % trackCount + trackCount) % trackCount;
+    // A pick from the list while shuffled starts a new cycle there.
+    if (_shuffle && ((int)_shuffleOrder.current() != index || (int)_shuffleOrder.count() != trackCount)) {
+        _shuffleOrder.reset(trackCount, esp_random(), index);
+    }
+    _orderIndex = -1;
+    _switchTrack(index);
+}
+
+// Stops whatever plays and starts `index`, leaving the play order alone.
+void AudioPlayer::_switchTrack(int index) {
     if (audio.isRunning()) {
         audio.stopSong();
     }
+    _wav.close();
+    _discardOutput();
     
     _pausePosition = 0; 
 
-    int trackCount = _playlist.getTrackCount();
-
-    _currentTrackIndex = (index % trackCount + trackCount) % trackCount;
+    _currentTrackIndex = index;
 
     Serial.printf("Switching track to index %d.\n", _currentTrackIndex);
     
@@ -82,18 +281,115 @@ void AudioPlayer::playTrack(int index) {
 }
 
 void AudioPlayer::_startTrack(const char* path) {
+    if (_outputLent) {
+        Serial.println("Output follows the sync leader; local playback is off.");
+        return;
+    }
+
     if (audio.isRunning()) {
         audio.stopSong();
     }
+    _wav.close();
     
     _finished = false;
     _pausePosition = 0;
+    _paused = false;
+    _released = false;
+    _skipFrames = 0;
+    _trackFrames = 0;
+    _output.setHold(false);
+    _prefetch.reset();
+    _seekTable.clear();
 
     Serial.printf("▶ Playing: %s\n", path);
+    if (_openWav(path, 0)) return;
+    if (_output.isRunning() && !_outputLent) _output.releaseSampleRate();
     audio.connecttoFS(SD, path);
 }
 
+// Needs the output task: the reader fills its ring directly.
+bool AudioPlayer::_openWav(const char* path, uint64_t startFrame) {
+    if (!_wavFastPath || !_output.isRunning() || !WavReader::isWavPath(path)) return false;
+    if (!_wav.open(SD, path, startFrame)) return false;
+
+    const WavFormat& format = _wav.format();
+    _output.setSampleRate(format.sampleRate);
+    Serial.printf("WAV direct: %u Hz, %u-bit, %u ch\n", (unsigned)format.sampleRate,
+                  (unsigned)format.bitsPerSample, (unsigned)format.channels);
+    return true;
+}
+
+// The fast path's audio.loop() and onPcm() in one: card to ring with no
+// copy in between. Like write() for the decoder, waiting for room is what
+// paces it, so loop() does not spin on a full ring.
+void AudioPlayer::_pumpWav() {
+    if (_paused || _wav.atEnd()) return;
+
+    _output.waitForSpace(WAV_PUMP_FRAMES);
+
+    uint32_t rate = _wav.format().sampleRate;
+    size_t budget = WAV_PUMP_FRAMES;
+    while (budget > 0) {
+        size_t frames;
+        int16_t* region = _output.writeRegion(frames);
+        if (frames == 0) return;
+        if (frames > budget) frames = budget;
+
+        size_t n = _wav.read(region, frames);
+        if (n == 0) {
+            Serial.println("WARNING: WAV read failed; moving on.");
+            _wav.close();
+            _finished = true;
+            return;
+        }
+        _prerolling = false;
+
+        if (_pcmListener) {
+            _pcmListener->onPcm(region, n, PcmRingBuffer::CHANNELS, rate,
+                                esp_timer_get_time() + _output.latencyUs(rate));
+        }
+        _output.commit(n);
+        _trackFrames += n;
+        budget -= n;
+
+        if (_wav.atEnd()) {
+            Serial.println("EOF: WAV");
+            _finished = true;
+            return;
+        }
+    }
+}
+
+void AudioPlayer::_decodeStep() {
+    if (_wav.isOpen()) {
+        _pumpWav();
+    } else {
+        audio.loop();
+    }
+}
+
+bool AudioPlayer::_sourceRunning() {
+    if (_wav.isOpen()) return !_paused && !_wav.atEnd();
+    return audio.isRunning();
+}
+
+uint32_t AudioPlayer::_sourceSampleRate() {
+    return _wav.isOpen() ? _wav.format().sampleRate : audio.getSampleRate();
+}
+
+uint32_t AudioPlayer::_sourceSeconds(bool duration) {
+    if (!_wav.isOpen()) {
+        return duration ? audio.getAudioFileDuration() : audio.getAudioCurrentTime();
+    }
+    uint64_t frames = duration ? _wav.totalFrames() : _wav.position();
+    return (uint32_t)(frames / _wav.format().sampleRate);
+}
+
 void AudioPlayer::_startPlayback() {
+    if (!isLibraryOnline()) {
+        Serial.println("No SD card; nothing to play.");
+        return;
+    }
     if (_playlist.getTrackCount() == 0) {
         Serial.println("ERROR: Cannot play track, playlist is empty.");
         return;
@@ -107,58 +403,180 @@ void AudioPlayer::_startPlayback() {
 }
 
 void AudioPlayer::play() {
-    if (_playlist.getTrackCount() == 0) return;
+    if (!isLibraryOnline() || _playlist.getTrackCount() == 0) return;
     
-    if (_pausePosition > 0) {
-        
-        if (audio.isRunning()) {
-            audio.stopSong(); 
-        }
-
-        const char* path = _playlist.getTrack(_currentTrackIndex);
-        Serial.printf("▶ Resuming: %s at byte position %u\n", path, _pausePosition);
-        
-        // Reconnect the file stream and seek to the saved position
-        // The third parameter is the starting byte position (fpos_t)
-        audio.connecttoFS(SD, path, _pausePosition); 
-        
-        _pausePosition = 0; // Reset stored position after resuming
-        
-    } else if (!audio.isRunning()) {
+    if (_released) {
+        _resumeReleased();
+    } else if (_paused) {
+        // Decoder and file were never touched: pick up where the ring left off.
+        if (!_wav.isOpen()) audio.pauseResume();
+        _output.setHold(false);
+        _paused = false;
+        Serial.println("Audio Resumed.");
+    } else if (!_sourceRunning()) {
         Serial.println("Audio starting playback from the beginning.");
         _startPlayback(); 
-    } else {
-        audio.pauseResume();
-        Serial.println("Audio Resumed.");
     }
 }
 
-// PUBLIC - Pauses playback and stores position
+// PUBLIC - Pauses playback. The decoder, its open file and the buffered PCM
+// are kept so play() is instant; only when the heap is short is the decoder
+// released and the position remembered in samples.
 void AudioPlayer::pause() {
-    if (audio.isRunning()) {
-        
-        _pausePosition = audio.getFilePos(); 
-        
-        audio.stopSong();       
-        
-        // StopSong will call audio_eof_mp3, We need to make sure to flip it back.
-        _finished = false;
+    if (!_sourceRunning()) return;
+
+    _output.setHold(true);
+    if (!_wav.isOpen()) audio.pauseResume();
+    _paused = true;
+    // Followers drop what they have queued and rejoin with the first
+    // audio decoded after the resume.
+    if (_pcmListener) _pcmListener->onDiscard();
 
-        Serial.printf("Audio Paused. Position stored at byte %u.\n", _pausePosition);
+    if (ESP.getFreeHeap() < _pauseKeepAliveMinHeap) {
+        _releaseDecoder();
+    } else {
+        Serial.println("Audio Paused.");
     }
 }
 
-void AudioPlayer::_advanceTrack(int direction) {
-    if (_playlist.getTrackCount() == 0) return;
+void AudioPlayer::setPauseKeepAliveMinHeap(uint32_t bytes) {
+    _pauseKeepAliveMinHeap = bytes;
+}
 
-    _currentTrackIndex += direction;
-    
-    int trackCount = _playlist.getTrackCount();
-    _currentTrackIndex = (_currentTrackIndex % trackCount + trackCount) % trackCount;
-    
+// Frames decoded for this track minus those still waiting in the ring is
+// exactly what the listener has heard.
+void AudioPlayer::_releaseDecoder() {
+    size_t buffered = _output.buffered();
+    _pauseSample = _trackFrames > buffered ? _trackFrames - buffered : 0;
+    _pausePosition = audio.getFilePos();
+
+    audio.stopSong();
+    _wav.close();
+    _discardOutput();
+    _output.setHold(false);
+
+    // StopSong will call audio_eof_mp3, We need to make sure to flip it back.
+    _finished = false;
+    _released = true;
+
+    Serial.printf("Audio Paused, decoder released at sample %llu.\n",
+                  (unsigned long long)_pauseSample);
+}
+
+void AudioPlayer::_resumeReleased() {
+    const char* path = _playlist.getTrack(_currentTrackIndex);
+    uint32_t offset = 0;
+    uint32_t skip = 0;
+
+    _paused = false;
+    _released = false;
+    _trackFrames = _pauseSample;
+
+    if (_openWav(path, _pauseSample)) {
+        Serial.printf("▶ Resuming: %s at sample %llu\n", path, (unsigned long long)_pauseSample);
+        return;
+    }
+    if (_seekTable.open(SD, path) && _seekTable.locate(SD, _pauseSample, offset, skip)) {
+        Serial.printf("▶ Resuming: %s at frame offset %u (+%u samples)\n", path, offset, skip);
+        audio.connecttoFS(SD, path, offset);
+        _skipFrames = skip;
+    } else {
+        // Unknown format: the old byte-offset reconnect.
+        Serial.printf("▶ Resuming: %s at byte position %u\n", path, _pausePosition);
+        audio.connecttoFS(SD, path, _pausePosition);
+    }
+}
+
+// flush drops audio still buffered from the current track. A user skip
+// wants that; an automatic advance at end of track does not.
+void AudioPlayer::_advanceTrack(int direction, bool flush) {
+    if (!isLibraryOnline() || _playlist.getTrackCount() == 0) return;
+
+    if (flush) {
+        _discardOutput();
+    }
+
+    _currentTrackIndex = _resolveStep(direction);
     _startPlayback();
 }
 
+// The track a skip of `steps` lands on. Forward steps take queued tracks
+// first; the regular order then carries on from where the queue cut in.
+int AudioPlayer::_resolveStep(int steps) {
+    if (steps == 0) return _currentTrackIndex;
+
+    int trackCount = _playlist.getTrackCount();
+    int base = _orderIndex >= 0 ? _orderIndex : _currentTrackIndex;
+    uint32_t queued;
+    int fromQueue = -1;
+    while (steps > 0 && _queue.pop(queued)) {
+        // Entries can outlive a library rescan.
+        if (queued < (uint32_t)trackCount) {
+            fromQueue = (int)queued;
+            steps--;
+        }
+    }
+    if (steps == 0 && fromQueue >= 0) {
+        _orderIndex = base;
+        return fromQueue;
+    }
+
+    // Back from a queued track is the track the queue cut in after.
+    if (_orderIndex >= 0 && steps < 0) steps++;
+    _orderIndex = -1;
+    return _stepOrder(base, steps);
+}
+
+// The track `steps` away from `from` in play order, moving the shuffle
+// order along.
+int AudioPlayer::_stepOrder(int from, int steps) {
+    int trackCount = _playlist.getTrackCount();
+    if (!_shuffle) {
+        int index = from + steps;
+        return (index % trackCount + trackCount) % trackCount;
+    }
+
+    if ((int)_shuffleOrder.count() != trackCount || (int)_shuffleOrder.current() != from) {
+        _shuffleOrder.reset(trackCount, esp_random(), from);
+    }
+    for (; steps > 0; steps--) _shuffleOrder.next();
+    for (; steps < 0; steps++) _shuffleOrder.previous();
+    return (int)_shuffleOrder.current();
+}
+
+// What the end of the current track leads to under the repeat mode, or -1
+// to stop there.
+int AudioPlayer::_autoNextIndex() {
+    int trackCount = _playlist.getTrackCount();
+    if (trackCount == 0) return -1;
+    if (_repeat == REPEAT_ONE) return _currentTrackIndex;
+
+    uint32_t queued;
+    if (_queue.peek(queued) && queued < (uint32_t)trackCount) return (int)queued;
+
+    int base = _orderIndex >= 0 ? _orderIndex : _currentTrackIndex;
+    if (_shuffle && (int)_shuffleOrder.count() == trackCount && (int)_shuffleOrder.current() == base) {
+        if (_repeat == REPEAT_OFF && _shuffleOrder.atEnd()) return -1;
+        return (int)_shuffleOrder.peekNext();
+    }
+    if (_repeat == REPEAT_OFF && base + 1 >= trackCount) return -1;
+    return (base + 1) % trackCount;
+}
+
+void AudioPlayer::setShuffle(bool enabled) {
+    if (enabled && !_shuffle && isLibraryOnline() && _playlist.getTrackCount() > 0) {
+        _shuffleOrder.reset(_playlist.getTrackCount(), esp_random(), _currentTrackIndex);
+    }
+    _shuffle = enabled;
+    Serial.printf("Shuffle %s.\n", enabled ? "on" : "off");
+}
+
+void AudioPlayer::setRepeat(RepeatMode mode) {
+    if (mode >= REPEAT_MODE_COUNT) return;
+    _repeat = mode;
+    Serial.printf("Repeat %s.\n", repeatModeName(mode));
+}
+
 void AudioPlayer::playNext() {
     _advanceTrack(1);
 }
@@ -168,69 +586,346 @@ void AudioPlayer::playPrevious() {
 }
 
 void AudioPlayer::loop() {
-    audio.loop();
+    _processCommands();
+
+    _decodeStep();
 
     // Auto-advance logic
     if (hasFinished()) {
-        Serial.println("Current track finished. Auto-advancing to next track.");
         hasFinished(false);
-        playNext();
+        _autoAdvance();
+    } else {
+        _prefetchNext();
+    }
+
+    // Set after a switch so the EOF-to-next-track moment never reads as
+    // "stopped" to the output task.
+    if (!_outputLent) {
+        _output.setPlaying(_sourceRunning());
+    }
+
+    // Codec clocks, volume ramps and EQ follow the stream from here. A
+    // follower sets the rate of the output it borrowed. Until a new
+    // track's first PCM, the decoder may still report the old rate.
+    uint32_t rate = _outputLent ? _output.getSampleRate() : _sourceSampleRate();
+    if (!_prerolling) {
+        dacController.setSampleRate(rate, I2S_WORD_BITS);
+        _output.setSlotBits(rate, dacController.slotBits());
+    }
+    dacController.update(millis());
+
+    _updateStateVersion();
+    _sampleProgress();
+}
+
+// Position comes from the PCM actually handed to the DAC (frames sent for
+// this track minus those still in the ring), so it does not run ahead by
+// the decoder's read-ahead. Without the output task, fall back to the
+// library's own clock.
+void AudioPlayer::_sampleProgress() {
+    uint32_t now = millis();
+    if (now - _progressSampledMs < PROGRESS_SAMPLE_MS) return;
+    _progressSampledMs = now;
+
+    // Released on pause: the decoder is gone, keep the last snapshot.
+    if (_released) return;
+
+    PlaybackProgress progress;
+    uint32_t sampleRate = _sourceSampleRate();
+    size_t buffered = _output.isRunning() ? _output.buffered() : 0;
+
+    if (_output.isRunning() && sampleRate > 0) {
+        uint64_t played = _trackFrames > buffered ? _trackFrames - buffered : 0;
+        progress.positionMs = (uint32_t)(played * 1000 / sampleRate);
+    } else {
+        progress.positionMs = audio.getAudioCurrentTime() * 1000;
+    }
+    if (_wav.isOpen()) {
+        const WavFormat& format = _wav.format();
+        progress.durationMs = (uint32_t)(_wav.totalFrames() * 1000 / format.sampleRate);
+        progress.bitrate = format.sampleRate * format.channels * format.bitsPerSample;
+    } else {
+        progress.durationMs = audio.getAudioFileDuration() * 1000;
+        progress.bitrate = audio.getBitRate();
+    }
+
+    _progress.write(progress);
+    _published.progress = progress;
+    _state.write(_published);
+}
+
+// Near the end of the current track, read the head of the next one.
+void AudioPlayer::_prefetchNext() {
+    if (!_sourceRunning()) return;
+
+    int nextIndex = _autoNextIndex();
+    if (nextIndex < 0 || _prefetch.isPrepared(nextIndex)) return;
+
+    uint32_t duration = _sourceSeconds(true);
+    if (duration == 0 || _sourceSeconds(false) + PREFETCH_LEAD_SECONDS < duration) return;
+
+    if (_prefetch.prepare(SD, nextIndex, _playlist.getTrack(nextIndex))) {
+        Serial.printf("Prefetched track %d (%u Hz, %u ch) in %u us.\n", nextIndex,
+                      (unsigned)_prefetch.sampleRate(), (unsigned)_prefetch.channels(),
+                      (unsigned)_prefetch.prepareMicros());
+        dacController.prepareSampleRate(_prefetch.sampleRate(), I2S_WORD_BITS);
+    }
+}
+
+// Switches to the next track at EOF without dropping what the ring still
+// holds of the old one, then decodes the new track back-to-back (no task
+// delay between loop() calls) until its first PCM is queued behind it.
+// As long as that takes less than the ring's lead, the DAC never sees the
+// boundary.
+void AudioPlayer::_autoAdvance() {
+    uint32_t eofMicros = micros();
+    int nextIndex = _autoNextIndex();
+    if (nextIndex < 0) {
+        Serial.println("Current track finished. End of playlist, stopping.");
+        return;
+    }
+    Serial.println("Current track finished. Auto-advancing to next track.");
+
+    // A track too short for the prefetch window is read now: its rate
+    // decides whether the switch can be gapless.
+    if (!_prefetch.isPrepared(nextIndex)) {
+        _prefetch.prepare(SD, nextIndex, _playlist.getTrack(nextIndex));
+    }
+    uint32_t rate = _sourceSampleRate();
+    uint32_t nextRate = _prefetch.isValid() ? _prefetch.sampleRate() : 0;
+    if (!_prefetch.isValid()) {
+        Serial.println("WARNING: Next track failed prefetch; expect a gap.");
+    } else if (nextRate != rate) {
+        Serial.printf("Sample rate changes %u -> %u Hz; transition is not gapless.\n",
+                      (unsigned)rate, (unsigned)nextRate);
+    }
+    // The ring still holds the end of this track. If the next one may run
+    // at another rate, that end plays out at its own rate before I2S or
+    // the codec is reclocked for the new one.
+    if (_output.isRunning() && rate != 0 && nextRate != rate) {
+        _output.drain(rate);
+        dacController.setSampleRate(nextRate, I2S_WORD_BITS);
+        _output.setSlotBits(nextRate, dacController.slotBits());
+    }
+
+    _output.markTrackBoundary();
+    if (_repeat == REPEAT_ONE) {
+        _startPlayback();
+    } else {
+        _advanceTrack(1, false);
+    }
+
+    _prerolling = true;
+    while (_prerolling && _sourceRunning() && micros() - eofMicros < PREROLL_BUDGET_US) {
+        _decodeStep();
+    }
+    // Still set if the budget ran out: cleared by the first PCM.
+
+    _lastSwitchMicros = micros() - eofMicros;
+    Serial.printf("Track switch took %u us.\n", (unsigned)_lastSwitchMicros);
+}
+
+bool AudioPlayer::post(PlayerCommand::Type type, int32_t value) {
+    return _commands.push(PlayerCommand{ type, value });
+}
+
+// Drains the queue and applies the net effect of everything in it:
+// ten "next" presses become one jump of ten tracks, a select followed by
+// "next" lands one past the selection, and for volume, EQ, seek and
+// play/pause only the last request counts. A track change implies play,
+// so only a play/pause that arrives after it still applies.
+void AudioPlayer::_processCommands() {
+    bool changeTrack = false;
+    bool hasSelect = false;
+    int selectIndex = 0;
+    int step = 0;
+    int transport = -1;    // PLAY, PAUSE or -1 for no change
+    int volume = -1;
+    int seekSeconds = -1;
+    bool hasEq = false;
+    int32_t eq = 0;
+    int shuffle = -1;
+    int repeat = -1;
+    int library = -1;      // EJECT or RELOAD, whichever came last
+    int32_t libraryVersion = 0;
+    bool lend = false;
+    int count = 0;
+
+    PlayerCommand cmd;
+    while (_commands.pop(cmd)) {
+        count++;
+        switch (cmd.type) {
+            case PlayerCommand::SELECT:
+                hasSelect = true;
+                selectIndex = cmd.value;
+                step = 0;
+                changeTrack = true;
+                transport = -1;
+                seekSeconds = -1;
+                break;
+            case PlayerCommand::NEXT:
+            case PlayerCommand::PREVIOUS:
+                step += cmd.type == PlayerCommand::NEXT ? 1 : -1;
+                changeTrack = true;
+                transport = -1;
+                seekSeconds = -1;
+                break;
+            case PlayerCommand::PLAY:
+            case PlayerCommand::PAUSE:
+                transport = cmd.type;
+                break;
+            case PlayerCommand::VOLUME:
+                volume = cmd.value;
+                break;
+            case PlayerCommand::SEEK:
+                seekSeconds = cmd.value;
+                break;
+            case PlayerCommand::EQ:
+                hasEq = true;
+                eq = cmd.value;
+                break;
+            case PlayerCommand::SHUFFLE:
+                shuffle = cmd.value != 0;
+                break;
+            case PlayerCommand::REPEAT:
+                repeat = cmd.value;
+                break;
+            case PlayerCommand::EJECT:
+            case PlayerCommand::RELOAD:
+                library = cmd.type;
+                libraryVersion = cmd.value;
+                break;
+            case PlayerCommand::LEND:
+                lend = true;
+                break;
+        }
+    }
+
+    if (count == 0) return;
+
+    // The card first: nothing below may touch a library that is going.
+    if (library == PlayerCommand::EJECT) {
+        _ejectLibrary();
+    } else if (library == PlayerCommand::RELOAD) {
+        _reloadLibrary((uint32_t)libraryVersion);
+    }
+    // Anything to play that came with it is refused from here on.
+    if (lend) {
+        _lendOutput();
+    }
+
+    // Modes first, so skips queued behind them already follow the new order.
+    if (shuffle >= 0) {
+        setShuffle(shuffle != 0);
+    }
+    if (repeat >= 0) {
+        setRepeat((RepeatMode)repeat);
+    }
+    if (changeTrack) {
+        if (count > 1) {
+            Serial.printf("Coalesced %d commands into one track change.\n", count);
+        }
+        int trackCount = isLibraryOnline() ? _playlist.getTrackCount() : -1;
+        if (trackCount < 0) {
+            Serial.println("No SD card; track change dropped.");
+        } else if (trackCount == 0) {
+            Serial.println("ERROR: Cannot set track, playlist is empty.");
+        } else if (hasSelect) {
+            int base = (selectIndex % trackCount + trackCount) % trackCount;
+            if (_shuffle) _shuffleOrder.reset(trackCount, esp_random(), base);
+            _orderIndex = -1;
+            _switchTrack(_stepOrder(base, step));
+        } else {
+            _switchTrack(_resolveStep(step));
+        }
+    }
+    if (seekSeconds >= 0) {
+        seek(seekSeconds);
+    }
+    if (transport == PlayerCommand::PLAY) {
+        play();
+    } else if (transport == PlayerCommand::PAUSE) {
+        pause();
+    }
+    if (volume >= 0) {
+        setVolume(volume > 100 ? 100 : volume);
+    }
+    if (hasEq) {
+        setEq(unpackEq(eq));
+    }
+}
+
+void AudioPlayer::seek(uint32_t seconds) {
+    if (!_sourceRunning()) return;
+
+    _discardOutput();
+    if (_wav.isOpen()) {
+        if (_wav.seek((uint64_t)seconds * _wav.format().sampleRate)) {
+            _trackFrames = _wav.position();
+            Serial.printf("Seeked to %u s.\n", (unsigned)seconds);
+        }
+        return;
+    }
+    if (audio.setAudioPlayPosition(seconds)) {
+        _trackFrames = (uint64_t)seconds * audio.getSampleRate();
+        Serial.printf("Seeked to %u s.\n", (unsigned)seconds);
+    }
+}
+
+void AudioPlayer::_updateStateVersion() {
+    bool running = _sourceRunning();
+    if (_currentTrackIndex != _published.trackIndex ||
+        running != _published.isPlaying ||
+        _currentVolume != _published.volume ||
+        _shuffle != _published.shuffle ||
+        _repeat != _published.repeat) {
+        _published.trackIndex = _currentTrackIndex;
+        _published.isPlaying = running;
+        _published.volume = _currentVolume;
+        _published.shuffle = _shuffle;
+        _published.repeat = _repeat;
+        // The snapshot before the version, so a reader that sees the bump
+        // also sees what changed.
+        _state.write(_published);
+        _stateVersion.fetch_add(1, std::memory_order_release);
     }
 }
 
 // STATUS & CONTROL SETTERS/GETTERS
 bool AudioPlayer::isRunning() {
-    return audio.isRunning();
+    return _sourceRunning();
 }
 
 bool AudioPlayer::hasFinished() {
-    return _finished;
+    return _finished.load();
 }
 
 void AudioPlayer::hasFinished(bool finished) {
-    _finished = finished;
+    _finished.store(finished);
 }
 
 void AudioPlayer::setVolume(uint8_t volume) {
     if (volume > 100) volume = 100;
     
-    uint8_t mappedVolume = map(volume, 0, 100, 0, 21);
-    
-    audio.setVolume(mappedVolume);
+    dacController.setVolumePercent(volume);
     _currentVolume = volume;
-    Serial.printf("Volume set to: %d%% (%d/21)\n", volume, mappedVolume);
+    Serial.printf("Volume set to: %d%% (%.1f dB)\n", volume, DACController::percentToDb(volume));
 }
 
-std::vector<std::string> AudioPlayer::getPlaylist() {
-    std::vector<std::string> rawPaths = _playlist.getPlaylist();
-    
-    std::vector<std::string> formattedTitles;
-
-    for (std::string path : rawPaths) {
-        
-        size_t lastSeparator = path.find_last_of('/');
-        if (lastSeparator != std::string::npos) {
-            path = path.substr(lastSeparator + 1);
-        }
-        
-        size_t lastDot = path.find_last_of('.');
-        
-        if (lastDot != std::string::npos && lastDot > 0) {
-            path = path.substr(0, lastDot);
-        }
-
-        formattedTitles.push_back(path);
-    }
-    
-    return formattedTitles;
+void AudioPlayer::setEq(const EqSettings& eq) {
+    dacController.setEq(eq);
+    _eqPacked.store(packEq(dacController.getEq()), std::memory_order_relaxed);
 }
 
 String AudioPlayer::getCurrentStateJSON() {
     StaticJsonDocument<512> doc;
 
-    doc["trackIndex"] = _currentTrackIndex;
-    doc["isPlaying"] = isRunning();
-    doc["volume"] = _currentVolume;
+    PlayerState state = getState();
+    doc["trackIndex"] = state.trackIndex;
+    doc["isPlaying"] = state.isPlaying;
+    doc["volume"] = state.volume;
+    doc["shuffle"] = state.shuffle;
+    doc["repeat"] = repeatModeName(state.repeat);
 
     String json;
     serializeJson(doc, json);
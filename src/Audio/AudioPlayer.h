@@ -9,9 +9,78 @@
 #include <SD.h>
 #include "DACController.h"
 #include "SDPlaylist.h"
-#include <vector> 
-#include <string>
+#include "AudioOutput.h"
+#include "CommandQueue.h"
+#include "TrackPrefetch.h"
+#include "FrameSeekTable.h"
+#include "WavReader.h"
+#include "MetadataIndex.h"
+#include "ShuffleOrder.h"
+#include "PlayQueue.h"
+#include "PlaylistStore.h"
+#include "CardMonitor.h"
+#include "Seqlock.h"
 #include <algorithm>
+#include <atomic>
+
+// Where playback is, sampled by the decode task.
+struct PlaybackProgress {
+    uint32_t positionMs;    // What has actually reached the DAC
+    uint32_t durationMs;    // 0 if unknown
+    uint32_t bitrate;       // bit/s, 0 if unknown
+};
+
+// What happens at the end of a track. Skips always move on and wrap.
+enum RepeatMode : uint8_t {
+    REPEAT_OFF,     // Stop after the last track (of the cycle, when shuffled)
+    REPEAT_ALL,     // Wrap around
+    REPEAT_ONE,     // Play the same track again
+    REPEAT_MODE_COUNT
+};
+
+inline const char* repeatModeName(RepeatMode mode) {
+    static const char* const names[] = { "off", "all", "one" };
+    return mode < REPEAT_MODE_COUNT ? names[mode] : "all";
+}
+
+// What the web UI mirrors. Plain values, copied out of the player.
+struct PlayerState {
+    int trackIndex;
+    bool isPlaying;
+    int volume;
+    PlaybackProgress progress;
+    bool shuffle;
+    RepeatMode repeat;
+};
+
+// Receives every PCM frame the player queues for its DAC, on the decode
+// task. playAtUs is the esp_timer time the first frame will be clocked out.
+class PcmListener {
+public:
+    virtual ~PcmListener() {}
+    virtual void onPcm(const int16_t* samples, size_t frames, uint8_t channels,
+                       uint32_t sampleRate, int64_t playAtUs) = 0;
+    // Everything reported so far and not yet played was dropped.
+    virtual void onDiscard() = 0;
+};
+
+// EQ bands travel through the command queue and across tasks as one word.
+inline int32_t packEq(const EqSettings& eq) {
+    return (int32_t)((uint8_t)eq.bassDb | ((uint8_t)eq.midDb << 8) | ((uint32_t)(uint8_t)eq.trebleDb << 16));
+}
+inline EqSettings unpackEq(int32_t value) {
+    return EqSettings{ (int8_t)(value & 0xFF), (int8_t)((value >> 8) & 0xFF), (int8_t)((value >> 16) & 0xFF) };
+}
+
+// How often the decode task refreshes the progress snapshot.
+static constexpr uint32_t PROGRESS_SAMPLE_MS = 100;
+
+// WAV frames moved per loop() iteration, about one MP3 frame's worth, so
+// commands and progress are serviced as often as with the decoder.
+static constexpr size_t WAV_PUMP_FRAMES = 1024;
+
+// Free heap a pause leaves in place before it gives up the open decoder.
+static constexpr uint32_t PAUSE_KEEP_ALIVE_MIN_HEAP = 16 * 1024;
 
 class AudioPlayer {
 public:
@@ -19,6 +88,17 @@ public:
     SDPlaylist _playlist; 
 
     bool begin();
+    // Moves decoding and I2S output onto dedicated tasks. After this,
+    // loop() is driven by the decode task and must not be called elsewhere.
+    bool startTasks();
+
+    // Thread-safe entry point for other tasks (HTTP handlers, setup()).
+    // Commands run on the decode task at its next iteration; bursts are
+    // coalesced there. Returns false if the queue is full.
+    bool post(PlayerCommand::Type type, int32_t value = 0);
+
+    // Direct control. Once startTasks() has run these belong to the decode
+    // task; everything else must go through post().
     void play();
     void pause();
     void playNext();
@@ -28,25 +108,169 @@ public:
     bool hasFinished();
     void playTrack(int index);
     void setVolume(uint8_t volume);
+    void setEq(const EqSettings& eq);
+    void seek(uint32_t seconds);
+    // Turning shuffle on starts a fresh cycle at the current track.
+    void setShuffle(bool enabled);
+    void setRepeat(RepeatMode mode);
+    // Below this much free heap a pause releases the decoder and resumes
+    // through the frame seek table instead of holding everything open.
+    void setPauseKeepAliveMinHeap(uint32_t bytes);
+    bool isPaused() const { return _paused; }
+    // Off sends .wav files through the general decoder, as before.
+    void setWavFastPath(bool enabled) { _wavFastPath = enabled; }
     void hasFinished(bool finished);
 
+    // Decode task; other tasks read getState().
     int getCurrentTrackIndex() const { return _currentTrackIndex; }
-    std::vector<std::string> getPlaylist();
+    TrackTitles getPlaylist() const { return _playlist.getTitles(); }
+    TrackTitles getPlaylist(int offset, int limit) const { return _playlist.getTitles(offset, limit); }
+    std::string_view getTitle(int index) const { return _playlist.getTitle(index); }
+    // Tags and durations, filled in the background after startTasks().
+    const MetadataIndex& getMetadata() const { return _metadata; }
+    // "Up next": plays before the regular order resumes. Thread-safe.
+    PlayQueue& getQueue() { return _queue; }
+    // Saved playlists on the card; for the web server's task.
+    PlaylistStore& getPlaylists() { return _playlists; }
     String getCurrentStateJSON();
+    // Lock-free; safe from any task. As of the decode task's last loop().
+    PlayerState getState() const { return _state.read(); }
+    // Lock-free; safe from any task.
+    PlaybackProgress getProgress() const { return _progress.read(); }
+    // Bumped whenever track, play state, volume or play mode changes.
+    uint32_t getStateVersion() const { return _stateVersion.load(std::memory_order_acquire); }
+    AudioOutputStats getOutputStats() const { return _output.getStats(); }
+    // Lock-free; safe from any task.
+    EqSettings getEq() const { return unpackEq(_eqPacked.load(std::memory_order_relaxed)); }
+    // Codec bus traffic since boot; the audio task writes it, so treat as approximate.
+    RegisterWriterStats getDacBusStats() const { return dacController.getBusStats(); }
+    const DacClockPlan& getDacClockPlan() const { return dacController.getClockPlan(); }
+    // Card reads behind the WAV fast path.
+    SDReadStats getSdReadStats() const { return _wav.getReadStats(); }
+    // EOF of one track to first PCM of the next, decoder side.
+    uint32_t getLastSwitchMicros() const { return _lastSwitchMicros; }
+
+    // Follows the SD slot from here on, see CardMonitor.h. After startTasks().
+    bool startCardMonitor() { return _cardMonitor.begin(); }
+    // False while there is no card (or it is being reloaded): playback
+    // requests are dropped then.
+    bool isLibraryOnline() const { return !_libraryOffline.load(std::memory_order_acquire); }
+    // For the card monitor's task. ejectLibrary() stops playback, waits
+    // for the decode task to close its files and unmounts the card.
+    // reloadLibrary() loads the mounted card and carries the current track
+    // and the queue over to the new list; refresh reads every file's size
+    // and date again (see SDPlaylist::load()).
+    void ejectLibrary();
+    bool reloadLibrary(bool refresh = false);
+    // Any task: asks the card monitor for a refreshing reload, for files
+    // edited in place. Taken at its next poll with the card in.
+    void requestRescan() { _rescanRequested.store(true); }
+    bool takeRescanRequest() { return _rescanRequested.exchange(false); }
+
+    // Multi-room leader: mirror the PCM stream. Set before startTasks().
+    void setPcmListener(PcmListener* listener) { _pcmListener = listener; }
+    // Multi-room follower: hands the output (already running after
+    // startTasks()) to whoever feeds it; local playback is refused from then on.
+    // Once the tasks run, the decode task lets go of the output itself and
+    // this waits until it has.
+    AudioOutput& lendOutput();
+
+    // Decoded PCM from the Audio library, see audio_process_i2s().
+    void onPcm(int16_t* samples, uint16_t frames, uint8_t bitsPerSample,
+               uint8_t channels, bool* continueI2S);
 
 private:
     Audio audio;
     DACController dacController; 
+    AudioOutput _output;
+    std::atomic<bool> _outputLent{false};
+    PcmListener* _pcmListener = nullptr;
+    void _discardOutput();
+    void _lendOutput();
+    TaskHandle_t _decodeTask = nullptr;
+    MpscQueue<PlayerCommand, 32> _commands;
 
     int _currentTrackIndex = 0;
-    bool _finished = false;
+    // Set from the audio_eof_mp3 callback, consumed by loop().
+    std::atomic<bool> _finished{false};
     uint32_t _pausePosition = 0;
+
+    // Paused: decoder suspended and output held, file still open.
+    // Released: decoder stopped to free memory; resume from _pauseSample.
+    bool _paused = false;
+    bool _released = false;
+    uint32_t _pauseKeepAliveMinHeap = PAUSE_KEEP_ALIVE_MIN_HEAP;
+    uint64_t _pauseSample = 0;
+    uint64_t _trackFrames = 0;     // PCM frames of this track sent to the ring
+    uint32_t _skipFrames = 0;
+    FrameSeekTable _seekTable;
+    void _releaseDecoder();
+    void _resumeReleased();
     int _currentVolume = 10;
+    std::atomic<int32_t> _eqPacked{0};
+
+    // Play order. With shuffle on, _shuffleOrder.current() is the
+    // current track.
+    bool _shuffle = false;
+    RepeatMode _repeat = REPEAT_ALL;
+    ShuffleOrder _shuffleOrder;
+    int _stepOrder(int from, int steps);
+    int _autoNextIndex();
+
+    // While a queued track plays, the track in the regular order to carry
+    // on from; -1 otherwise.
+    PlayQueue _queue;
+    int _orderIndex = -1;
+    int _resolveStep(int steps);
+    PlaylistStore _playlists;
+
+    // Card hot-plug. Offline, the decode task touches neither files nor the
+    // track list; _libraryVersion is the list its indices refer to.
+    CardMonitor _cardMonitor{ *this };
+    std::atomic<bool> _libraryOffline{false};
+    std::atomic<bool> _ejected{false};
+    std::atomic<bool> _rescanRequested{false};
+    uint32_t _libraryVersion = 0;
+    void _ejectLibrary();
+    void _reloadLibrary(uint32_t version);
     
     void _startPlayback();
-    void _advanceTrack(int direction);
+    void _switchTrack(int index);
+    void _advanceTrack(int direction, bool flush = true);
         
     void _startTrack(const char* path);
+
+    // PCM WAV bypasses the decoder while the output task runs.
+    WavReader _wav;
+    bool _wavFastPath = true;
+    bool _openWav(const char* path, uint64_t startFrame);
+    void _pumpWav();
+    // One step of whichever source is active: WAV reader or decoder.
+    void _decodeStep();
+    bool _sourceRunning();
+    uint32_t _sourceSampleRate();
+    uint32_t _sourceSeconds(bool duration);
+
+    void _processCommands();
+
+    MetadataIndex _metadata;
+
+    TrackPrefetch _prefetch;
+    bool _prerolling = false;
+    uint32_t _lastSwitchMicros = 0;
+    void _prefetchNext();
+    void _autoAdvance();
+
+    Seqlock<PlaybackProgress> _progress;
+    uint32_t _progressSampledMs = 0;
+    void _sampleProgress();
+
+    std::atomic<uint32_t> _stateVersion{0};
+    PlayerState _published{ -1, false, -1, {}, false, REPEAT_ALL };
+    Seqlock<PlayerState> _state;
+    void _updateStateVersion();
+
+    static void _decodeTaskEntry(void* param);
 };
 
 // Global callback functions for Audio library
@@ -55,5 +279,7 @@ void audio_id3data(const char *info);
 void audio_eof_mp3(const char *info);
 void audio_showstation(const char *info);
 void audio_showstreamtitle(const char *info);
+void audio_process_i2s(int16_t* outBuff, uint16_t validSamples, uint8_t bitsPerSample,
+                       uint8_t channels, bool* continueI2S);
 
 #endif 
\ No newline at end of file
@@ -0,0 +1,86 @@
+// ============================================================================
+// CardMonitor.cpp
+// ============================================================================
+#include "CardMonitor.h"
+#include "AudioPlayer.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Next to the metadata indexer, on the core the audio tasks leave alone.
+// Reloads run here too, so the stack covers a library scan.
+static constexpr UBaseType_t CARD_MONITOR_TASK_PRIORITY = 1;
+static constexpr BaseType_t CARD_MONITOR_TASK_CORE = 0;
+
+CardMonitor::CardMonitor(AudioPlayer& player)
+    : _player(player), _started(false), _mountTried(false), _mountTriedMs(0), _removals(0), _insertions(0) {
+}
+
+bool CardMonitor::begin() {
+    if (_started) return true;
+
+#if MUSICBOX_SD_DETECT_PIN >= 0
+    pinMode(MUSICBOX_SD_DETECT_PIN, INPUT_PULLUP);
+#endif
+
+    if (xTaskCreatePinnedToCore(taskEntry, "sd_card", 8192, this, CARD_MONITOR_TASK_PRIORITY, nullptr,
+                                CARD_MONITOR_TASK_CORE) != pdPASS) {
+        Serial.println("ERROR: Failed to start SD card monitor!");
+        return false;
+    }
+    _started = true;
+    Serial.printf("✓ SD card monitor (%s)\n", MUSICBOX_SD_DETECT_PIN >= 0 ? "detect switch" : "polling");
+    return true;
+}
+
+bool CardMonitor::switchClosed() const {
+#if MUSICBOX_SD_DETECT_PIN >= 0
+    return digitalRead(MUSICBOX_SD_DETECT_PIN) == MUSICBOX_SD_DETECT_LEVEL;
+#else
+    return true;
+#endif
+}
+
+void CardMonitor::poll() {
+    SDPlaylist& playlist = _player._playlist;
+    bool hasSwitch = MUSICBOX_SD_DETECT_PIN >= 0;
+
+    if (playlist.isMounted()) {
+        if (hasSwitch ? switchClosed() : playlist.isCardResponding()) {
+            if (_player.takeRescanRequest()) {
+                Serial.println("Rescanning the library.");
+                _player.reloadLibrary(true);
+            }
+            return;
+        }
+        Serial.println("SD card removed.");
+        _removals++;
+        _player.ejectLibrary();
+        _mountTried = false;
+        return;
+    }
+
+    // An open switch is a sure answer; without one, the only way to find a
+    // card is to mount it, which is not done on every poll.
+    if (hasSwitch && !switchClosed()) {
+        _mountTried = false;
+        return;
+    }
+    uint32_t now = millis();
+    if (_mountTried && now - _mountTriedMs < CARD_MOUNT_RETRY_MS) return;
+    if (hasSwitch && !_mountTried) vTaskDelay(pdMS_TO_TICKS(CARD_SETTLE_MS));
+    _mountTried = true;
+    _mountTriedMs = now;
+
+    if (!playlist.mount(true)) return;
+    Serial.println("SD card inserted.");
+    _insertions++;
+    _player.reloadLibrary();
+}
+
+void CardMonitor::taskEntry(void* param) {
+    CardMonitor* monitor = static_cast<CardMonitor*>(param);
+    for (;;) {
+        monitor->poll();
+        vTaskDelay(pdMS_TO_TICKS(CARD_POLL_MS));
+    }
+}
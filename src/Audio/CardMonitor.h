@@ -0,0 +1,66 @@
+// ============================================================================
+// CardMonitor.h
+// Follows the SD slot while the box runs. When the card goes, playback
+// stops, the metadata indexer exits and the card is unmounted; the track
+// list stays in memory, so the web UI can still show it. When a card comes
+// (back) in, it is mounted and the library reloaded on this task: from the
+// card's index if it is current, otherwise by a scan that only opens files
+// the index does not know. Clients are then told which runs of the list
+// changed, see LibraryChange. A rescan the player was asked for (files
+// edited in place) is a reload that opens every file.
+//
+// With the slot's card-detect switch wired (MUSICBOX_SD_DETECT_PIN), the
+// switch says whether a card is in. Without it, a mounted card is probed
+// with a one-sector read, and an empty slot is tried with a mount every
+// CARD_MOUNT_RETRY_MS.
+// ============================================================================
+#ifndef CARD_MONITOR_H
+#define CARD_MONITOR_H
+
+#include <Arduino.h>
+
+// GPIO of the card-detect switch, -1 if it is not wired.
+#ifndef MUSICBOX_SD_DETECT_PIN
+#define MUSICBOX_SD_DETECT_PIN -1
+#endif
+// Level the switch reads with a card in.
+#ifndef MUSICBOX_SD_DETECT_LEVEL
+#define MUSICBOX_SD_DETECT_LEVEL LOW
+#endif
+
+static constexpr uint32_t CARD_POLL_MS = 500;
+// Between mount attempts on a slot that seems empty or holds a bad card.
+static constexpr uint32_t CARD_MOUNT_RETRY_MS = 3000;
+// A card just pushed in gets this long to seat before it is mounted.
+static constexpr uint32_t CARD_SETTLE_MS = 250;
+
+class AudioPlayer;
+
+class CardMonitor {
+public:
+    explicit CardMonitor(AudioPlayer& player);
+
+    // Starts the monitor task; call after the player's startTasks().
+    bool begin();
+
+    // One look at the slot, acting on what changed; the task runs it every
+    // CARD_POLL_MS. Blocks through an eject or a reload.
+    void poll();
+
+    uint32_t removals() const { return _removals; }
+    uint32_t insertions() const { return _insertions; }
+
+private:
+    AudioPlayer& _player;
+    bool _started;
+    bool _mountTried;
+    uint32_t _mountTriedMs;
+    uint32_t _removals;
+    uint32_t _insertions;
+
+    bool switchClosed() const;
+
+    static void taskEntry(void* param);
+};
+
+#endif // CARD_MONITOR_H
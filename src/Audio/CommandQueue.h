@@ -0,0 +1,95 @@
+// ============================================================================
+// CommandQueue.h
+// Player commands and the bounded lock-free queue that carries them from
+// the HTTP handlers (AsyncTCP task, any number of producers) to the audio
+// decode task (the single consumer), which is the only place the Audio
+// object is touched.
+// ============================================================================
+#ifndef COMMAND_QUEUE_H
+#define COMMAND_QUEUE_H
+
+#include <Arduino.h>
+#include <atomic>
+
+struct PlayerCommand {
+    enum Type : uint8_t {
+        PLAY,
+        PAUSE,
+        NEXT,
+        PREVIOUS,
+        SELECT,    // value = track index
+        VOLUME,    // value = 0-100
+        SEEK,      // value = seconds into the current track
+        EQ,        // value = packEq()
+        SHUFFLE,   // value = 0 off, 1 on
+        REPEAT,    // value = RepeatMode
+        EJECT,     // The card is going: stop and let go of the library
+        RELOAD,    // value = library version now loaded
+        LEND,      // Stop local playback and hand the output over
+    };
+
+    Type type;
+    int32_t value;
+};
+
+// Bounded multi-producer/single-consumer queue (Vyukov's sequence-numbered
+// ring). push() never blocks: when full it fails and the caller reports
+// "busy". Capacity must be a power of two.
+template <typename T, size_t CAPACITY>
+class MpscQueue {
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "capacity must be a power of two");
+
+public:
+    MpscQueue() {
+        for (size_t i = 0; i < CAPACITY; i++) {
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool push(const T& item) {
+        size_t pos = _enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = _cells[pos & (CAPACITY - 1)];
+            size_t sequence = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+
+            if (diff == 0) {
+                if (_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.item = item;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;  // Full
+            } else {
+                pos = _enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Consumer only.
+    bool pop(T& item) {
+        Cell& cell = _cells[_dequeuePos & (CAPACITY - 1)];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        if ((intptr_t)sequence - (intptr_t)(_dequeuePos + 1) < 0) {
+            return false;  // Empty
+        }
+
+        item = cell.item;
+        cell.sequence.store(_dequeuePos + CAPACITY, std::memory_order_release);
+        _dequeuePos++;
+        return true;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T item;
+    };
+
+    Cell _cells[CAPACITY];
+    std::atomic<size_t> _enqueuePos{0};
+    size_t _dequeuePos = 0;
+};
+
+#endif
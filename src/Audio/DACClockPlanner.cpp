@@ -0,0 +1,144 @@
+// ============================================================================
+// DACClockPlanner.cpp
+// ============================================================================
+#include "DACClockPlanner.h"
+
+static constexpr uint8_t CLOCK_MUX_BCLK_PLL = 0x07;     // PLL_CLKIN = BCLK, CODEC_CLKIN = PLL
+static constexpr uint8_t CLOCK_POWER = 0x80;
+
+// I2S word length field of page 0, register 27 (bits 5:4).
+struct WordLength {
+    uint8_t bits;
+    uint8_t code;
+};
+
+static const WordLength WORD_LENGTHS[] = {
+    { 16, 0x00 }, { 20, 0x10 }, { 24, 0x20 }, { 32, 0x30 },
+};
+
+static bool wordLengthCode(uint8_t bits, uint8_t& code) {
+    for (const WordLength& w : WORD_LENGTHS) {
+        if (w.bits == bits) {
+            code = w.code;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* DACClockPlanner::check(const DacClockPlan& p) {
+    uint8_t code;
+    if (p.sampleRate == 0) return "no sample rate";
+    if (p.sampleRate > DAC_FILTER_A_MAX_RATE) return "rate above interpolation filter A";
+    if (!wordLengthCode(p.wordBits, code)) return "unsupported word length";
+    if (p.pllP < 1 || p.pllP > 8) return "PLL P out of range";
+    if (p.pllR < 1 || p.pllR > 16) return "PLL R out of range";
+    if (p.pllJ < 1 || p.pllJ > 63) return "PLL J out of range";
+    if (p.pllD > 9999) return "PLL D out of range";
+    if (p.ndac < 1 || p.ndac > 128) return "NDAC out of range";
+    if (p.mdac < 1 || p.mdac > 128) return "MDAC out of range";
+    if (p.dosr < DAC_DOSR_STEP || p.dosr > DAC_DOSR_MAX || p.dosr % DAC_DOSR_STEP != 0) {
+        return "DOSR not a multiple of 8 in range";
+    }
+
+    uint32_t pllIn = p.bclkHz() / p.pllP;
+    if (pllIn < DAC_PLL_IN_MIN_HZ || pllIn > DAC_PLL_IN_MAX_HZ) return "PLL input out of range";
+    // A fractional J needs a 10 MHz+ input and R = 1.
+    if (p.pllD != 0 && (pllIn < 10000000 || p.pllR != 1)) return "fractional PLL needs a faster input";
+    uint32_t jr = (uint32_t)p.pllJ * p.pllR;
+    if (jr < DAC_PLL_JR_MIN || jr > DAC_PLL_JR_MAX) return "PLL J * R out of range";
+
+    uint32_t codecClk = p.codecClkHz();
+    if (codecClk < DAC_PLL_OUT_MIN_HZ || codecClk > DAC_PLL_OUT_MAX_HZ) return "PLL output out of range";
+    uint32_t dacClk = codecClk / p.ndac;
+    if (dacClk > DAC_CLK_MAX_HZ) return "DAC_CLK too fast";
+    uint32_t modClk = dacClk / p.mdac;
+    if (modClk > DAC_MOD_CLK_MAX_HZ) return "DAC_MOD_CLK too fast";
+    uint32_t osrClk = p.dosr * p.sampleRate;
+    if (osrClk < DAC_OSR_CLK_MIN_HZ || osrClk > DAC_OSR_CLK_MAX_HZ) return "DOSR * fs out of range";
+    if ((uint32_t)p.mdac * p.dosr / 32 < DAC_PRB_RESOURCE_CLASS) return "MDAC * DOSR too low for PRB_P1";
+
+    // Exact division back to fs, in integers: BCLK * R * J.D / P over
+    // NDAC * MDAC * DOSR.
+    uint64_t num = (uint64_t)p.bclkHz() * p.pllR * (p.pllJ * 10000u + p.pllD);
+    uint64_t den = (uint64_t)10000u * p.pllP * p.ndac * p.mdac * p.dosr;
+    if (num != den * p.sampleRate) return "does not divide to the sample rate";
+    return nullptr;
+}
+
+// BCLK is always 2 * wordBits * fs, so with D = 0 the whole tree is an
+// integer ratio: 2 * wordBits * R * J / P = NDAC * MDAC * DOSR. BCLK is far
+// below the 10 MHz a fractional PLL needs, so D stays 0.
+bool DACClockPlanner::plan(uint32_t sampleRate, uint8_t wordBits, DacClockPlan& out) {
+    uint8_t code;
+    if (sampleRate == 0 || sampleRate > DAC_FILTER_A_MAX_RATE) return false;
+    if (!wordLengthCode(wordBits, code)) return false;
+
+    // DOSR * fs must land in its window; search it from the top.
+    uint32_t dosrMin = (DAC_OSR_CLK_MIN_HZ + sampleRate - 1) / sampleRate;
+    dosrMin = (dosrMin + DAC_DOSR_STEP - 1) / DAC_DOSR_STEP * DAC_DOSR_STEP;
+    uint32_t dosrMax = DAC_OSR_CLK_MAX_HZ / sampleRate / DAC_DOSR_STEP * DAC_DOSR_STEP;
+    if (dosrMax > DAC_DOSR_MAX) dosrMax = DAC_DOSR_MAX;
+    if (dosrMin < DAC_DOSR_STEP) dosrMin = DAC_DOSR_STEP;
+
+    bool found = false;
+    DacClockPlan best = {};
+    uint32_t bclk = sampleRate * 2 * wordBits;
+
+    for (uint8_t p = 1; p <= 8; p++) {
+        if (bclk / p < DAC_PLL_IN_MIN_HZ) break;
+        if (bclk / p > DAC_PLL_IN_MAX_HZ) continue;
+        for (uint8_t r = 1; r <= 16; r++) {
+            for (uint8_t j = 1; j <= 63; j++) {
+                uint32_t jr = (uint32_t)j * r;
+                if (jr < DAC_PLL_JR_MIN) continue;
+                if (jr > DAC_PLL_JR_MAX) break;
+                uint64_t ratioNum = 2ull * wordBits * r * j;
+                if (ratioNum % p != 0) continue;
+                uint32_t ratio = (uint32_t)(ratioNum / p);    // NDAC * MDAC * DOSR
+                uint64_t codecClk = (uint64_t)ratio * sampleRate;
+                if (codecClk < DAC_PLL_OUT_MIN_HZ) continue;
+                if (codecClk > DAC_PLL_OUT_MAX_HZ) break;
+
+                for (uint32_t dosr = dosrMax; dosr >= dosrMin; dosr -= DAC_DOSR_STEP) {
+                    if (found && dosr < best.dosr) break;
+                    if (ratio % dosr != 0) continue;
+                    uint32_t nm = ratio / dosr;
+                    for (uint16_t mdac = 1; mdac <= 128 && mdac <= nm; mdac++) {
+                        if (nm % mdac != 0 || nm / mdac > 128) continue;
+                        DacClockPlan candidate = { sampleRate, wordBits, p, r, j, 0,
+                                                   (uint8_t)(nm / mdac), (uint8_t)mdac, (uint16_t)dosr };
+                        if (check(candidate) != nullptr) continue;
+                        if (!found || dosr > best.dosr ||
+                            (dosr == best.dosr && codecClk < best.codecClkHz())) {
+                            best = candidate;
+                            found = true;
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    if (found) out = best;
+    return found;
+}
+
+void DACClockPlanner::toRegisters(const DacClockPlan& p, bool powered,
+                                  RegisterValue (&out)[DAC_CLOCK_REGISTERS]) {
+    uint8_t power = powered ? CLOCK_POWER : 0;
+    uint8_t code = 0;
+    wordLengthCode(p.wordBits, code);
+    size_t i = 0;
+    out[i++] = { 0, 4, CLOCK_MUX_BCLK_PLL };
+    out[i++] = { 0, 5, (uint8_t)(power | ((p.pllP & 0x07) << 4) | (p.pllR & 0x0F)) };
+    out[i++] = { 0, 6, p.pllJ };
+    out[i++] = { 0, 7, (uint8_t)((p.pllD >> 8) & 0x3F) };
+    out[i++] = { 0, 8, (uint8_t)p.pllD };
+    out[i++] = { 0, 11, (uint8_t)(power | (p.ndac & 0x7F)) };
+    out[i++] = { 0, 12, (uint8_t)(power | (p.mdac & 0x7F)) };
+    out[i++] = { 0, 13, (uint8_t)((p.dosr >> 8) & 0x03) };
+    out[i++] = { 0, 14, (uint8_t)p.dosr };
+    out[i++] = { 0, 27, code };
+}
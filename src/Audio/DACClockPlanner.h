@@ -0,0 +1,81 @@
+// ============================================================================
+// DACClockPlanner.h
+// Derives the TLV320DAC3100's clock tree from BCLK for a given sample rate
+// and I2S word length:
+//
+//   BCLK -> PLL (x R * J.D / P) -> CODEC_CLKIN -> /NDAC -> /MDAC -> /DOSR = fs
+//
+// Every plan is checked against the datasheet limits below. Rates BCLK is
+// too slow for (under 16 kHz with 16-bit words) and rates above what the
+// PRB_P1 interpolation filter covers have no plan.
+// ============================================================================
+#ifndef DAC_CLOCK_PLANNER_H
+#define DAC_CLOCK_PLANNER_H
+
+#include <Arduino.h>
+#include "RegisterWriter.h"
+
+// TLV320DAC3100 clock limits (datasheet, "Clock Generation and PLL").
+static constexpr uint32_t DAC_PLL_IN_MIN_HZ = 512000;       // PLL_CLKIN / P
+static constexpr uint32_t DAC_PLL_IN_MAX_HZ = 20000000;
+static constexpr uint32_t DAC_PLL_OUT_MIN_HZ = 80000000;
+static constexpr uint32_t DAC_PLL_OUT_MAX_HZ = 110000000;
+static constexpr uint16_t DAC_PLL_JR_MIN = 4;               // J * R
+static constexpr uint16_t DAC_PLL_JR_MAX = 259;
+static constexpr uint32_t DAC_CLK_MAX_HZ = 49152000;        // CODEC_CLKIN / NDAC
+static constexpr uint32_t DAC_MOD_CLK_MAX_HZ = 6758000;     // DAC_CLK / MDAC
+static constexpr uint32_t DAC_OSR_CLK_MIN_HZ = 2800000;     // DOSR * fs
+static constexpr uint32_t DAC_OSR_CLK_MAX_HZ = 6200000;
+static constexpr uint16_t DAC_DOSR_STEP = 8;                // Interpolation filter A
+static constexpr uint16_t DAC_DOSR_MAX = 1024;
+// PRB_P1 (three biquads, filter A) is resource class 8: MDAC * DOSR / 32 >= 8.
+static constexpr uint16_t DAC_PRB_RESOURCE_CLASS = 8;
+// Filter A is specified up to 48 kHz; faster rates need another block.
+static constexpr uint32_t DAC_FILTER_A_MAX_RATE = 48000;
+
+// Registers a plan occupies: clock mux, PLL (5-8), dividers (11-14) and
+// the interface word length (27), all on page 0.
+static constexpr size_t DAC_CLOCK_REGISTERS = 10;
+
+struct DacClockPlan {
+    uint32_t sampleRate;
+    uint8_t wordBits;       // I2S slot width: 16, 20, 24 or 32
+    uint8_t pllP;           // 1-8
+    uint8_t pllR;           // 1-16
+    uint8_t pllJ;           // 1-63
+    uint16_t pllD;          // 0-9999, fractional J in 1/10000ths
+    uint8_t ndac;           // 1-128
+    uint8_t mdac;           // 1-128
+    uint16_t dosr;          // 8-1024
+
+    uint32_t bclkHz() const { return sampleRate * 2 * wordBits; }
+    // CODEC_CLKIN, i.e. the PLL output.
+    uint32_t codecClkHz() const {
+        return (uint32_t)((uint64_t)bclkHz() * pllR * (pllJ * 10000u + pllD) / (10000u * pllP));
+    }
+
+    bool operator==(const DacClockPlan& other) const {
+        return sampleRate == other.sampleRate && wordBits == other.wordBits &&
+               pllP == other.pllP && pllR == other.pllR && pllJ == other.pllJ &&
+               pllD == other.pllD && ndac == other.ndac && mdac == other.mdac &&
+               dosr == other.dosr;
+    }
+};
+
+class DACClockPlanner {
+public:
+    // Highest oversampling first, then the slowest PLL (least power).
+    // False if no combination meets every limit.
+    static bool plan(uint32_t sampleRate, uint8_t wordBits, DacClockPlan& out);
+
+    // nullptr if the plan meets every limit and divides down to exactly
+    // its sample rate, else the first limit it breaks.
+    static const char* check(const DacClockPlan& plan);
+
+    // Page-0 register values for the plan. With powered false, the PLL and
+    // dividers are written switched off, for changing them safely.
+    static void toRegisters(const DacClockPlan& plan, bool powered,
+                            RegisterValue (&out)[DAC_CLOCK_REGISTERS]);
+};
+
+#endif // DAC_CLOCK_PLANNER_H
@@ -3,23 +3,91 @@
 // ============================================================================
 #include "DACController.h"
 #include <Arduino.h>
+#include <math.h>
 
-DACController::DACController() {
+// Page 0: clocks, interface and the digital side of the DAC.
+static constexpr uint8_t DAC_REG_RESET = 1;
+static constexpr uint8_t DAC_REG_VOLUME_CONTROL = 64;  // Mute bits, then left and right volume
+static constexpr uint8_t DAC_MUTE_BOTH = 0x0C;
+
+// Coefficient RAM (DAC3100 pages 8-9 and 12-13): the DAC runs from one
+// buffer while the other is written, then swaps on a frame boundary, so
+// tone changes never glitch mid-sample.
+static constexpr uint8_t COEF_PAGE_A_LEFT = 8;
+static constexpr uint8_t COEF_PAGE_A_RIGHT = 9;
+static constexpr uint8_t COEF_PAGE_B_LEFT = 12;
+static constexpr uint8_t COEF_PAGE_B_RIGHT = 13;
+static constexpr uint8_t COEF_ADAPTIVE_REG = 1;      // Page 8
+static constexpr uint8_t COEF_ADAPTIVE_ENABLE = 0x04;
+static constexpr uint8_t COEF_ADAPTIVE_SWITCH = 0x01;
+static constexpr uint8_t COEF_BIQUAD_A_REG = 2;      // Biquads A-C follow back to back
+
+static constexpr float EQ_BASS_HZ = 100.0f;
+static constexpr float EQ_MID_HZ = 1000.0f;
+static constexpr float EQ_MID_Q = 0.7f;
+static constexpr float EQ_TREBLE_HZ = 8000.0f;
+
+// Datasheet reset values of everything bring-up writes. Registers that
+// already hold the wanted value are never sent.
+static const RegisterValue DAC_RESET_DEFAULTS[] = {
+    { 0, 4, 0x00 },     // Clock muxing
+    { 0, 5, 0x11 },     // PLL P = 1, R = 1, powered down
+    { 0, 6, 0x04 },     // PLL J
+    { 0, 7, 0x00 },     // PLL D
+    { 0, 8, 0x00 },
+    { 0, 11, 0x01 },    // NDAC, powered down
+    { 0, 12, 0x01 },    // MDAC, powered down
+    { 0, 13, 0x00 },    // DOSR
+    { 0, 14, 0x80 },
+    { 0, 27, 0x00 },    // Codec interface
+    { 0, 63, 0x14 },    // DAC data path, both DACs off
+    { 0, 64, 0x0C },    // Both channels muted
+    { 0, 65, 0x00 },    // Left DAC volume
+    { 0, 66, 0x00 },    // Right DAC volume
+    { 1, 32, 0x06 },    // Class-D amp off
+    { 1, 35, 0x00 },    // DAC output routing
+    { 1, 38, 0x7F },    // Left analog volume to speaker, not routed
+    { 1, 42, 0x00 },    // Speaker driver muted
+    { 8, 1, 0x00 },     // Adaptive filtering off
+};
+
+// Output stage; channel volumes come from stageVolume().
+static const RegisterValue DAC_OUTPUT[] = {
+    { 0, 63, 0xD4 },    // Both DACs on, normal paths, soft-step per sample
+    { 1, 32, 0x86 },    // Class-D amp on
+    { 1, 35, 0x44 },    // Left and right DAC to the mixers
+    { 1, 38, 0x80 },    // Left analog volume routed to the speaker at 0 dB
+    { 1, 42, 0x04 },    // Speaker driver 6 dB, unmuted
+    { COEF_PAGE_A_LEFT, COEF_ADAPTIVE_REG, COEF_ADAPTIVE_ENABLE },
+};
+
+DACController::DACController()
+    : _regs(Wire, DAC_I2C_ADDR), _ready(false),
+      _targetDb(DAC_VOLUME_FULL_DB), _currentDb(DAC_VOLUME_FULL_DB), _rampMs(0),
+      _sampleRate(44100), _wordBits(16), _clockPlan{}, _preparedPlan{}, _preparedBits(0), _clocked(false),
+      _eq{0, 0, 0}, _writtenEq{0, 0, 0}, _writtenRate(0),
+      _headroomDb(0), _bufferB(false) {
 }
 
 bool DACController::begin() {
 
     Serial.println("\n=== Initializing DAC System ===");
+    uint32_t start = millis();
     
     // Initialize I2C
     // Uses I2C_SDA (47) and I2C_SCL (48) from DACController.h
     Wire.begin(I2C_SDA, I2C_SCL);
-    delay(100);
+    Wire.setClock(DAC_I2C_CLOCK_HZ);
     
-    // Initialize codec using Adafruit library with hardware reset pin
+    // Hardware reset; the DAC takes I2C 1 ms after RST rises.
     // Uses DAC_RST_PIN (7) from DACController.h
-    Serial.println("Initializing codec with hardware reset...");
-    if (!codec.begin()) {
+    Serial.println("Resetting codec...");
+    pinMode(DAC_RST_PIN, OUTPUT);
+    digitalWrite(DAC_RST_PIN, LOW);
+    delay(1);
+    digitalWrite(DAC_RST_PIN, HIGH);
+    delay(1);
+    if (!_regs.probe()) {
         Serial.println("ERROR: Failed to initialize TLV320DAC3100!");
         Serial.println("Check wiring:");
         Serial.printf("  RST pin: GPIO %d to DAC RST\n", DAC_RST_PIN);
@@ -36,6 +104,10 @@ bool DACController::begin() {
         return false;
     }
     
+    const RegisterWriterStats& bus = _regs.getStats();
+    Serial.printf("✓ DAC up in %lu ms: %u I2C transactions, %u bytes, %u us on the bus, %u writes skipped\n",
+                  (unsigned long)(millis() - start), (unsigned)bus.transactions,
+                  (unsigned)bus.bytes, (unsigned)bus.busUs, (unsigned)bus.skipped);
     // Uses BCLK_PIN (9), LRCK_PIN (10), DOUT_PIN (11), I2C_SDA (47), I2C_SCL (48), and DAC_RST_PIN (7) from DACController.h
     Serial.printf("✓ I2S Pins: BCLK=%d, WSEL=%d, DIN=%d\n", BCLK_PIN, LRCK_PIN, DOUT_PIN);
     Serial.printf("✓ I2C Pins: SDA=%d, SCL=%d\n", I2C_SDA, I2C_SCL);
@@ -45,86 +117,38 @@ bool DACController::begin() {
     return true;
 }
 
+// Clocks first (planned for the current rate, PLL powered once its
+// dividers are in), then the output stage. Each flush is a handful of
+// burst transfers.
 bool DACController::configureDAC() {
     Serial.println("Configuring TLV320DAC3100...");
     
-    // Reset codec (hardware reset already done in begin())
-    codec.reset();
-    delay(100);
-    
-    Serial.println("  [1/6] Configuring codec interface...");
-    if (!codec.setCodecInterface(TLV320DAC3100_FORMAT_I2S, TLV320DAC3100_DATA_LEN_16)) {
-        Serial.println("Failed to configure codec interface!");
+    // Software reset; registers are back at their defaults within 1 ms.
+    _regs.invalidateAll();
+    if (!_regs.strobe(0, DAC_REG_RESET, 0x01)) {
+        Serial.println("Failed to reset codec!");
         return false;
     }
+    delay(1);
+    _regs.invalidateAll();
+    _regs.assume(DAC_RESET_DEFAULTS, sizeof(DAC_RESET_DEFAULTS) / sizeof(DAC_RESET_DEFAULTS[0]));
+    _clocked = false;
     
-    Serial.println("  [2/6] Configuring codec clocks...");
-    if (!codec.setCodecClockInput(TLV320DAC3100_CODEC_CLKIN_PLL) ||
-        !codec.setPLLClockInput(TLV320DAC3100_PLL_CLKIN_BCLK)) {
+    Serial.println("  [1/2] Configuring codec interface and clocks...");
+    if (!applyClocks()) {
         Serial.println("Failed to configure codec clocks!");
         return false;
     }
     
-    Serial.println("  [3/6] Configuring PLL...");
-    if (!codec.setPLLValues(1, 1, 8, 0)) {
-        Serial.println("Failed to configure PLL values!");
-        return false;
-    }
-    
-    Serial.println("  [4/6] Configuring DAC dividers...");
-    if (!codec.setNDAC(true, 8) ||
-        !codec.setMDAC(true, 2) ||
-        !codec.setDOSR(128)) {
-        Serial.println("Failed to configure DAC dividers!");
-        return false;
-    }
-    
-    if (!codec.powerPLL(true)) {
-        Serial.println("Failed to power up PLL!");
-        return false;
-    }
-    
-    Serial.println("  [5/6] Configuring DAC path...");
-    if (!codec.setDACDataPath(true, true, 
-                             TLV320_DAC_PATH_NORMAL,
-                             TLV320_DAC_PATH_NORMAL,
-                             TLV320_VOLUME_STEP_1SAMPLE)) {
-        Serial.println("Failed to configure DAC data path!");
+    Serial.println("  [2/2] Configuring DAC path, volume and speaker...");
+    _regs.write(DAC_OUTPUT, sizeof(DAC_OUTPUT) / sizeof(DAC_OUTPUT[0]));
+    stageVolume();
+    if (!_regs.flush()) {
+        Serial.println("Failed to configure DAC output!");
         return false;
     }
-    
-    if (!codec.configureAnalogInputs(TLV320_DAC_ROUTE_MIXER,
-                                     TLV320_DAC_ROUTE_MIXER,
-                                     false, false, false,
-                                     false)) {
-        Serial.println("Failed to configure DAC routing!");
-        return false;
-    }
-    
-    Serial.println("  [6/6] Setting volume and powering up speaker...");
-    if (!codec.setDACVolumeControl(
-            false, false, TLV320_VOL_INDEPENDENT) ||
-        !codec.setChannelVolume(false, 18) ||
-        !codec.setChannelVolume(true, 18)) {
-        Serial.println("Failed to configure DAC volume control!");
-        return false;
-    }
-    
-    if (!codec.setChannelVolume(false, 5.0) ||
-        !codec.setChannelVolume(true, 5.0)) {
-        Serial.println("Failed to set DAC channel volumes!");
-        return false;
-    }
-    
-    if (!codec.enableSpeaker(true) ||
-        !codec.configureSPK_PGA(TLV320_SPK_GAIN_6DB,
-                                true) ||
-        !codec.setSPKVolume(true, 0)) {
-        Serial.println("Failed to configure speaker output!");
-        return false;
-    }
-    
-    delay(100);
+
+    _ready = true;
     
     Serial.println("✓ DAC Configuration Complete!");
     Serial.println("\nHardware Checklist (Based on Example Wiring):");
@@ -139,4 +163,226 @@ bool DACController::configureDAC() {
     Serial.println("  □ DAC JST-PH to speaker (4-8Ω speaker)\n");
     
     return true;
-}
\ No newline at end of file
+}
+
+float DACController::percentToDb(uint8_t percent) {
+    if (percent == 0) return DAC_VOLUME_MIN_DB;
+    if (percent > 100) percent = 100;
+    float db = DAC_VOLUME_FULL_DB + 40.0f * log10f(percent / 100.0f);
+    return db < DAC_VOLUME_MIN_DB ? DAC_VOLUME_MIN_DB : db;
+}
+
+void DACController::setVolumePercent(uint8_t percent) {
+    setVolumeDb(percentToDb(percent));
+}
+
+void DACController::setVolumeDb(float db) {
+    if (db < DAC_VOLUME_MIN_DB) db = DAC_VOLUME_MIN_DB;
+    if (db > DAC_VOLUME_MAX_DB) db = DAC_VOLUME_MAX_DB;
+    _targetDb = db;
+}
+
+void DACController::update(uint32_t nowMs) {
+    uint32_t elapsed = nowMs - _rampMs;
+    _rampMs = nowMs;
+    if (!_ready) return;
+
+    if (_currentDb != _targetDb) {
+        float step = VOLUME_RAMP_DB_PER_S * elapsed / 1000.0f;
+        if (_currentDb < _targetDb) {
+            _currentDb = _currentDb + step > _targetDb ? _targetDb : _currentDb + step;
+        } else {
+            _currentDb = _currentDb - step < _targetDb ? _targetDb : _currentDb - step;
+        }
+    }
+    writeVolume();
+}
+
+// Mute bits and both channel volumes, one burst; the shadow drops it when
+// the ramp has not crossed a 0.5 dB step. Muting waits for the ramp to
+// reach the bottom, unmuting happens there.
+void DACController::stageVolume() {
+    bool mute = _targetDb <= DAC_VOLUME_MIN_DB && _currentDb <= DAC_VOLUME_MIN_DB;
+
+    float level = _currentDb + _headroomDb;
+    if (level < DAC_VOLUME_MIN_DB) level = DAC_VOLUME_MIN_DB;
+    if (level > DAC_VOLUME_MAX_DB) level = DAC_VOLUME_MAX_DB;
+    uint8_t halfDb = (uint8_t)(int8_t)lroundf(level * 2);
+
+    uint8_t regs[3] = { mute ? DAC_MUTE_BOTH : (uint8_t)0, halfDb, halfDb };
+    _regs.write(0, DAC_REG_VOLUME_CONTROL, regs, sizeof(regs));
+}
+
+bool DACController::writeVolume() {
+    stageVolume();
+    return _regs.flush();
+}
+
+bool DACController::setEq(const EqSettings& eq) {
+    EqSettings clamped = eq;
+    int8_t* bands[] = { &clamped.bassDb, &clamped.midDb, &clamped.trebleDb };
+    for (int8_t* band : bands) {
+        if (*band > EQ_MAX_DB) *band = EQ_MAX_DB;
+        if (*band < -EQ_MAX_DB) *band = -EQ_MAX_DB;
+    }
+    _eq = clamped;
+    return writeEq();
+}
+
+void DACController::setSampleRate(uint32_t sampleRate, uint8_t wordBits) {
+    if (sampleRate == 0 || (sampleRate == _sampleRate && wordBits == _wordBits)) return;
+    _sampleRate = sampleRate;
+    _wordBits = wordBits;
+    if (_ready) applyClocks();
+    writeEq();
+}
+
+// The requested width, or DAC_WIDE_SLOT_BITS when BCLK at that width is
+// out of the PLL's reach.
+static bool planClocks(uint32_t sampleRate, uint8_t wordBits, DacClockPlan& out) {
+    if (DACClockPlanner::plan(sampleRate, wordBits, out)) return true;
+    return wordBits < DAC_WIDE_SLOT_BITS && DACClockPlanner::plan(sampleRate, DAC_WIDE_SLOT_BITS, out);
+}
+
+void DACController::prepareSampleRate(uint32_t sampleRate, uint8_t wordBits) {
+    if (sampleRate == 0) return;
+    if (_preparedPlan.sampleRate == sampleRate && _preparedBits == wordBits) return;
+    _preparedBits = wordBits;
+    if (!planClocks(sampleRate, wordBits, _preparedPlan)) _preparedPlan = DacClockPlan{};
+}
+
+// A running tree is switched off with its old values, rewritten, then
+// powered again, so the dividers never run half-programmed. The shadow
+// keeps each step to the registers that actually change.
+bool DACController::applyClocks() {
+    DacClockPlan plan;
+    if (_preparedPlan.sampleRate == _sampleRate && _preparedBits == _wordBits) {
+        plan = _preparedPlan;
+    } else if (!planClocks(_sampleRate, _wordBits, plan)) {
+        Serial.printf("WARNING: No DAC clock plan for %u Hz, %u-bit from BCLK.\n",
+                      (unsigned)_sampleRate, (unsigned)_wordBits);
+        return false;
+    }
+    if (_clocked && plan == _clockPlan) return true;
+
+    RegisterValue regs[DAC_CLOCK_REGISTERS];
+    if (_clocked) {
+        DACClockPlanner::toRegisters(_clockPlan, false, regs);
+        _regs.write(regs, DAC_CLOCK_REGISTERS);
+        if (!_regs.flush()) return false;
+    }
+    DACClockPlanner::toRegisters(plan, false, regs);
+    _regs.write(regs, DAC_CLOCK_REGISTERS);
+    if (!_regs.flush()) return false;
+    DACClockPlanner::toRegisters(plan, true, regs);
+    _regs.write(regs, DAC_CLOCK_REGISTERS);
+    if (!_regs.flush()) return false;
+
+    _clockPlan = plan;
+    _clocked = true;
+    Serial.printf("DAC clocks: %u Hz %u-bit, PLL %.2f MHz (P=%u R=%u J=%u), NDAC=%u MDAC=%u DOSR=%u\n",
+                  (unsigned)plan.sampleRate, (unsigned)plan.wordBits, plan.codecClkHz() / 1e6,
+                  (unsigned)plan.pllP, (unsigned)plan.pllR, (unsigned)plan.pllJ,
+                  (unsigned)plan.ndac, (unsigned)plan.mdac, (unsigned)plan.dosr);
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// Biquads (RBJ cookbook), in the codec's Q15 format:
+//   H(z) = (N0 + 2*N1 z^-1 + N2 z^-2) / (32768 - 2*D1 z^-1 - D2 z^-2)
+// A boosting band has its numerator scaled down by its own gain so no
+// coefficient leaves [-1, 1); the sum of those boosts is the headroom.
+// ----------------------------------------------------------------------------
+struct Biquad {
+    float b0, b1, b2, a1, a2;
+};
+
+static Biquad shelf(bool high, float f0, float gainDb, float fs) {
+    float A = powf(10.0f, gainDb / 40.0f);
+    float w0 = 2.0f * (float)M_PI * f0 / fs;
+    float c = cosf(w0);
+    float alpha = sinf(w0) / 2.0f * sqrtf(2.0f);
+    float k = 2.0f * sqrtf(A) * alpha;
+    float sign = high ? -1.0f : 1.0f;
+
+    float b0 = A * ((A + 1) - sign * (A - 1) * c + k);
+    float b1 = sign * 2 * A * ((A - 1) - sign * (A + 1) * c);
+    float b2 = A * ((A + 1) - sign * (A - 1) * c - k);
+    float a0 = (A + 1) + sign * (A - 1) * c + k;
+    float a1 = -sign * 2 * ((A - 1) + sign * (A + 1) * c);
+    float a2 = (A + 1) + sign * (A - 1) * c - k;
+    return Biquad{ b0 / a0, b1 / a0, b2 / a0, a1 / a0, a2 / a0 };
+}
+
+static Biquad peak(float f0, float q, float gainDb, float fs) {
+    float A = powf(10.0f, gainDb / 40.0f);
+    float w0 = 2.0f * (float)M_PI * f0 / fs;
+    float c = cosf(w0);
+    float alpha = sinf(w0) / (2.0f * q);
+    float a0 = 1 + alpha / A;
+    return Biquad{ (1 + alpha * A) / a0, -2 * c / a0, (1 - alpha * A) / a0,
+                   -2 * c / a0, (1 - alpha / A) / a0 };
+}
+
+static void putQ15(uint8_t* out, float value) {
+    long q = lroundf(value * 32768.0f);
+    if (q > 32767) q = 32767;
+    if (q < -32768) q = -32768;
+    out[0] = (uint8_t)((uint16_t)q >> 8);
+    out[1] = (uint8_t)q;
+}
+
+static void encodeBiquad(uint8_t* out, const Biquad& bq, float gainDb) {
+    float scale = gainDb > 0 ? powf(10.0f, -gainDb / 20.0f) : 1.0f;
+    putQ15(out + 0, bq.b0 * scale);
+    putQ15(out + 2, bq.b1 * scale / 2);
+    putQ15(out + 4, bq.b2 * scale);
+    putQ15(out + 6, -bq.a1 / 2);
+    putQ15(out + 8, -bq.a2);
+}
+
+// Fills the idle buffer and swaps. Volume moves first when headroom grows
+// and last when it shrinks, so the level never overshoots in between.
+bool DACController::writeEq() {
+    if (!_ready) return true;
+    if (_eq == _writtenEq && (_eq.isFlat() || _sampleRate == _writtenRate)) return true;
+
+    float fs = (float)_sampleRate;
+    uint8_t coefficients[30];
+    encodeBiquad(coefficients, shelf(false, EQ_BASS_HZ, _eq.bassDb, fs), _eq.bassDb);
+    encodeBiquad(coefficients + 10, peak(EQ_MID_HZ, EQ_MID_Q, _eq.midDb, fs), _eq.midDb);
+    encodeBiquad(coefficients + 20, shelf(true, EQ_TREBLE_HZ, _eq.trebleDb, fs), _eq.trebleDb);
+
+    float headroom = 0;
+    if (_eq.bassDb > 0) headroom += _eq.bassDb;
+    if (_eq.midDb > 0) headroom += _eq.midDb;
+    if (_eq.trebleDb > 0) headroom += _eq.trebleDb;
+
+    bool growing = headroom > _headroomDb;
+    if (growing) {
+        _headroomDb = headroom;
+        writeVolume();
+    }
+
+    uint8_t left = _bufferB ? COEF_PAGE_A_LEFT : COEF_PAGE_B_LEFT;
+    uint8_t right = _bufferB ? COEF_PAGE_A_RIGHT : COEF_PAGE_B_RIGHT;
+    _regs.write(left, COEF_BIQUAD_A_REG, coefficients, sizeof(coefficients));
+    _regs.write(right, COEF_BIQUAD_A_REG, coefficients, sizeof(coefficients));
+    if (!_regs.flush() ||
+        !_regs.strobe(COEF_PAGE_A_LEFT, COEF_ADAPTIVE_REG, COEF_ADAPTIVE_ENABLE | COEF_ADAPTIVE_SWITCH)) {
+        Serial.println("ERROR: Failed to write EQ coefficients!");
+        return false;
+    }
+    _bufferB = !_bufferB;
+    _writtenEq = _eq;
+    _writtenRate = _sampleRate;
+
+    if (!growing) {
+        _headroomDb = headroom;
+        writeVolume();
+    }
+
+    Serial.printf("EQ: bass %+d dB, mid %+d dB, treble %+d dB at %u Hz\n",
+                  _eq.bassDb, _eq.midDb, _eq.trebleDb, (unsigned)_sampleRate);
+    return true;
+}
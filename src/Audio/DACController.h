@@ -4,8 +4,9 @@
 #ifndef DAC_CONTROLLER_H
 #define DAC_CONTROLLER_H
 
-#include <Adafruit_TLV320DAC3100.h>
 #include <Wire.h>
+#include "RegisterWriter.h"
+#include "DACClockPlanner.h"
 
 // I2S Pins for Adafruit TLV320DAC3100 (avoiding SD card pins: 21, 39, 42, 45)
 static constexpr int BCLK_PIN = 9;   // Bit Clock (D9 in example)
@@ -19,24 +20,107 @@ static constexpr int DAC_RST_PIN = 7; // Hardware reset (D7 in example)
 static constexpr int I2C_SDA = 47;   // STEMMA QT SDA
 static constexpr int I2C_SCL = 48;   // STEMMA QT SCL
 
-// TLV320DAC3100 I2C address (handled by Adafruit library)
+// Slot width to fall back to when the requested one has no clock plan:
+// BCLK is 2 * slot bits * fs, and at 8-12 kHz 16-bit slots leave it under
+// the PLL's 512 kHz input minimum.
+static constexpr uint8_t DAC_WIDE_SLOT_BITS = 32;
+
+// TLV320DAC3100 I2C address
 static constexpr uint8_t DAC_I2C_ADDR = 0x18;
 
+// The DAC3100 runs the bus in fast mode.
+static constexpr uint32_t DAC_I2C_CLOCK_HZ = 400000;
+
+// Codec digital volume: 0.5 dB steps from -63.5 to +24 dB.
+static constexpr float DAC_VOLUME_MIN_DB = -63.5f;
+static constexpr float DAC_VOLUME_MAX_DB = 24.0f;
+
+// Level at 100%. Slider positions follow an amplitude-squared taper
+// (40 * log10(percent / 100) dB), so the top of the slider is fine and
+// the bottom still reaches silence.
+static constexpr float DAC_VOLUME_FULL_DB = 5.0f;
+
+// How fast the digital volume glides to a new level. A slider drag only
+// costs one write per 0.5 dB the ramp actually passes through.
+static constexpr float VOLUME_RAMP_DB_PER_S = 60.0f;
+
+// Tone control range per band; boosts are paid for with headroom taken
+// back out of the digital volume, so the biquads never clip.
+static constexpr int8_t EQ_MAX_DB = 12;
+
+struct EqSettings {
+    int8_t bassDb;      // Low shelf, 100 Hz
+    int8_t midDb;       // Peak, 1 kHz
+    int8_t trebleDb;    // High shelf, 8 kHz
+
+    bool operator==(const EqSettings& other) const {
+        return bassDb == other.bassDb && midDb == other.midDb && trebleDb == other.trebleDb;
+    }
+    bool isFlat() const { return bassDb == 0 && midDb == 0 && trebleDb == 0; }
+};
+
 class DACController {
 public:
     DACController();
     
     // Initialize I2C and DAC hardware
     bool begin();
-    
-    // Get the codec instance
-    Adafruit_TLV320DAC3100& getCodec() { return codec; }
+
+    // Volume and tone run in the codec, so decoded samples pass through
+    // the CPU untouched. Targets only; update() ramps toward them.
+    void setVolumePercent(uint8_t percent);
+    void setVolumeDb(float db);     // At or below DAC_VOLUME_MIN_DB mutes
+    static float percentToDb(uint8_t percent);
+
+    // Programs the biquads for the current sample rate. Skipped when
+    // nothing changed.
+    bool setEq(const EqSettings& eq);
+    EqSettings getEq() const { return _eq; }
+    // Reclocks the codec for the I2S stream (only the registers that
+    // differ) and recomputes the EQ. The player reports every track's rate.
+    // Where wordBits has no plan, the codec is clocked for
+    // DAC_WIDE_SLOT_BITS instead; I2S has to follow, see slotBits().
+    void setSampleRate(uint32_t sampleRate, uint8_t wordBits = 16);
+    // Plans ahead, e.g. while the next track is prefetched, so the switch
+    // itself only writes registers.
+    void prepareSampleRate(uint32_t sampleRate, uint8_t wordBits = 16);
+    const DacClockPlan& getClockPlan() const { return _clockPlan; }
+    // I2S slot width the codec is clocked for.
+    uint8_t slotBits() const { return _clocked ? _clockPlan.wordBits : _wordBits; }
+
+    // Steps the volume ramp. Call often from the audio task.
+    void update(uint32_t nowMs);
+
+    // Every register write since boot, bring-up included.
+    const RegisterWriterStats& getBusStats() const { return _regs.getStats(); }
     
 private:
-    Adafruit_TLV320DAC3100 codec;
+    RegisterWriter _regs;
+    bool _ready;
     
     // Configure the DAC registers
     bool configureDAC();
+
+    float _targetDb;
+    float _currentDb;      // Ramp position, before headroom
+    uint32_t _rampMs;
+    void stageVolume();
+    bool writeVolume();
+
+    uint32_t _sampleRate;
+    uint8_t _wordBits;
+    DacClockPlan _clockPlan;        // Running, once _clocked
+    DacClockPlan _preparedPlan;
+    uint8_t _preparedBits;          // Width asked for; the plan may be wider
+    bool _clocked;
+    bool applyClocks();
+
+    EqSettings _eq;
+    EqSettings _writtenEq;
+    uint32_t _writtenRate;
+    float _headroomDb;
+    bool _bufferB;         // Coefficient buffer the DAC is running from
+    bool writeEq();
 };
 
 #endif // DAC_CONTROLLER_H
@@ -0,0 +1,185 @@
+// ============================================================================
+// FolderWalker.cpp
+// ============================================================================
+#include "FolderWalker.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// Copies the next comma-separated item of `list` into out, trimmed. False
+// at the end of the list.
+static bool nextItem(const char*& list, char* out, size_t size) {
+    while (*list == ',' || *list == ' ') list++;
+    if (*list == '\0') return false;
+
+    const char* end = strchr(list, ',');
+    if (end == nullptr) end = list + strlen(list);
+    const char* last = end;
+    while (last > list && last[-1] == ' ') last--;
+
+    size_t length = last - list;
+    if (length >= size) length = size - 1;
+    memcpy(out, list, length);
+    out[length] = '\0';
+    // "/Music/" and "/Music" are the same folder; "/" stays.
+    while (length > 1 && out[length - 1] == '/') out[--length] = '\0';
+    list = end;
+    return true;
+}
+
+// True if `path` is `folder` or lies inside it.
+static bool isWithin(const char* path, const char* folder) {
+    size_t length = strlen(folder);
+    if (length == 1 && folder[0] == '/') return true;
+    return strncasecmp(path, folder, length) == 0 && (path[length] == '\0' || path[length] == '/');
+}
+
+FolderWalker::FolderWalker()
+    : _pool(nullptr), _offsets(nullptr), _depths(nullptr), _top(0), _poolUsed(0), _folders(0), _entries(0),
+      _skipped(0) {
+    configure(MUSICBOX_SCAN_INCLUDE, MUSICBOX_SCAN_EXCLUDE);
+}
+
+FolderWalker::~FolderWalker() {
+    release();
+}
+
+bool FolderWalker::allocate() {
+    size_t bytes = SCAN_STACK_BYTES + SCAN_STACK_ENTRIES * (sizeof(uint16_t) + sizeof(uint8_t));
+    uint8_t* block = nullptr;
+    if (psramFound()) block = (uint8_t*)ps_malloc(bytes);
+    if (block == nullptr) block = (uint8_t*)malloc(bytes);
+    if (block == nullptr) {
+        Serial.println("ERROR: No memory for the folder scan.");
+        return false;
+    }
+    _offsets = (uint16_t*)block;
+    _depths = block + SCAN_STACK_ENTRIES * sizeof(uint16_t);
+    _pool = (char*)(_depths + SCAN_STACK_ENTRIES);
+    return true;
+}
+
+void FolderWalker::release() {
+    free(_offsets);
+    _offsets = nullptr;
+    _depths = nullptr;
+    _pool = nullptr;
+}
+
+bool FolderWalker::configure(const char* include, const char* exclude) {
+    if (strlen(include) > SCAN_LIST_MAX || strlen(exclude) > SCAN_LIST_MAX) return false;
+    strcpy(_include, include);
+    strcpy(_exclude, exclude);
+    return true;
+}
+
+bool FolderWalker::push(const char* path, uint8_t depth) {
+    size_t length = strlen(path) + 1;
+    if (_top == SCAN_STACK_ENTRIES || _poolUsed + length > SCAN_STACK_BYTES || depth > SCAN_MAX_DEPTH) {
+        _skipped++;
+        return false;
+    }
+    memcpy(_pool + _poolUsed, path, length);
+    _offsets[_top] = _poolUsed;
+    _depths[_top] = depth;
+    _top++;
+    _poolUsed += length;
+    return true;
+}
+
+// First pool byte past every path still on the stack. Siblings are popped
+// in the opposite order to their place in the pool, so this is not always
+// the popped path's own offset.
+size_t FolderWalker::poolEnd() const {
+    size_t end = 0;
+    for (int i = 0; i < _top; i++) {
+        size_t entryEnd = _offsets[i] + strlen(_pool + _offsets[i]) + 1;
+        if (entryEnd > end) end = entryEnd;
+    }
+    return end;
+}
+
+// Reverses the stack entries from `from` up, so folders pushed in listing
+// order are popped in listing order. Only the offsets move.
+void FolderWalker::reverse(int from) {
+    for (int a = from, b = _top - 1; a < b; a++, b--) {
+        uint16_t offset = _offsets[a];
+        _offsets[a] = _offsets[b];
+        _offsets[b] = offset;
+        uint8_t depth = _depths[a];
+        _depths[a] = _depths[b];
+        _depths[b] = depth;
+    }
+}
+
+bool FolderWalker::isExcluded(const char* path, const char* name) const {
+    if (name[0] == '.') return true;
+
+    char item[SCAN_LIST_MAX + 1];
+    for (const char* list = _exclude; nextItem(list, item, sizeof(item)); ) {
+        if (item[0] == '/' ? strcasecmp(path, item) == 0 : strcasecmp(name, item) == 0) return true;
+    }
+    return false;
+}
+
+bool FolderWalker::walk(fs::FS& fs, FolderVisitor& visitor) {
+    _folders.store(0, std::memory_order_relaxed);
+    _entries.store(0, std::memory_order_relaxed);
+    _skipped = 0;
+    if (!allocate()) return false;
+
+    char root[SCAN_LIST_MAX + 1];
+    char other[SCAN_LIST_MAX + 1];
+    for (const char* roots = _include; nextItem(roots, root, sizeof(root)); ) {
+        // A root inside another root is covered by that one's walk.
+        bool nested = false;
+        for (const char* list = _include; !nested && nextItem(list, other, sizeof(other)); ) {
+            nested = strcasecmp(other, root) != 0 && isWithin(root, other);
+        }
+        if (nested) continue;
+
+        _top = 0;
+        _poolUsed = 0;
+        push(root, 0);
+
+        while (_top > 0) {
+            _top--;
+            const char* folder = _pool + _offsets[_top];
+            uint8_t depth = _depths[_top];
+            // Its children may be pushed over the path once it is open.
+            File dir = fs.open(folder);
+            _poolUsed = poolEnd();
+            if (!dir || !dir.isDirectory()) continue;
+            _folders.fetch_add(1, std::memory_order_relaxed);
+
+            int children = _top;
+            bool isDir = false;
+            String path = dir.getNextFileName(&isDir);
+            while (path.length() > 0) {
+                const char* name = strrchr(path.c_str(), '/');
+                name = name != nullptr ? name + 1 : path.c_str();
+
+                if (isDir) {
+                    if (!isExcluded(path.c_str(), name)) push(path.c_str(), depth + 1);
+                } else if (!visitor.onFile(path.c_str(), name)) {
+                    release();
+                    return false;
+                }
+
+                if (_entries.fetch_add(1, std::memory_order_relaxed) % SCAN_YIELD_EVERY == SCAN_YIELD_EVERY - 1) {
+                    visitor.onYield();
+                    vTaskDelay(1);
+                }
+                path = dir.getNextFileName(&isDir);
+            }
+            dir.close();
+            reverse(children);
+            visitor.onFolderDone();
+        }
+    }
+
+    release();
+    if (_skipped > 0) {
+        Serial.printf("WARNING: %u folder(s) skipped, too deep or too many pending.\n", (unsigned)_skipped);
+    }
+    return true;
+}
@@ -0,0 +1,100 @@
+// ============================================================================
+// FolderWalker.h
+// Walks the folders the library is built from without recursion: pending
+// folders wait on an explicit, fixed-size stack of paths (allocated for the
+// walk only, in PSRAM when there is some), and only one directory handle
+// is ever open. A folder's files are reported while its handle is open;
+// its subfolders are pushed and walked after it is closed, in the order the
+// card lists them.
+//
+// Which folders count is configurable: a comma-separated include list of
+// card paths to start from, and an exclude list whose entries either name
+// a card path ("/Music/Demos") or a folder name to skip anywhere ("Demos").
+// Hidden folders (".name") are always skipped.
+//
+// The walk pauses for a tick every SCAN_YIELD_EVERY entries so lower
+// priority tasks (the web server among them) keep running through a long
+// scan.
+// ============================================================================
+#ifndef FOLDER_WALKER_H
+#define FOLDER_WALKER_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <atomic>
+
+// Default folders to scan; override with -DMUSICBOX_SCAN_INCLUDE="..." etc.
+#ifndef MUSICBOX_SCAN_INCLUDE
+#define MUSICBOX_SCAN_INCLUDE "/"
+#endif
+#ifndef MUSICBOX_SCAN_EXCLUDE
+#define MUSICBOX_SCAN_EXCLUDE "System Volume Information,LOST.DIR,$RECYCLE.BIN,RECYCLER"
+#endif
+
+// Longest include or exclude list, in bytes.
+static constexpr size_t SCAN_LIST_MAX = 160;
+
+// Work stack: folder paths waiting to be walked, which for a wide library
+// is every sibling of every folder on the current path. A folder that does
+// not fit is skipped and counted, never overflowed.
+static constexpr size_t SCAN_STACK_BYTES = 24 * 1024;
+static constexpr int SCAN_STACK_ENTRIES = 1536;
+static constexpr uint8_t SCAN_MAX_DEPTH = 16;
+
+// Directory entries between yields.
+static constexpr uint32_t SCAN_YIELD_EVERY = 32;
+
+class FolderVisitor {
+public:
+    virtual ~FolderVisitor() {}
+    // A file (not a folder). The folder's handle is open, so nothing may be
+    // opened here. Return false to stop the walk.
+    virtual bool onFile(const char* path, const char* name) = 0;
+    // The folder whose files were just reported is closed again.
+    virtual void onFolderDone() {}
+    // Called at every yield point.
+    virtual void onYield() {}
+};
+
+class FolderWalker {
+public:
+    FolderWalker();
+    ~FolderWalker();
+
+    // False if a list is too long; the previous lists stay in force.
+    bool configure(const char* include, const char* exclude);
+    const char* include() const { return _include; }
+    const char* exclude() const { return _exclude; }
+
+    // False if the visitor stopped the walk or the stack could not be
+    // allocated.
+    bool walk(fs::FS& fs, FolderVisitor& visitor);
+
+    // Of the current or last walk; readable from any task.
+    uint32_t foldersScanned() const { return _folders.load(std::memory_order_relaxed); }
+    uint32_t entriesScanned() const { return _entries.load(std::memory_order_relaxed); }
+    uint32_t foldersSkipped() const { return _skipped; }
+
+private:
+    char _include[SCAN_LIST_MAX + 1];
+    char _exclude[SCAN_LIST_MAX + 1];
+
+    char* _pool;                // [SCAN_STACK_BYTES]
+    uint16_t* _offsets;         // [SCAN_STACK_ENTRIES] into _pool
+    uint8_t* _depths;           // [SCAN_STACK_ENTRIES]
+    int _top;
+    size_t _poolUsed;
+
+    std::atomic<uint32_t> _folders;
+    std::atomic<uint32_t> _entries;
+    uint32_t _skipped;
+
+    bool allocate();
+    void release();
+    bool push(const char* path, uint8_t depth);
+    void reverse(int from);
+    size_t poolEnd() const;
+    bool isExcluded(const char* path, const char* name) const;
+};
+
+#endif // FOLDER_WALKER_H
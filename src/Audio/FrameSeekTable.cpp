@@ -0,0 +1,201 @@
+// ============================================================================
+// FrameSeekTable.cpp
+// ============================================================================
+#include "FrameSeekTable.h"
+
+// kbit/s, indexed [MPEG1 ? 0 : 1][layer - 1][bitrate index]
+static const uint16_t BITRATES[2][3][15] = {
+    {
+        { 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448 },
+        { 0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384 },
+        { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 },
+    },
+    {
+        { 0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256 },
+        { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 },
+        { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 },
+    },
+};
+
+static const uint32_t SAMPLE_RATES[3] = { 44100, 48000, 32000 };
+
+bool MpegFrame::parse(const uint8_t* p, MpegFrame& frame) {
+    if (p[0] != 0xFF || (p[1] & 0xE0) != 0xE0) return false;
+
+    uint8_t version = (p[1] >> 3) & 0x03;     // 3 = MPEG1, 2 = MPEG2, 0 = MPEG2.5
+    uint8_t layerBits = (p[1] >> 1) & 0x03;   // 3 = Layer I, 1 = Layer III
+    uint8_t bitrateIndex = p[2] >> 4;
+    uint8_t rateIndex = (p[2] >> 2) & 0x03;
+    uint8_t padding = (p[2] >> 1) & 0x01;
+
+    if (version == 1 || layerBits == 0 || bitrateIndex == 0 || bitrateIndex == 0x0F || rateIndex == 3) {
+        return false;
+    }
+
+    bool mpeg1 = version == 3;
+    uint8_t layer = 4 - layerBits;
+    uint32_t bitrate = BITRATES[mpeg1 ? 0 : 1][layer - 1][bitrateIndex] * 1000;
+    uint32_t rate = SAMPLE_RATES[rateIndex] >> (mpeg1 ? 0 : (version == 2 ? 1 : 2));
+
+    if (layer == 1) {
+        frame.samples = 384;
+        frame.length = (12 * bitrate / rate + padding) * 4;
+    } else if (layer == 3 && !mpeg1) {
+        frame.samples = 576;
+        frame.length = 72 * bitrate / rate + padding;
+    } else {
+        frame.samples = 1152;
+        frame.length = 144 * bitrate / rate + padding;
+    }
+    frame.sampleRate = rate;
+    frame.channels = ((p[3] >> 6) == 3) ? 1 : 2;
+    return frame.length > 4;
+}
+
+uint32_t id3v2TagSize(const uint8_t* head, size_t length) {
+    if (length < 10 || memcmp(head, "ID3", 3) != 0) return 0;
+
+    uint32_t size = ((uint32_t)(head[6] & 0x7F) << 21) | ((uint32_t)(head[7] & 0x7F) << 14) |
+                    ((uint32_t)(head[8] & 0x7F) << 7) | (uint32_t)(head[9] & 0x7F);
+    return 10 + size + ((head[5] & 0x10) ? 10 : 0);
+}
+
+FrameSeekTable::FrameSeekTable()
+    : _format(NONE), _samplesPerFrame(0), _dataOffset(0), _blockAlign(0),
+      _offsets(nullptr), _count(0), _capacity(0) {
+}
+
+FrameSeekTable::~FrameSeekTable() {
+    free(_offsets);
+}
+
+void FrameSeekTable::clear() {
+    _path = "";
+    _format = NONE;
+    _count = 0;
+}
+
+bool FrameSeekTable::append(uint32_t offset) {
+    if (_count == _capacity) {
+        size_t capacity = _capacity ? _capacity * 2 : 64;
+        uint32_t* offsets = (uint32_t*)realloc(_offsets, capacity * sizeof(uint32_t));
+        if (offsets == nullptr) return false;
+        _offsets = offsets;
+        _capacity = capacity;
+    }
+    _offsets[_count++] = offset;
+    return true;
+}
+
+bool FrameSeekTable::open(fs::FS& fs, const char* path) {
+    if (_format != NONE && _path == path) return true;
+
+    clear();
+
+    File file = fs.open(path);
+    if (!file || file.isDirectory()) return false;
+
+    uint8_t head[512];
+    size_t length = file.read(head, sizeof(head));
+
+    if (length >= 12 && memcmp(head, "RIFF", 4) == 0 && memcmp(head + 8, "WAVE", 4) == 0) {
+        file.seek(12);
+        if (!parseWav(file)) return false;
+        _format = WAV;
+        _path = path;
+        return true;
+    }
+
+    // First frame after any ID3v2 tag: a sync whose successor is also a
+    // valid header, so a stray 0xFF in the data does not count.
+    uint32_t start = id3v2TagSize(head, length);
+    if (!file.seek(start)) return false;
+    length = file.read(head, sizeof(head));
+
+    for (size_t i = 0; i + 4 <= length; i++) {
+        MpegFrame frame;
+        if (!MpegFrame::parse(head + i, frame)) continue;
+
+        uint8_t next[4];
+        if (!file.seek(start + i + frame.length) || file.read(next, 4) != 4) break;
+
+        MpegFrame following;
+        if (MpegFrame::parse(next, following) && following.sampleRate == frame.sampleRate) {
+            _samplesPerFrame = frame.samples;
+            _format = MP3;
+            _path = path;
+            return append(start + i);
+        }
+    }
+    return false;
+}
+
+bool FrameSeekTable::parseWav(File& file) {
+    uint8_t chunk[8];
+    while (file.read(chunk, 8) == 8) {
+        uint32_t size = (uint32_t)chunk[4] | ((uint32_t)chunk[5] << 8) |
+                        ((uint32_t)chunk[6] << 16) | ((uint32_t)chunk[7] << 24);
+
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            uint8_t fmt[16];
+            if (size < 16 || file.read(fmt, 16) != 16) return false;
+            _blockAlign = (uint16_t)fmt[12] | ((uint16_t)fmt[13] << 8);
+            if (!file.seek(file.position() + size - 16 + (size & 1))) return false;
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            _dataOffset = file.position();
+            return _blockAlign != 0;
+        } else if (!file.seek(file.position() + size + (size & 1))) {
+            return false;
+        }
+    }
+    return false;
+}
+
+bool FrameSeekTable::locate(fs::FS& fs, uint64_t sample, uint32_t& offset, uint32_t& skipFrames) {
+    if (_format == WAV) {
+        offset = _dataOffset + (uint32_t)(sample * _blockAlign);
+        skipFrames = 0;
+        return true;
+    }
+    if (_format != MP3 || _count == 0) return false;
+
+    uint32_t target = (uint32_t)(sample / _samplesPerFrame);
+    skipFrames = (uint32_t)(sample % _samplesPerFrame);
+
+    // Layer III frames may borrow bits from the previous one; start a frame
+    // early and drop its output so the target frame decodes cleanly.
+    if (target > 0) {
+        target--;
+        skipFrames += _samplesPerFrame;
+    }
+
+    size_t entry = target / SEEK_TABLE_STRIDE;
+    if (entry >= _count) entry = _count - 1;
+    uint32_t frameIndex = entry * SEEK_TABLE_STRIDE;
+    uint32_t pos = _offsets[entry];
+
+    if (frameIndex == target) {
+        offset = pos;
+        return true;
+    }
+
+    File file = fs.open(_path.c_str());
+    if (!file) return false;
+
+    while (frameIndex < target) {
+        uint8_t header[4];
+        MpegFrame frame;
+        if (!file.seek(pos) || file.read(header, 4) != 4 || !MpegFrame::parse(header, frame)) {
+            return false;   // Past the end or lost sync
+        }
+        pos += frame.length;
+        frameIndex++;
+
+        if (frameIndex % SEEK_TABLE_STRIDE == 0 && frameIndex / SEEK_TABLE_STRIDE == _count) {
+            append(pos);
+        }
+    }
+
+    offset = pos;
+    return true;
+}
@@ -0,0 +1,64 @@
+// ============================================================================
+// FrameSeekTable.h
+// Maps a sample position in a track to a byte offset that starts a frame,
+// so a reconnect after the decoder was released lands on a frame boundary
+// instead of mid-frame. MP3 offsets are found by walking frame headers;
+// every SEEK_TABLE_STRIDE-th frame offset is kept so later lookups in the
+// same track start close to their target. WAV is plain arithmetic.
+// ============================================================================
+#ifndef FRAME_SEEK_TABLE_H
+#define FRAME_SEEK_TABLE_H
+
+#include <Arduino.h>
+#include <FS.h>
+
+// One table entry per this many MPEG frames (~0.84 s at 44.1 kHz).
+static constexpr uint32_t SEEK_TABLE_STRIDE = 32;
+
+struct MpegFrame {
+    uint32_t sampleRate;
+    uint16_t samples;      // PCM frames per MPEG frame
+    uint16_t length;       // Bytes including the header
+    uint8_t channels;
+
+    // Parses the 4-byte header at p. False if it is not a valid header.
+    static bool parse(const uint8_t* p, MpegFrame& frame);
+};
+
+// Size of an ID3v2 tag at the start of `head` (0 if there is none).
+uint32_t id3v2TagSize(const uint8_t* head, size_t length);
+
+class FrameSeekTable {
+public:
+    FrameSeekTable();
+    ~FrameSeekTable();
+
+    // Prepares the table for `path`. Keeps what was already built when it
+    // is the same track. False if the format is not seekable here.
+    bool open(fs::FS& fs, const char* path);
+    void clear();
+
+    // Frame-aligned byte offset at or before `sample`, and how many decoded
+    // frames to drop after reconnecting there to land exactly on it.
+    bool locate(fs::FS& fs, uint64_t sample, uint32_t& offset, uint32_t& skipFrames);
+
+    size_t entries() const { return _count; }
+
+private:
+    enum Format : uint8_t { NONE, MP3, WAV };
+
+    String _path;
+    Format _format;
+    uint32_t _samplesPerFrame;   // MP3
+    uint32_t _dataOffset;        // WAV: start of the data chunk
+    uint16_t _blockAlign;        // WAV
+
+    uint32_t* _offsets;          // MP3: byte offset of frame i * STRIDE
+    size_t _count;
+    size_t _capacity;
+
+    bool append(uint32_t offset);
+    bool parseWav(File& file);
+};
+
+#endif
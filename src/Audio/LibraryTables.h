@@ -0,0 +1,66 @@
+// ============================================================================
+// LibraryTables.h
+// Helpers shared by the tables built over the track list: the playlist
+// index, the metadata cache, saved playlists and the search index. FNV-1a
+// for checksums and in-memory buckets, 64-bit path hashes for anything that
+// matches paths across loads or keeps them on the card, and one allocator
+// that prefers PSRAM.
+// ============================================================================
+#ifndef LIBRARY_TABLES_H
+#define LIBRARY_TABLES_H
+
+#include <Arduino.h>
+#include "TrackArena.h"
+
+static constexpr uint32_t FNV_OFFSET = 2166136261u;
+static constexpr uint32_t FNV_PRIME = 16777619u;
+
+// 32-bit FNV-1a over `len` bytes, continuing from `hash`.
+inline uint32_t fnv1a(const void* data, size_t len, uint32_t hash = FNV_OFFSET) {
+    const uint8_t* p = (const uint8_t*)data;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= p[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+// 64-bit FNV-1a of a path, wide enough that two different paths of one
+// library never meet.
+inline uint64_t pathHash(const char* path) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const uint8_t* p = (const uint8_t*)path; *p; p++) {
+        hash ^= *p;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// The same, case-folded, for paths typed by people (M3U lines): FAT
+// compares names without case.
+inline uint64_t pathHashNoCase(const char* path) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const uint8_t* p = (const uint8_t*)path; *p; p++) {
+        hash ^= (uint8_t)tolower(*p);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// A track's path hash and its index, sorted by hash for lower_bound.
+struct PathKey {
+    uint64_t hash;
+    int32_t index;
+    bool operator<(const PathKey& other) const { return hash < other.hash; }
+};
+
+// PSRAM when it is present and enabled, otherwise, or when it is full,
+// internal RAM. Release with free().
+inline void* allocateTable(size_t size) {
+    void* p = nullptr;
+    if (PLAYLIST_USE_PSRAM && psramFound()) p = ps_malloc(size);
+    if (p == nullptr) p = malloc(size);
+    return p;
+}
+
+#endif // LIBRARY_TABLES_H
@@ -0,0 +1,333 @@
+// ============================================================================
+// MetadataIndex.cpp
+// ============================================================================
+#include "MetadataIndex.h"
+#include "LibraryTables.h"
+#include <SD.h>
+#include <algorithm>
+#include <new>
+
+static const char* META_CACHE_PATH = "/.musicbox.meta";
+static const char* META_CACHE_TMP_PATH = "/.musicbox.mtmp";
+static const uint32_t META_CACHE_MAGIC = 0x544D424D;  // "MBMT"
+static const uint16_t META_CACHE_VERSION = 2;
+
+// Just above idle, on the core the audio tasks leave alone.
+static constexpr UBaseType_t META_INDEX_TASK_PRIORITY = 1;
+static constexpr BaseType_t META_INDEX_TASK_CORE = 0;
+
+// Pause between files, so card time goes to playback first.
+static constexpr uint32_t META_INDEX_GAP_MS = 10;
+
+struct MetaCacheHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;
+    uint32_t count;
+    uint32_t bytes;        // Records and strings after the header
+    uint32_t checksum;     // FNV-1a over those bytes
+};
+
+struct MetaCacheRecord {
+    uint64_t pathHash;
+    uint32_t size;
+    uint32_t mtime;
+    uint32_t durationMs;
+    uint8_t lengths[4];    // Title, artist, album; the last is unused
+};
+
+MetadataIndex::MetadataIndex()
+    : _playlist(nullptr), _count(0), _meta(nullptr), _ready(nullptr), _indexed(0), _running(false), _stop(false),
+      _chunks(nullptr), _chunkBytes(0), _lastArtist(""), _lastAlbum("") {
+}
+
+MetadataIndex::~MetadataIndex() {
+    release();
+}
+
+// Forgets every entry but keeps the tables.
+void MetadataIndex::clearEntries() {
+    while (_chunks != nullptr) {
+        Chunk* next = _chunks->next;
+        free(_chunks);
+        _chunks = next;
+    }
+    _chunkBytes = 0;
+    _lastArtist = "";
+    _lastAlbum = "";
+    for (int i = 0; i < _count; i++) _ready[i].store(false, std::memory_order_relaxed);
+    _indexed.store(0);
+}
+
+void MetadataIndex::release() {
+    clearEntries();
+    free(_meta);
+    delete[] _ready;
+    _meta = nullptr;
+    _ready = nullptr;
+    _count = 0;
+}
+
+bool MetadataIndex::begin(SDPlaylist* playlist) {
+    if (_running.load()) return false;
+    release();
+
+    _playlist = playlist;
+    _count = playlist->getTrackCount();
+    if (_count == 0) return true;
+
+    _meta = (TrackMeta*)allocateTable(_count * sizeof(TrackMeta));
+    _ready = new (std::nothrow) std::atomic<bool>[_count];
+    if (_meta == nullptr || _ready == nullptr) {
+        Serial.println("ERROR: No memory for the metadata index!");
+        release();
+        return false;
+    }
+    clearEntries();
+
+    unsigned long start = millis();
+    if (loadCache()) {
+        Serial.printf("Metadata cache: %d of %d tracks in %lu ms\n", indexedCount(), _count,
+                      millis() - start);
+    }
+    return true;
+}
+
+const TrackMeta* MetadataIndex::get(int index) const {
+    if (index < 0 || index >= _count || !_ready[index].load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    return &_meta[index];
+}
+
+// Copies text into chunk storage, NUL-terminated. nullptr if out of memory.
+const char* MetadataIndex::store(const char* text, size_t length) {
+    if (length == 0) return "";
+
+    if (_chunks == nullptr || _chunks->used + length + 1 > META_CHUNK_BYTES) {
+        Chunk* chunk = (Chunk*)allocateTable(sizeof(Chunk));
+        if (chunk == nullptr) return nullptr;
+        chunk->next = _chunks;
+        chunk->used = 0;
+        _chunks = chunk;
+        _chunkBytes += sizeof(Chunk);
+    }
+
+    char* p = _chunks->data + _chunks->used;
+    memcpy(p, text, length);
+    p[length] = '\0';
+    _chunks->used += length + 1;
+    return p;
+}
+
+void MetadataIndex::publish(int index, const char* title, const char* artist, const char* album,
+                            size_t titleLength, size_t artistLength, size_t albumLength,
+                            uint32_t durationMs) {
+    TrackMeta meta;
+    meta.durationMs = durationMs;
+    meta.title = store(title, titleLength);
+
+    // Tracks of one album sit next to each other in the playlist.
+    if (artistLength == strlen(_lastArtist) && memcmp(artist, _lastArtist, artistLength) == 0) {
+        meta.artist = _lastArtist;
+    } else {
+        meta.artist = store(artist, artistLength);
+    }
+    if (albumLength == strlen(_lastAlbum) && memcmp(album, _lastAlbum, albumLength) == 0) {
+        meta.album = _lastAlbum;
+    } else {
+        meta.album = store(album, albumLength);
+    }
+
+    // Out of memory: the entry still counts, with the duration only.
+    if (meta.title == nullptr) meta.title = "";
+    if (meta.artist == nullptr) meta.artist = "";
+    if (meta.album == nullptr) meta.album = "";
+    _lastArtist = meta.artist;
+    _lastAlbum = meta.album;
+
+    _meta[index] = meta;
+    _ready[index].store(true, std::memory_order_release);
+    _indexed.fetch_add(1, std::memory_order_release);
+}
+
+bool MetadataIndex::loadCache() {
+    File file = SD.open(META_CACHE_PATH, FILE_READ);
+    if (!file) return false;
+
+    MetaCacheHeader header;
+    if (file.read((uint8_t*)&header, sizeof(header)) != sizeof(header) ||
+        header.magic != META_CACHE_MAGIC || header.version != META_CACHE_VERSION ||
+        header.recordSize != sizeof(MetaCacheRecord) ||
+        file.size() != sizeof(header) + header.bytes) {
+        return false;
+    }
+
+    // Playlist paths by hash, for matching records in any order.
+    PathKey* keys = (PathKey*)malloc(_count * sizeof(PathKey));
+    if (keys == nullptr) return false;
+    for (int i = 0; i < _count; i++) {
+        keys[i] = PathKey{ pathHash(_playlist->getTrack(i)), i };
+    }
+    std::sort(keys, keys + _count);
+
+    uint32_t checksum = FNV_OFFSET;
+    uint32_t consumed = 0;
+    bool ok = true;
+    for (uint32_t r = 0; ok && r < header.count; r++) {
+        MetaCacheRecord record;
+        char text[3 * META_TEXT_MAX];
+        ok = file.read((uint8_t*)&record, sizeof(record)) == sizeof(record) &&
+             record.lengths[0] <= META_TEXT_MAX && record.lengths[1] <= META_TEXT_MAX &&
+             record.lengths[2] <= META_TEXT_MAX;
+        if (!ok) break;
+
+        size_t textBytes = record.lengths[0] + record.lengths[1] + record.lengths[2];
+        ok = file.read((uint8_t*)text, textBytes) == textBytes;
+        checksum = fnv1a(&record, sizeof(record), checksum);
+        checksum = fnv1a(text, textBytes, checksum);
+        consumed += sizeof(record) + textBytes;
+
+        PathKey key{ record.pathHash, 0 };
+        for (PathKey* k = std::lower_bound(keys, keys + _count, key);
+             ok && k < keys + _count && k->hash == record.pathHash; k++) {
+            const TrackInfo* info = _playlist->getTrackInfo(k->index);
+            if (_ready[k->index].load(std::memory_order_relaxed) ||
+                info->size != record.size || info->mtime != record.mtime) {
+                continue;
+            }
+            publish(k->index, text, text + record.lengths[0],
+                    text + record.lengths[0] + record.lengths[1], record.lengths[0],
+                    record.lengths[1], record.lengths[2], record.durationMs);
+        }
+    }
+    free(keys);
+
+    if (!ok || consumed != header.bytes || checksum != header.checksum) {
+        Serial.println("Metadata cache is corrupt, ignoring it.");
+        // Nothing reads the index before begin() returns.
+        clearEntries();
+        return false;
+    }
+    return true;
+}
+
+// Every indexed entry, written in full and swapped in only once complete.
+bool MetadataIndex::saveCache() {
+    MetaCacheHeader header = {};
+    header.magic = META_CACHE_MAGIC;
+    header.version = META_CACHE_VERSION;
+    header.recordSize = sizeof(MetaCacheRecord);
+
+    uint8_t buffer[sizeof(MetaCacheRecord) + 3 * META_TEXT_MAX];
+    auto encode = [&](int index) -> size_t {
+        const TrackMeta& meta = _meta[index];
+        const TrackInfo* info = _playlist->getTrackInfo(index);
+        MetaCacheRecord record = {};
+        record.pathHash = pathHash(_playlist->getTrack(index));
+        record.size = info->size;
+        record.mtime = info->mtime;
+        record.durationMs = meta.durationMs;
+        record.lengths[0] = (uint8_t)strlen(meta.title);
+        record.lengths[1] = (uint8_t)strlen(meta.artist);
+        record.lengths[2] = (uint8_t)strlen(meta.album);
+
+        size_t n = sizeof(record);
+        memcpy(buffer, &record, n);
+        memcpy(buffer + n, meta.title, record.lengths[0]);
+        n += record.lengths[0];
+        memcpy(buffer + n, meta.artist, record.lengths[1]);
+        n += record.lengths[1];
+        memcpy(buffer + n, meta.album, record.lengths[2]);
+        return n + record.lengths[2];
+    };
+
+    uint32_t checksum = FNV_OFFSET;
+    for (int i = 0; i < _count; i++) {
+        if (!_ready[i].load(std::memory_order_acquire)) continue;
+        size_t n = encode(i);
+        checksum = fnv1a(buffer, n, checksum);
+        header.count++;
+        header.bytes += n;
+    }
+    header.checksum = checksum;
+
+    File file = SD.open(META_CACHE_TMP_PATH, FILE_WRITE);
+    bool ok = (bool)file;
+    if (ok) {
+        ok = file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header);
+        for (int i = 0; ok && i < _count; i++) {
+            if (!_ready[i].load(std::memory_order_acquire)) continue;
+            size_t n = encode(i);
+            ok = file.write(buffer, n) == n;
+        }
+        file.close();
+    }
+
+    if (ok) {
+        SD.remove(META_CACHE_PATH);
+        ok = SD.rename(META_CACHE_TMP_PATH, META_CACHE_PATH);
+    }
+    if (!ok) {
+        SD.remove(META_CACHE_TMP_PATH);
+    }
+    return ok;
+}
+
+bool MetadataIndex::startIndexer() {
+    if (_running.load() || isComplete()) return true;
+
+    _stop.store(false);
+    _running.store(true);
+    if (xTaskCreatePinnedToCore(taskEntry, "meta_index", 6144, this, META_INDEX_TASK_PRIORITY,
+                                nullptr, META_INDEX_TASK_CORE) != pdPASS) {
+        _running.store(false);
+        Serial.println("ERROR: Failed to start metadata indexer!");
+        return false;
+    }
+
+    Serial.printf("✓ Metadata indexer: %d of %d tracks to read\n", _count - indexedCount(), _count);
+    return true;
+}
+
+void MetadataIndex::stopIndexer() {
+    _stop.store(true);
+    while (_running.load()) vTaskDelay(pdMS_TO_TICKS(10));
+}
+
+void MetadataIndex::taskEntry(void* param) {
+    MetadataIndex* index = static_cast<MetadataIndex*>(param);
+    index->run();
+    index->_running.store(false);
+    vTaskDelete(nullptr);
+}
+
+void MetadataIndex::run() {
+    unsigned long start = millis();
+    int read = 0;
+    int unsaved = 0;
+
+    for (int i = 0; i < _count && !_stop.load(); i++) {
+        if (_ready[i].load(std::memory_order_relaxed)) continue;
+
+        // A file that cannot be opened still gets an (empty) entry, so the
+        // index completes and the API falls back to the file name.
+        TrackTags tags;
+        TagReader::read(SD, _playlist->getTrack(i), tags);
+        publish(i, tags.title, tags.artist, tags.album, strlen(tags.title), strlen(tags.artist),
+                strlen(tags.album), tags.durationMs);
+        read++;
+
+        if (++unsaved >= META_SAVE_EVERY) {
+            saveCache();
+            unsaved = 0;
+        }
+        vTaskDelay(pdMS_TO_TICKS(META_INDEX_GAP_MS));
+    }
+
+    if (unsaved > 0 && !saveCache()) {
+        Serial.println("WARNING: Could not write metadata cache");
+    }
+    Serial.printf("✓ Metadata: read %d files in %lu ms, %u bytes\n", read, millis() - start,
+                  (unsigned)bytesUsed());
+}
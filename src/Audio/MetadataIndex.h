@@ -0,0 +1,103 @@
+// ============================================================================
+// MetadataIndex.h
+// Title, artist, album and duration for every playlist entry, read by a
+// low-priority background task and kept in a compact cache on the card, so
+// the web API can list rich metadata without opening a single file.
+//
+// Strings live in fixed chunks that never move (PSRAM when available);
+// artist and album repeat from one track to the next on most libraries and
+// are stored once per run. An entry is published with a release store of
+// its ready flag, after which it never changes: get() is lock-free from any
+// task.
+//
+// Cache file (little-endian): MetaCacheHeader, then per indexed track a
+// MetaCacheRecord followed by its three strings (no terminators). Records
+// are matched to the playlist by path hash, size and mtime, so the rest
+// survive any reordering of the playlist. The size and mtime are the
+// playlist's: a file edited in place is read again after the refreshing
+// rescan (POST /api/library, action=rescan) has picked up its new ones.
+// ============================================================================
+#ifndef METADATA_INDEX_H
+#define METADATA_INDEX_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "SDPlaylist.h"
+#include "TagReader.h"
+
+// String storage grows in chunks of this size.
+static constexpr size_t META_CHUNK_BYTES = 4096;
+
+// The indexer rewrites the cache after this many new entries, so a reboot
+// mid-scan loses little work.
+static constexpr int META_SAVE_EVERY = 64;
+
+struct TrackMeta {
+    const char* title;      // "" if the file has no tag for it
+    const char* artist;
+    const char* album;
+    uint32_t durationMs;    // 0 if unknown
+};
+
+class MetadataIndex {
+public:
+    MetadataIndex();
+    ~MetadataIndex();
+
+    // Sizes the index for the playlist and takes whatever the card cache
+    // still holds for it. Call with the playlist loaded and before anything
+    // reads the index; fails while the indexer runs, which also needs the
+    // playlist to stay as it is.
+    bool begin(SDPlaylist* playlist);
+
+    // Starts the background task for the entries the cache did not cover.
+    bool startIndexer();
+    // Lets the indexer finish the file in hand, save what it has and exit;
+    // returns once it is gone.
+    void stopIndexer();
+
+    // nullptr until the entry has been indexed.
+    const TrackMeta* get(int index) const;
+
+    int trackCount() const { return _count; }
+    int indexedCount() const { return _indexed.load(std::memory_order_acquire); }
+    bool isComplete() const { return _count == indexedCount(); }
+    bool isIndexing() const { return _running.load(); }
+    size_t bytesUsed() const { return _chunkBytes + _count * (sizeof(TrackMeta) + sizeof(std::atomic<bool>)); }
+
+private:
+    struct Chunk {
+        Chunk* next;
+        size_t used;
+        char data[META_CHUNK_BYTES];
+    };
+
+    SDPlaylist* _playlist;
+    int _count;
+    TrackMeta* _meta;
+    std::atomic<bool>* _ready;
+    std::atomic<int> _indexed;
+    std::atomic<bool> _running;     // Indexer task alive
+    std::atomic<bool> _stop;
+
+    Chunk* _chunks;
+    size_t _chunkBytes;
+    const char* _lastArtist;
+    const char* _lastAlbum;
+
+    void clearEntries();
+    void release();
+    const char* store(const char* text, size_t length);
+    void publish(int index, const char* title, const char* artist, const char* album,
+                 size_t titleLength, size_t artistLength, size_t albumLength, uint32_t durationMs);
+
+    bool loadCache();
+    bool saveCache();
+
+    static void taskEntry(void* param);
+    void run();
+};
+
+#endif // METADATA_INDEX_H
@@ -0,0 +1,148 @@
+// ============================================================================
+// PcmRingBuffer.h
+// Lock-free single-producer/single-consumer ring of interleaved stereo
+// 16-bit frames. The decoder task is the only writer and the I2S task the
+// only reader; neither ever blocks the other.
+//
+// Positions are free-running frame counters, so "how much is buffered" is a
+// plain subtraction and a discard can be requested by position.
+// ============================================================================
+#ifndef PCM_RING_BUFFER_H
+#define PCM_RING_BUFFER_H
+
+#include <Arduino.h>
+#include <atomic>
+
+class PcmRingBuffer {
+public:
+    static constexpr size_t CHANNELS = 2;
+
+    PcmRingBuffer() : _buffer(nullptr), _capacity(0), _mask(0) {}
+    ~PcmRingBuffer() { free(_buffer); }
+
+    // Capacity is rounded up to a power of two frames. Not thread-safe;
+    // call before either side starts.
+    bool begin(size_t frames) {
+        size_t capacity = 1;
+        while (capacity < frames) capacity <<= 1;
+
+        int16_t* buffer = (int16_t*)realloc(_buffer, capacity * CHANNELS * sizeof(int16_t));
+        if (buffer == nullptr) return false;
+
+        _buffer = buffer;
+        _capacity = capacity;
+        _mask = capacity - 1;
+        _head.store(0, std::memory_order_relaxed);
+        _tail.store(0, std::memory_order_relaxed);
+        _discardTo.store(0, std::memory_order_relaxed);
+        return true;
+    }
+
+    size_t capacity() const { return _capacity; }
+
+    // ---- Producer side ---------------------------------------------------
+
+    size_t space() const {
+        return _capacity - (_head.load(std::memory_order_relaxed) - _tail.load(std::memory_order_acquire));
+    }
+
+    // Total frames ever written; a frame's position is stable across wraps.
+    size_t writePosition() const { return _head.load(std::memory_order_relaxed); }
+
+    // Copies up to `frames` interleaved stereo frames; returns frames taken.
+    size_t write(const int16_t* samples, size_t frames) {
+        size_t head = _head.load(std::memory_order_relaxed);
+        size_t free = _capacity - (head - _tail.load(std::memory_order_acquire));
+        if (frames > free) frames = free;
+
+        size_t start = head & _mask;
+        size_t first = frames < _capacity - start ? frames : _capacity - start;
+        memcpy(_buffer + start * CHANNELS, samples, first * CHANNELS * sizeof(int16_t));
+        memcpy(_buffer, samples + first * CHANNELS, (frames - first) * CHANNELS * sizeof(int16_t));
+
+        _head.store(head + frames, std::memory_order_release);
+        return frames;
+    }
+
+    // Same as write() for mono input, duplicating each sample to both sides.
+    size_t writeMono(const int16_t* samples, size_t frames) {
+        size_t head = _head.load(std::memory_order_relaxed);
+        size_t free = _capacity - (head - _tail.load(std::memory_order_acquire));
+        if (frames > free) frames = free;
+
+        for (size_t i = 0; i < frames; i++) {
+            int16_t* frame = _buffer + ((head + i) & _mask) * CHANNELS;
+            frame[0] = frame[1] = samples[i];
+        }
+
+        _head.store(head + frames, std::memory_order_release);
+        return frames;
+    }
+
+    // Zero-copy alternative to write(): the free run from the write
+    // position up to the wrap, to be filled in place and then commit()ted.
+    // The consumer sees nothing of it before that.
+    int16_t* writeRegion(size_t& frames) {
+        size_t head = _head.load(std::memory_order_relaxed);
+        size_t free = _capacity - (head - _tail.load(std::memory_order_acquire));
+        size_t start = head & _mask;
+        frames = free < _capacity - start ? free : _capacity - start;
+        return _buffer + start * CHANNELS;
+    }
+
+    void commit(size_t frames) {
+        _head.store(_head.load(std::memory_order_relaxed) + frames, std::memory_order_release);
+    }
+
+    // Asks the consumer to drop everything written so far (e.g. on a skip).
+    // Frames written after this call are kept.
+    void discardAll() {
+        _discardTo.store(_head.load(std::memory_order_relaxed), std::memory_order_release);
+    }
+
+    // ---- Consumer side ---------------------------------------------------
+
+    size_t available() const {
+        return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_relaxed);
+    }
+
+    // Total frames consumed (or discarded) so far.
+    size_t readPosition() const { return _tail.load(std::memory_order_relaxed); }
+
+    // Copies up to `frames` stereo frames out; returns frames read.
+    size_t read(int16_t* samples, size_t frames) {
+        size_t tail = applyDiscard();
+        size_t used = _head.load(std::memory_order_acquire) - tail;
+        if (frames > used) frames = used;
+
+        size_t start = tail & _mask;
+        size_t first = frames < _capacity - start ? frames : _capacity - start;
+        memcpy(samples, _buffer + start * CHANNELS, first * CHANNELS * sizeof(int16_t));
+        memcpy(samples + first * CHANNELS, _buffer, (frames - first) * CHANNELS * sizeof(int16_t));
+
+        _tail.store(tail + frames, std::memory_order_release);
+        return frames;
+    }
+
+private:
+    int16_t* _buffer;
+    size_t _capacity;
+    size_t _mask;
+
+    // Each index is written by one side only.
+    std::atomic<size_t> _head{0};        // producer
+    std::atomic<size_t> _tail{0};        // consumer
+    std::atomic<size_t> _discardTo{0};   // producer
+
+    size_t applyDiscard() {
+        size_t tail = _tail.load(std::memory_order_relaxed);
+        size_t discardTo = _discardTo.load(std::memory_order_acquire);
+        if ((ptrdiff_t)(discardTo - tail) > 0) {
+            tail = discardTo;
+            _tail.store(tail, std::memory_order_release);
+        }
+        return tail;
+    }
+};
+
+#endif
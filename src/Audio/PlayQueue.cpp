@@ -0,0 +1,65 @@
+// ============================================================================
+// PlayQueue.cpp
+// ============================================================================
+#include "PlayQueue.h"
+
+PlayQueue::PlayQueue() : _head(0), _count(0), _version(0) {
+}
+
+bool PlayQueue::push(uint32_t track) {
+    return append(&track, 1) == 1;
+}
+
+int PlayQueue::append(const uint32_t* tracks, int count) {
+    std::lock_guard<std::mutex> guard(_lock);
+    int added = 0;
+    while (added < count && _count < PLAY_QUEUE_MAX) {
+        _tracks[(_head + _count) % PLAY_QUEUE_MAX] = tracks[added++];
+        _count++;
+    }
+    if (added > 0) _version++;
+    return added;
+}
+
+void PlayQueue::clear() {
+    std::lock_guard<std::mutex> guard(_lock);
+    _head = 0;
+    _count = 0;
+    _version++;
+}
+
+bool PlayQueue::pop(uint32_t& track) {
+    std::lock_guard<std::mutex> guard(_lock);
+    if (_count == 0) return false;
+    track = _tracks[_head];
+    _head = (_head + 1) % PLAY_QUEUE_MAX;
+    _count--;
+    _version++;
+    return true;
+}
+
+bool PlayQueue::peek(uint32_t& track) const {
+    std::lock_guard<std::mutex> guard(_lock);
+    if (_count == 0) return false;
+    track = _tracks[_head];
+    return true;
+}
+
+int PlayQueue::size() const {
+    std::lock_guard<std::mutex> guard(_lock);
+    return _count;
+}
+
+int PlayQueue::copy(uint32_t* out, int max) const {
+    std::lock_guard<std::mutex> guard(_lock);
+    int n = _count < max ? _count : max;
+    for (int i = 0; i < n; i++) {
+        out[i] = _tracks[(_head + i) % PLAY_QUEUE_MAX];
+    }
+    return n;
+}
+
+uint32_t PlayQueue::version() const {
+    std::lock_guard<std::mutex> guard(_lock);
+    return _version;
+}
@@ -0,0 +1,62 @@
+// ============================================================================
+// PlayQueue.h
+// The "up next" queue: track indices that play before the regular order
+// resumes. A fixed ring of indices into the playlist, so queueing a whole
+// saved playlist costs no allocation at all.
+//
+// The web server adds and clears from its task while the decode task takes
+// from the front; a short mutex covers each call.
+// ============================================================================
+#ifndef PLAY_QUEUE_H
+#define PLAY_QUEUE_H
+
+#include <Arduino.h>
+#include <mutex>
+
+static constexpr int PLAY_QUEUE_MAX = 1024;
+
+class PlayQueue {
+public:
+    PlayQueue();
+
+    // False when full.
+    bool push(uint32_t track);
+    // Appends as many as fit. Returns how many did.
+    int append(const uint32_t* tracks, int count);
+    void clear();
+
+    bool pop(uint32_t& track);
+    bool peek(uint32_t& track) const;
+
+    int size() const;
+    // Copies up to max entries from the front. Returns how many.
+    int copy(uint32_t* out, int max) const;
+
+    // Bumped by every change, so readers can tell when to refetch.
+    uint32_t version() const;
+
+    // Passes every entry through map(track), which returns its new index
+    // or -1 to drop it. Returns how many were dropped.
+    template <typename Map>
+    int remap(Map map) {
+        std::lock_guard<std::mutex> guard(_lock);
+        int kept = 0;
+        for (int i = 0; i < _count; i++) {
+            int track = map((int)_tracks[(_head + i) % PLAY_QUEUE_MAX]);
+            if (track >= 0) _tracks[(_head + kept++) % PLAY_QUEUE_MAX] = (uint32_t)track;
+        }
+        int dropped = _count - kept;
+        _count = kept;
+        _version++;
+        return dropped;
+    }
+
+private:
+    mutable std::mutex _lock;
+    uint32_t _tracks[PLAY_QUEUE_MAX];
+    int _head;
+    int _count;
+    uint32_t _version;
+};
+
+#endif // PLAY_QUEUE_H
@@ -0,0 +1,390 @@
+// ============================================================================
+// PlaylistStore.cpp
+// ============================================================================
+#include "PlaylistStore.h"
+#include "LibraryTables.h"
+#include <FS.h>
+#include <SD.h>
+#include <algorithm>
+
+static constexpr uint32_t PLAYLIST_MAGIC = 0x4C50424D;  // "MBPL"
+static constexpr uint16_t PLAYLIST_VERSION = 2;
+static const char* PLAYLIST_EXT = ".mbpl";
+static const char* PLAYLIST_TMP_PATH = "/.playlists/.save.tmp";
+
+// Entries read or written per file access.
+static constexpr int PLAYLIST_IO_CHUNK = 32;
+
+struct PlaylistFileHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t entrySize;
+    uint32_t count;
+    uint32_t checksum;     // FNV-1a over the entries
+};
+
+// The hash is case-folded, so M3U lines match whatever case the card
+// reports, and 64 bits wide: an entry found again by hash alone is taken
+// as the saved track, so two paths of one library must never share one.
+struct PlaylistFileEntry {
+    uint64_t pathHash;     // pathHashNoCase() of that track's path
+    uint32_t index;        // Into the library when saved
+    uint32_t reserved;     // Zero
+};
+
+// ----------------------------------------------------------------------------
+// TrackList
+// ----------------------------------------------------------------------------
+
+TrackList::TrackList() : _tracks(nullptr), _count(0), _capacity(0) {
+}
+
+TrackList::~TrackList() {
+    free(_tracks);
+}
+
+bool TrackList::reserve(int count) {
+    if (count <= _capacity) return true;
+    uint32_t* tracks = (uint32_t*)allocateTable(count * sizeof(uint32_t));
+    if (tracks == nullptr) return false;
+    if (_count > 0) memcpy(tracks, _tracks, _count * sizeof(uint32_t));
+    free(_tracks);
+    _tracks = tracks;
+    _capacity = count;
+    return true;
+}
+
+bool TrackList::add(uint32_t track) {
+    if (_count == _capacity && !reserve(_capacity == 0 ? 64 : _capacity * 2)) return false;
+    _tracks[_count++] = track;
+    return true;
+}
+
+// ----------------------------------------------------------------------------
+// PlaylistStore
+// ----------------------------------------------------------------------------
+
+PlaylistStore::PlaylistStore() : _library(nullptr), _keys(nullptr), _keyCount(0) {
+}
+
+bool PlaylistStore::begin(SDPlaylist* library) {
+    _library = library;
+    if (!SD.exists(PLAYLIST_DIR) && !SD.mkdir(PLAYLIST_DIR)) {
+        Serial.println("WARNING: Could not create the playlist folder");
+        return false;
+    }
+    return true;
+}
+
+bool PlaylistStore::isValidName(const char* name) {
+    size_t len = strlen(name);
+    if (len == 0 || len > PLAYLIST_NAME_MAX || name[0] == ' ') return false;
+    for (size_t i = 0; i < len; i++) {
+        char c = name[i];
+        if (!isalnum((unsigned char)c) && c != ' ' && c != '-' && c != '_') return false;
+    }
+    return true;
+}
+
+void PlaylistStore::filePath(const char* name, char* out, size_t size) {
+    snprintf(out, size, "%s/%s%s", PLAYLIST_DIR, name, PLAYLIST_EXT);
+}
+
+bool PlaylistStore::buildKeys() {
+    if (_keys != nullptr) return true;
+
+    int count = _library->getTrackCount();
+    _keys = (PathKey*)allocateTable((count > 0 ? count : 1) * sizeof(PathKey));
+    if (_keys == nullptr) return false;
+    for (int i = 0; i < count; i++) {
+        _keys[i] = PathKey{ pathHashNoCase(_library->getTrack(i)), i };
+    }
+    std::sort(_keys, _keys + count);
+    _keyCount = count;
+    return true;
+}
+
+void PlaylistStore::releaseKeys() {
+    free(_keys);
+    _keys = nullptr;
+    _keyCount = 0;
+}
+
+// Library index with this path hash, or -1.
+int PlaylistStore::find(uint64_t hash) {
+    if (!buildKeys()) return -1;
+    PathKey* key = std::lower_bound(_keys, _keys + _keyCount, PathKey{ hash, 0 });
+    return key < _keys + _keyCount && key->hash == hash ? key->index : -1;
+}
+
+int PlaylistStore::list(PlaylistSummary* out, int max) {
+    File dir = SD.open(PLAYLIST_DIR);
+    if (!dir || !dir.isDirectory()) return 0;
+
+    int found = 0;
+    size_t extLength = strlen(PLAYLIST_EXT);
+    for (File file = dir.openNextFile(); file && found < max; file = dir.openNextFile()) {
+        const char* name = file.name();
+        const char* slash = strrchr(name, '/');
+        if (slash != nullptr) name = slash + 1;
+
+        size_t length = strlen(name);
+        if (file.isDirectory() || length <= extLength || length - extLength > PLAYLIST_NAME_MAX ||
+            strcmp(name + length - extLength, PLAYLIST_EXT) != 0) {
+            continue;
+        }
+
+        PlaylistFileHeader header;
+        if (file.read((uint8_t*)&header, sizeof(header)) != sizeof(header) ||
+            header.magic != PLAYLIST_MAGIC || header.version != PLAYLIST_VERSION) {
+            continue;
+        }
+        memcpy(out[found].name, name, length - extLength);
+        out[found].name[length - extLength] = '\0';
+        out[found].count = header.count;
+        found++;
+    }
+    return found;
+}
+
+bool PlaylistStore::load(const char* name, TrackList& out, int* missing) {
+    out.clear();
+    if (missing != nullptr) *missing = 0;
+    if (_library == nullptr || !isValidName(name)) return false;
+
+    char path[64];
+    filePath(name, path, sizeof(path));
+    File file = SD.open(path, FILE_READ);
+    if (!file) return false;
+
+    PlaylistFileHeader header;
+    if (file.read((uint8_t*)&header, sizeof(header)) != sizeof(header) ||
+        header.magic != PLAYLIST_MAGIC || header.version != PLAYLIST_VERSION ||
+        header.entrySize != sizeof(PlaylistFileEntry) || header.count > PLAYLIST_MAX_TRACKS ||
+        file.size() != sizeof(header) + header.count * sizeof(PlaylistFileEntry)) {
+        Serial.printf("ERROR: Playlist '%s' is not a valid playlist file.\n", name);
+        return false;
+    }
+    // One allocation at most, however long the playlist.
+    if (!out.reserve(header.count)) return false;
+
+    int trackCount = _library->getTrackCount();
+    uint32_t checksum = FNV_OFFSET;
+    int lost = 0;
+    bool ok = true;
+
+    PlaylistFileEntry chunk[PLAYLIST_IO_CHUNK];
+    for (uint32_t i = 0; ok && i < header.count; ) {
+        uint32_t n = header.count - i;
+        if (n > PLAYLIST_IO_CHUNK) n = PLAYLIST_IO_CHUNK;
+
+        size_t bytes = n * sizeof(PlaylistFileEntry);
+        ok = file.read((uint8_t*)chunk, bytes) == bytes;
+        checksum = fnv1a(chunk, bytes, checksum);
+
+        for (uint32_t j = 0; ok && j < n; j++) {
+            const PlaylistFileEntry& e = chunk[j];
+            int index = (int)e.index;
+            // The library changed under the playlist: look the file up again.
+            if (index >= trackCount || pathHashNoCase(_library->getTrack(index)) != e.pathHash) {
+                index = find(e.pathHash);
+            }
+            if (index >= 0) {
+                out.add(index);
+            } else {
+                lost++;
+            }
+        }
+        i += n;
+    }
+    releaseKeys();
+
+    if (!ok || checksum != header.checksum) {
+        Serial.printf("ERROR: Playlist '%s' is corrupt.\n", name);
+        out.clear();
+        return false;
+    }
+    if (lost > 0) {
+        Serial.printf("WARNING: %d track(s) of playlist '%s' are no longer on the card.\n", lost, name);
+    }
+    if (missing != nullptr) *missing = lost;
+    return true;
+}
+
+bool PlaylistStore::save(const char* name, const uint32_t* tracks, int count) {
+    if (_library == nullptr || !isValidName(name) || count < 0 || count > PLAYLIST_MAX_TRACKS) return false;
+
+    int trackCount = _library->getTrackCount();
+    for (int i = 0; i < count; i++) {
+        if (tracks[i] >= (uint32_t)trackCount) return false;
+    }
+
+    PlaylistFileHeader header = {};
+    header.magic = PLAYLIST_MAGIC;
+    header.version = PLAYLIST_VERSION;
+    header.entrySize = sizeof(PlaylistFileEntry);
+    header.count = count;
+
+    // Entries are hashed once for the checksum and again as they are written,
+    // rather than held in a second buffer.
+    uint32_t checksum = FNV_OFFSET;
+    PlaylistFileEntry chunk[PLAYLIST_IO_CHUNK];
+    for (int i = 0; i < count; i += PLAYLIST_IO_CHUNK) {
+        int n = std::min(count - i, PLAYLIST_IO_CHUNK);
+        for (int j = 0; j < n; j++) {
+            chunk[j] = PlaylistFileEntry{ pathHashNoCase(_library->getTrack(tracks[i + j])), tracks[i + j], 0 };
+        }
+        checksum = fnv1a(chunk, n * sizeof(PlaylistFileEntry), checksum);
+    }
+    header.checksum = checksum;
+
+    File file = SD.open(PLAYLIST_TMP_PATH, FILE_WRITE);
+    bool ok = (bool)file;
+    if (ok) {
+        ok = file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header);
+        for (int i = 0; ok && i < count; i += PLAYLIST_IO_CHUNK) {
+            int n = std::min(count - i, PLAYLIST_IO_CHUNK);
+            for (int j = 0; j < n; j++) {
+                chunk[j] = PlaylistFileEntry{ pathHashNoCase(_library->getTrack(tracks[i + j])), tracks[i + j], 0 };
+            }
+            size_t bytes = n * sizeof(PlaylistFileEntry);
+            ok = file.write((const uint8_t*)chunk, bytes) == bytes;
+        }
+        file.close();
+    }
+
+    char path[64];
+    filePath(name, path, sizeof(path));
+    if (ok) {
+        SD.remove(path);
+        ok = SD.rename(PLAYLIST_TMP_PATH, path);
+    }
+    if (!ok) {
+        SD.remove(PLAYLIST_TMP_PATH);
+        Serial.printf("ERROR: Could not save playlist '%s'.\n", name);
+    }
+    return ok;
+}
+
+bool PlaylistStore::remove(const char* name) {
+    if (!isValidName(name)) return false;
+    char path[64];
+    filePath(name, path, sizeof(path));
+    return SD.remove(path);
+}
+
+// Resolves "." and ".." segments and doubled slashes in place.
+static void normalizePath(char* path) {
+    char* out = path;
+    const char* in = path;
+    while (*in) {
+        while (*in == '/') in++;
+        const char* end = in;
+        while (*end && *end != '/') end++;
+        size_t length = end - in;
+
+        if (length == 0 || (length == 1 && in[0] == '.')) {
+            // Nothing to add
+        } else if (length == 2 && in[0] == '.' && in[1] == '.') {
+            while (out > path && *--out != '/') {}
+        } else {
+            *out++ = '/';
+            memmove(out, in, length);
+            out += length;
+        }
+        in = end;
+    }
+    if (out == path) *out++ = '/';
+    *out = '\0';
+}
+
+bool PlaylistStore::importM3u(const char* m3uPath, const char* name, TrackList& out, int* missing) {
+    out.clear();
+    if (missing != nullptr) *missing = 0;
+    if (_library == nullptr || !isValidName(name)) return false;
+
+    File file = SD.open(m3uPath, FILE_READ);
+    if (!file || file.isDirectory()) {
+        Serial.printf("ERROR: Cannot open playlist file %s\n", m3uPath);
+        return false;
+    }
+    if (!buildKeys()) return false;
+
+    // Relative entries are relative to the M3U's own folder.
+    const char* slash = strrchr(m3uPath, '/');
+    size_t dirLength = slash != nullptr ? slash - m3uPath : 0;
+
+    char line[M3U_LINE_MAX + 1];
+    char path[2 * M3U_LINE_MAX + 2];
+    size_t lineLength = 0;
+    bool overlong = false;
+    bool firstLine = true;
+    int lost = 0;
+
+    // Resolves one complete line; false once the list cannot grow.
+    auto endLine = [&]() {
+        while (lineLength > 0 && isspace((unsigned char)line[lineLength - 1])) lineLength--;
+        line[lineLength] = '\0';
+        char* entry = line;
+        if (firstLine && strncmp(entry, "\xEF\xBB\xBF", 3) == 0) entry += 3;
+        while (*entry == ' ' || *entry == '\t') entry++;
+
+        bool comment = *entry == '\0' || *entry == '#';
+        bool tooLong = overlong;
+        firstLine = false;
+        lineLength = 0;
+        overlong = false;
+        if (comment) return true;
+        if (tooLong) {
+            lost++;
+            return true;
+        }
+
+        if (strncmp(entry, "file://", 7) == 0) entry += 7;
+        for (char* p = entry; *p; p++) {
+            if (*p == '\\') *p = '/';
+        }
+        if (entry[0] == '/') {
+            snprintf(path, sizeof(path), "%s", entry);
+        } else {
+            snprintf(path, sizeof(path), "%.*s/%s", (int)dirLength, m3uPath, entry);
+        }
+        normalizePath(path);
+
+        // Hash hits are confirmed on the path itself.
+        uint64_t hash = pathHashNoCase(path);
+        for (PathKey* key = std::lower_bound(_keys, _keys + _keyCount, PathKey{ hash, 0 });
+             key < _keys + _keyCount && key->hash == hash; key++) {
+            if (strcasecmp(_library->getTrack(key->index), path) == 0) {
+                return out.count() >= PLAYLIST_MAX_TRACKS || out.add(key->index);
+            }
+        }
+        lost++;
+        return true;
+    };
+
+    uint8_t buffer[512];
+    bool ok = true;
+    size_t got;
+    while (ok && (got = file.read(buffer, sizeof(buffer))) > 0) {
+        for (size_t i = 0; ok && i < got; i++) {
+            char c = (char)buffer[i];
+            if (c == '\n') {
+                ok = endLine();
+            } else if (lineLength < M3U_LINE_MAX) {
+                line[lineLength++] = c;
+            } else {
+                overlong = true;
+            }
+        }
+    }
+    if (ok && (lineLength > 0 || overlong)) ok = endLine();
+    releaseKeys();
+
+    if (lost > 0) {
+        Serial.printf("WARNING: %d entr%s of %s not found in the library.\n", lost, lost == 1 ? "y" : "ies", m3uPath);
+    }
+    if (missing != nullptr) *missing = lost;
+    Serial.printf("Imported %d track(s) from %s as '%s'.\n", out.count(), m3uPath, name);
+    return ok && save(name, out.data(), out.count());
+}
@@ -0,0 +1,93 @@
+// ============================================================================
+// PlaylistStore.h
+// Named playlists saved on the card, one small file each under
+// PLAYLIST_DIR. A playlist is an array of indices into the main track table
+// plus a hash of each track's path; no path is stored twice. The hashes
+// catch a library that changed since the playlist was saved: entries whose
+// index no longer points at the same file are found again by hash, and
+// files that are gone are dropped.
+//
+// File (little-endian): PlaylistFileHeader, PlaylistFileEntry[count].
+//
+// M3U/M3U8 files on the card can be imported; each line is resolved
+// against the library (relative to the M3U's folder, case-insensitively,
+// as FAT compares names) and the result saved as a playlist.
+//
+// Used from one task (the web server's) while the library stays as it is.
+// ============================================================================
+#ifndef PLAYLIST_STORE_H
+#define PLAYLIST_STORE_H
+
+#include <Arduino.h>
+#include "SDPlaylist.h"
+
+static constexpr const char* PLAYLIST_DIR = "/.playlists";
+static constexpr size_t PLAYLIST_NAME_MAX = 32;
+static constexpr int PLAYLIST_MAX_TRACKS = 4096;
+
+// Longer M3U lines are skipped.
+static constexpr size_t M3U_LINE_MAX = 255;
+
+// Track indices, in one block that is reused from load to load.
+class TrackList {
+public:
+    TrackList();
+    ~TrackList();
+
+    // Grows only; true if `count` entries fit.
+    bool reserve(int count);
+    bool add(uint32_t track);
+    void clear() { _count = 0; }
+
+    int count() const { return _count; }
+    const uint32_t* data() const { return _tracks; }
+    uint32_t operator[](int i) const { return _tracks[i]; }
+
+private:
+    uint32_t* _tracks;
+    int _count;
+    int _capacity;
+};
+
+struct PlaylistSummary {
+    char name[PLAYLIST_NAME_MAX + 1];
+    int count;
+};
+
+class PlaylistStore {
+public:
+    PlaylistStore();
+
+    bool begin(SDPlaylist* library);
+
+    // Letters, digits, space, '-' and '_'; 1 to PLAYLIST_NAME_MAX bytes.
+    static bool isValidName(const char* name);
+
+    // Up to max playlists, read from their headers only. Returns how many.
+    int list(PlaylistSummary* out, int max);
+
+    // Tracks of a saved playlist as current library indices. `missing`
+    // counts entries whose file is no longer in the library.
+    bool load(const char* name, TrackList& out, int* missing = nullptr);
+    bool save(const char* name, const uint32_t* tracks, int count);
+    bool remove(const char* name);
+
+    // Resolves an M3U on the card into `out` and saves it as `name`.
+    // `missing` counts lines naming files outside the library.
+    bool importM3u(const char* m3uPath, const char* name, TrackList& out, int* missing = nullptr);
+
+private:
+    SDPlaylist* _library;
+
+    // Library paths by hash, built only when an entry has to be looked up.
+    PathKey* _keys;
+    int _keyCount;
+
+    bool buildKeys();
+    void releaseKeys();
+    int find(uint64_t hash);
+
+    static void filePath(const char* name, char* out, size_t size);
+};
+
+#endif // PLAYLIST_STORE_H
@@ -0,0 +1,157 @@
+// ============================================================================
+// RegisterWriter.cpp
+// ============================================================================
+#include "RegisterWriter.h"
+#include <string.h>
+
+static constexpr uint8_t PAGE_SELECT_REG = 0;
+
+RegisterWriter::RegisterWriter(TwoWire& wire, uint8_t address)
+    : _wire(wire), _address(address), _page(-1), _pendingPages(0), _stats{} {
+    memset(_shadow, 0, sizeof(_shadow));
+    memset(_staged, 0, sizeof(_staged));
+    memset(_known, 0, sizeof(_known));
+    memset(_pending, 0, sizeof(_pending));
+}
+
+bool RegisterWriter::probe() {
+    _wire.beginTransmission(_address);
+    return _wire.endTransmission() == 0;
+}
+
+bool RegisterWriter::isKnown(uint8_t page, uint8_t reg) const {
+    return _known[page][reg / 8] & (1u << (reg % 8));
+}
+
+bool RegisterWriter::isPending(uint8_t page, uint8_t reg) const {
+    return _pending[page][reg / 8] & (1u << (reg % 8));
+}
+
+bool RegisterWriter::isDirty(uint8_t page, uint8_t reg) const {
+    return isPending(page, reg) &&
+           (!isKnown(page, reg) || _staged[page][reg] != _shadow[page][reg]);
+}
+
+void RegisterWriter::write(uint8_t page, uint8_t reg, uint8_t value) {
+    if (page >= REGISTER_PAGES || reg == PAGE_SELECT_REG || reg >= REGISTERS_PER_PAGE) return;
+    _staged[page][reg] = value;
+    _pending[page][reg / 8] |= (uint8_t)(1u << (reg % 8));
+    _pendingPages |= (uint16_t)(1u << page);
+}
+
+void RegisterWriter::write(uint8_t page, uint8_t reg, const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        write(page, (uint8_t)(reg + i), data[i]);
+    }
+}
+
+void RegisterWriter::write(const RegisterValue* values, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        write(values[i].page, values[i].reg, values[i].value);
+    }
+}
+
+void RegisterWriter::assume(const RegisterValue* values, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        const RegisterValue& v = values[i];
+        if (v.page >= REGISTER_PAGES || v.reg >= REGISTERS_PER_PAGE) continue;
+        _shadow[v.page][v.reg] = v.value;
+        _known[v.page][v.reg / 8] |= (uint8_t)(1u << (v.reg % 8));
+    }
+}
+
+void RegisterWriter::invalidate(uint8_t page, uint8_t reg) {
+    if (page >= REGISTER_PAGES || reg >= REGISTERS_PER_PAGE) return;
+    _known[page][reg / 8] &= (uint8_t)~(1u << (reg % 8));
+}
+
+void RegisterWriter::invalidateAll() {
+    memset(_known, 0, sizeof(_known));
+    _page = -1;
+}
+
+bool RegisterWriter::send(uint8_t reg, const uint8_t* data, size_t len) {
+    _wire.beginTransmission(_address);
+    _wire.write(reg);
+    _wire.write(data, len);
+    uint32_t start = micros();
+    uint8_t result = _wire.endTransmission();
+    _stats.busUs += micros() - start;
+    _stats.transactions++;
+    _stats.bytes += 1 + len;
+    if (result != 0) {
+        _stats.errors++;
+        return false;
+    }
+    return true;
+}
+
+bool RegisterWriter::selectPage(uint8_t page) {
+    if (_page == page) return true;
+    if (!send(PAGE_SELECT_REG, &page, 1)) {
+        _page = -1;
+        return false;
+    }
+    _page = page;
+    return true;
+}
+
+bool RegisterWriter::strobe(uint8_t page, uint8_t reg, uint8_t value) {
+    if (!selectPage(page)) return false;
+    bool ok = send(reg, &value, 1);
+    invalidate(page, reg);
+    return ok;
+}
+
+bool RegisterWriter::flush() {
+    bool ok = true;
+    uint8_t burst[REGISTER_BURST_MAX];
+
+    for (uint8_t page = 0; page < REGISTER_PAGES && _pendingPages; page++) {
+        if (!(_pendingPages & (1u << page))) continue;
+
+        uint8_t reg = 1;
+        while (reg < REGISTERS_PER_PAGE) {
+            if (!isDirty(page, reg)) {
+                if (isPending(page, reg)) _stats.skipped++;
+                reg++;
+                continue;
+            }
+
+            // Grow the run over dirty registers and short, known gaps.
+            uint8_t end = reg + 1;
+            uint8_t next = end;
+            while (next < REGISTERS_PER_PAGE && next - reg < (int)REGISTER_BURST_MAX) {
+                if (isDirty(page, next)) {
+                    end = ++next;
+                    continue;
+                }
+                if (next - end >= REGISTER_BURST_GAP || !isKnown(page, next)) break;
+                next++;
+            }
+
+            size_t len = end - reg;
+            for (size_t i = 0; i < len; i++) {
+                uint8_t r = reg + i;
+                burst[i] = isPending(page, r) ? _staged[page][r] : _shadow[page][r];
+            }
+
+            bool sent = selectPage(page) && send(reg, burst, len);
+            for (size_t i = 0; i < len; i++) {
+                uint8_t r = reg + i;
+                if (sent) {
+                    _shadow[page][r] = burst[i];
+                    _known[page][r / 8] |= (uint8_t)(1u << (r % 8));
+                } else {
+                    invalidate(page, r);
+                }
+            }
+            ok = ok && sent;
+            reg = end;
+        }
+
+        memset(_pending[page], 0, sizeof(_pending[page]));
+        _pendingPages &= (uint16_t)~(1u << page);
+    }
+    return ok;
+}
@@ -0,0 +1,85 @@
+// ============================================================================
+// RegisterWriter.h
+// Shadow-cached, batched register writes for a TI-style paged I2C device
+// (register 0 of every page selects the page). Writes are staged, then
+// flush() sends only registers whose value differs from what the part is
+// known to hold, one burst per run of consecutive registers, and switches
+// page only when it has to.
+// ============================================================================
+#ifndef REGISTER_WRITER_H
+#define REGISTER_WRITER_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+// Pages 0-15 cover the DAC3100's control and coefficient pages.
+static constexpr uint8_t REGISTER_PAGES = 16;
+static constexpr uint8_t REGISTERS_PER_PAGE = 128;
+
+// A run may bridge this many registers it has no reason to write, as long
+// as their contents are known: resending a byte is cheaper than a new
+// transaction.
+static constexpr uint8_t REGISTER_BURST_GAP = 2;
+
+// ESP32 Arduino's Wire buffer is 128 bytes, including the register pointer.
+static constexpr size_t REGISTER_BURST_MAX = 120;
+
+struct RegisterValue {
+    uint8_t page;
+    uint8_t reg;
+    uint8_t value;
+};
+
+struct RegisterWriterStats {
+    uint32_t transactions;  // Write transactions put on the bus
+    uint32_t bytes;         // Bytes after the address, register pointers included
+    uint32_t skipped;       // Staged writes the shadow made redundant
+    uint32_t busUs;         // Time spent inside endTransmission()
+    uint32_t errors;        // Transactions the device did not acknowledge
+};
+
+class RegisterWriter {
+public:
+    RegisterWriter(TwoWire& wire, uint8_t address);
+
+    // True if the device acknowledges its address.
+    bool probe();
+
+    // Staged until flush(). A later write to the same register wins.
+    void write(uint8_t page, uint8_t reg, uint8_t value);
+    void write(uint8_t page, uint8_t reg, const uint8_t* data, size_t len);
+    void write(const RegisterValue* values, size_t count);
+    bool flush();
+
+    // Sends immediately and leaves the register unknown afterwards, for
+    // self-clearing bits such as resets and buffer swaps.
+    bool strobe(uint8_t page, uint8_t reg, uint8_t value);
+
+    // What the part holds without being told, e.g. its reset defaults.
+    void assume(const RegisterValue* values, size_t count);
+    void invalidate(uint8_t page, uint8_t reg);
+    void invalidateAll();
+
+    const RegisterWriterStats& getStats() const { return _stats; }
+
+private:
+    TwoWire& _wire;
+    uint8_t _address;
+    int _page;              // Page the device has selected, -1 if unknown
+
+    uint8_t _shadow[REGISTER_PAGES][REGISTERS_PER_PAGE];
+    uint8_t _staged[REGISTER_PAGES][REGISTERS_PER_PAGE];
+    uint8_t _known[REGISTER_PAGES][REGISTERS_PER_PAGE / 8];
+    uint8_t _pending[REGISTER_PAGES][REGISTERS_PER_PAGE / 8];
+    uint16_t _pendingPages; // Bit per page with anything staged
+
+    RegisterWriterStats _stats;
+
+    bool isKnown(uint8_t page, uint8_t reg) const;
+    bool isPending(uint8_t page, uint8_t reg) const;
+    bool isDirty(uint8_t page, uint8_t reg) const;
+    bool selectPage(uint8_t page);
+    bool send(uint8_t reg, const uint8_t* data, size_t len);
+};
+
+#endif // REGISTER_WRITER_H
@@ -0,0 +1,562 @@
+// SDPlaylist.cpp
+#include "SDPlaylist.h"
+#include "LibraryTables.h"
+#include <Arduino.h>
+#include <FS.h>
+#include <SD.h>
+#include <SPI.h>
+#include <algorithm>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// ----------------------------------------------------------------------------
+// On-card playlist index
+//
+// Layout (little-endian, as written by the ESP32):
+//   IndexHeader
+//   IndexEntry[trackCount]
+//   char strings[stringBytes]   NUL-terminated paths, referenced by offset
+//
+// The signature is a hash of the folder settings and every audio path,
+// read with getNextFileName() so no file is opened or stat'ed to compute
+// it. Only when it differs from the stored one do we fall back to a
+// scan, which still takes sizes and dates from the stale index for every
+// path it lists, so only files new to the card are opened.
+//
+// A file edited in place (re-tagged under the same name) changes neither,
+// so its size and date stay as first read until a refreshing load(), see
+// SDPlaylist.h, opens every file again.
+// ----------------------------------------------------------------------------
+static const char* INDEX_PATH = "/.playlist.idx";
+static const char* INDEX_TMP_PATH = "/.playlist.tmp";
+static const uint32_t INDEX_MAGIC = 0x5849424D;  // "MBIX"
+static const uint16_t INDEX_VERSION = 2;
+// A header claiming more is corrupt; far past what fits in memory anyway.
+static const uint32_t INDEX_MAX_TRACKS = 1u << 20;
+
+struct IndexHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t entrySize;
+    uint32_t signature;
+    uint32_t trackCount;
+    uint32_t stringBytes;
+    uint32_t checksum;     // FNV-1a over entries followed by strings
+};
+
+struct IndexEntry {
+    uint32_t pathOffset;
+    uint32_t size;
+    uint32_t mtime;
+};
+
+// A path the stale index listed, with what it knew about the file.
+struct SDPlaylist::KnownTrack {
+    uint64_t hash;
+    TrackInfo info;
+    bool operator<(const KnownTrack& other) const { return hash < other.hash; }
+};
+
+// Collects audio files into the arena. Sizes and dates come from the
+// known tracks, or need the file opened, which waits until the walker has
+// closed the folder again.
+class LibraryScan : public FolderVisitor {
+public:
+    LibraryScan(SDPlaylist& playlist, const SDPlaylist::KnownTrack* known, int knownCount)
+        : _playlist(playlist), _known(known), _knownCount(knownCount), _unfilled(0), _opened(0) {}
+
+    bool onFile(const char* path, const char* name) override {
+        if (!SDPlaylist::isAudioFile(name)) return true;
+        if (!_playlist._tracks.add(path, TrackInfo{ 0, 0 })) {
+            Serial.println("WARNING: Out of memory for playlist, stopping scan.");
+            return false;
+        }
+        _playlist._scanTracks.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void onFolderDone() override {
+        TrackArena& tracks = _playlist._tracks;
+        for (; _unfilled < tracks.count(); _unfilled++) {
+            SDPlaylist::KnownTrack key{ pathHash(tracks.path(_unfilled)), {} };
+            const SDPlaylist::KnownTrack* known = std::lower_bound(_known, _known + _knownCount, key);
+            if (known < _known + _knownCount && known->hash == key.hash) {
+                tracks.info(_unfilled) = known->info;
+                continue;
+            }
+            File file = SD.open(tracks.path(_unfilled));
+            if (file) {
+                tracks.info(_unfilled) = TrackInfo{ (uint32_t)file.size(), (uint32_t)file.getLastWrite() };
+            }
+            _opened++;
+        }
+    }
+
+    void onYield() override { _playlist.reportProgress(false); }
+
+    int opened() const { return _opened; }
+
+private:
+    SDPlaylist& _playlist;
+    const SDPlaylist::KnownTrack* _known;
+    int _knownCount;
+    int _unfilled;
+    int _opened;
+};
+
+class LibrarySignature : public FolderVisitor {
+public:
+    LibrarySignature(SDPlaylist& playlist, uint32_t hash) : _playlist(playlist), _hash(hash) {}
+
+    bool onFile(const char* path, const char* name) override {
+        if (SDPlaylist::isAudioFile(name)) {
+            _hash = fnv1a(path, strlen(path) + 1, _hash);
+        }
+        return true;
+    }
+
+    void onYield() override { _playlist.reportProgress(false); }
+
+    uint32_t hash() const { return _hash; }
+
+private:
+    SDPlaylist& _playlist;
+    uint32_t _hash;
+};
+
+SDPlaylist::SDPlaylist()
+    : _listener(nullptr), _mounted(false), _readersLocked(false), _readers(0), _change(),
+      _changePending(false), _scanning(false), _scanReading(false), _scanTracks(0), _scanStartMs(0),
+      _scanMs(0), _scanReportedMs(0) {
+}
+
+bool SDPlaylist::begin() {
+    Serial.println("Initializing SD Playlist...");
+    return mount() && load();
+}
+
+bool SDPlaylist::mount(bool quiet) {
+    // Not in the constructor: the player is a global, built before
+    // initArduino() brings PSRAM up, when psramFound() is still false.
+    // Every load() that grows the list comes after a mount.
+    _tracks.usePSRAM(PLAYLIST_USE_PSRAM && psramFound());
+
+    // Metro ESP32-S3 SD card pins
+    SPI.begin(39, 21, 42, 45);  // SCK, MISO, MOSI, CS
+    
+    if (!SD.begin(45, SPI, MUSICBOX_SD_SPI_HZ)) {
+        if (!quiet) Serial.println("SD Card failed!");
+        return false;
+    }
+    
+    Serial.printf("SD Card OK at %u MHz\n", (unsigned)(MUSICBOX_SD_SPI_HZ / 1000000));
+    _mounted.store(true, std::memory_order_release);
+    if (_listener) _listener->onCardChanged(true);
+    return true;
+}
+
+// Whoever had files open on the card has closed them by now.
+void SDPlaylist::unmount() {
+    if (!_mounted.exchange(false)) return;
+    SD.end();
+    Serial.println("SD card unmounted.");
+    if (_listener) _listener->onCardChanged(false);
+}
+
+// Sector 0 is the card's boot sector or partition table; the driver queues
+// this read behind playback's own.
+bool SDPlaylist::isCardResponding() {
+    static uint8_t sector[512];
+    return isMounted() && SD.readRAW(sector, 0);
+}
+
+bool SDPlaylist::load(bool refresh) {
+    if (!isMounted()) return false;
+
+    Serial.println("Checking playlist index...");
+    Serial.printf("Scanning folders: %s (excluding %s)\n", _walker.include(), _walker.exclude());
+
+    _scanTracks.store(0, std::memory_order_relaxed);
+    _scanReading.store(false, std::memory_order_relaxed);
+    _scanStartMs = millis();
+    _scanning.store(true, std::memory_order_release);
+    reportProgress(true);
+
+    // The list as readers know it, for telling them what changed.
+    int previousCount = _tracks.count();
+    PathKey* previous = collectPaths();
+    _tracks.clear();
+
+    uint32_t signature = directorySignature();
+
+    if (!refresh && loadIndex(signature)) {
+        Serial.printf("Loaded %d tracks from index in %lu ms\n", _tracks.count(), millis() - _scanStartMs);
+    } else {
+        int knownCount = 0;
+        KnownTrack* known = !refresh && loadIndex(signature, false) ? collectKnown(knownCount) : nullptr;
+        _tracks.clear();
+        Serial.println(refresh            ? "Refresh - Reading every file again..."
+                       : known != nullptr ? "Index stale - Scanning for changes..."
+                                          : "Index missing - Scanning for music...");
+        _scanReading.store(true, std::memory_order_relaxed);
+        int opened = scanForMusic(known, knownCount);
+        free(known);
+
+        if (!saveIndex(signature)) {
+            Serial.println("WARNING: Could not write playlist index");
+        }
+        Serial.printf("Found %d tracks (%d read from the card) in %u folders in %lu ms\n", _tracks.count(),
+                      opened, (unsigned)_walker.foldersScanned(), millis() - _scanStartMs);
+    }
+
+    recordChange(previous, previousCount);
+    free(previous);
+
+    _scanTracks.store(_tracks.count(), std::memory_order_relaxed);
+    _scanMs = millis() - _scanStartMs;
+    _scanning.store(false, std::memory_order_release);
+    reportProgress(true);
+    printFootprint();
+    return true;
+}
+
+// Returns how many files had to be opened for their size and date.
+int SDPlaylist::scanForMusic(const KnownTrack* known, int knownCount) {
+    LibraryScan scan(*this, known, knownCount);
+    _walker.walk(SD, scan);
+    // Sizes for the folder an out-of-memory stop left open.
+    scan.onFolderDone();
+    return scan.opened();
+}
+
+// The loaded list by path hash. nullptr without memory for it, in which
+// case the scan opens every file.
+SDPlaylist::KnownTrack* SDPlaylist::collectKnown(int& count) {
+    count = _tracks.count();
+    KnownTrack* known = (KnownTrack*)allocateTable(count * sizeof(KnownTrack) + 1);
+    if (known == nullptr) {
+        count = 0;
+        return nullptr;
+    }
+    for (int i = 0; i < count; i++) {
+        known[i] = KnownTrack{ pathHash(_tracks.path(i)), _tracks.info(i) };
+    }
+    std::sort(known, known + count);
+    return known;
+}
+
+// The current list by path hash; nullptr if it is empty or there is no
+// memory for it.
+PathKey* SDPlaylist::collectPaths() {
+    int count = _tracks.count();
+    if (count == 0) return nullptr;
+    PathKey* keys = (PathKey*)allocateTable(count * sizeof(PathKey));
+    if (keys == nullptr) return nullptr;
+    for (int i = 0; i < count; i++) {
+        keys[i] = PathKey{ pathHash(_tracks.path(i)), i };
+    }
+    std::sort(keys, keys + count);
+    return keys;
+}
+
+// Diffs the new list against the previous one in a single pass. Each new
+// path either continues the previous list at or after the last match, so
+// everything skipped there was removed, or it counts as added. Listing
+// order on a card barely moves, so this finds the few runs that changed;
+// a path that did move shows up as removed in one place and added in
+// another, which is still a correct edit script.
+void SDPlaylist::recordChange(const PathKey* previous, int previousCount) {
+    LibraryChange& change = _change;
+    change.previousVersion = change.version;
+    change.version++;
+    change.previousCount = previousCount;
+    change.count = _tracks.count();
+    change.editCount = 0;
+    // Without the previous paths, nothing can be said about them.
+    change.full = previous == nullptr && previousCount > 0;
+
+    int cursor = 0;     // First previous track not yet matched or removed
+    int added = 0;      // New tracks since the last match
+    auto emit = [&](int removedTo, int newIndex) {
+        if (removedTo == cursor && added == 0) return;
+        if (change.editCount == LIBRARY_EDITS_MAX) {
+            change.full = true;
+            return;
+        }
+        change.edits[change.editCount++] =
+            LibraryEdit{ (uint32_t)(newIndex - added), (uint32_t)(removedTo - cursor), (uint32_t)added };
+    };
+
+    for (int i = 0; !change.full && i < change.count; i++) {
+        int match = -1;
+        if (previous != nullptr) {
+            PathKey key{ pathHash(_tracks.path(i)), 0 };
+            const PathKey* found = std::lower_bound(previous, previous + previousCount, key);
+            if (found < previous + previousCount && found->hash == key.hash) match = found->index;
+        }
+        if (match < cursor) {
+            added++;
+            continue;
+        }
+        emit(match, i);
+        cursor = match + 1;
+        added = 0;
+    }
+    if (!change.full) emit(previousCount, change.count);
+
+    if (change.full) change.editCount = 0;
+    _changePending = true;
+}
+
+int LibraryChange::mapIndex(int previousIndex) const {
+    if (full || previousIndex < 0 || previousIndex >= previousCount) return -1;
+    int shift = 0;
+    for (int i = 0; i < editCount; i++) {
+        const LibraryEdit& edit = edits[i];
+        int start = (int)edit.at - shift;
+        if (previousIndex < start) break;
+        if (previousIndex < start + (int)edit.removed) return -1;
+        shift += (int)edit.added - (int)edit.removed;
+    }
+    return previousIndex + shift;
+}
+
+bool SDPlaylist::beginRead() {
+    _readers.fetch_add(1);
+    if (_readersLocked.load()) {
+        _readers.fetch_sub(1);
+        return false;
+    }
+    return true;
+}
+
+void SDPlaylist::endRead() {
+    _readers.fetch_sub(1);
+}
+
+// A reader that gets in sees the lock clear after announcing itself, so
+// once the count drains to zero nobody is left reading.
+void SDPlaylist::lockReaders() {
+    _readersLocked.store(true);
+    uint32_t start = millis();
+    bool warned = false;
+    while (_readers.load() > 0) {
+        if (!warned && millis() - start > 2000) {
+            Serial.printf("WARNING: Waiting on %d playlist reader(s).\n", _readers.load());
+            warned = true;
+        }
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+}
+
+void SDPlaylist::unlockReaders() {
+    _readersLocked.store(false);
+    if (_changePending) {
+        _changePending = false;
+        if (_listener) _listener->onLibraryChanged(_change);
+    }
+}
+
+// Walks the same folders as scanForMusic(), hashing names only.
+uint32_t SDPlaylist::directorySignature() {
+    uint32_t hash = fnv1a(_walker.include(), strlen(_walker.include()) + 1, FNV_OFFSET);
+    hash = fnv1a(_walker.exclude(), strlen(_walker.exclude()) + 1, hash);
+    LibrarySignature signature(*this, hash);
+    _walker.walk(SD, signature);
+    return signature.hash();
+}
+
+ScanProgress SDPlaylist::getScanProgress() const {
+    bool scanning = _scanning.load(std::memory_order_acquire);
+    return ScanProgress{ scanning, _scanReading.load(std::memory_order_relaxed), _walker.foldersScanned(),
+                         _walker.entriesScanned(), _scanTracks.load(std::memory_order_relaxed),
+                         scanning ? (uint32_t)millis() - _scanStartMs : _scanMs };
+}
+
+void SDPlaylist::reportProgress(bool force) {
+    if (_listener == nullptr) return;
+    uint32_t now = millis();
+    if (!force && now - _scanReportedMs < SCAN_PROGRESS_MS) return;
+    _scanReportedMs = now;
+    _listener->onScanProgress(getScanProgress());
+}
+
+bool SDPlaylist::isAudioFile(const char* filename) {
+    // Hidden files, including macOS "._" resource forks.
+    if (filename[0] == '.') {
+        return false;
+    }
+
+    // Compared in place: this runs for every directory entry on every boot.
+    size_t len = strlen(filename);
+    if (len < 4) {
+        return false;
+    }
+    const char* ext = filename + len - 4;
+    return strcasecmp(ext, ".mp3") == 0 || strcasecmp(ext, ".wav") == 0;
+}
+
+void SDPlaylist::printFootprint() {
+    Serial.printf("Playlist storage: %d tracks, %u bytes used, %u reserved (%s)\n",
+                  _tracks.count(), (unsigned)_tracks.bytesUsed(), (unsigned)_tracks.bytesReserved(),
+                  _tracks.inPSRAM() ? "PSRAM" : "internal RAM");
+}
+
+bool SDPlaylist::loadIndex(uint32_t signature, bool checkSignature) {
+    File file = SD.open(INDEX_PATH, FILE_READ);
+    if (!file) return false;
+
+    IndexHeader header;
+    if (file.read((uint8_t*)&header, sizeof(header)) != sizeof(header)) return false;
+
+    if (header.magic != INDEX_MAGIC ||
+        header.version != INDEX_VERSION ||
+        header.entrySize != sizeof(IndexEntry) ||
+        header.trackCount > INDEX_MAX_TRACKS ||
+        (checkSignature && header.signature != signature)) {
+        return false;
+    }
+
+    // In 64 bits, so no count or string size can wrap past the check.
+    uint64_t expected = sizeof(header) + (uint64_t)header.trackCount * sizeof(IndexEntry) + header.stringBytes;
+    if (file.size() != expected) return false;
+
+    // An empty library is a valid index too.
+    if (header.trackCount == 0 || header.stringBytes == 0) {
+        return header.trackCount == 0 && header.stringBytes == 0;
+    }
+
+    // The on-card string block has the arena's layout, so it is read straight
+    // into place and the entries only need their offsets copied across.
+    char* strings = _tracks.prepare(header.trackCount, header.stringBytes);
+    if (strings == nullptr) return false;
+
+    uint32_t checksum = FNV_OFFSET;
+    bool ok = true;
+
+    IndexEntry chunk[32];
+    for (uint32_t i = 0; ok && i < header.trackCount; ) {
+        uint32_t n = header.trackCount - i;
+        if (n > 32) n = 32;
+
+        size_t bytes = n * sizeof(IndexEntry);
+        ok = file.read((uint8_t*)chunk, bytes) == bytes;
+        checksum = fnv1a(chunk, bytes, checksum);
+
+        for (uint32_t j = 0; ok && j < n; j++) {
+            const IndexEntry& e = chunk[j];
+            TrackInfo info = { e.size, e.mtime };
+            ok = e.pathOffset < header.stringBytes;
+            _tracks.setTrack(i + j, e.pathOffset, info);
+        }
+        i += n;
+    }
+
+    ok = ok && file.read((uint8_t*)strings, header.stringBytes) == header.stringBytes &&
+         strings[header.stringBytes - 1] == '\0' &&
+         fnv1a(strings, header.stringBytes, checksum) == header.checksum;
+
+    if (ok) {
+        _tracks.finishLoad();
+    } else {
+        Serial.println("Playlist index is corrupt, ignoring it.");
+        _tracks.clear();
+    }
+    return ok;
+}
+
+bool SDPlaylist::saveIndex(uint32_t signature) {
+    int count = _tracks.count();
+
+    IndexHeader header = {};
+    header.magic = INDEX_MAGIC;
+    header.version = INDEX_VERSION;
+    header.entrySize = sizeof(IndexEntry);
+    header.signature = signature;
+    header.trackCount = count;
+    header.stringBytes = _tracks.stringBytes();
+
+    uint32_t checksum = FNV_OFFSET;
+    for (int i = 0; i < count; i++) {
+        const TrackInfo& info = _tracks.info(i);
+        IndexEntry e = { _tracks.pathOffset(i), info.size, info.mtime };
+        checksum = fnv1a(&e, sizeof(e), checksum);
+    }
+    header.checksum = header.stringBytes ? fnv1a(_tracks.stringData(), header.stringBytes, checksum) : checksum;
+
+    File file = SD.open(INDEX_TMP_PATH, FILE_WRITE);
+    bool ok = (bool)file;
+    if (ok) {
+        ok = file.write((const uint8_t*)&header, sizeof(header)) == sizeof(header);
+
+        for (int i = 0; ok && i < count; i++) {
+            const TrackInfo& info = _tracks.info(i);
+            IndexEntry e = { _tracks.pathOffset(i), info.size, info.mtime };
+            ok = file.write((const uint8_t*)&e, sizeof(e)) == sizeof(e);
+        }
+
+        if (ok && header.stringBytes > 0) {
+            ok = file.write((const uint8_t*)_tracks.stringData(), header.stringBytes) == header.stringBytes;
+        }
+        file.close();
+    }
+
+    // Swap in the new index only once it is completely on the card.
+    if (ok) {
+        SD.remove(INDEX_PATH);
+        ok = SD.rename(INDEX_TMP_PATH, INDEX_PATH);
+    }
+    if (!ok) {
+        SD.remove(INDEX_TMP_PATH);
+    }
+    return ok;
+}
+
+void SDPlaylist::invalidateIndex() {
+    SD.remove(INDEX_PATH);
+}
+
+const char* SDPlaylist::getTrack(int index) {
+    if (index >= 0 && index < _tracks.count()) {
+        return _tracks.path(index);
+    }
+    return "";
+}
+
+const TrackInfo* SDPlaylist::getTrackInfo(int index) {
+    if (index >= 0 && index < _tracks.count()) {
+        return &_tracks.info(index);
+    }
+    return nullptr;
+}
+
+int SDPlaylist::getTrackCount() {
+    return _tracks.count();
+}
+
+void SDPlaylist::printPlaylist() {
+    Serial.println("\n=== Playlist ===");
+    for (int i = 0; i < _tracks.count(); i++) {
+        Serial.printf("%d: %s\n", i, _tracks.path(i));
+    }
+}
+
+std::string_view SDPlaylist::getTitle(int index) const {
+    if (index >= 0 && index < _tracks.count()) {
+        return _tracks.title(index);
+    }
+    return std::string_view();
+}
+
+TrackTitles SDPlaylist::getTitles() const {
+    return _tracks.titles();
+}
+
+// Clamped to the playlist, so any offset/limit pair yields a valid range.
+TrackTitles SDPlaylist::getTitles(int offset, int limit) const {
+    int count = _tracks.count();
+    if (offset < 0) offset = 0;
+    if (offset > count) offset = count;
+    if (limit < 0 || limit > count - offset) limit = count - offset;
+    return _tracks.titles(offset, offset + limit);
+}
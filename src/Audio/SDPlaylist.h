@@ -0,0 +1,186 @@
+// SDPlaylist.h
+#ifndef SD_PLAYLIST_H
+#define SD_PLAYLIST_H
+
+#include <WString.h>
+#include <atomic>
+#include <string_view>
+#include "TrackArena.h"
+#include "FolderWalker.h"
+
+struct PathKey;     // LibraryTables.h
+
+// SD SPI clock. The Arduino default of 4 MHz leaves no headroom for WAV
+// next to other card traffic; build with -DMUSICBOX_SD_SPI_HZ=4000000 to
+// go back to it on marginal wiring.
+#ifndef MUSICBOX_SD_SPI_HZ
+#define MUSICBOX_SD_SPI_HZ 20000000
+#endif
+
+// Scan progress goes to the listener at most this often, and once at the end.
+static constexpr uint32_t SCAN_PROGRESS_MS = 250;
+
+struct ScanProgress {
+    bool scanning;
+    bool reading;       // Building the list; false while only checking the index
+    uint32_t folders;
+    uint32_t files;     // Directory entries seen, folders included
+    uint32_t tracks;
+    uint32_t elapsedMs;
+};
+
+// One run of the old list replaced by a run of the new one. Applied in
+// order, each as a splice at `at` (a new-list index), the edits turn the
+// old list into the new one.
+struct LibraryEdit {
+    uint32_t at;
+    uint32_t removed;
+    uint32_t added;
+};
+
+// Edits kept per change; a load that needs more reports a full change.
+static constexpr int LIBRARY_EDITS_MAX = 64;
+
+// What the last load did to the track list.
+struct LibraryChange {
+    uint32_t version;           // Bumped by every load
+    uint32_t previousVersion;
+    int previousCount;
+    int count;
+    bool full;                  // Edits not listed: everything may have moved
+    int editCount;
+    LibraryEdit edits[LIBRARY_EDITS_MAX];
+
+    // Where a track of the previous list went; -1 if it is gone (or the
+    // change is full).
+    int mapIndex(int previousIndex) const;
+};
+
+// Called on the task that mounts and loads the card.
+class LibraryListener {
+public:
+    virtual ~LibraryListener() {}
+    virtual void onScanProgress(const ScanProgress& progress) = 0;
+    // The card was mounted or unmounted.
+    virtual void onCardChanged(bool present) {}
+    // A load finished, whether or not it changed the list (then there are
+    // no edits, only a new version); called once readers are let back in.
+    virtual void onLibraryChanged(const LibraryChange& change) {}
+};
+
+class SDPlaylist {
+    friend class LibraryScan;
+    friend class LibrarySignature;
+
+public:
+    SDPlaylist();
+    
+    // mount() and load(). False if there is no card.
+    bool begin();
+
+    // The card on its own: mounting leaves the track list alone, and
+    // unmounting keeps it in memory, so it can still be listed.
+    // Quiet leaves a failure unreported, for retries on an empty slot.
+    bool mount(bool quiet = false);
+    void unmount();
+    bool isMounted() const { return _mounted.load(std::memory_order_acquire); }
+    // Reads a sector; false once a mounted card has been pulled.
+    bool isCardResponding();
+
+    // Rebuilds the list from the mounted card: from the index when it is
+    // current, otherwise by a scan that reuses the size and date the
+    // index still has for each known path and opens only new files.
+    // Neither notices a file edited in place under the same name; refresh
+    // scans and opens every file, so sizes and dates are current again.
+    // Records how the list changed, see getLastChange(). Hold the readers
+    // lock around it once other tasks may read the list.
+    bool load(bool refresh = false);
+    const LibraryChange& getLastChange() const { return _change; }
+    uint32_t getVersion() const { return _change.version; }
+
+    // Tasks other than the one that loads read the list between
+    // beginRead() and endRead() (see LibraryReader), which fails while
+    // lockReaders() is in force. lockReaders() waits for the readers
+    // already in; unlockReaders() reports a pending change.
+    bool beginRead();
+    void endRead();
+    void lockReaders();
+    void unlockReaders();
+
+    const char* getTrack(int index);
+    const TrackInfo* getTrackInfo(int index);
+    int getTrackCount();
+    size_t getBytesUsed() const { return _tracks.bytesUsed(); }
+    size_t getBytesReserved() const { return _tracks.bytesReserved(); }
+    bool inPSRAM() const { return _tracks.inPSRAM(); }
+    void printPlaylist();
+
+    // Display titles (file name without folder or extension) as views into
+    // the stored paths. Valid until the next load().
+    std::string_view getTitle(int index) const;
+    TrackTitles getTitles() const;
+    TrackTitles getTitles(int offset, int limit) const;
+
+    // Forget the on-card index so the next load() does a full scan.
+    void invalidateIndex();
+
+    // Comma-separated folder lists, see FolderWalker.h. Takes effect at the
+    // next load(); a change forces a full scan.
+    bool setScanFolders(const char* include, const char* exclude) { return _walker.configure(include, exclude); }
+    void setListener(LibraryListener* listener) { _listener = listener; }
+    // Lock-free; safe from any task.
+    bool isScanning() const { return _scanning.load(std::memory_order_acquire); }
+    ScanProgress getScanProgress() const;
+
+private:
+    TrackArena _tracks;
+    FolderWalker _walker;
+
+    LibraryListener* _listener;
+    std::atomic<bool> _mounted;
+    std::atomic<bool> _readersLocked;
+    std::atomic<int> _readers;
+    LibraryChange _change;
+    bool _changePending;
+    std::atomic<bool> _scanning;
+    std::atomic<bool> _scanReading;
+    std::atomic<uint32_t> _scanTracks;
+    uint32_t _scanStartMs;
+    uint32_t _scanMs;           // Length of the last scan
+    uint32_t _scanReportedMs;
+    void reportProgress(bool force);
+    
+    struct KnownTrack;
+    int scanForMusic(const KnownTrack* known, int knownCount);
+    uint32_t directorySignature();
+    KnownTrack* collectKnown(int& count);
+    PathKey* collectPaths();
+    void recordChange(const PathKey* previous, int previousCount);
+
+    static bool isAudioFile(const char* filename);
+
+    void printFootprint();
+
+    // Any signature will do without checkSignature.
+    bool loadIndex(uint32_t signature, bool checkSignature = true);
+    bool saveIndex(uint32_t signature);
+};
+
+// Holds the track list still for the scope, see SDPlaylist::beginRead().
+class LibraryReader {
+public:
+    explicit LibraryReader(SDPlaylist& playlist) : _playlist(playlist), _held(playlist.beginRead()) {}
+    ~LibraryReader() {
+        if (_held) _playlist.endRead();
+    }
+    LibraryReader(const LibraryReader&) = delete;
+    LibraryReader& operator=(const LibraryReader&) = delete;
+
+    explicit operator bool() const { return _held; }
+
+private:
+    SDPlaylist& _playlist;
+    bool _held;
+};
+
+#endif
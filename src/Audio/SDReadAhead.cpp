@@ -0,0 +1,236 @@
+// ============================================================================
+// SDReadAhead.cpp
+// ============================================================================
+#include "SDReadAhead.h"
+#include "AudioOutput.h"
+#include <string.h>
+
+// Above the decoder, so a refill preempts it; below the I2S task.
+static constexpr UBaseType_t SD_READ_TASK_PRIORITY = 12;
+
+// A block that has not arrived by then counts as a card error.
+static constexpr uint32_t READ_AHEAD_TIMEOUT_MS = 1000;
+
+SDReadAhead::SDReadAhead()
+    : _open(false), _size(0), _position(0), _task(nullptr), _generation(0), _fillFrom(0),
+      _fillEnd(0), _busy(false), _taskGeneration(0), _taskNext(0), _taskEnd(0), _bytesRead(0),
+      _blockReads(0), _stalls(0), _stallUs(0), _maxReadUs(0) {
+    for (auto& bucket : _latency) bucket.store(0, std::memory_order_relaxed);
+}
+
+SDReadAhead::~SDReadAhead() {
+    for (Block& block : _blocks) free(block.data);
+}
+
+bool SDReadAhead::allocate() {
+    for (Block& block : _blocks) {
+        if (block.data == nullptr) block.data = (uint8_t*)malloc(READ_AHEAD_BLOCK);
+        if (block.data == nullptr) {
+            Serial.println("ERROR: No memory for SD read-ahead buffers!");
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SDReadAhead::begin() {
+    if (_task != nullptr) return true;
+    if (!allocate()) return false;
+
+    if (xTaskCreatePinnedToCore(taskEntry, "sd_read", 3072, this, SD_READ_TASK_PRIORITY,
+                                &_task, AUDIO_TASK_CORE) != pdPASS) {
+        _task = nullptr;
+        Serial.println("ERROR: Failed to start SD read-ahead task!");
+        return false;
+    }
+
+    Serial.printf("✓ SD read-ahead: %u x %u KB blocks\n", (unsigned)READ_AHEAD_BUFFERS,
+                  (unsigned)(READ_AHEAD_BLOCK / 1024));
+    return true;
+}
+
+bool SDReadAhead::open(fs::FS& fs, const char* path) {
+    close();
+    if (!allocate()) return false;
+
+    _file = fs.open(path);
+    if (!_file || _file.isDirectory()) {
+        _file.close();
+        return false;
+    }
+    _size = _file.size();
+    _position = 0;
+    _open = true;
+    restart(0);
+    return true;
+}
+
+// The task only touches the file inside a _busy window that started under
+// the current generation, so after the bump and one wait it is ours.
+void SDReadAhead::close() {
+    if (!_open) return;
+    _open = false;
+    _fillEnd.store(0);
+    _generation.fetch_add(1);
+    while (_busy.load()) {
+        vTaskDelay(1);
+    }
+    _file.close();
+    _size = 0;
+    _position = 0;
+}
+
+void SDReadAhead::restart(size_t pos) {
+    _fillFrom.store(pos - pos % READ_AHEAD_BLOCK);
+    _fillEnd.store(_size);
+    _generation.fetch_add(1);
+}
+
+bool SDReadAhead::seek(size_t pos) {
+    if (!_open || pos > _size) return false;
+
+    // Blocks from the current one up to the end of the double buffer are
+    // buffered or on their way; find() drops any that are skipped over.
+    size_t current = _position - _position % READ_AHEAD_BLOCK;
+    size_t offset = pos - pos % READ_AHEAD_BLOCK;
+    _position = pos;
+    if (offset < current || offset >= current + READ_AHEAD_BUFFERS * READ_AHEAD_BLOCK) {
+        restart(pos);
+    }
+    return true;
+}
+
+// Blocks from an older generation, and those behind `offset`, are released
+// back to the task on the way.
+SDReadAhead::Block* SDReadAhead::find(size_t offset) {
+    uint32_t generation = _generation.load(std::memory_order_relaxed);
+    Block* found = nullptr;
+    for (Block& block : _blocks) {
+        if (!block.full.load(std::memory_order_acquire)) continue;
+        if (block.generation != generation || block.offset < offset) {
+            block.full.store(false, std::memory_order_release);
+        } else if (block.offset == offset) {
+            found = &block;
+        }
+    }
+    return found;
+}
+
+size_t SDReadAhead::read(uint8_t* dst, size_t len) {
+    if (!_open) return 0;
+    if (len > _size - _position) len = _size - _position;
+
+    size_t done = 0;
+    while (done < len) {
+        size_t offset = _position - _position % READ_AHEAD_BLOCK;
+        Block* block = find(offset);
+
+        if (block == nullptr) {
+            uint32_t start = micros();
+            _stalls.fetch_add(1, std::memory_order_relaxed);
+            if (_task == nullptr) {
+                fillNext();
+                block = find(offset);
+            } else {
+                while ((block = find(offset)) == nullptr &&
+                       micros() - start < READ_AHEAD_TIMEOUT_MS * 1000) {
+                    vTaskDelay(1);
+                }
+            }
+            _stallUs.fetch_add(micros() - start, std::memory_order_relaxed);
+            if (block == nullptr) break;
+        }
+
+        size_t expected = _size - offset < READ_AHEAD_BLOCK ? _size - offset : READ_AHEAD_BLOCK;
+        size_t at = _position - offset;
+        size_t n = at < block->length ? block->length - at : 0;
+        if (n > len - done) n = len - done;
+        memcpy(dst + done, block->data + at, n);
+        done += n;
+        _position += n;
+
+        if (at + n >= block->length) {
+            block->full.store(false, std::memory_order_release);
+            // A short block is a failed card read: retry from here next time.
+            if (block->length < expected) {
+                restart(_position);
+                break;
+            }
+        }
+    }
+    return done;
+}
+
+void SDReadAhead::taskEntry(void* param) {
+    static_cast<SDReadAhead*>(param)->run();
+}
+
+void SDReadAhead::run() {
+    for (;;) {
+        if (!fillNext()) {
+            vTaskDelay(1);
+        }
+    }
+}
+
+// One block into a free buffer, if the current file has one left to read.
+bool SDReadAhead::fillNext() {
+    _busy.store(true);
+    uint32_t generation = _generation.load();
+    if (generation != _taskGeneration) {
+        _taskGeneration = generation;
+        _taskNext = _fillFrom.load();
+        _taskEnd = _fillEnd.load();
+    }
+
+    bool filled = false;
+    if (_taskNext < _taskEnd) {
+        for (Block& block : _blocks) {
+            if (block.full.load(std::memory_order_acquire)) continue;
+            fill(block, generation, _taskNext);
+            _taskNext += READ_AHEAD_BLOCK;
+            filled = true;
+            break;
+        }
+    }
+    _busy.store(false);
+    return filled;
+}
+
+void SDReadAhead::fill(Block& block, uint32_t generation, size_t offset) {
+    size_t want = _taskEnd - offset < READ_AHEAD_BLOCK ? _taskEnd - offset : READ_AHEAD_BLOCK;
+
+    uint32_t start = micros();
+    size_t got = 0;
+    if (_file.position() == offset || _file.seek(offset)) {
+        got = _file.read(block.data, want);
+    }
+    uint32_t us = micros() - start;
+
+    _bytesRead.fetch_add(got, std::memory_order_relaxed);
+    _blockReads.fetch_add(1, std::memory_order_relaxed);
+    if (us > _maxReadUs.load(std::memory_order_relaxed)) _maxReadUs.store(us, std::memory_order_relaxed);
+    size_t bucket = 0;
+    for (uint32_t ms = us / 1000; ms > 0 && bucket < READ_LATENCY_BUCKETS - 1; ms >>= 1) {
+        bucket++;
+    }
+    _latency[bucket].fetch_add(1, std::memory_order_relaxed);
+
+    block.generation = generation;
+    block.offset = offset;
+    block.length = got;
+    block.full.store(true, std::memory_order_release);
+}
+
+SDReadStats SDReadAhead::getStats() const {
+    SDReadStats stats;
+    stats.bytesRead = _bytesRead.load();
+    stats.blockReads = _blockReads.load();
+    stats.stalls = _stalls.load();
+    stats.stallUs = _stallUs.load();
+    stats.maxReadUs = _maxReadUs.load();
+    for (size_t i = 0; i < READ_LATENCY_BUCKETS; i++) {
+        stats.latency[i] = _latency[i].load();
+    }
+    return stats;
+}
@@ -0,0 +1,105 @@
+// ============================================================================
+// SDReadAhead.h
+// Sequential reads from the card in large sector-aligned blocks. A
+// background task keeps two block buffers filled ahead of the consumer, so
+// read() is a copy out of RAM while the next multi-sector transfer runs,
+// instead of one small SPI transaction (or several) per call.
+//
+// One consumer task calls everything but getStats(). Until begin() starts
+// the task, read() fills blocks itself, synchronously.
+// ============================================================================
+#ifndef SD_READ_AHEAD_H
+#define SD_READ_AHEAD_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <atomic>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+// 32 sectors: one multi-block command per block, ~93 ms of 44.1 kHz
+// 16-bit stereo WAV.
+static constexpr size_t READ_AHEAD_BLOCK = 16 * 1024;
+static constexpr size_t READ_AHEAD_BUFFERS = 2;
+
+// Block read latency histogram: under 1, 2, 4 ... 64 ms, then the rest.
+static constexpr size_t READ_LATENCY_BUCKETS = 8;
+
+struct SDReadStats {
+    uint64_t bytesRead;         // Off the card
+    uint32_t blockReads;
+    uint32_t stalls;            // read() found its block still in flight
+    uint32_t stallUs;           // Consumer time spent waiting on those
+    uint32_t maxReadUs;
+    uint32_t latency[READ_LATENCY_BUCKETS];
+};
+
+class SDReadAhead {
+public:
+    SDReadAhead();
+    ~SDReadAhead();
+
+    // Allocates the buffers and starts the fill task.
+    bool begin();
+
+    bool open(fs::FS& fs, const char* path);
+    void close();
+    bool isOpen() const { return _open; }
+
+    size_t size() const { return _size; }
+    size_t position() const { return _position; }
+    // Inside a block already buffered this is free; elsewhere the buffers
+    // restart from the sector-aligned block holding `pos`.
+    bool seek(size_t pos);
+
+    // Waits only if the block it needs is not buffered yet. Short only at
+    // the end of the file or on a card error.
+    size_t read(uint8_t* dst, size_t len);
+
+    SDReadStats getStats() const;
+
+private:
+    struct Block {
+        uint8_t* data = nullptr;
+        std::atomic<bool> full{false};   // Task sets, consumer clears
+        uint32_t generation = 0;
+        size_t offset = 0;
+        size_t length = 0;
+    };
+
+    Block _blocks[READ_AHEAD_BUFFERS];
+    fs::File _file;
+    bool _open;
+    size_t _size;
+    size_t _position;
+    TaskHandle_t _task;
+
+    // Bumped on every open, seek or close; blocks from an older one are
+    // dropped. The task fills from _fillFrom to _fillEnd after a bump.
+    std::atomic<uint32_t> _generation;
+    std::atomic<size_t> _fillFrom;
+    std::atomic<size_t> _fillEnd;
+    std::atomic<bool> _busy;    // Task is inside a card read
+
+    // Fill task only (or the consumer, before begin()).
+    uint32_t _taskGeneration;
+    size_t _taskNext;
+    size_t _taskEnd;
+
+    std::atomic<uint64_t> _bytesRead;
+    std::atomic<uint32_t> _blockReads;
+    std::atomic<uint32_t> _stalls;
+    std::atomic<uint32_t> _stallUs;
+    std::atomic<uint32_t> _maxReadUs;
+    std::atomic<uint32_t> _latency[READ_LATENCY_BUCKETS];
+
+    bool allocate();
+    static void taskEntry(void* param);
+    void run();
+    bool fillNext();
+    void fill(Block& block, uint32_t generation, size_t offset);
+    Block* find(size_t offset);
+    void restart(size_t pos);
+};
+
+#endif // SD_READ_AHEAD_H
@@ -0,0 +1,314 @@
+// ============================================================================
+// SearchIndex.cpp
+// ============================================================================
+#include "SearchIndex.h"
+#include "LibraryTables.h"
+#include <algorithm>
+#include <vector>
+
+// Field of a posting; the weight it adds to a hit is 1 << field.
+enum SearchField : uint8_t { FIELD_ALBUM = 0, FIELD_ARTIST = 1, FIELD_TITLE = 2, FIELD_TITLE_START = 3 };
+
+// U+00C0..U+00FF to a base letter; ' ' for the two that are punctuation.
+static const char LATIN1_FOLD[] = "aaaaaaaceeeeiiiidnooooo ouuuuytsaaaaaaaceeeeiiiidnooooo ouuuuyty";
+
+// Calls fn(word, length, position) for every word of text, normalized.
+// Letters and digits make words; other ASCII and Latin-1 punctuation split
+// them. Bytes of other scripts are kept as they are.
+template <typename Fn>
+static void forEachWord(const char* text, size_t length, Fn fn) {
+    char word[SEARCH_WORD_MAX];
+    size_t n = 0;
+    int position = 0;
+
+    for (size_t i = 0; i <= length; i++) {
+        uint8_t c = i < length ? (uint8_t)text[i] : 0;
+        char out = 0;
+        if (c == '\'') {
+            continue;
+        } else if (c < 0x80) {
+            if (isalnum(c)) out = (char)tolower(c);
+        } else if ((c == 0xC2 || c == 0xC3) && i + 1 < length && ((uint8_t)text[i + 1] & 0xC0) == 0x80) {
+            uint8_t low = (uint8_t)text[++i] & 0x3F;
+            if (c == 0xC3 && LATIN1_FOLD[low] != ' ') out = LATIN1_FOLD[low];
+        } else {
+            out = (char)c;
+        }
+
+        if (out != 0) {
+            if (n < sizeof(word)) word[n++] = out;
+        } else if (n > 0) {
+            fn(word, n, position++);
+            n = 0;
+        }
+    }
+}
+
+SearchIndex::SearchIndex()
+    : _words(nullptr), _wordOffset(nullptr), _postingStart(nullptr), _postings(nullptr),
+      _wordBytes(0), _wordCount(0), _postingCount(0), _trackCount(0), _matched(nullptr),
+      _weight(nullptr), _score(nullptr), _built(false), _metaIndexed(0), _version(0), _builtMs(0),
+      _buildMicros(0) {
+}
+
+SearchIndex::~SearchIndex() {
+    release();
+}
+
+void SearchIndex::release() {
+    free(_words);
+    free(_wordOffset);
+    free(_postingStart);
+    free(_postings);
+    free(_matched);
+    free(_weight);
+    free(_score);
+    _words = nullptr;
+    _wordOffset = nullptr;
+    _postingStart = nullptr;
+    _postings = nullptr;
+    _matched = nullptr;
+    _weight = nullptr;
+    _score = nullptr;
+    _wordBytes = 0;
+    _wordCount = 0;
+    _postingCount = 0;
+    _trackCount = 0;
+    _built = false;
+}
+
+size_t SearchIndex::bytesUsed() const {
+    return _wordBytes + _wordCount * sizeof(uint32_t) + (_wordCount + 1) * sizeof(uint32_t) +
+           _postingCount * sizeof(uint32_t) + _trackCount * (2 + sizeof(uint16_t));
+}
+
+// Two passes over the same words: the first builds the dictionary and
+// counts postings per word, the second fills them in place.
+bool SearchIndex::build(TrackTitles titles, const MetadataIndex* metadata) {
+    uint32_t start = micros();
+    release();
+
+    int tracks = titles.size();
+    // The indexer may publish more entries meanwhile; both passes must see
+    // the same ones.
+    std::vector<const TrackMeta*> metas(tracks, nullptr);
+    if (metadata != nullptr) {
+        for (int i = 0; i < tracks; i++) metas[i] = metadata->get(i);
+    }
+
+    auto forEachTrackWord = [&](auto fn) {
+        for (auto it = titles.begin(); it != titles.end(); ++it) {
+            int track = it.index();
+            const TrackMeta* meta = metas[track];
+            std::string_view title = *it;
+            if (meta != nullptr && meta->title[0] != '\0') title = meta->title;
+
+            forEachWord(title.data(), title.size(), [&](const char* w, size_t n, int position) {
+                fn(track, position == 0 ? FIELD_TITLE_START : FIELD_TITLE, w, n);
+            });
+            if (meta == nullptr) continue;
+            forEachWord(meta->artist, strlen(meta->artist), [&](const char* w, size_t n, int) {
+                fn(track, FIELD_ARTIST, w, n);
+            });
+            forEachWord(meta->album, strlen(meta->album), [&](const char* w, size_t n, int) {
+                fn(track, FIELD_ALBUM, w, n);
+            });
+        }
+    };
+
+    // Pass 1: distinct words, through an open-addressed hash table.
+    std::vector<char> blob;
+    std::vector<uint32_t> wordAt;
+    std::vector<uint32_t> counts;
+    std::vector<int32_t> lastTrack;
+    std::vector<int32_t> table(1024, -1);
+
+    auto lookup = [&](const char* w, size_t n, bool insert) -> int32_t {
+        size_t mask = table.size() - 1;
+        for (size_t slot = fnv1a(w, n) & mask;; slot = (slot + 1) & mask) {
+            int32_t id = table[slot];
+            if (id < 0) {
+                if (!insert) return -1;
+                id = (int32_t)wordAt.size();
+                table[slot] = id;
+                wordAt.push_back((uint32_t)blob.size());
+                blob.insert(blob.end(), w, w + n);
+                blob.push_back('\0');
+                counts.push_back(0);
+                lastTrack.push_back(-1);
+                return id;
+            }
+            const char* known = blob.data() + wordAt[id];
+            if (strncmp(known, w, n) == 0 && known[n] == '\0') return id;
+        }
+    };
+
+    forEachTrackWord([&](int track, uint8_t, const char* w, size_t n) {
+        if (wordAt.size() * 2 >= table.size()) {
+            std::vector<int32_t> grown(table.size() * 2, -1);
+            size_t mask = grown.size() - 1;
+            for (int32_t id : table) {
+                if (id < 0) continue;
+                const char* known = blob.data() + wordAt[id];
+                size_t slot = fnv1a(known, strlen(known)) & mask;
+                while (grown[slot] >= 0) slot = (slot + 1) & mask;
+                grown[slot] = id;
+            }
+            table.swap(grown);
+        }
+        int32_t id = lookup(w, n, true);
+        if (lastTrack[id] != track) {
+            lastTrack[id] = track;
+            counts[id]++;
+        }
+    });
+
+    int words = (int)wordAt.size();
+    std::vector<int32_t> order(words);
+    for (int i = 0; i < words; i++) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](int32_t a, int32_t b) {
+        return strcmp(blob.data() + wordAt[a], blob.data() + wordAt[b]) < 0;
+    });
+
+    size_t postings = 0;
+    for (uint32_t c : counts) postings += c;
+
+    _words = (char*)allocateTable(blob.size() ? blob.size() : 1);
+    _wordOffset = (uint32_t*)allocateTable(words * sizeof(uint32_t) + 1);
+    _postingStart = (uint32_t*)allocateTable((words + 1) * sizeof(uint32_t));
+    _postings = (uint32_t*)allocateTable(postings * sizeof(uint32_t) + 1);
+    _matched = (uint8_t*)allocateTable(tracks + 1);
+    _weight = (uint8_t*)allocateTable(tracks + 1);
+    _score = (uint16_t*)allocateTable((tracks + 1) * sizeof(uint16_t));
+    if (!_words || !_wordOffset || !_postingStart || !_postings || !_matched || !_weight || !_score) {
+        Serial.println("ERROR: No memory for the search index!");
+        release();
+        return false;
+    }
+
+    // Dictionary in sorted order; rank maps a pass-1 id to its position.
+    std::vector<int32_t> rank(words);
+    size_t at = 0;
+    uint32_t next = 0;
+    for (int i = 0; i < words; i++) {
+        const char* w = blob.data() + wordAt[order[i]];
+        size_t n = strlen(w) + 1;
+        memcpy(_words + at, w, n);
+        _wordOffset[i] = (uint32_t)at;
+        at += n;
+        rank[order[i]] = i;
+        _postingStart[i] = next;
+        next += counts[order[i]];
+    }
+    _postingStart[words] = next;
+
+    // Pass 2: postings, in track order within each word. A word seen again
+    // in the same track keeps its best field.
+    std::vector<uint32_t> cursor(_postingStart, _postingStart + words);
+    std::fill(lastTrack.begin(), lastTrack.end(), -1);
+    forEachTrackWord([&](int track, uint8_t field, const char* w, size_t n) {
+        int32_t i = rank[lookup(w, n, false)];
+        if (lastTrack[i] != track) {
+            lastTrack[i] = track;
+            _postings[cursor[i]++] = ((uint32_t)track << 2) | field;
+        } else {
+            uint32_t& posting = _postings[cursor[i] - 1];
+            if (field > (posting & 3)) posting = (posting & ~3u) | field;
+        }
+    });
+
+    _wordBytes = blob.size();
+    _wordCount = words;
+    _postingCount = postings;
+    _trackCount = tracks;
+    _built = true;
+    _buildMicros = micros() - start;
+    return true;
+}
+
+bool SearchIndex::refresh(TrackTitles titles, uint32_t version, const MetadataIndex& metadata, uint32_t nowMs) {
+    int indexed = metadata.indexedCount();
+    bool sameTracks = _built && version == _version && titles.size() == _trackCount;
+    if (sameTracks && indexed == _metaIndexed) return false;
+    if (sameTracks && !metadata.isComplete() && nowMs - _builtMs < SEARCH_REBUILD_MS) return false;
+
+    _metaIndexed = indexed;
+    _version = version;
+    _builtMs = nowMs;
+    if (!build(titles, &metadata)) return false;
+    Serial.printf("Search index: %d tracks, %d words, %u postings, %u bytes in %u us\n",
+                  _trackCount, _wordCount, (unsigned)_postingCount, (unsigned)bytesUsed(),
+                  (unsigned)_buildMicros);
+    return true;
+}
+
+int SearchIndex::search(const char* query, SearchHit* hits, int maxHits) {
+    char terms[SEARCH_MAX_TERMS][SEARCH_WORD_MAX + 1];
+    int termCount = 0;
+    forEachWord(query, strlen(query), [&](const char* w, size_t n, int) {
+        if (termCount == SEARCH_MAX_TERMS) return;
+        memcpy(terms[termCount], w, n);
+        terms[termCount][n] = '\0';
+        termCount++;
+    });
+    if (termCount == 0 || _trackCount == 0) return 0;
+
+    memset(_matched, 0, _trackCount);
+    for (int t = 0; t < termCount; t++) {
+        const char* term = terms[t];
+        size_t length = strlen(term);
+
+        // Every dictionary word the term is a prefix of, as one sorted range.
+        int lo = 0;
+        int hi = _wordCount;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (strcmp(word(mid), term) < 0) lo = mid + 1;
+            else hi = mid;
+        }
+        int first = lo;
+        hi = _wordCount;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (strncmp(word(mid), term, length) == 0) lo = mid + 1;
+            else hi = mid;
+        }
+
+        // A track counts only if it matched every earlier term; for this
+        // one it scores its best field.
+        uint8_t seen = (uint8_t)t;
+        for (int w = first; w < lo; w++) {
+            for (uint32_t p = _postingStart[w]; p < _postingStart[w + 1]; p++) {
+                uint32_t track = _postings[p] >> 2;
+                uint8_t weight = (uint8_t)(1 << (_postings[p] & 3));
+                if (_matched[track] == seen) {
+                    _matched[track] = seen + 1;
+                    if (t == 0) _score[track] = 0;
+                    _score[track] += weight;
+                    _weight[track] = weight;
+                } else if (_matched[track] == seen + 1 && weight > _weight[track]) {
+                    _score[track] += weight - _weight[track];
+                    _weight[track] = weight;
+                }
+            }
+        }
+    }
+
+    // Best maxHits by score, then playlist order, kept by insertion.
+    int total = 0;
+    int kept = 0;
+    for (int i = 0; i < _trackCount; i++) {
+        if (_matched[i] != termCount) continue;
+        total++;
+        uint16_t score = _score[i];
+        if (kept == maxHits && (maxHits == 0 || score <= hits[kept - 1].score)) continue;
+
+        int at = kept < maxHits ? kept++ : kept - 1;
+        while (at > 0 && hits[at - 1].score < score) {
+            hits[at] = hits[at - 1];
+            at--;
+        }
+        hits[at] = SearchHit{ i, score };
+    }
+    return total;
+}
@@ -0,0 +1,85 @@
+// ============================================================================
+// SearchIndex.h
+// Search-as-you-type over the library: every word of each track's title,
+// artist and album in one sorted dictionary, with a list of the tracks
+// holding it. A query word matches every dictionary word it is a prefix of
+// ("beat" finds "Beatles"), so a query is a binary search and a walk over
+// postings per word typed; no title is compared at query time.
+//
+// Words are folded to lower case, accented Latin-1 letters to their base
+// letter and apostrophes dropped, for the index and the query alike. Each
+// posting carries the best field the word appears in, which ranks the hits:
+// first word of the title, rest of the title, artist, album.
+//
+// build(), refresh() and search() share scratch space and belong to one
+// task (the web server's).
+// ============================================================================
+#ifndef SEARCH_INDEX_H
+#define SEARCH_INDEX_H
+
+#include <Arduino.h>
+#include "TrackArena.h"
+#include "MetadataIndex.h"
+
+// Query words past this many are ignored.
+static constexpr int SEARCH_MAX_TERMS = 8;
+// Longer words are indexed and matched on their first this-many bytes.
+static constexpr size_t SEARCH_WORD_MAX = 32;
+static constexpr int SEARCH_MAX_RESULTS = 50;
+
+// While the metadata indexer is still adding tags, rebuild at most this often.
+static constexpr uint32_t SEARCH_REBUILD_MS = 5000;
+
+struct SearchHit {
+    int index;          // Playlist index
+    uint16_t score;     // Higher is better
+};
+
+class SearchIndex {
+public:
+    SearchIndex();
+    ~SearchIndex();
+
+    // Indexes file-name titles, or the tag fields where metadata has them.
+    bool build(TrackTitles titles, const MetadataIndex* metadata);
+
+    // Rebuilds if the playlist (its SDPlaylist version) or the metadata
+    // changed since the last build. True if it did.
+    bool refresh(TrackTitles titles, uint32_t version, const MetadataIndex& metadata, uint32_t nowMs);
+
+    // Up to maxHits matches for every word of the query, best first.
+    // Returns how many tracks matched in all.
+    int search(const char* query, SearchHit* hits, int maxHits);
+
+    int trackCount() const { return _trackCount; }
+    int wordCount() const { return _wordCount; }
+    size_t postingCount() const { return _postingCount; }
+    size_t bytesUsed() const;
+    uint32_t buildMicros() const { return _buildMicros; }
+
+private:
+    char* _words;               // Sorted, NUL-terminated
+    uint32_t* _wordOffset;      // [_wordCount] into _words
+    uint32_t* _postingStart;    // [_wordCount + 1] into _postings
+    uint32_t* _postings;        // Track index << 2 | field
+    size_t _wordBytes;
+    int _wordCount;
+    size_t _postingCount;
+    int _trackCount;
+
+    // Per-track query scratch.
+    uint8_t* _matched;          // Query words matched so far
+    uint8_t* _weight;           // Best field weight for the current word
+    uint16_t* _score;
+
+    bool _built;
+    int _metaIndexed;           // Metadata entries the build saw
+    uint32_t _version;          // Playlist version the build saw
+    uint32_t _builtMs;
+    uint32_t _buildMicros;
+
+    void release();
+    const char* word(int i) const { return _words + _wordOffset[i]; }
+};
+
+#endif // SEARCH_INDEX_H
@@ -0,0 +1,65 @@
+// ============================================================================
+// Seqlock.h
+// Single-writer snapshot that any number of readers can copy without ever
+// blocking the writer. The writer bumps a sequence counter to odd, stores
+// the value, and bumps it back to even; a reader retries if it saw an odd
+// counter or the counter moved while it copied. The value is held in
+// relaxed atomic words so the copy is race-free as far as C++ is concerned.
+// ============================================================================
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <type_traits>
+
+template <typename T>
+class Seqlock {
+    static_assert(std::is_trivially_copyable<T>::value, "Seqlock needs a trivially copyable type");
+
+public:
+    Seqlock() {
+        T empty{};
+        write(empty);
+    }
+
+    // Writer task only.
+    void write(const T& value) {
+        uint32_t words[WORDS] = {};
+        memcpy(words, &value, sizeof(T));
+
+        uint32_t seq = _seq.load(std::memory_order_relaxed);
+        _seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (size_t i = 0; i < WORDS; i++) {
+            _words[i].store(words[i], std::memory_order_relaxed);
+        }
+        _seq.store(seq + 2, std::memory_order_release);
+    }
+
+    // Any task. Spins only while a write is in flight (a few stores).
+    T read() const {
+        uint32_t words[WORDS];
+        uint32_t before, after;
+        do {
+            before = _seq.load(std::memory_order_acquire);
+            for (size_t i = 0; i < WORDS; i++) {
+                words[i] = _words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = _seq.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+
+        T value;
+        memcpy(&value, words, sizeof(T));
+        return value;
+    }
+
+private:
+    static constexpr size_t WORDS = (sizeof(T) + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+
+    std::atomic<uint32_t> _seq{0};
+    std::atomic<uint32_t> _words[WORDS];
+};
+
+#endif
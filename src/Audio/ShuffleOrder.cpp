@@ -0,0 +1,121 @@
+// ============================================================================
+// ShuffleOrder.cpp
+// ============================================================================
+#include "ShuffleOrder.h"
+
+static constexpr int FEISTEL_ROUNDS = 4;
+
+// Murmur3 finalizer.
+static uint32_t mix32(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x85EBCA6Bu;
+    x ^= x >> 13;
+    x *= 0xC2B2AE35u;
+    x ^= x >> 16;
+    return x;
+}
+
+ShuffleOrder::ShuffleOrder()
+    : _count(0), _seed(0), _halfBits(1), _position(0), _cycle(0), _offset(0), _previousOffset(0),
+      _hasPrevious(false) {
+}
+
+void ShuffleOrder::reset(uint32_t count, uint32_t seed, uint32_t first) {
+    _count = count;
+    _seed = seed;
+    _position = 0;
+    _cycle = 0;
+    _hasPrevious = false;
+
+    // Half the bits of the smallest even-width domain holding [0, count).
+    uint32_t bits = 0;
+    while (bits < 32 && (1ull << bits) < count) bits++;
+    _halfBits = bits < 2 ? 1 : (bits + 1) / 2;
+
+    _offset = first < count ? decrypt(key(0), first) : 0;
+}
+
+uint32_t ShuffleOrder::key(uint32_t cycle) const {
+    return mix32(_seed + cycle * 0x9E3779B9u);
+}
+
+uint32_t ShuffleOrder::encrypt(uint32_t key, uint32_t x) const {
+    uint32_t mask = (1u << _halfBits) - 1;
+    // Cycle walking: results outside [0, count) are permuted again until
+    // they land inside, which keeps the map a bijection on [0, count).
+    do {
+        uint32_t left = x >> _halfBits;
+        uint32_t right = x & mask;
+        for (int round = 0; round < FEISTEL_ROUNDS; round++) {
+            uint32_t f = mix32(right ^ key ^ (round * 0x9E3779B9u)) & mask;
+            uint32_t next = left ^ f;
+            left = right;
+            right = next;
+        }
+        x = (left << _halfBits) | right;
+    } while (x >= _count);
+    return x;
+}
+
+uint32_t ShuffleOrder::decrypt(uint32_t key, uint32_t y) const {
+    uint32_t mask = (1u << _halfBits) - 1;
+    do {
+        uint32_t left = y >> _halfBits;
+        uint32_t right = y & mask;
+        for (int round = FEISTEL_ROUNDS - 1; round >= 0; round--) {
+            uint32_t f = mix32(left ^ key ^ (round * 0x9E3779B9u)) & mask;
+            uint32_t previous = right ^ f;
+            right = left;
+            left = previous;
+        }
+        y = (left << _halfBits) | right;
+    } while (y >= _count);
+    return y;
+}
+
+uint32_t ShuffleOrder::at(uint32_t cycle, uint32_t offset, uint32_t position) const {
+    if (_count == 0) return 0;
+    uint32_t x = position + offset;
+    if (x >= _count) x -= _count;
+    return encrypt(key(cycle), x);
+}
+
+// Rotates a new cycle by one if it would open with the track just played.
+uint32_t ShuffleOrder::newCycleOffset(uint32_t cycle, uint32_t last) const {
+    return _count > 1 && at(cycle, 0, 0) == last ? 1 : 0;
+}
+
+uint32_t ShuffleOrder::peekNext() const {
+    if (_count == 0) return 0;
+    if (!atEnd()) return at(_cycle, _offset, _position + 1);
+    uint32_t last = current();
+    return at(_cycle + 1, newCycleOffset(_cycle + 1, last), 0);
+}
+
+uint32_t ShuffleOrder::next() {
+    if (_count == 0) return 0;
+    if (!atEnd()) {
+        _position++;
+    } else {
+        uint32_t last = current();
+        _previousOffset = _offset;
+        _hasPrevious = true;
+        _cycle++;
+        _offset = newCycleOffset(_cycle, last);
+        _position = 0;
+    }
+    return current();
+}
+
+uint32_t ShuffleOrder::previous() {
+    if (_count == 0) return 0;
+    if (_position > 0) {
+        _position--;
+    } else if (_hasPrevious) {
+        _cycle--;
+        _offset = _previousOffset;
+        _hasPrevious = false;
+        _position = _count - 1;
+    }
+    return current();
+}
@@ -0,0 +1,58 @@
+// ============================================================================
+// ShuffleOrder.h
+// Shuffled play order with no array behind it: position i of a cycle plays
+// track F((i + offset) mod n), where F is a keyed Feistel permutation of
+// [0, n) (cycle-walked down from the next power of four). Every track plays
+// exactly once per cycle, next() and previous() are O(1) whatever the
+// library size, and the history is just the position counter.
+//
+// Each cycle gets a fresh key derived from the seed and the cycle number.
+// The offset starts a cycle on a chosen track (a selection made while
+// shuffled), or keeps the first track of a new cycle from repeating the
+// last one of the cycle before.
+// ============================================================================
+#ifndef SHUFFLE_ORDER_H
+#define SHUFFLE_ORDER_H
+
+#include <Arduino.h>
+
+class ShuffleOrder {
+public:
+    ShuffleOrder();
+
+    // New order over `count` tracks whose first cycle starts at `first`.
+    void reset(uint32_t count, uint32_t seed, uint32_t first);
+
+    uint32_t count() const { return _count; }
+    uint32_t position() const { return _position; }
+    uint32_t cycle() const { return _cycle; }
+    bool atEnd() const { return _position + 1 >= _count; }
+
+    uint32_t current() const { return at(_cycle, _offset, _position); }
+    // The track after current(), without moving.
+    uint32_t peekNext() const;
+
+    // Moves one step; past the end of a cycle a new one begins.
+    uint32_t next();
+    // Moves one step back, into the previous cycle once (then stays at
+    // the start).
+    uint32_t previous();
+
+private:
+    uint32_t _count;
+    uint32_t _seed;
+    uint32_t _halfBits;
+    uint32_t _position;
+    uint32_t _cycle;
+    uint32_t _offset;
+    uint32_t _previousOffset;
+    bool _hasPrevious;
+
+    uint32_t key(uint32_t cycle) const;
+    uint32_t encrypt(uint32_t key, uint32_t x) const;
+    uint32_t decrypt(uint32_t key, uint32_t y) const;
+    uint32_t at(uint32_t cycle, uint32_t offset, uint32_t position) const;
+    uint32_t newCycleOffset(uint32_t cycle, uint32_t last) const;
+};
+
+#endif // SHUFFLE_ORDER_H
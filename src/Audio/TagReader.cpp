@@ -0,0 +1,371 @@
+// ============================================================================
+// TagReader.cpp
+// ============================================================================
+#include "TagReader.h"
+#include "FrameSeekTable.h"
+
+// Enough raw bytes for a full field in any ID3 encoding (UTF-16 included).
+static constexpr size_t TEXT_READ_MAX = 2 * (META_TEXT_MAX + 1) + 4;
+
+// File bytes held at a time while walking MPEG frames.
+static constexpr size_t MP3_SCAN_BYTES = 2048;
+
+// Bound the chunk and LIST/INFO walks on a corrupt WAV.
+static constexpr int WAV_MAX_CHUNKS = 32;
+static constexpr int WAV_MAX_INFO_ITEMS = 32;
+
+enum TextEncoding : uint8_t { LATIN1 = 0, UTF16 = 1, UTF16BE = 2, UTF8 = 3 };
+
+static uint16_t le16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t le32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t be32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint32_t syncsafe(const uint8_t* p) {
+    return ((uint32_t)(p[0] & 0x7F) << 21) | ((uint32_t)(p[1] & 0x7F) << 14) |
+           ((uint32_t)(p[2] & 0x7F) << 7) | (uint32_t)(p[3] & 0x7F);
+}
+
+// Appends `cp` as UTF-8. False (and nothing written) once it would not fit.
+static bool putUtf8(char* out, size_t& n, uint32_t cp) {
+    char seq[4];
+    size_t len;
+    if (cp < 0x80) {
+        seq[0] = (char)cp;
+        len = 1;
+    } else if (cp < 0x800) {
+        seq[0] = (char)(0xC0 | (cp >> 6));
+        seq[1] = (char)(0x80 | (cp & 0x3F));
+        len = 2;
+    } else if (cp < 0x10000) {
+        seq[0] = (char)(0xE0 | (cp >> 12));
+        seq[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        seq[2] = (char)(0x80 | (cp & 0x3F));
+        len = 3;
+    } else {
+        seq[0] = (char)(0xF0 | (cp >> 18));
+        seq[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+        seq[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        seq[3] = (char)(0x80 | (cp & 0x3F));
+        len = 4;
+    }
+    if (n + len > META_TEXT_MAX) return false;
+    memcpy(out + n, seq, len);
+    n += len;
+    return true;
+}
+
+// One UTF-8 sequence at p; a byte that does not start a valid one is read
+// as Latin-1, which is what untagged INFO chunks and old writers use.
+static uint32_t nextUtf8(const uint8_t* p, size_t len, size_t& used) {
+    uint8_t b = p[0];
+    size_t extra = b >= 0xF0 && b < 0xF5 ? 3 : (b >= 0xE0 ? 2 : (b >= 0xC2 && b < 0xE0 ? 1 : 0));
+    if (b < 0x80 || extra == 0 || extra >= len) {
+        used = 1;
+        return b;
+    }
+    uint32_t cp = b & (0x3F >> extra);
+    for (size_t i = 1; i <= extra; i++) {
+        if ((p[i] & 0xC0) != 0x80) {
+            used = 1;
+            return b;
+        }
+        cp = (cp << 6) | (p[i] & 0x3F);
+    }
+    used = extra + 1;
+    return cp;
+}
+
+// First string of an ID3 (or INFO) text field into `out`, as UTF-8, with
+// control characters dropped and trailing spaces trimmed.
+static void decodeText(uint8_t encoding, const uint8_t* p, size_t len, char* out) {
+    size_t n = 0;
+    bool bigEndian = encoding == UTF16BE;
+    if (encoding == UTF16 && len >= 2) {
+        if (p[0] == 0xFE && p[1] == 0xFF) {
+            bigEndian = true;
+            p += 2;
+            len -= 2;
+        } else if (p[0] == 0xFF && p[1] == 0xFE) {
+            p += 2;
+            len -= 2;
+        }
+    }
+
+    size_t i = 0;
+    while (i < len) {
+        uint32_t cp;
+        if (encoding == UTF16 || encoding == UTF16BE) {
+            if (i + 2 > len) break;
+            cp = bigEndian ? (uint32_t)(p[i] << 8 | p[i + 1]) : le16(p + i);
+            i += 2;
+            if (cp >= 0xD800 && cp < 0xDC00 && i + 2 <= len) {
+                uint32_t low = bigEndian ? (uint32_t)(p[i] << 8 | p[i + 1]) : le16(p + i);
+                if (low >= 0xDC00 && low < 0xE000) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    i += 2;
+                }
+            }
+            if (cp >= 0xD800 && cp < 0xE000) cp = 0xFFFD;
+        } else if (encoding == UTF8) {
+            size_t used;
+            cp = nextUtf8(p + i, len - i, used);
+            i += used;
+        } else {
+            cp = p[i++];
+        }
+
+        if (cp == 0) break;
+        if (cp < 0x20) continue;
+        if (!putUtf8(out, n, cp)) break;
+    }
+
+    while (n > 0 && out[n - 1] == ' ') n--;
+    out[n] = '\0';
+}
+
+bool TagReader::read(fs::FS& fs, const char* path, TrackTags& out) {
+    memset(&out, 0, sizeof(out));
+
+    File file = fs.open(path);
+    if (!file || file.isDirectory()) return false;
+
+    uint8_t head[12];
+    size_t length = file.read(head, sizeof(head));
+    if (length == sizeof(head) && memcmp(head, "RIFF", 4) == 0 && memcmp(head + 8, "WAVE", 4) == 0) {
+        readWav(file, out);
+    } else {
+        readMp3(file, out);
+    }
+    return true;
+}
+
+void TagReader::readMp3(File& file, TrackTags& out) {
+    uint8_t head[10];
+    size_t length = file.seek(0) ? file.read(head, sizeof(head)) : 0;
+    uint32_t start = id3v2TagSize(head, length);
+    if (start > 0) readId3v2(file, 0, out);
+
+    uint32_t end = file.size();
+    if (readId3v1(file, out)) end -= 128;
+    if (start < end) out.durationMs = mp3Duration(file, start, end);
+}
+
+void TagReader::readId3v2(File& file, uint32_t start, TrackTags& out) {
+    uint8_t header[10];
+    if (!file.seek(start) || file.read(header, 10) != 10 || memcmp(header, "ID3", 3) != 0) return;
+
+    uint8_t version = header[3];
+    uint8_t flags = header[5];
+    if (version < 2 || version > 4) return;
+    // ID3v2.2 has no frame-level way around its compression flag.
+    if (version == 2 && (flags & 0x40)) return;
+
+    // Offsets are checked against `end` before they move, so a corrupt
+    // size can neither wrap them nor send the walk backwards.
+    uint32_t pos = start + 10;
+    uint64_t tagEnd = (uint64_t)pos + syncsafe(header + 6);
+    uint32_t end = tagEnd < file.size() ? (uint32_t)tagEnd : file.size();
+    if (pos > end) return;
+
+    if (version >= 3 && (flags & 0x40)) {
+        uint8_t ext[4];
+        if (file.read(ext, 4) != 4) return;
+        // v2.4 counts the size field itself; v2.3 does not.
+        uint64_t skip = version == 4 ? syncsafe(ext) : (uint64_t)be32(ext) + 4;
+        if (skip > end - pos) return;
+        pos += (uint32_t)skip;
+    }
+
+    size_t headerLength = version == 2 ? 6 : 10;
+    while (end - pos >= headerLength) {
+        uint8_t fh[10];
+        if (!file.seek(pos) || file.read(fh, headerLength) != headerLength) return;
+        if (fh[0] == 0) return;     // Padding
+
+        uint32_t size;
+        uint16_t frameFlags = 0;
+        char* target = nullptr;
+        if (version == 2) {
+            size = ((uint32_t)fh[3] << 16) | ((uint32_t)fh[4] << 8) | fh[5];
+            if (memcmp(fh, "TT2", 3) == 0) target = out.title;
+            else if (memcmp(fh, "TP1", 3) == 0) target = out.artist;
+            else if (memcmp(fh, "TAL", 3) == 0) target = out.album;
+        } else {
+            size = version == 4 ? syncsafe(fh + 4) : be32(fh + 4);
+            frameFlags = (uint16_t)(fh[8] << 8 | fh[9]);
+            if (memcmp(fh, "TIT2", 4) == 0) target = out.title;
+            else if (memcmp(fh, "TPE1", 4) == 0) target = out.artist;
+            else if (memcmp(fh, "TALB", 4) == 0) target = out.album;
+        }
+
+        uint32_t data = pos + headerLength;
+        if (size == 0 || size > end - data) return;
+        pos = data + size;
+        if (target == nullptr || target[0] != '\0') continue;
+
+        // Compressed or encrypted frames are skipped; a grouping byte or a
+        // data length indicator in front of the text is stepped over.
+        if (version == 3) {
+            if (frameFlags & 0x00C0) continue;
+            if (frameFlags & 0x0020) data++;
+        } else if (version == 4) {
+            if (frameFlags & 0x000C) continue;
+            if (frameFlags & 0x0040) data++;
+            if (frameFlags & 0x0001) data += 4;
+        }
+        if (data >= pos) continue;
+
+        uint8_t text[TEXT_READ_MAX];
+        size_t length = pos - data < sizeof(text) ? pos - data : sizeof(text);
+        if (!file.seek(data) || file.read(text, length) != length) return;
+        decodeText(text[0], text + 1, length - 1, target);
+    }
+}
+
+bool TagReader::readId3v1(File& file, TrackTags& out) {
+    size_t size = file.size();
+    uint8_t tag[128];
+    if (size < sizeof(tag) || !file.seek(size - sizeof(tag)) ||
+        file.read(tag, sizeof(tag)) != sizeof(tag) || memcmp(tag, "TAG", 3) != 0) {
+        return false;
+    }
+    if (out.title[0] == '\0') decodeText(LATIN1, tag + 3, 30, out.title);
+    if (out.artist[0] == '\0') decodeText(LATIN1, tag + 33, 30, out.artist);
+    if (out.album[0] == '\0') decodeText(LATIN1, tag + 63, 30, out.album);
+    return true;
+}
+
+uint32_t TagReader::mp3Duration(File& file, uint32_t start, uint32_t end) {
+    uint8_t buf[MP3_SCAN_BYTES];
+    if (!file.seek(start)) return 0;
+    size_t length = file.read(buf, sizeof(buf));
+
+    // First frame: a sync whose successor is also a valid header, as in
+    // FrameSeekTable.
+    uint32_t first = 0;
+    MpegFrame frame;
+    bool found = false;
+    for (size_t i = 0; i + 4 <= length && !found; i++) {
+        if (!MpegFrame::parse(buf + i, frame)) continue;
+        MpegFrame following;
+        if (i + frame.length + 4 <= length) {
+            found = MpegFrame::parse(buf + i + frame.length, following);
+        } else {
+            uint8_t next[4];
+            found = file.seek(start + i + frame.length) && file.read(next, 4) == 4 &&
+                    MpegFrame::parse(next, following);
+        }
+        found = found && following.sampleRate == frame.sampleRate;
+        if (found) first = start + i;
+    }
+    if (!found) return 0;
+
+    // Xing/Info sits after the side information, VBRI at a fixed 36 bytes.
+    uint8_t head[64];
+    size_t headLength = file.seek(first) ? file.read(head, sizeof(head)) : 0;
+    bool mpeg1 = frame.samples == 1152;
+    size_t xing = 4 + (mpeg1 ? (frame.channels == 1 ? 17 : 32) : (frame.channels == 1 ? 9 : 17));
+    uint32_t frames = 0;
+    if (xing + 12 <= headLength &&
+        (memcmp(head + xing, "Xing", 4) == 0 || memcmp(head + xing, "Info", 4) == 0) &&
+        (be32(head + xing + 4) & 0x01)) {
+        frames = be32(head + xing + 8);
+    } else if (36 + 18 <= headLength && memcmp(head + 36, "VBRI", 4) == 0) {
+        frames = be32(head + 36 + 14);
+    }
+    if (frames > 0) {
+        return (uint32_t)((uint64_t)frames * frame.samples * 1000 / frame.sampleRate);
+    }
+
+    // No header: walk the frames. Sizes that stay within the padding byte
+    // mean CBR, and the rest of the file is more of the same.
+    uint64_t samples = 0;
+    uint32_t count = 0;
+    uint16_t minLength = UINT16_MAX;
+    uint16_t maxLength = 0;
+    uint32_t bufStart = 0;
+    length = 0;
+    for (uint32_t pos = first; pos + 4 <= end;) {
+        if (pos < bufStart || pos + 4 > bufStart + length) {
+            size_t want = end - pos < sizeof(buf) ? end - pos : sizeof(buf);
+            if (!file.seek(pos)) break;
+            length = file.read(buf, want);
+            bufStart = pos;
+            if (length < 4) break;
+        }
+
+        MpegFrame f;
+        if (!MpegFrame::parse(buf + (pos - bufStart), f)) break;
+        count++;
+        samples += f.samples;
+        if (f.length < minLength) minLength = f.length;
+        if (f.length > maxLength) maxLength = f.length;
+        pos += f.length;
+
+        if (count == CBR_PROBE_FRAMES && maxLength - minLength <= 1) {
+            uint64_t total = ((uint64_t)(end - first) * count + (pos - first) / 2) / (pos - first);
+            return (uint32_t)(total * frame.samples * 1000 / frame.sampleRate);
+        }
+    }
+    return (uint32_t)(samples * 1000 / frame.sampleRate);
+}
+
+void TagReader::readWav(File& file, TrackTags& out) {
+    uint32_t size = file.size();
+    uint32_t byteRate = 0;
+    uint32_t dataBytes = 0;
+    uint32_t pos = 12;
+
+    for (int chunk = 0; chunk < WAV_MAX_CHUNKS && pos + 8 <= size; chunk++) {
+        uint8_t header[8];
+        if (!file.seek(pos) || file.read(header, 8) != 8) break;
+        uint32_t length = le32(header + 4);
+        uint32_t body = pos + 8;
+
+        if (memcmp(header, "fmt ", 4) == 0) {
+            uint8_t fmt[16];
+            if (length >= 16 && file.read(fmt, 16) == 16) byteRate = le32(fmt + 8);
+        } else if (memcmp(header, "data", 4) == 0) {
+            // Unpatched sizes (0 or too large) run to the end of the file.
+            dataBytes = length == 0 || length > size - body ? size - body : length;
+            length = dataBytes;
+        } else if (memcmp(header, "LIST", 4) == 0) {
+            uint8_t type[4];
+            if (length >= 4 && file.read(type, 4) == 4 && memcmp(type, "INFO", 4) == 0) {
+                uint32_t end = length > size - body ? size : body + length;
+                uint32_t at = body + 4;
+                for (int item = 0; item < WAV_MAX_INFO_ITEMS && at <= end && end - at >= 8; item++) {
+                    uint8_t sub[8];
+                    if (!file.seek(at) || file.read(sub, 8) != 8) break;
+                    uint32_t subLength = le32(sub + 4);
+                    char* target = memcmp(sub, "INAM", 4) == 0 ? out.title
+                                 : memcmp(sub, "IART", 4) == 0 ? out.artist
+                                 : memcmp(sub, "IPRD", 4) == 0 ? out.album : nullptr;
+                    if (target != nullptr && target[0] == '\0') {
+                        uint8_t text[TEXT_READ_MAX];
+                        size_t n = subLength < sizeof(text) ? subLength : sizeof(text);
+                        if (file.read(text, n) == n) decodeText(UTF8, text, n, target);
+                    }
+                    uint64_t next = (uint64_t)at + 8 + subLength + (subLength & 1);
+                    if (next > end) break;
+                    at = (uint32_t)next;
+                }
+            }
+        } else if (memcmp(header, "id3 ", 4) == 0 || memcmp(header, "ID3 ", 4) == 0) {
+            readId3v2(file, body, out);
+        }
+
+        if (length > size - body) break;
+        pos = body + length + (length & 1);
+    }
+
+    if (byteRate > 0) out.durationMs = (uint32_t)((uint64_t)dataBytes * 1000 / byteRate);
+}
@@ -0,0 +1,48 @@
+// ============================================================================
+// TagReader.h
+// Title, artist, album and duration of one file, for the metadata index.
+//
+//   MP3: ID3v2.2/2.3/2.4 text frames, then ID3v1 for whatever is missing.
+//        Duration from a Xing/Info or VBRI header; without one, the first
+//        frames are walked, and a file whose frame sizes vary (VBR) is
+//        scanned to the end.
+//   WAV: fmt and data chunks for the duration; LIST/INFO (INAM, IART,
+//        IPRD) or an embedded "id3 " chunk for the text.
+//
+// Text comes out as UTF-8 whatever the tag's encoding, cut on a character
+// boundary to META_TEXT_MAX bytes.
+// ============================================================================
+#ifndef TAG_READER_H
+#define TAG_READER_H
+
+#include <Arduino.h>
+#include <FS.h>
+
+static constexpr size_t META_TEXT_MAX = 95;
+
+// Frames walked before a file with steady frame sizes is taken as CBR.
+static constexpr uint32_t CBR_PROBE_FRAMES = 64;
+
+struct TrackTags {
+    char title[META_TEXT_MAX + 1];
+    char artist[META_TEXT_MAX + 1];
+    char album[META_TEXT_MAX + 1];
+    uint32_t durationMs;    // 0 if unknown
+};
+
+class TagReader {
+public:
+    // False only if the file cannot be opened; an untagged file reads as
+    // empty strings and whatever duration could be found.
+    static bool read(fs::FS& fs, const char* path, TrackTags& out);
+
+private:
+    static void readMp3(File& file, TrackTags& out);
+    static void readWav(File& file, TrackTags& out);
+    static void readId3v2(File& file, uint32_t start, TrackTags& out);
+    // True if the file ends in an ID3v1 tag (128 bytes).
+    static bool readId3v1(File& file, TrackTags& out);
+    static uint32_t mp3Duration(File& file, uint32_t start, uint32_t end);
+};
+
+#endif // TAG_READER_H
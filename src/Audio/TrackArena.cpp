@@ -0,0 +1,125 @@
+// ============================================================================
+// TrackArena.cpp
+// ============================================================================
+#include "TrackArena.h"
+
+static const size_t INITIAL_STRING_CAPACITY = 4096;
+static const int INITIAL_SLOT_CAPACITY = 64;
+
+TrackArena::TrackArena()
+    : _strings(nullptr), _stringSize(0), _stringCapacity(0),
+      _slots(nullptr), _count(0), _slotCapacity(0),
+      _psram(false) {
+}
+
+TrackArena::~TrackArena() {
+    release();
+}
+
+void* TrackArena::reallocate(void* ptr, size_t size) {
+    if (_psram) {
+        void* p = ps_realloc(ptr, size);
+        if (p != nullptr) return p;
+        // PSRAM full or absent: fall back to internal RAM.
+    }
+    return realloc(ptr, size);
+}
+
+bool TrackArena::growStrings(size_t needed) {
+    if (needed <= _stringCapacity) return true;
+
+    size_t capacity = _stringCapacity ? _stringCapacity : INITIAL_STRING_CAPACITY;
+    while (capacity < needed) capacity *= 2;
+
+    char* p = (char*)reallocate(_strings, capacity);
+    if (p == nullptr) return false;
+    _strings = p;
+    _stringCapacity = capacity;
+    return true;
+}
+
+bool TrackArena::growSlots(int needed) {
+    if (needed <= _slotCapacity) return true;
+
+    int capacity = _slotCapacity ? _slotCapacity : INITIAL_SLOT_CAPACITY;
+    while (capacity < needed) capacity *= 2;
+
+    Slot* p = (Slot*)reallocate(_slots, capacity * sizeof(Slot));
+    if (p == nullptr) return false;
+    _slots = p;
+    _slotCapacity = capacity;
+    return true;
+}
+
+bool TrackArena::add(const char* path, const TrackInfo& info) {
+    size_t len = strlen(path) + 1;
+    if (!growStrings(_stringSize + len) || !growSlots(_count + 1)) {
+        return false;
+    }
+
+    memcpy(_strings + _stringSize, path, len);
+    _slots[_count].pathOffset = (uint32_t)_stringSize;
+    _slots[_count].info = info;
+    locateTitle(_slots[_count]);
+    _stringSize += len;
+    _count++;
+    return true;
+}
+
+char* TrackArena::prepare(int count, size_t stringBytes) {
+    clear();
+    if (count < 0 || !growStrings(stringBytes) || !growSlots(count)) {
+        return nullptr;
+    }
+    _stringSize = stringBytes;
+    _count = count;
+    return _strings;
+}
+
+void TrackArena::setTrack(int index, uint32_t pathOffset, const TrackInfo& info) {
+    _slots[index].pathOffset = pathOffset;
+    _slots[index].info = info;
+}
+
+void TrackArena::finishLoad() {
+    for (int i = 0; i < _count; i++) {
+        locateTitle(_slots[i]);
+    }
+}
+
+void TrackArena::locateTitle(Slot& slot) {
+    const char* path = _strings + slot.pathOffset;
+    const char* slash = strrchr(path, '/');
+    const char* name = slash ? slash + 1 : path;
+    const char* dot = strrchr(name, '.');
+
+    size_t length = (dot && dot > name) ? (size_t)(dot - name) : strlen(name);
+    size_t offset = name - path;
+    if (offset > UINT16_MAX) offset = UINT16_MAX;
+    if (length > UINT16_MAX - offset) length = UINT16_MAX - offset;
+
+    slot.titleOffset = (uint16_t)offset;
+    slot.titleLength = (uint16_t)length;
+}
+
+size_t TrackArena::bytesUsed() const {
+    return _stringSize + _count * sizeof(Slot);
+}
+
+size_t TrackArena::bytesReserved() const {
+    return _stringCapacity + _slotCapacity * sizeof(Slot);
+}
+
+void TrackArena::clear() {
+    _stringSize = 0;
+    _count = 0;
+}
+
+void TrackArena::release() {
+    free(_strings);
+    free(_slots);
+    _strings = nullptr;
+    _slots = nullptr;
+    _stringSize = _stringCapacity = 0;
+    _count = _slotCapacity = 0;
+}
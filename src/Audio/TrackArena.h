@@ -0,0 +1,129 @@
+// ============================================================================
+// TrackArena.h
+// Playlist storage: every path lives in one contiguous, growable string
+// buffer, and a parallel table holds each track's offset and file facts.
+// Two allocations in total, however many tracks, instead of one heap block
+// per path. Both buffers go to PSRAM when it is present and enabled.
+// ============================================================================
+#ifndef TRACK_ARENA_H
+#define TRACK_ARENA_H
+
+#include <Arduino.h>
+#include <string_view>
+
+// Place playlist storage in PSRAM when the board has it.
+#ifndef PLAYLIST_USE_PSRAM
+#define PLAYLIST_USE_PSRAM 1
+#endif
+
+// Per-track file facts kept alongside the path and persisted in the index.
+// Durations live in the metadata index, see MetadataIndex.h.
+struct TrackInfo {
+    uint32_t size;
+    uint32_t mtime;
+};
+
+class TrackArena;
+
+// Forward range over display titles. Each title is a view into the stored
+// path, so walking the whole playlist allocates nothing.
+class TrackTitles {
+public:
+    class Iterator {
+    public:
+        Iterator(const TrackArena* arena, int index) : _arena(arena), _index(index) {}
+        std::string_view operator*() const;
+        Iterator& operator++() { _index++; return *this; }
+        bool operator!=(const Iterator& other) const { return _index != other._index; }
+        int index() const { return _index; }
+
+    private:
+        const TrackArena* _arena;
+        int _index;
+    };
+
+    TrackTitles(const TrackArena* arena, int first, int last) : _arena(arena), _first(first), _last(last) {}
+
+    Iterator begin() const { return Iterator(_arena, _first); }
+    Iterator end() const { return Iterator(_arena, _last); }
+    int size() const { return _last - _first; }
+
+private:
+    const TrackArena* _arena;
+    int _first;
+    int _last;
+};
+
+class TrackArena {
+public:
+    TrackArena();
+    ~TrackArena();
+
+    void usePSRAM(bool enable) { _psram = enable; }
+    bool inPSRAM() const { return _psram; }
+
+    // Appends a track. Returns false if memory could not be grown.
+    // Pointers from path() are invalidated by add() and prepare().
+    bool add(const char* path, const TrackInfo& info);
+
+    // Bulk load: sizes the arena for exactly `count` tracks and `stringBytes`
+    // of path data and returns the string buffer for the caller to fill,
+    // followed by setTrack() for every index and finishLoad() once the
+    // strings are in place. Returns nullptr on failure.
+    char* prepare(int count, size_t stringBytes);
+    void setTrack(int index, uint32_t pathOffset, const TrackInfo& info);
+    void finishLoad();
+
+    int count() const { return _count; }
+    const char* path(int index) const { return _strings + _slots[index].pathOffset; }
+    uint32_t pathOffset(int index) const { return _slots[index].pathOffset; }
+    std::string_view title(int index) const {
+        const Slot& slot = _slots[index];
+        return std::string_view(_strings + slot.pathOffset + slot.titleOffset, slot.titleLength);
+    }
+    TrackTitles titles() const { return TrackTitles(this, 0, _count); }
+    TrackTitles titles(int first, int last) const { return TrackTitles(this, first, last); }
+    const TrackInfo& info(int index) const { return _slots[index].info; }
+    TrackInfo& info(int index) { return _slots[index].info; }
+
+    const char* stringData() const { return _strings; }
+    size_t stringBytes() const { return _stringSize; }
+
+    // Bytes holding live data vs. bytes currently allocated.
+    size_t bytesUsed() const;
+    size_t bytesReserved() const;
+
+    void clear();     // Drops all tracks, keeps the buffers for reuse
+    void release();   // Drops all tracks and frees the buffers
+
+private:
+    // The title is the file name without folders or extension, located
+    // once when the track is added.
+    struct Slot {
+        uint32_t pathOffset;
+        uint16_t titleOffset;
+        uint16_t titleLength;
+        TrackInfo info;
+    };
+
+    char* _strings;
+    size_t _stringSize;
+    size_t _stringCapacity;
+
+    Slot* _slots;
+    int _count;
+    int _slotCapacity;
+
+    bool _psram;
+
+    void locateTitle(Slot& slot);
+    bool growStrings(size_t needed);
+    bool growSlots(int needed);
+    void* reallocate(void* ptr, size_t size);
+};
+
+inline std::string_view TrackTitles::Iterator::operator*() const {
+    return _arena->title(_index);
+}
+
+#endif
@@ -0,0 +1,68 @@
+// ============================================================================
+// TrackPrefetch.cpp
+// ============================================================================
+#include "TrackPrefetch.h"
+
+TrackPrefetch::TrackPrefetch()
+    : _index(-1), _valid(false), _sampleRate(0), _channels(0),
+      _audioOffset(0), _prepareMicros(0) {
+}
+
+bool TrackPrefetch::prepare(fs::FS& fs, int index, const char* path) {
+    uint32_t start = micros();
+
+    _index = index;
+    _valid = false;
+    _sampleRate = 0;
+    _channels = 0;
+    _audioOffset = 0;
+
+    File file = fs.open(path);
+    if (!file || file.isDirectory()) {
+        Serial.printf("WARNING: Prefetch could not open %s\n", path);
+        return false;
+    }
+
+    size_t length = file.read(_head, sizeof(_head));
+
+    // Skip an ID3v2 tag (often large with cover art) so what we hold is the
+    // first audio the decoder will need.
+    _audioOffset = id3v2TagSize(_head, length);
+    if (_audioOffset >= length) {
+        length = file.seek(_audioOffset) ? file.read(_head, sizeof(_head)) : 0;
+    } else if (_audioOffset > 0) {
+        memmove(_head, _head + _audioOffset, length - _audioOffset);
+        length -= _audioOffset;
+    }
+    file.close();
+
+    if (length == 0) {
+        Serial.printf("WARNING: Prefetch read nothing from %s\n", path);
+        return false;
+    }
+
+    parseFormat(length);
+    _valid = true;
+    _prepareMicros = micros() - start;
+    return true;
+}
+
+void TrackPrefetch::parseFormat(size_t length) {
+    // Canonical WAV: fmt chunk right after the RIFF header.
+    if (length >= 36 && memcmp(_head, "RIFF", 4) == 0 && memcmp(_head + 8, "WAVE", 4) == 0) {
+        _channels = _head[22];
+        _sampleRate = (uint32_t)_head[24] | ((uint32_t)_head[25] << 8) |
+                      ((uint32_t)_head[26] << 16) | ((uint32_t)_head[27] << 24);
+        return;
+    }
+
+    // MPEG audio: first frame sync in the buffer.
+    for (size_t i = 0; i + 4 <= length; i++) {
+        MpegFrame frame;
+        if (MpegFrame::parse(_head + i, frame)) {
+            _sampleRate = frame.sampleRate;
+            _channels = frame.channels;
+            return;
+        }
+    }
+}
@@ -0,0 +1,51 @@
+// ============================================================================
+// TrackPrefetch.h
+// Opens the upcoming track during the tail of the current one and reads its
+// first bytes, so the card, the FAT chain and the directory entry are warm
+// when the decoder switches over, and a missing or unreadable file is known
+// before the gap instead of after it. The stream format is parsed from the
+// same bytes so a sample-rate change at the boundary can be detected.
+// ============================================================================
+#ifndef TRACK_PREFETCH_H
+#define TRACK_PREFETCH_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include "FrameSeekTable.h"
+
+// How long before the end of a track the next one is prefetched.
+static constexpr uint32_t PREFETCH_LEAD_SECONDS = 3;
+
+// Bytes read from the head of the next file (after any ID3v2 tag).
+static constexpr size_t PREFETCH_BYTES = 4096;
+
+class TrackPrefetch {
+public:
+    TrackPrefetch();
+
+    // Reads the head of `path`. Returns false if it cannot be opened or read.
+    bool prepare(fs::FS& fs, int index, const char* path);
+    void reset() { _index = -1; }
+
+    bool isPrepared(int index) const { return _index >= 0 && _index == index; }
+    bool isValid() const { return _valid; }
+
+    // 0 / 0 when the format was not recognised.
+    uint32_t sampleRate() const { return _sampleRate; }
+    uint8_t channels() const { return _channels; }
+    uint32_t audioOffset() const { return _audioOffset; }
+    uint32_t prepareMicros() const { return _prepareMicros; }
+
+private:
+    int _index;
+    bool _valid;
+    uint32_t _sampleRate;
+    uint8_t _channels;
+    uint32_t _audioOffset;
+    uint32_t _prepareMicros;
+    uint8_t _head[PREFETCH_BYTES];
+
+    void parseFormat(size_t length);
+};
+
+#endif
@@ -0,0 +1,202 @@
+// ============================================================================
+// WavReader.cpp
+// ============================================================================
+#include "WavReader.h"
+#include <string.h>
+
+static constexpr uint16_t WAVE_FORMAT_PCM = 0x0001;
+static constexpr uint16_t WAVE_FORMAT_EXTENSIBLE = 0xFFFE;
+
+// Bounds the chunk walk on a corrupt file.
+static constexpr int WAV_MAX_CHUNKS = 16;
+
+static uint16_t le16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t le32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// ----------------------------------------------------------------------------
+// Kernels. Word-at-a-time (four bytes in, four bytes out per step) rather
+// than per sample; the 24-bit ones take the top 16 bits of each sample.
+// Both the CPU and the PCM are little-endian. A source that is no wider
+// than its output may sit at the tail of the destination: every step reads
+// its input before it writes, and never writes past input it has not read.
+// ----------------------------------------------------------------------------
+static void widenMono16(const uint8_t* src, int16_t* out, size_t frames) {
+    uint32_t* dst = (uint32_t*)out;
+    size_t i = 0;
+    for (; i + 2 <= frames; i += 2) {
+        uint32_t pair;
+        memcpy(&pair, src + i * 2, 4);
+        uint32_t a = pair & 0xFFFF;
+        uint32_t b = pair >> 16;
+        dst[i] = a | (a << 16);
+        dst[i + 1] = b | (b << 16);
+    }
+    for (; i < frames; i++) {
+        uint32_t s = le16(src + i * 2);
+        dst[i] = s | (s << 16);
+    }
+}
+
+static void narrowMono24(const uint8_t* src, int16_t* out, size_t frames) {
+    uint32_t* dst = (uint32_t*)out;
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        uint32_t w[3];
+        memcpy(w, src + i * 3, 12);
+        uint32_t a = (w[0] >> 8) & 0xFFFF;
+        uint32_t b = w[1] & 0xFFFF;
+        uint32_t c = (w[1] >> 24) | ((w[2] & 0xFF) << 8);
+        uint32_t d = w[2] >> 16;
+        dst[i] = a | (a << 16);
+        dst[i + 1] = b | (b << 16);
+        dst[i + 2] = c | (c << 16);
+        dst[i + 3] = d | (d << 16);
+    }
+    for (; i < frames; i++) {
+        uint32_t s = le16(src + i * 3 + 1);
+        dst[i] = s | (s << 16);
+    }
+}
+
+static void narrowStereo24(const uint8_t* src, int16_t* out, size_t frames) {
+    uint32_t* dst = (uint32_t*)out;
+    size_t i = 0;
+    for (; i + 2 <= frames; i += 2) {
+        uint32_t w[3];
+        memcpy(w, src + i * 6, 12);
+        uint32_t l0 = (w[0] >> 8) & 0xFFFF;
+        uint32_t r0 = w[1] & 0xFFFF;
+        uint32_t l1 = (w[1] >> 24) | ((w[2] & 0xFF) << 8);
+        uint32_t r1 = w[2] >> 16;
+        dst[i] = l0 | (r0 << 16);
+        dst[i + 1] = l1 | (r1 << 16);
+    }
+    for (; i < frames; i++) {
+        dst[i] = (uint32_t)le16(src + i * 6 + 1) | ((uint32_t)le16(src + i * 6 + 4) << 16);
+    }
+}
+
+WavReader::WavReader() : _open(false), _format{}, _position(0) {
+}
+
+bool WavReader::isWavPath(const char* path) {
+    size_t len = strlen(path);
+    return len >= 4 && strcasecmp(path + len - 4, ".wav") == 0;
+}
+
+bool WavReader::parse(SDReadAhead& file, WavFormat& format) {
+    uint8_t riff[12];
+    if (file.read(riff, sizeof(riff)) != sizeof(riff) ||
+        memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+
+    bool haveFormat = false;
+    uint16_t tag = 0;
+    uint32_t pos = sizeof(riff);
+    for (int chunk = 0; chunk < WAV_MAX_CHUNKS; chunk++) {
+        uint8_t header[8];
+        if (file.read(header, sizeof(header)) != sizeof(header)) return false;
+        uint32_t size = le32(header + 4);
+        pos += sizeof(header);
+
+        if (memcmp(header, "fmt ", 4) == 0) {
+            uint8_t fmt[40];
+            size_t n = size < sizeof(fmt) ? size : sizeof(fmt);
+            if (size < 16 || file.read(fmt, n) != n) return false;
+            tag = le16(fmt);
+            if (tag == WAVE_FORMAT_EXTENSIBLE && n >= 26) tag = le16(fmt + 24);
+            format.channels = le16(fmt + 2);
+            format.sampleRate = le32(fmt + 4);
+            format.frameBytes = le16(fmt + 12);
+            format.bitsPerSample = le16(fmt + 14);
+            haveFormat = true;
+        } else if (memcmp(header, "data", 4) == 0) {
+            if (!haveFormat || tag != WAVE_FORMAT_PCM) return false;
+            if (format.channels < 1 || format.channels > 2) return false;
+            if (format.bitsPerSample != 16 && format.bitsPerSample != 24) return false;
+            if (format.frameBytes != format.channels * format.bitsPerSample / 8) return false;
+            if (format.sampleRate == 0) return false;
+
+            // Writers that never went back to patch the size leave it at 0
+            // or 0xFFFFFFFF; the file end bounds it either way.
+            uint32_t available = file.size() > pos ? (uint32_t)(file.size() - pos) : 0;
+            if (size == 0 || size > available) size = available;
+            format.dataOffset = pos;
+            format.dataBytes = size - size % format.frameBytes;
+            return true;
+        }
+
+        // Chunks are padded to an even length.
+        pos += size + (size & 1);
+        if (!file.seek(pos)) return false;
+    }
+    return false;
+}
+
+bool WavReader::open(fs::FS& fs, const char* path, uint64_t startFrame) {
+    close();
+    if (!_source.open(fs, path)) return false;
+    if (!parse(_source, _format)) {
+        _source.close();
+        return false;
+    }
+    _open = true;
+    if (!seek(startFrame)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void WavReader::close() {
+    if (_open) _source.close();
+    _open = false;
+    _position = 0;
+}
+
+bool WavReader::seek(uint64_t frame) {
+    if (!_open) return false;
+    if (frame > totalFrames()) frame = totalFrames();
+    if (!_source.seek(_format.dataOffset + (size_t)(frame * _format.frameBytes))) return false;
+    _position = frame;
+    return true;
+}
+
+size_t WavReader::read(int16_t* out, size_t frames) {
+    if (!_open) return 0;
+    uint64_t left = totalFrames() - _position;
+    if (frames > left) frames = (size_t)left;
+    if (frames == 0) return 0;
+
+    size_t inBytes = frames * _format.frameBytes;
+    size_t outBytes = frames * 2 * sizeof(int16_t);
+
+    if (inBytes <= outBytes) {
+        // Read into the tail of the destination and widen forwards.
+        uint8_t* src = (uint8_t*)out + (outBytes - inBytes);
+        if (_source.read(src, inBytes) != inBytes) return 0;
+        if (_format.channels == 1) {
+            if (_format.bitsPerSample == 16) {
+                widenMono16(src, out, frames);
+            } else {
+                narrowMono24(src, out, frames);
+            }
+        }
+    } else {
+        for (size_t done = 0; done < frames;) {
+            size_t n = frames - done < WAV_SCRATCH_FRAMES ? frames - done : WAV_SCRATCH_FRAMES;
+            if (_source.read(_scratch, n * 6) != n * 6) return 0;
+            narrowStereo24(_scratch, out + done * 2, n);
+            done += n;
+        }
+    }
+
+    _position += frames;
+    return frames;
+}
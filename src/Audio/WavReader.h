@@ -0,0 +1,66 @@
+// ============================================================================
+// WavReader.h
+// PCM WAV straight from the card into the output ring, bypassing the
+// general decoder. The RIFF chunks are walked once at open(); after that
+// every read() copies out of the SD read-ahead buffers into the caller's
+// buffer (the ring's free run) and is widened there to 16-bit stereo, so
+// mono or 24-bit data is converted in the same single pass.
+// ============================================================================
+#ifndef WAV_READER_H
+#define WAV_READER_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include "SDReadAhead.h"
+
+// 24-bit stereo is wider on the card than in the ring, so it alone goes
+// through a bounce buffer of this many frames.
+static constexpr size_t WAV_SCRATCH_FRAMES = 256;
+
+struct WavFormat {
+    uint32_t sampleRate;
+    uint16_t channels;      // 1 or 2
+    uint16_t bitsPerSample; // 16 or 24
+    uint16_t frameBytes;    // Block align
+    uint32_t dataOffset;    // First PCM byte in the file
+    uint32_t dataBytes;
+};
+
+class WavReader {
+public:
+    WavReader();
+
+    // Starts the read-ahead task; without it reads are synchronous.
+    bool begin() { return _source.begin(); }
+
+    static bool isWavPath(const char* path);
+
+    // Walks the chunks up to "data". False for anything but 16/24-bit
+    // mono or stereo integer PCM, which the general decoder keeps.
+    static bool parse(SDReadAhead& file, WavFormat& format);
+
+    bool open(fs::FS& fs, const char* path, uint64_t startFrame = 0);
+    void close();
+    bool isOpen() const { return _open; }
+
+    const WavFormat& format() const { return _format; }
+    uint64_t totalFrames() const { return _format.dataBytes / _format.frameBytes; }
+    uint64_t position() const { return _position; }
+    bool atEnd() const { return _position >= totalFrames(); }
+    bool seek(uint64_t frame);
+
+    // Fills up to `frames` interleaved 16-bit stereo frames at `out`.
+    // Returns 0 at the end of the data or on a read error.
+    size_t read(int16_t* out, size_t frames);
+
+    SDReadStats getReadStats() const { return _source.getStats(); }
+
+private:
+    SDReadAhead _source;
+    bool _open;
+    WavFormat _format;
+    uint64_t _position;     // Frames
+    uint8_t _scratch[WAV_SCRATCH_FRAMES * 6];
+};
+
+#endif // WAV_READER_H
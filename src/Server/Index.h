@@ -84,7 +84,7 @@ const char index_html[] PROGMEM = R"rawliteral(
     }
   </style>
 </head>
-<body onload="fetchPlaylist()">
+<body onload="fetchPlaylist(); fetchSavedPlaylists(); fetchLibraryStatus()">
   <h1><img src="https://media3.giphy.com/media/v1.Y2lkPTc5MGI3NjExMm41ODg0aHp0cmZnMjVhNnJreHd2ZGUyNnkwbnpidGR1dTd3N3F2NyZlcD12MV9pbnRlcm5hbF9naWZfYnlfaWQmY3Q9cw/IBAFn2cP42zkCYLL5F/giphy.gif" alt="Music Note" style="width: 40px; height: 40px; vertical-align: middle; image-rendering: pixelated;" /> MUSIC BOX <img src="https://media3.giphy.com/media/v1.Y2lkPTc5MGI3NjExMm41ODg0aHp0cmZnMjVhNnJreHd2ZGUyNnkwbnpidGR1dTd3N3F2NyZlcD12MV9pbnRlcm5hbF9naWZfYnlfaWQmY3Q9cw/IBAFn2cP42zkCYLL5F/giphy.gif" alt="Music Note" style="width: 40px; height: 40px; vertical-align: middle; image-rendering: pixelated;" /></h1>
   <img src="https://media1.giphy.com/media/v1.Y2lkPTc5MGI3NjExOWE5N2tnYTdpejNhZTBuaTY1OWVsZWpkcDYzbDQ0NnY4aTA1a2x0cyZlcD12MV9pbnRlcm5hbF9naWZfYnlfaWQmY3Q9cw/cE4hYhquh5YnkAWysd/giphy.gif" alt="Dancing Santa" style="margin-bottom:10px; image-rendering: pixelated;" />
   <div class="container">
@@ -96,11 +96,32 @@ const char index_html[] PROGMEM = R"rawliteral(
     <button id="playPauseBtn" onclick="togglePlayPause()">▶ t</button>
     <button onclick="next()">⏭ NEXT</button>
     </div>
+    <div style="display:flex; flex-wrap:wrap; justify-content:center;">
+    <button id="shuffleBtn" onclick="toggleShuffle()">🔀 SHUFFLE OFF</button>
+    <button id="repeatBtn" onclick="cycleRepeat()">🔁 REPEAT ALL</button>
+    </div>
+    <div style="margin-top:10px; color:yellow;">
+      ⏱ <span id="elapsed">0:00</span> / <span id="duration">0:00</span>
+      <span id="bitrate" style="color:cyan;"></span><br>
+      <progress id="progress" max="1" value="0" style="width:60%;"></progress>
+    </div>
     <div style="margin-top:10px; color:cyan;">
       🔊 Volume: <span id="volume-display">100</span>%<br>
       <input id="volume-slider" type="range" min="0" max="100" oninput="updateVolume(this.value)" style="width:60%;">
     </div>
-   <div class="playlist">
+    <div id="scan-status" style="margin-top:10px; color:orange; display:none;"></div>
+    <div style="margin-top:10px;">
+      <input id="search" type="search" placeholder="🔍 Search songs, artists, albums" oninput="searchTracks(this.value)" style="width:80%;">
+    </div>
+    <div style="margin-top:10px; color:lime;">
+      📼 <select id="playlist-picker"></select>
+      <button onclick="savedPlaylistAction('play')">▶</button>
+      <button onclick="savedPlaylistAction('queue')">➕</button>
+      <button onclick="savedPlaylistAction('delete')">🗑</button><br>
+      ⏭ Up next: <span id="queue-length">0</span> <button onclick="clearQueue()">CLEAR</button>
+    </div>
+    <div id="search-results" class="playlist" style="display:none;"></div>
+   <div id="playlist" class="playlist">
       <strong>🎶 PLAYLIST 🎶</strong>
     </div>
   </div>
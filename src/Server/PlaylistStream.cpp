@@ -0,0 +1,124 @@
+#include "PlaylistStream.h"
+
+PlaylistJsonStream::PlaylistJsonStream(TrackTitles page, int total, int offset, uint32_t version,
+                                       const MetadataIndex* metadata)
+    : _page(page), _it(page.begin()), _total(total), _offset(offset), _version(version), _metadata(metadata) {
+}
+
+void PlaylistJsonStream::setPending(const char* text) {
+    _pendingLen = strlen(text);
+    memcpy(_pending, text, _pendingLen);
+    _pendingPos = 0;
+}
+
+void PlaylistJsonStream::setPendingEscape(char c) {
+    switch (c) {
+        case '"':  setPending("\\\""); break;
+        case '\\': setPending("\\\\"); break;
+        case '\n': setPending("\\n"); break;
+        case '\r': setPending("\\r"); break;
+        case '\t': setPending("\\t"); break;
+        default:
+            _pendingLen = snprintf(_pending, sizeof(_pending), "\\u%04x", (unsigned)(uint8_t)c);
+            _pendingPos = 0;
+            break;
+    }
+}
+
+static inline bool needsEscape(char c) {
+    return c == '"' || c == '\\' || (uint8_t)c < 0x20;
+}
+
+size_t PlaylistJsonStream::fill(uint8_t* buffer, size_t maxLen) {
+    uint8_t* out = buffer;
+    uint8_t* end = buffer + maxLen;
+
+    while (out < end) {
+        if (_pendingPos < _pendingLen) {
+            size_t n = _pendingLen - _pendingPos;
+            if (n > (size_t)(end - out)) n = end - out;
+            memcpy(out, _pending + _pendingPos, n);
+            out += n;
+            _pendingPos += n;
+            continue;
+        }
+
+        switch (_stage) {
+            case HEADER:
+                if (_metadata != nullptr) {
+                    _pendingLen = snprintf(_pending, sizeof(_pending),
+                                           "{\"total\":%d,\"offset\":%d,\"count\":%d,\"version\":%u,\"indexed\":%d,"
+                                           "\"playlist\":[",
+                                           _total, _offset, _page.size(), (unsigned)_version,
+                                           _metadata->indexedCount());
+                } else {
+                    _pendingLen = snprintf(_pending, sizeof(_pending),
+                                           "{\"total\":%d,\"offset\":%d,\"count\":%d,\"version\":%u,\"playlist\":[",
+                                           _total, _offset, _page.size(), (unsigned)_version);
+                }
+                _pendingPos = 0;
+                _stage = ITEM_START;
+                break;
+
+            case ITEM_START:
+                if (!(_it != _page.end())) {
+                    _stage = FOOTER;
+                    break;
+                }
+                _text = *_it;
+                _textPos = 0;
+                if (_metadata != nullptr) {
+                    _meta = _metadata->get(_it.index());
+                    if (_meta != nullptr && _meta->title[0] != '\0') _text = _meta->title;
+                    _field = 0;
+                    setPending(_first ? "{\"title\":\"" : ",{\"title\":\"");
+                } else {
+                    setPending(_first ? "\"" : ",\"");
+                }
+                _first = false;
+                _stage = ITEM_BODY;
+                break;
+
+            case ITEM_BODY:
+                // Copy runs of plain characters directly into the output.
+                while (_textPos < _text.size() && out < end && !needsEscape(_text[_textPos])) {
+                    *out++ = (uint8_t)_text[_textPos++];
+                }
+                if (_textPos < _text.size()) {
+                    if (out < end) setPendingEscape(_text[_textPos++]);
+                    break;
+                }
+
+                // String done: on to the next field, or the next item.
+                _textPos = 0;
+                _text = std::string_view();
+                if (_metadata == nullptr) {
+                    setPending("\"");
+                } else if (++_field == 1) {
+                    if (_meta != nullptr) _text = _meta->artist;
+                    setPending("\",\"artist\":\"");
+                    break;
+                } else if (_field == 2) {
+                    if (_meta != nullptr) _text = _meta->album;
+                    setPending("\",\"album\":\"");
+                    break;
+                } else {
+                    _pendingLen = snprintf(_pending, sizeof(_pending), "\",\"durationMs\":%u}",
+                                           _meta != nullptr ? (unsigned)_meta->durationMs : 0u);
+                    _pendingPos = 0;
+                }
+                ++_it;
+                _stage = ITEM_START;
+                break;
+
+            case FOOTER:
+                setPending("]}");
+                _stage = DONE;
+                break;
+
+            case DONE:
+                return out - buffer;
+        }
+    }
+    return out - buffer;
+}
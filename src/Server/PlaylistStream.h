@@ -0,0 +1,62 @@
+#ifndef PLAYLIST_STREAM_H
+#define PLAYLIST_STREAM_H
+
+#include <Arduino.h>
+#include <string_view>
+#include "Audio/TrackArena.h"
+#include "Audio/MetadataIndex.h"
+
+// Renders one page of the playlist as JSON, a buffer at a time:
+//
+//   {"total":N,"offset":O,"count":C,"version":V,"playlist":["title",...]}
+//
+// or, given the metadata index, one object per track:
+//
+//   {"total":N,"offset":O,"count":C,"version":V,"indexed":I,"playlist":[
+//     {"title":"...","artist":"...","album":"...","durationMs":D},...]}
+//
+// where V is the library version the indices belong to, which the
+// "playlist_changed" event moves on from.
+//
+// A track not indexed yet, or without a title tag, has its file name
+// as the title, empty artist and album and a durationMs of 0.
+//
+// fill() may be called with any buffer size and picks up exactly where the
+// previous call stopped, even in the middle of an escape sequence. Titles are
+// read straight from the playlist storage, so memory use does not depend on
+// the number or length of titles.
+class PlaylistJsonStream {
+public:
+    PlaylistJsonStream(TrackTitles page, int total, int offset, uint32_t version,
+                       const MetadataIndex* metadata = nullptr);
+
+    // Writes up to maxLen bytes and returns how many; 0 once complete.
+    size_t fill(uint8_t* buffer, size_t maxLen);
+
+private:
+    enum Stage { HEADER, ITEM_START, ITEM_BODY, FOOTER, DONE };
+
+    TrackTitles _page;
+    TrackTitles::Iterator _it;
+    int _total;
+    int _offset;
+    uint32_t _version;
+    const MetadataIndex* _metadata;
+    const TrackMeta* _meta = nullptr;
+
+    Stage _stage = HEADER;
+    std::string_view _text;     // String being copied out
+    size_t _textPos = 0;
+    int _field = 0;             // Of the current item, in metadata mode
+    bool _first = true;
+
+    // Small pieces (header, separators, escapes) that may straddle buffers.
+    char _pending[128];
+    size_t _pendingLen = 0;
+    size_t _pendingPos = 0;
+
+    void setPending(const char* text);
+    void setPendingEscape(char c);
+};
+
+#endif
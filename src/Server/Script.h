@@ -3,6 +3,16 @@
 
 const char script_js[] PROGMEM = R"rawliteral(
 
+let currentTrackIndex = -1;
+let isPlaying = false;
+let shuffle = false;
+let repeatMode = 'all';
+
+// The box reports position twice a second; in between, count locally.
+let positionMs = 0;
+let positionAt = performance.now();
+let durationMs = 0;
+
 const evtSource = new EventSource("http://santaBox.local/events");
 
 evtSource.onopen = () => {
@@ -12,8 +22,73 @@ evtSource.onopen = () => {
 evtSource.addEventListener("audio_state", e => {
     const state = JSON.parse(e.data);
     console.log("Current audio state:", state);
+    applyState(state);
+});
+
+// Library scans report progress a few times a second; what the scan
+// changed arrives as a playlist_changed event.
+evtSource.addEventListener("scan_progress", e => {
+    const scan = JSON.parse(e.data);
+    const status = document.getElementById('scan-status');
+    if (scan.scanning) {
+        const what = scan.phase === 'reading' ? 'Scanning card' : 'Checking card';
+        status.textContent = `💾 ${what}: ${scan.folders} folders, ${scan.files} files, ${scan.tracks} tracks`;
+        status.style.display = '';
+    } else {
+        status.style.display = 'none';
+    }
+});
+
+// The SD card was pulled or pushed in. Without one the list stays up but
+// nothing plays.
+evtSource.addEventListener("card", e => {
+    showCardStatus(JSON.parse(e.data).present);
+});
+
+// A library load says which runs of the list changed. A client holding the
+// previous version patches its list and fetches only the tracks added;
+// any other fetches the whole list again.
+evtSource.addEventListener("playlist_changed", e => {
+    const change = JSON.parse(e.data);
+    if (change.full || change.previousVersion !== playlistVersion || playlistLoading || playlistLoaded === 0) {
+        fetchPlaylist();
+    } else {
+        change.edits.forEach(([at, removed, added]) => spliceTracks(at, removed, added, change.version));
+        playlistVersion = change.version;
+        playlistTotal = change.total;
+        renumberTracks();
+        updatePlaylistMore();
+        highlightTrack(currentTrackIndex);
+    }
+    // Queued tracks that left the card were dropped from the queue.
+    fetchQueueLength();
+    const query = document.getElementById('search').value;
+    if (query.trim() !== '') searchTracks(query);
+});
+
+function showCardStatus(present) {
+    const status = document.getElementById('scan-status');
+    if (present) {
+        status.style.display = 'none';
+    } else {
+        status.textContent = '💾 No SD card: insert one to play';
+        status.style.display = '';
+    }
+}
+
+function fetchLibraryStatus() {
+    fetch('/api/library')
+        .then(response => response.json())
+        .then(library => showCardStatus(library.card))
+        .catch(error => console.error('Failed to fetch library status:', error));
+}
 
+// State updates carry only the fields that changed.
+function applyState(state) {
     if (state.isPlaying !== undefined) {
+        // Re-base the local clock so it stops or starts from where it is
+        positionMs = currentPosition();
+        positionAt = performance.now();
         isPlaying = state.isPlaying;
         updatePlayPauseButton();
     }
@@ -23,9 +98,127 @@ evtSource.addEventListener("audio_state", e => {
     }
 
     if (state.trackIndex !== undefined) {
+        currentTrackIndex = state.trackIndex;
         highlightTrack(state.trackIndex);
+        // A track change may have taken one from the queue.
+        fetchQueueLength();
     }
-});
+
+    if (state.positionMs !== undefined) {
+        positionMs = state.positionMs;
+        positionAt = performance.now();
+    }
+
+    if (state.durationMs !== undefined) {
+        durationMs = state.durationMs;
+    }
+
+    if (state.bitrate !== undefined) {
+        document.getElementById('bitrate').textContent =
+            state.bitrate ? `(${Math.round(state.bitrate / 1000)} kbps)` : '';
+    }
+
+    if (state.shuffle !== undefined) {
+        shuffle = state.shuffle;
+        repeatMode = state.repeat;
+        updateModeButtons();
+    }
+
+    updateProgress();
+}
+
+// Binary control channel (layout in WsProtocol.h). Commands fall back to
+// the REST API whenever the socket is not open.
+const WS_OP = { play: 0x01, pause: 0x02, next: 0x03, previous: 0x04, seek: 0x05, volume: 0x06, select: 0x07,
+                shuffle: 0x08, repeat: 0x09 };
+const WS_OP_ACK = 0x80;
+const REPEAT_MODES = ['off', 'all', 'one'];
+const WS_OP_STATE = 0x81;
+let ws = null;
+let wsSeq = 0;
+
+function connectWebSocket() {
+    if (!('WebSocket' in window)) return;
+
+    const socket = new WebSocket(`ws://${location.host}/ws`);
+    socket.binaryType = 'arraybuffer';
+    socket.onopen = () => { ws = socket; };
+    socket.onclose = () => {
+        ws = null;
+        setTimeout(connectWebSocket, 2000);
+    };
+    socket.onmessage = e => {
+        if (!(e.data instanceof ArrayBuffer)) return;
+        const view = new DataView(e.data);
+        const op = view.getUint8(0);
+        if (op === WS_OP_STATE) {
+            applyState(decodeState(view));
+        } else if (op === WS_OP_ACK && view.getUint8(2) !== 0) {
+            console.warn('Command', view.getUint8(1), 'rejected with status', view.getUint8(2));
+        }
+    };
+}
+
+function decodeState(view) {
+    const mask = view.getUint8(1);
+    const state = {};
+    let at = 2;
+    if (mask & 0x01) { state.trackIndex = view.getInt32(at, true); at += 4; }
+    if (mask & 0x02) { state.isPlaying = view.getUint8(at) !== 0; at += 1; }
+    if (mask & 0x04) { state.volume = view.getUint8(at); at += 1; }
+    if (mask & 0x08) { state.positionMs = view.getUint32(at, true); at += 4; }
+    if (mask & 0x10) { state.durationMs = view.getUint32(at, true); at += 4; }
+    if (mask & 0x20) { state.bitrate = view.getUint32(at, true); at += 4; }
+    if (mask & 0x40) {
+        const mode = view.getUint8(at); at += 1;
+        state.shuffle = (mode & 0x01) !== 0;
+        state.repeat = REPEAT_MODES[(mode >> 1) & 0x03];
+    }
+    return state;
+}
+
+function wsSend(op, value) {
+    if (!ws || ws.readyState !== WebSocket.OPEN) return false;
+
+    const frame = new DataView(new ArrayBuffer(6));
+    wsSeq = (wsSeq + 1) & 0xFF;
+    frame.setUint8(0, op);
+    frame.setUint8(1, wsSeq);
+    frame.setInt32(2, value | 0, true);
+    ws.send(frame.buffer);
+    return true;
+}
+
+connectWebSocket();
+
+
+function formatTime(ms) {
+    const total = Math.floor(ms / 1000);
+    return `${Math.floor(total / 60)}:${String(total % 60).padStart(2, '0')}`;
+}
+
+function currentPosition() {
+    let position = positionMs;
+    if (isPlaying) {
+        position += performance.now() - positionAt;
+    }
+    if (durationMs > 0 && position > durationMs) {
+        position = durationMs;
+    }
+    return position;
+}
+
+function updateProgress() {
+    const position = currentPosition();
+
+    document.getElementById('elapsed').textContent = formatTime(position);
+    document.getElementById('duration').textContent = formatTime(durationMs);
+    const bar = document.getElementById('progress');
+    bar.max = durationMs > 0 ? durationMs : 1;
+    bar.value = durationMs > 0 ? position : 0;
+}
+
+setInterval(updateProgress, 250);
 
 function updateDisplayVolume(volumeValue) {
     document.getElementById('volume-slider').value = volumeValue
@@ -41,8 +234,8 @@ function highlightTrack(index) {
         track.style.color = '';
     });
 
-    if (index >= 0 && index < tracks.length) {
-        const currentTrack = tracks[index];
+    const currentTrack = document.querySelector(`.playlist .track-item[data-index="${index}"]`);
+    if (currentTrack) {
         // Apply the same highlight style as the hover effect for consistency
         currentTrack.style.backgroundColor = 'red'; 
         currentTrack.style.color = 'white';
@@ -52,6 +245,7 @@ function highlightTrack(index) {
     
 function updateVolume(value) {
     document.getElementById('volume-display').textContent = value;
+    if (wsSend(WS_OP.volume, value)) return;
     
     fetch('/api/volume', {
         method: 'POST',
@@ -64,6 +258,8 @@ function updateVolume(value) {
 }
 
 function sendControl(action) {
+    if (wsSend(WS_OP[action], 0)) return;
+
     fetch('/api/control', {
         method: 'POST',
         headers: {'Content-Type': 'application/x-www-form-urlencoded'},
@@ -111,15 +307,82 @@ function updatePlayPauseButton() {
     button.textContent = isPlaying ? '⏸ PAUSE' : '▶ PLAY';
 }
 
+// Shuffle and repeat take effect on the box; the buttons follow the state
+// it reports back.
+function sendMode(name, value) {
+    const code = name === 'repeat' ? REPEAT_MODES.indexOf(value) : (value ? 1 : 0);
+    if (wsSend(WS_OP[name], code)) return;
+
+    fetch('/api/mode', {
+        method: 'POST',
+        headers: {'Content-Type': 'application/x-www-form-urlencoded'},
+        body: name + '=' + (name === 'repeat' ? value : code)
+    })
+    .catch(error => console.error('Mode change failed:', error));
+}
+
+function toggleShuffle() {
+    sendMode('shuffle', !shuffle);
+}
+
+function cycleRepeat() {
+    sendMode('repeat', REPEAT_MODES[(REPEAT_MODES.indexOf(repeatMode) + 1) % REPEAT_MODES.length]);
+}
+
+function updateModeButtons() {
+    document.getElementById('shuffleBtn').textContent = shuffle ? '🔀 SHUFFLE ON' : '🔀 SHUFFLE OFF';
+    document.getElementById('repeatBtn').textContent =
+        { off: '➡ REPEAT OFF', all: '🔁 REPEAT ALL', one: '🔂 REPEAT ONE' }[repeatMode];
+}
+
+// The playlist is fetched a page at a time; the next page is requested when
+// the end of the list scrolls into view. Pages of a list that changed in
+// between (another version) start the fetch over.
+const PLAYLIST_PAGE_SIZE = 100;
+let playlistLoaded = 0;
+let playlistTotal = 0;
+let playlistVersion = 0;
+let playlistLoading = false;
+let playlistObserver = null;
+let playlistSeq = 0;
+
 function fetchPlaylist() {
     console.log('Requesting playlist from /api/playlist...');
-    const playlistContainer = document.querySelector('.playlist');
+    const playlistContainer = document.getElementById('playlist');
     
     // Clear the current list content while fetching
-    playlistContainer.innerHTML = '<strong>🎶 PLAYLIST 🎶</strong><div style="color:yellow;">Loading...</div>';
+    playlistContainer.innerHTML = '<strong>🎶 PLAYLIST 🎶</strong><div id="playlist-more" style="color:yellow;">Loading...</div>';
+    playlistLoaded = 0;
+    playlistTotal = 0;
+    playlistLoading = false;
+    playlistSeq++;
+
+    if (playlistObserver) {
+        playlistObserver.disconnect();
+    }
+    if ('IntersectionObserver' in window) {
+        playlistObserver = new IntersectionObserver(entries => {
+            if (entries.some(entry => entry.isIntersecting)) {
+                loadPlaylistPage();
+            }
+        });
+        playlistObserver.observe(document.getElementById('playlist-more'));
+    }
+
+    loadPlaylistPage();
+}
 
-    // Send HTTP GET request to the new endpoint
-    fetch('/api/playlist', { method: 'GET' })
+function loadPlaylistPage() {
+    if (playlistLoading || (playlistTotal > 0 && playlistLoaded >= playlistTotal)) {
+        return;
+    }
+    playlistLoading = true;
+
+    const seq = playlistSeq;
+    const playlistContainer = document.getElementById('playlist');
+    const more = document.getElementById('playlist-more');
+
+    fetch(`/api/playlist?offset=${playlistLoaded}&limit=${PLAYLIST_PAGE_SIZE}&meta=1`, { method: 'GET' })
         .then(response => {
             if (!response.ok) {
                 throw new Error(`HTTP error! status: ${response.status}`);
@@ -127,35 +390,258 @@ function fetchPlaylist() {
             return response.json();
         })
         .then(data => {
+            if (seq !== playlistSeq) return;
             // Check if the expected array is in the response
             const playlist = data.playlist;
             if (!Array.isArray(playlist)) {
                 throw new Error('Invalid playlist format received.');
             }
+            if (data.offset > 0 && data.version !== playlistVersion) {
+                fetchPlaylist();
+                return;
+            }
+
+            playlistTotal = data.total;
+            playlistVersion = data.version;
 
-            // Clear the container again before rendering
-            playlistContainer.innerHTML = '<strong>🎶 PLAYLIST 🎶</strong>';
-
-            playlist.forEach((title, index) => {
-                const div = document.createElement('div');
-                div.classList.add('track-item');
-                // Use index + 1 for display number
-                div.textContent = `${index + 1}. ${title}`;
-                
-                div.onclick = () => selectTrack(index); 
-                
-                playlistContainer.appendChild(div);
+            playlist.forEach((track, i) => {
+                playlistContainer.insertBefore(trackItem(data.offset + i, track), more);
             });
-            console.log(`Playlist loaded with ${playlist.length} tracks.`);
+            playlistLoaded = data.offset + playlist.length;
+
+            const done = updatePlaylistMore() || playlist.length === 0;
+            console.log(`Playlist loaded ${playlistLoaded} of ${playlistTotal} tracks.`);
+
+            playlistLoading = false;
+            // Without IntersectionObserver, just keep going until complete.
+            if (!done && !playlistObserver) {
+                loadPlaylistPage();
+            }
+            highlightTrack(currentTrackIndex);
         })
         .catch(error => {
+            if (seq !== playlistSeq) return;
+            playlistLoading = false;
             console.error('Failed to fetch playlist:', error);
-            playlistContainer.innerHTML = `<strong>🎶 PLAYLIST 🎶</strong><div style="color:red;">Error loading list.</div>`;
+            more.style.color = 'red';
+            more.textContent = 'Error loading list.';
         });
 }
 
+// True once the whole list is in.
+function updatePlaylistMore() {
+    const done = playlistLoaded >= playlistTotal;
+    document.getElementById('playlist-more').textContent = done ? '' : 'Scroll for more...';
+    return done;
+}
+
+// Clicks read the index from the item, so renumbering keeps them right.
+function trackItem(index, track) {
+    const div = document.createElement('div');
+    div.classList.add('track-item');
+    div.dataset.index = index;
+    div.track = track;
+    // Use index + 1 for display number
+    div.textContent = trackLabel(index, track);
+    div.appendChild(queueButton());
+    div.onclick = () => selectTrack(Number(div.dataset.index));
+    return div;
+}
+
+function setTrackLabel(div, index, track) {
+    div.dataset.index = index;
+    div.track = track;
+    div.firstChild.textContent = trackLabel(index, track);
+}
+
+// One edit of a playlist_changed event, applied to the loaded part of the
+// list. Edits come in list order, each past the ones before it, so the
+// added tracks already sit at their final indices.
+function spliceTracks(at, removed, added, version) {
+    if (at >= playlistLoaded) return;   // Paging brings it in
+    const playlistContainer = document.getElementById('playlist');
+    const items = playlistContainer.querySelectorAll('.track-item');
+    const gone = Math.min(removed, playlistLoaded - at);
+    for (let i = 0; i < gone; i++) {
+        items[at + i].remove();
+    }
+    playlistLoaded -= gone;
+    if (added === 0) return;
+
+    const before = items[at + gone] || document.getElementById('playlist-more');
+    const placeholders = [];
+    for (let i = 0; i < added; i++) {
+        const div = trackItem(at + i, { title: '…' });
+        playlistContainer.insertBefore(div, before);
+        placeholders.push(div);
+    }
+    playlistLoaded += added;
+
+    fetch(`/api/playlist?offset=${at}&limit=${added}&meta=1`)
+        .then(response => {
+            if (!response.ok) {
+                throw new Error(`HTTP error! status: ${response.status}`);
+            }
+            return response.json();
+        })
+        .then(data => {
+            if (data.version !== version) {
+                fetchPlaylist();
+                return;
+            }
+            data.playlist.forEach((track, i) => {
+                const div = placeholders[i];
+                setTrackLabel(div, Number(div.dataset.index), track);
+            });
+        })
+        .catch(error => console.error('Failed to fetch added tracks:', error));
+}
+
+function renumberTracks() {
+    document.querySelectorAll('#playlist .track-item').forEach((div, index) => {
+        if (Number(div.dataset.index) !== index) setTrackLabel(div, index, div.track);
+    });
+}
+
+function trackLabel(index, track) {
+    let text = `${index + 1}. ${track.title}`;
+    if (track.artist) text += ` — ${track.artist}`;
+    if (track.durationMs > 0) text += ` (${formatTime(track.durationMs)})`;
+    return text;
+}
+
+// Search as you type: requests are spaced out while typing and a reply
+// that arrives after a newer request was sent is dropped.
+const SEARCH_DELAY_MS = 150;
+let searchTimer = null;
+let searchSeq = 0;
+
+function searchTracks(query) {
+    clearTimeout(searchTimer);
+    const results = document.getElementById('search-results');
+    const playlist = document.getElementById('playlist');
+    if (query.trim() === '') {
+        searchSeq++;
+        results.style.display = 'none';
+        playlist.style.display = '';
+        return;
+    }
+
+    searchTimer = setTimeout(() => {
+        const seq = ++searchSeq;
+        fetch(`/api/search?q=${encodeURIComponent(query)}&limit=50`)
+            .then(response => {
+                if (!response.ok) {
+                    throw new Error(`HTTP error! status: ${response.status}`);
+                }
+                return response.json();
+            })
+            .then(data => {
+                if (seq !== searchSeq) return;
+                results.innerHTML = `<strong>🔍 ${data.total} match${data.total === 1 ? '' : 'es'}</strong>`;
+                data.results.forEach(track => {
+                    const div = document.createElement('div');
+                    div.classList.add('track-item');
+                    div.dataset.index = track.index;
+                    div.textContent = trackLabel(track.index, track);
+                    div.appendChild(queueButton());
+                    div.onclick = () => selectTrack(track.index);
+                    results.appendChild(div);
+                });
+                results.style.display = '';
+                playlist.style.display = 'none';
+                highlightTrack(currentTrackIndex);
+            })
+            .catch(error => {
+                console.error('Search failed:', error);
+            });
+    }, SEARCH_DELAY_MS);
+}
+
+// "Up next": tracks queued here play before the list carries on. The
+// button queues whatever track its item shows.
+function queueButton() {
+    const button = document.createElement('span');
+    button.textContent = ' ➕';
+    button.title = 'Play next';
+    button.onclick = event => {
+        event.stopPropagation();
+        queueTrack(Number(button.parentNode.dataset.index));
+    };
+    return button;
+}
+
+function queueTrack(index) {
+    fetch('/api/selectTrack', {
+        method: 'POST',
+        headers: {'Content-Type': 'application/x-www-form-urlencoded'},
+        body: 'index=' + index + '&queue=1'
+    })
+    .then(response => response.json())
+    .then(data => updateQueueLength(data.queueLength))
+    .catch(error => console.error('Error queueing track:', error));
+}
+
+function updateQueueLength(length) {
+    if (length !== undefined) {
+        document.getElementById('queue-length').textContent = length;
+    }
+}
+
+function fetchQueueLength() {
+    fetch('/api/queue')
+        .then(response => response.json())
+        .then(data => updateQueueLength(data.count))
+        .catch(error => console.error('Failed to fetch queue:', error));
+}
+
+function clearQueue() {
+    fetch('/api/queue', {
+        method: 'POST',
+        headers: {'Content-Type': 'application/x-www-form-urlencoded'},
+        body: 'action=clear'
+    })
+    .then(() => updateQueueLength(0))
+    .catch(error => console.error('Error clearing queue:', error));
+}
+
+function fetchSavedPlaylists() {
+    fetch('/api/playlists')
+        .then(response => response.json())
+        .then(data => {
+            const picker = document.getElementById('playlist-picker');
+            picker.innerHTML = '';
+            data.playlists.forEach(playlist => {
+                const option = document.createElement('option');
+                option.value = playlist.name;
+                option.textContent = `${playlist.name} (${playlist.count})`;
+                picker.appendChild(option);
+            });
+        })
+        .catch(error => console.error('Failed to fetch saved playlists:', error));
+}
+
+// action: play, queue or delete
+function savedPlaylistAction(action) {
+    const name = document.getElementById('playlist-picker').value;
+    if (!name) return;
+
+    fetch('/api/playlists', {
+        method: 'POST',
+        headers: {'Content-Type': 'application/x-www-form-urlencoded'},
+        body: 'action=' + action + '&name=' + encodeURIComponent(name)
+    })
+    .then(response => response.json())
+    .then(data => {
+        updateQueueLength(data.queueLength);
+        if (action === 'delete') fetchSavedPlaylists();
+    })
+    .catch(error => console.error('Playlist action failed:', error));
+}
+
 function selectTrack(index) {
     console.log("Selecting track index:", index);
+    if (wsSend(WS_OP.select, index)) return;
   
     // Send a POST request to the new API endpoint
     fetch('/api/selectTrack', {
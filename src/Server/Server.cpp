@@ -2,11 +2,16 @@
 #include <ESPAsyncWebServer.h>
 #include <AsyncEventSource.h>
 #include <ESPmDNS.h>
-#include <ArduinoJson.h>
+#include <memory>
+#include <mutex>
+#include <vector>
 #include "Audio/AudioPlayer.h"
+#include "Audio/SearchIndex.h"
 #include "Server.h"
-#include "Index.h"
-#include "Script.h"
+#include "PlaylistStream.h"
+#include "StatePublisher.h"
+#include "WsProtocol.h"
+#include "WebUi.h"   // Generated from Index.h + Script.h at build time
 
 // TODO: Include your audioPlayer class header here
 // #include "audioPlayer.h"
@@ -26,6 +31,196 @@ AsyncEventSource events("/events");
 // Store pointer to audioPlayer
 AudioPlayer* playerPtr = nullptr;
 
+// Binary control channel, see WsProtocol.h
+AsyncWebSocket ws("/ws");
+
+// Diffed, rate-limited "audio_state" events for the SSE and WebSocket clients
+StatePublisher statePublisher(events);
+
+// Word index over titles and tags for /api/search. Built and queried only
+// from request handlers, so it never leaves the web server's task.
+static SearchIndex searchIndex;
+
+// Appends text as a quoted JSON string.
+static void appendJsonString(String& out, const char* text, size_t length) {
+    out.concat('"');
+    size_t run = 0;
+    for (size_t i = 0; i < length; i++) {
+        char c = text[i];
+        if (c != '"' && c != '\\' && (uint8_t)c >= 0x20) continue;
+        out.concat(text + run, i - run);
+        char escape[8];
+        if (c == '"' || c == '\\') {
+            snprintf(escape, sizeof(escape), "\\%c", c);
+        } else {
+            snprintf(escape, sizeof(escape), "\\u%04x", (unsigned)(uint8_t)c);
+        }
+        out.concat(escape);
+        run = i + 1;
+    }
+    out.concat(text + run, length - run);
+    out.concat('"');
+}
+
+// Handlers that read the track list hold a LibraryReader for as long as
+// they do (a streamed response, until it is sent). While the list is
+// being rebuilt they cannot get one and answer 503.
+static bool libraryBusy(AsyncWebServerRequest* request, const LibraryReader& reader) {
+    if (reader) return false;
+    request->send(503, "application/json", "{\"error\":\"Library scan in progress\"}");
+    return true;
+}
+
+// Library events, raised on the task that mounts and loads the card
+// (setup()'s, then the card monitor's):
+//   scan_progress     a few times a second while the list is rebuilt
+//   card              {"present":true|false}
+//   playlist_changed  {"version":V,"previousVersion":P,"total":N,"full":F,
+//                      "edits":[[at,removed,added],...]}
+// A client whose list is at version P splices each edit in turn and
+// fetches only the added runs; any other client, or any with full set,
+// fetches the list again.
+//
+// The payloads wait here, in order, until serverLoop() sends them, so the
+// event source's client list is only touched from loopTask. Progress
+// reports queued back to back collapse into the latest one.
+class LibraryEvents : public LibraryListener {
+public:
+    // From serverLoop().
+    void flush() {
+        std::vector<Pending> ready;
+        {
+            std::lock_guard<std::mutex> guard(_lock);
+            if (_pending.empty()) return;
+            ready.swap(_pending);
+        }
+        // No id: Last-Event-ID stays with the state events.
+        for (const Pending& event : ready) events.send(event.json.c_str(), event.name, 0);
+    }
+
+    void onScanProgress(const ScanProgress& progress) override {
+        char json[160];
+        snprintf(json, sizeof(json),
+                 "{\"scanning\":%s,\"phase\":\"%s\",\"folders\":%u,\"files\":%u,\"tracks\":%u,\"elapsedMs\":%u}",
+                 progress.scanning ? "true" : "false",
+                 !progress.scanning ? "done" : progress.reading ? "reading" : "checking",
+                 (unsigned)progress.folders, (unsigned)progress.files, (unsigned)progress.tracks,
+                 (unsigned)progress.elapsedMs);
+        _queue("scan_progress", String(json));
+    }
+
+    void onCardChanged(bool present) override {
+        _queue("card", String(present ? "{\"present\":true}" : "{\"present\":false}"));
+    }
+
+    void onLibraryChanged(const LibraryChange& change) override {
+        char head[128];
+        snprintf(head, sizeof(head), "{\"version\":%u,\"previousVersion\":%u,\"total\":%d,\"full\":%s,\"edits\":[",
+                 (unsigned)change.version, (unsigned)change.previousVersion, change.count,
+                 change.full ? "true" : "false");
+        String json;
+        json.reserve(sizeof(head) + change.editCount * 36 + 2);
+        json.concat(head);
+        for (int i = 0; i < change.editCount; i++) {
+            const LibraryEdit& edit = change.edits[i];
+            char item[40];
+            int n = snprintf(item, sizeof(item), "%s[%u,%u,%u]", i ? "," : "", (unsigned)edit.at,
+                             (unsigned)edit.removed, (unsigned)edit.added);
+            json.concat(item, n);
+        }
+        json.concat("]}");
+        _queue("playlist_changed", std::move(json));
+    }
+
+private:
+    struct Pending {
+        const char* name;
+        String json;
+    };
+
+    void _queue(const char* name, String json) {
+        std::lock_guard<std::mutex> guard(_lock);
+        bool progress = strcmp(name, "scan_progress") == 0;
+        if (progress && !_pending.empty() && strcmp(_pending.back().name, name) == 0) {
+            _pending.back().json = std::move(json);
+            return;
+        }
+        _pending.push_back(Pending{ name, std::move(json) });
+    }
+
+    std::mutex _lock;
+    std::vector<Pending> _pending;
+};
+static LibraryEvents libraryEvents;
+
+// Scratch for playlist requests; one block, reused across requests.
+static TrackList playlistTracks;
+static uint32_t queueSnapshot[PLAY_QUEUE_MAX];
+
+// Appends track indices as a JSON array.
+static void appendTrackArray(String& out, const uint32_t* tracks, int count) {
+    out.reserve(out.length() + count * 6 + 2);
+    out.concat('[');
+    char number[12];
+    for (int i = 0; i < count; i++) {
+        int n = snprintf(number, sizeof(number), i == 0 ? "%u" : ",%u", (unsigned)tracks[i]);
+        out.concat(number, n);
+    }
+    out.concat(']');
+}
+
+// "3,17,42" into the list. False on anything that is not an index in the
+// library.
+static bool parseTrackList(const String& text, int trackCount, TrackList& out) {
+    out.clear();
+    const char* p = text.c_str();
+    while (*p) {
+        char* end;
+        long index = strtol(p, &end, 10);
+        if (end == p || index < 0 || index >= trackCount || !out.add((uint32_t)index)) return false;
+        p = end;
+        if (*p == ',') p++;
+        else if (*p) return false;
+    }
+    return out.count() <= PLAYLIST_MAX_TRACKS;
+}
+
+// Commands arrive as one small binary frame each and are answered with an
+// ACK carrying the same sequence number; the state change itself follows
+// as a STATE frame from the publisher.
+static void onWsEvent(AsyncWebSocket* socket, AsyncWebSocketClient* client, AwsEventType type,
+                      void* arg, uint8_t* data, size_t len) {
+    if (type == WS_EVT_CONNECT) {
+        statePublisher.onConnect(client);
+        return;
+    }
+    if (type != WS_EVT_DATA) return;
+
+    AwsFrameInfo* info = (AwsFrameInfo*)arg;
+    uint8_t reply[WS_COMMAND_SIZE];
+    WsCommand command;
+
+    if (!info->final || info->index != 0 || info->len != len || info->opcode != WS_BINARY ||
+        !wsDecodeCommand(data, len, command)) {
+        client->binary(reply, wsEncodeAck(reply, 0, WS_STATUS_BAD_REQUEST));
+        return;
+    }
+
+    if (command.opcode == WS_OP_PING) {
+        client->binary(reply, wsEncodePong(reply, command));
+        return;
+    }
+
+    PlayerCommand::Type playerCommand;
+    uint8_t status = WS_STATUS_OK;
+    if (playerPtr == nullptr || !wsToPlayerCommand(command, playerCommand)) {
+        status = WS_STATUS_BAD_REQUEST;
+    } else if (!playerPtr->post(playerCommand, command.value)) {
+        status = WS_STATUS_BUSY;
+    }
+    client->binary(reply, wsEncodeAck(reply, command.seq, status));
+}
+
 void initServer(AudioPlayer* player) {
     playerPtr = player;  // Save the player pointer
     
@@ -47,22 +242,37 @@ void initServer(AudioPlayer* player) {
     }
     Serial.println("mDNS started. Access at http://" + String(mdnsName) + ".local");
 
-    // Optional: Log when a client connects to the SSE stream
+    // New clients get the full state; reconnecting ones only what they missed
     events.onConnect([](AsyncEventSourceClient *client){
       if(client->lastId()){
         Serial.printf("SSE Client reconnected! Last ID: %u\n", client->lastId());
       }
     
-      client->send(playerPtr->getCurrentStateJSON().c_str(), "audio_state"); 
+      statePublisher.onConnect(client);
     });
+    player->_playlist.setListener(&libraryEvents);
 
     server.addHandler(&events);
+
+    ws.onEvent(onWsEvent);
+    statePublisher.attach(ws);
+    server.addHandler(&ws);
     
-    // Serve the main HTML page
+    // Serve the main HTML page, pre-rendered and gzipped at build time and
+    // sent straight from flash. Browsers revalidate with If-None-Match and
+    // get an empty 304 while the firmware (and so the ETag) is unchanged.
     server.on("/", HTTP_GET, [](AsyncWebServerRequest *request){
-        String html = String(index_html);
-        html.replace("{{SCRIPT_CONTENT}}", script_js);
-        request->send_P(200, "text/html", html.c_str());
+        AsyncWebServerResponse *response;
+        if (request->hasHeader("If-None-Match") &&
+            request->getHeader("If-None-Match")->value() == WEB_UI_ETAG) {
+            response = request->beginResponse(304);
+        } else {
+            response = request->beginResponse_P(200, "text/html", web_ui_gz, sizeof(web_ui_gz));
+            response->addHeader("Content-Encoding", "gzip");
+        }
+        response->addHeader("ETag", WEB_UI_ETAG);
+        response->addHeader("Cache-Control", "no-cache");
+        request->send(response);
     });
     
     // API: Set volume
@@ -70,17 +280,109 @@ void initServer(AudioPlayer* player) {
         if (request->hasParam("volume", true)) {
             int vol = request->getParam("volume", true)->value().toInt();
             
-            // Call your audioPlayer setVolume method
-            if (playerPtr != nullptr) {
-                playerPtr->setVolume(vol);
+            // Queued for the audio task; a slider drag collapses to its last value
+            if (playerPtr == nullptr || !playerPtr->post(PlayerCommand::VOLUME, vol)) {
+                request->send(503, "application/json", "{\"error\":\"Player busy\"}");
+                return;
             }
             
             request->send(200, "application/json", "{\"status\":\"ok\",\"volume\":" + String(vol) + "}");
         } else {
             request->send(400, "application/json", "{\"error\":\"Missing volume parameter\"}");
         }
+    });
 
-        events.send(playerPtr->getCurrentStateJSON().c_str(), "audio_state");
+    // API: Tone controls, dB per band (-12..+12); omitted bands keep their value
+    server.on("/api/eq", HTTP_GET, [](AsyncWebServerRequest *request) {
+        if (playerPtr == nullptr) {
+            request->send(500, "application/json", "{\"error\":\"Player not initialized\"}");
+            return;
+        }
+        EqSettings eq = playerPtr->getEq();
+        char json[64];
+        snprintf(json, sizeof(json), "{\"bass\":%d,\"mid\":%d,\"treble\":%d}",
+                 eq.bassDb, eq.midDb, eq.trebleDb);
+        request->send(200, "application/json", json);
+    });
+
+    server.on("/api/eq", HTTP_POST, [](AsyncWebServerRequest *request) {
+        if (playerPtr == nullptr) {
+            request->send(500, "application/json", "{\"error\":\"Player not initialized\"}");
+            return;
+        }
+
+        EqSettings eq = playerPtr->getEq();
+        const char* names[] = { "bass", "mid", "treble" };
+        int8_t* bands[] = { &eq.bassDb, &eq.midDb, &eq.trebleDb };
+        for (int i = 0; i < 3; i++) {
+            if (!request->hasParam(names[i], true)) continue;
+            int db = request->getParam(names[i], true)->value().toInt();
+            *bands[i] = (int8_t)constrain(db, -EQ_MAX_DB, EQ_MAX_DB);
+        }
+
+        if (!playerPtr->post(PlayerCommand::EQ, packEq(eq))) {
+            request->send(503, "application/json", "{\"error\":\"Player busy\"}");
+            return;
+        }
+        char json[80];
+        snprintf(json, sizeof(json), "{\"status\":\"ok\",\"bass\":%d,\"mid\":%d,\"treble\":%d}",
+                 eq.bassDb, eq.midDb, eq.trebleDb);
+        request->send(200, "application/json", json);
+    });
+
+    // API: Play mode. POST shuffle=0|1 and/or repeat=off|all|one; omitted
+    // settings keep their value
+    server.on("/api/mode", HTTP_GET, [](AsyncWebServerRequest *request) {
+        if (playerPtr == nullptr) {
+            request->send(500, "application/json", "{\"error\":\"Player not initialized\"}");
+            return;
+        }
+        PlayerState state = playerPtr->getState();
+        char json[48];
+        snprintf(json, sizeof(json), "{\"shuffle\":%s,\"repeat\":\"%s\"}",
+                 state.shuffle ? "true" : "false", repeatModeName(state.repeat));
+        request->send(200, "application/json", json);
+    });
+
+    server.on("/api/mode", HTTP_POST, [](AsyncWebServerRequest *request) {
+        if (playerPtr == nullptr) {
+            request->send(500, "application/json", "{\"error\":\"Player not initialized\"}");
+            return;
+        }
+
+        int shuffle = -1;
+        int repeat = -1;
+        if (request->hasParam("shuffle", true)) {
+            String value = request->getParam("shuffle", true)->value();
+            if (value == "1" || value == "true") shuffle = 1;
+            else if (value == "0" || value == "false") shuffle = 0;
+            else {
+                request->send(400, "application/json", "{\"error\":\"Invalid shuffle\"}");
+                return;
+            }
+        }
+        if (request->hasParam("repeat", true)) {
+            String value = request->getParam("repeat", true)->value();
+            for (int i = 0; i < REPEAT_MODE_COUNT; i++) {
+                if (value == repeatModeName((RepeatMode)i)) repeat = i;
+            }
+            if (repeat < 0) {
+                request->send(400, "application/json", "{\"error\":\"Invalid repeat\"}");
+                return;
+            }
+        }
+        if (shuffle < 0 && repeat < 0) {
+            request->send(400, "application/json", "{\"error\":\"Missing shuffle or repeat parameter\"}");
+            return;
+        }
+
+        // Applied by the audio task; the new mode follows over SSE.
+        if ((shuffle >= 0 && !playerPtr->post(PlayerCommand::SHUFFLE, shuffle)) ||
+            (repeat >= 0 && !playerPtr->post(PlayerCommand::REPEAT, repeat))) {
+            request->send(503, "application/json", "{\"error\":\"Player busy\"}");
+            return;
+        }
+        request->send(200, "application/json", "{\"status\":\"ok\"}");
     });
 
     server.on("/api/control", HTTP_POST, [](AsyncWebServerRequest *request){
@@ -95,77 +397,170 @@ void initServer(AudioPlayer* player) {
         }
         
         String action = request->getParam("action", true)->value();
+        PlayerCommand::Type type;
         
         if (action == "play") {
-            playerPtr->play();
-            request->send(200, "application/json", "{\"status\":\"ok\",\"action\":\"play\"}");
+            type = PlayerCommand::PLAY;
         } 
         else if (action == "pause") {
-            playerPtr->pause();
-            request->send(200, "application/json", "{\"status\":\"ok\",\"action\":\"pause\"}");
+            type = PlayerCommand::PAUSE;
         } 
         else if (action == "next") {
-            playerPtr->playNext();
-            request->send(200, "application/json", "{\"status\":\"ok\",\"action\":\"next\"}");
+            type = PlayerCommand::NEXT;
         } 
         else if (action == "previous") {
-            playerPtr->playPrevious();
-            request->send(200, "application/json", "{\"status\":\"ok\",\"action\":\"previous\"}");
+            type = PlayerCommand::PREVIOUS;
         } 
         else {
             request->send(400, "application/json", "{\"error\":\"Invalid action\"}");
+            return;
         }
 
-        events.send(playerPtr->getCurrentStateJSON().c_str(), "audio_state");
+        // The audio task applies it; the new state follows over SSE.
+        if (!playerPtr->post(type)) {
+            request->send(503, "application/json", "{\"error\":\"Player busy\"}");
+            return;
+        }
+        request->send(200, "application/json", "{\"status\":\"ok\",\"action\":\"" + action + "\"}");
     });
 
+    // API: Playlist titles, optionally paged with ?offset=&limit=
+    // With ?meta=1 each entry is an object with the tags and duration from
+    // the metadata index; no file is opened to answer either form.
+    // The JSON is streamed in chunks straight from the playlist storage, so
+    // memory use stays flat however large the library is.
     server.on("/api/playlist", HTTP_GET, [](AsyncWebServerRequest *request){
         if (playerPtr == nullptr) {
             request->send(500, "application/json", "{\"error\":\"Player not initialized\"}");
             return;
         }
+        auto reader = std::make_shared<LibraryReader>(playerPtr->_playlist);
+        if (libraryBusy(request, *reader)) return;
 
-        // 1. Get the playlist data from the AudioPlayer (which calls SDPlaylist::getPlaylist())
-        std::vector<std::string> titles = playerPtr->getPlaylist();
+        int total = playerPtr->getPlaylist().size();
+        int offset = 0;
+        int limit = -1;  // Everything from offset on
+        if (request->hasParam("offset")) {
+            offset = request->getParam("offset")->value().toInt();
+        }
+        if (request->hasParam("limit")) {
+            limit = request->getParam("limit")->value().toInt();
+        }
+        if (offset < 0) offset = 0;
+        if (offset > total) offset = total;
 
-        // 2. Estimate the required size for the JSON document.
-        //    We need space for:
-        //    - JSON_OBJECT_SIZE(1): The outer "playlist" object.
-        //    - JSON_ARRAY_SIZE(titles.size()): The array container.
-        //    - The combined length of all track titles (approx 30 bytes per title).
-        const size_t JSON_CAPACITY = JSON_OBJECT_SIZE(1) + 
-                                    JSON_ARRAY_SIZE(titles.size()) + 
-                                    (titles.size() * 30); // ~30 bytes/string
-      
-    
-        // // Check if we can allocate the memory. If not, return an error.
-        // we are not checking this this could cause a memory overflow.
-        // if (JSON_CAPACITY > ARDUINOJSON_DEFAULT_NESTING_LIMIT) {
-        //     Serial.println("Error: JSON capacity estimate too high.");
-        //     request->send(500, "application/json", "{\"error\":\"Not enough memory for playlist JSON\"}");
-        //     return;
-        // }
-        
-        DynamicJsonDocument doc(JSON_CAPACITY);
-        
-        // 3. Create the JSON array where the track titles will go.
-        JsonArray jsonPlaylist = doc.createNestedArray("playlist");
-        
-        // 4. Iterate over the C++ vector and populate the JSON array.
-        for (const std::string& title : titles) {
-            // Use the JsonArray::add() method to insert the title.
-            // ArduinoJson automatically handles the conversion from std::string to JSON string.
-            jsonPlaylist.add(title);
+        const MetadataIndex* metadata = nullptr;
+        if (request->hasParam("meta") && request->getParam("meta")->value().toInt() != 0) {
+            metadata = &playerPtr->getMetadata();
         }
-        
-        // 5. Serialize the JSON document to a String buffer.
-        String responseJson;
-        serializeJson(doc, responseJson);
-        
-        // 6. Send the response back to the client.
-        request->send(200, "application/json", responseJson);
-        
-        Serial.printf("API: /api/playlist responded with %d tracks.\n", titles.size());
+
+        TrackTitles page = playerPtr->getPlaylist(offset, limit);
+
+        // The filler runs later on the AsyncTCP task, so the stream state
+        // (and the hold on the list) is owned by the callback rather than
+        // this handler's stack.
+        auto stream = std::make_shared<PlaylistJsonStream>(page, total, offset, playerPtr->_playlist.getVersion(),
+                                                           metadata);
+        AsyncWebServerResponse *response = request->beginChunkedResponse("application/json",
+            [stream, reader](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+                return stream->fill(buffer, maxLen);
+            });
+        request->send(response);
+
+        Serial.printf("API: /api/playlist streaming %d of %d tracks from %d.\n", page.size(), total, offset);
+    });
+
+    // API: Card and library status, for clients that missed the events
+    server.on("/api/library", HTTP_GET, [](AsyncWebServerRequest *request){
+        if (playerPtr == nullptr) {
+            request->send(500, "application/json", "{\"error\":\"Player not initialized\"}");
+            return;
+        }
+        SDPlaylist& playlist = playerPtr->_playlist;
+        ScanProgress scan = playlist.getScanProgress();
+        char json[96];
+        snprintf(json, sizeof(json), "{\"card\":%s,\"online\":%s,\"scanning\":%s,\"version\":%u,\"tracks\":%u}",
+                 playlist.isMounted() ? "true" : "false", playerPtr->isLibraryOnline() ? "true" : "false",
+                 scan.scanning ? "true" : "false", (unsigned)playlist.getVersion(), (unsigned)scan.tracks);
+        request->send(200, "application/json", json);
+    });
+
+    // API: action=rescan reads every file on the card again, for tracks
+    // edited in place under the same name. The card monitor does the work;
+    // scan_progress and playlist_changed follow as for an insertion.
+    server.on("/api/library", HTTP_POST, [](AsyncWebServerRequest *request){
+        if (playerPtr == nullptr) {
+            request->send(500, "application/json", "{\"error\":\"Player not initialized\"}");
+            return;
+        }
+        if (!request->hasParam("action", true) || request->getParam("action", true)->value() != "rescan") {
+            request->send(400, "application/json", "{\"error\":\"Invalid action\"}");
+            return;
+        }
+        if (!playerPtr->_playlist.isMounted()) {
+            request->send(409, "application/json", "{\"error\":\"No SD card\"}");
+            return;
+        }
+        playerPtr->requestRescan();
+        request->send(202, "application/json", "{\"status\":\"ok\",\"action\":\"rescan\"}");
+    });
+
+    // API: Tracks matching every word of ?q= as a prefix of a word in the
+    // title, artist or album, best first; ?limit= caps the list (default 20).
+    // The index is rebuilt here when the playlist or the tags have moved on.
+    server.on("/api/search", HTTP_GET, [](AsyncWebServerRequest *request){
+        if (playerPtr == nullptr) {
+            request->send(500, "application/json", "{\"error\":\"Player not initialized\"}");
+            return;
+        }
+        LibraryReader reader(playerPtr->_playlist);
+        if (libraryBusy(request, reader)) return;
+        if (!request->hasParam("q")) {
+            request->send(400, "application/json", "{\"error\":\"Missing q parameter\"}");
+            return;
+        }
+
+        int limit = 20;
+        if (request->hasParam("limit")) {
+            limit = request->getParam("limit")->value().toInt();
+        }
+        if (limit < 1) limit = 1;
+        if (limit > SEARCH_MAX_RESULTS) limit = SEARCH_MAX_RESULTS;
+
+        const MetadataIndex& metadata = playerPtr->getMetadata();
+        uint32_t start = micros();
+        searchIndex.refresh(playerPtr->getPlaylist(), playerPtr->_playlist.getVersion(), metadata, millis());
+        SearchHit hits[SEARCH_MAX_RESULTS];
+        const String& query = request->getParam("q")->value();
+        int total = searchIndex.search(query.c_str(), hits, limit);
+        int count = total < limit ? total : limit;
+        uint32_t tookUs = micros() - start;
+
+        char head[160];
+        snprintf(head, sizeof(head), "{\"total\":%d,\"count\":%d,\"tookUs\":%u,\"indexBytes\":%u,\"results\":[",
+                 total, count, (unsigned)tookUs, (unsigned)searchIndex.bytesUsed());
+        String json;
+        json.reserve(sizeof(head) + count * 160);
+        json.concat(head);
+        for (int i = 0; i < count; i++) {
+            const TrackMeta* meta = metadata.get(hits[i].index);
+            std::string_view title = playerPtr->getTitle(hits[i].index);
+            if (meta != nullptr && meta->title[0] != '\0') title = meta->title;
+
+            char item[48];
+            snprintf(item, sizeof(item), "%s{\"index\":%d,\"score\":%u,\"title\":", i ? "," : "",
+                     hits[i].index, (unsigned)hits[i].score);
+            json.concat(item);
+            appendJsonString(json, title.data(), title.size());
+            json.concat(",\"artist\":");
+            appendJsonString(json, meta ? meta->artist : "", meta ? strlen(meta->artist) : 0);
+            json.concat(",\"album\":");
+            appendJsonString(json, meta ? meta->album : "", meta ? strlen(meta->album) : 0);
+            snprintf(item, sizeof(item), ",\"durationMs\":%u}", meta ? (unsigned)meta->durationMs : 0u);
+            json.concat(item);
+        }
+        json.concat("]}");
+        request->send(200, "application/json", json);
     });
 
     server.on("/api/selectTrack", HTTP_POST, [](AsyncWebServerRequest *request){
@@ -180,15 +575,213 @@ void initServer(AudioPlayer* player) {
         }
 
         int index = request->getParam("index", true)->value().toInt();
-        playerPtr->playTrack(index);
 
-        //String responseJson = "{\"status\":\"ok\",\"selected_index\":" + String(index) + "}";
-        request->send(200, "application/json", "");
+        // With queue=1 the track goes to the end of "up next" instead.
+        if (request->hasParam("queue", true) && request->getParam("queue", true)->value() == "1") {
+            LibraryReader reader(playerPtr->_playlist);
+            if (libraryBusy(request, reader)) return;
+            if (index < 0 || index >= playerPtr->_playlist.getTrackCount()) {
+                request->send(400, "application/json", "{\"error\":\"Invalid index\"}");
+                return;
+            }
+            if (!playerPtr->getQueue().push(index)) {
+                request->send(503, "application/json", "{\"error\":\"Queue full\"}");
+                return;
+            }
+            char json[64];
+            snprintf(json, sizeof(json), "{\"status\":\"ok\",\"queued_index\":%d,\"queueLength\":%d}",
+                     index, playerPtr->getQueue().size());
+            request->send(200, "application/json", json);
+            return;
+        }
 
-        events.send(playerPtr->getCurrentStateJSON().c_str(), "audio_state");
+        if (!playerPtr->post(PlayerCommand::SELECT, index)) {
+            request->send(503, "application/json", "{\"error\":\"Player busy\"}");
+            return;
+        }
+
+        request->send(200, "application/json", "{\"status\":\"ok\",\"selected_index\":" + String(index) + "}");
      });
 
     
+    // API: The "up next" queue, front first
+    server.on("/api/queue", HTTP_GET, [](AsyncWebServerRequest *request){
+        if (playerPtr == nullptr) {
+            request->send(500, "application/json", "{\"error\":\"Player not initialized\"}");
+            return;
+        }
+        int count = playerPtr->getQueue().copy(queueSnapshot, PLAY_QUEUE_MAX);
+        String json = "{\"count\":" + String(count) + ",\"tracks\":";
+        appendTrackArray(json, queueSnapshot, count);
+        json.concat('}');
+        request->send(200, "application/json", json);
+    });
+
+    server.on("/api/queue", HTTP_POST, [](AsyncWebServerRequest *request){
+        if (playerPtr == nullptr) {
+            request->send(500, "application/json", "{\"error\":\"Player not initialized\"}");
+            return;
+        }
+        if (!request->hasParam("action", true) || request->getParam("action", true)->value() != "clear") {
+            request->send(400, "application/json", "{\"error\":\"Invalid action\"}");
+            return;
+        }
+        playerPtr->getQueue().clear();
+        request->send(200, "application/json", "{\"status\":\"ok\",\"action\":\"clear\"}");
+    });
+
+    // API: Saved playlists. Without ?name= lists them; with it, returns the
+    // tracks as playlist indices.
+    server.on("/api/playlists", HTTP_GET, [](AsyncWebServerRequest *request){
+        if (playerPtr == nullptr) {
+            request->send(500, "application/json", "{\"error\":\"Player not initialized\"}");
+            return;
+        }
+        LibraryReader reader(playerPtr->_playlist);
+        if (libraryBusy(request, reader)) return;
+        PlaylistStore& store = playerPtr->getPlaylists();
+
+        if (request->hasParam("name")) {
+            String name = request->getParam("name")->value();
+            int missing = 0;
+            if (!store.load(name.c_str(), playlistTracks, &missing)) {
+                request->send(404, "application/json", "{\"error\":\"No such playlist\"}");
+                return;
+            }
+            String json = "{\"name\":";
+            appendJsonString(json, name.c_str(), name.length());
+            json += ",\"count\":" + String(playlistTracks.count()) + ",\"missing\":" + String(missing) + ",\"tracks\":";
+            appendTrackArray(json, playlistTracks.data(), playlistTracks.count());
+            json.concat('}');
+            request->send(200, "application/json", json);
+            return;
+        }
+
+        static PlaylistSummary summaries[32];
+        int count = store.list(summaries, 32);
+        String json = "{\"playlists\":[";
+        for (int i = 0; i < count; i++) {
+            if (i > 0) json.concat(',');
+            json += "{\"name\":";
+            appendJsonString(json, summaries[i].name, strlen(summaries[i].name));
+            json += ",\"count\":" + String(summaries[i].count) + "}";
+        }
+        json += "]}";
+        request->send(200, "application/json", json);
+    });
+
+    // action=save    name, tracks=3,17,42 (omit tracks to save the queue)
+    // action=import  name, path=/Music/party.m3u
+    // action=play    name: plays the first track, queues the rest
+    // action=queue   name: appends to the queue
+    // action=delete  name
+    server.on("/api/playlists", HTTP_POST, [](AsyncWebServerRequest *request){
+        if (playerPtr == nullptr) {
+            request->send(500, "application/json", "{\"error\":\"Player not initialized\"}");
+            return;
+        }
+        LibraryReader reader(playerPtr->_playlist);
+        if (libraryBusy(request, reader)) return;
+        if (!request->hasParam("action", true) || !request->hasParam("name", true)) {
+            request->send(400, "application/json", "{\"error\":\"Missing action or name parameter\"}");
+            return;
+        }
+
+        String action = request->getParam("action", true)->value();
+        String name = request->getParam("name", true)->value();
+        if (!PlaylistStore::isValidName(name.c_str())) {
+            request->send(400, "application/json", "{\"error\":\"Invalid playlist name\"}");
+            return;
+        }
+
+        PlaylistStore& store = playerPtr->getPlaylists();
+        PlayQueue& queue = playerPtr->getQueue();
+        int missing = 0;
+        bool ok;
+
+        if (action == "save") {
+            if (request->hasParam("tracks", true)) {
+                if (!parseTrackList(request->getParam("tracks", true)->value(),
+                                    playerPtr->_playlist.getTrackCount(), playlistTracks)) {
+                    request->send(400, "application/json", "{\"error\":\"Invalid tracks\"}");
+                    return;
+                }
+                ok = store.save(name.c_str(), playlistTracks.data(), playlistTracks.count());
+            } else {
+                int count = queue.copy(queueSnapshot, PLAY_QUEUE_MAX);
+                playlistTracks.clear();
+                for (int i = 0; i < count; i++) playlistTracks.add(queueSnapshot[i]);
+                ok = store.save(name.c_str(), queueSnapshot, count);
+            }
+        } else if (action == "import") {
+            if (!request->hasParam("path", true)) {
+                request->send(400, "application/json", "{\"error\":\"Missing path parameter\"}");
+                return;
+            }
+            ok = store.importM3u(request->getParam("path", true)->value().c_str(), name.c_str(),
+                                 playlistTracks, &missing);
+        } else if (action == "play" || action == "queue") {
+            ok = store.load(name.c_str(), playlistTracks, &missing);
+            if (ok && playlistTracks.count() > 0) {
+                if (action == "play") {
+                    queue.clear();
+                    queue.append(playlistTracks.data() + 1, playlistTracks.count() - 1);
+                    if (!playerPtr->post(PlayerCommand::SELECT, playlistTracks[0])) {
+                        request->send(503, "application/json", "{\"error\":\"Player busy\"}");
+                        return;
+                    }
+                } else {
+                    queue.append(playlistTracks.data(), playlistTracks.count());
+                }
+            }
+        } else if (action == "delete") {
+            playlistTracks.clear();
+            ok = store.remove(name.c_str());
+        } else {
+            request->send(400, "application/json", "{\"error\":\"Invalid action\"}");
+            return;
+        }
+
+        if (!ok) {
+            request->send(action == "save" || action == "import" ? 500 : 404, "application/json",
+                          "{\"error\":\"Playlist operation failed\"}");
+            return;
+        }
+        char json[128];
+        snprintf(json, sizeof(json), "{\"status\":\"ok\",\"action\":\"%s\",\"count\":%d,\"missing\":%d,\"queueLength\":%d}",
+                 action.c_str(), playlistTracks.count(), missing, queue.size());
+        request->send(200, "application/json", json);
+    });
+
+    // API: Output health - ring fill level, underrun counters and SD reads
+    server.on("/api/stats", HTTP_GET, [](AsyncWebServerRequest *request){
+        if (playerPtr == nullptr) {
+            request->send(500, "application/json", "{\"error\":\"Player not initialized\"}");
+            return;
+        }
+
+        AudioOutputStats stats = playerPtr->getOutputStats();
+        SDReadStats sd = playerPtr->getSdReadStats();
+        char json[640];
+        snprintf(json, sizeof(json),
+                 "{\"framesPlayed\":%llu,\"underruns\":%u,\"underrunFrames\":%u,"
+                 "\"bufferedFrames\":%u,\"capacityFrames\":%u,"
+                 "\"trackTransitions\":%u,\"lastGapMs\":%.1f,\"maxGapMs\":%.1f,\"lastSwitchUs\":%u,"
+                 "\"sd\":{\"spiHz\":%u,\"bytesRead\":%llu,\"blockReads\":%u,\"stalls\":%u,"
+                 "\"stallMs\":%.1f,\"maxReadMs\":%.1f,\"readMsHistogram\":[%u,%u,%u,%u,%u,%u,%u,%u]}}",
+                 (unsigned long long)stats.framesPlayed, (unsigned)stats.underrunEvents,
+                 (unsigned)stats.underrunFrames, (unsigned)stats.bufferedFrames,
+                 (unsigned)stats.capacityFrames, (unsigned)stats.trackTransitions,
+                 stats.lastGapUs / 1000.0, stats.maxGapUs / 1000.0,
+                 (unsigned)playerPtr->getLastSwitchMicros(),
+                 (unsigned)MUSICBOX_SD_SPI_HZ, (unsigned long long)sd.bytesRead,
+                 (unsigned)sd.blockReads, (unsigned)sd.stalls, sd.stallUs / 1000.0,
+                 sd.maxReadUs / 1000.0, (unsigned)sd.latency[0], (unsigned)sd.latency[1],
+                 (unsigned)sd.latency[2], (unsigned)sd.latency[3], (unsigned)sd.latency[4],
+                 (unsigned)sd.latency[5], (unsigned)sd.latency[6], (unsigned)sd.latency[7]);
+        request->send(200, "application/json", json);
+    });
+
     // Handle 404
     server.onNotFound([](AsyncWebServerRequest *request){
         request->send(404, "text/plain", "Not found");
@@ -199,3 +792,13 @@ void initServer(AudioPlayer* player) {
     Serial.println("HTTP server started");
 }
 
+// State changes happen on the audio task and library events on the card
+// monitor's; both are broadcast from here, on loopTask, the only task that
+// sends to the event source's clients.
+void serverLoop() {
+    if (playerPtr == nullptr) return;
+
+    libraryEvents.flush();
+    statePublisher.update(playerPtr->getState(), millis());
+    ws.cleanupClients();
+}
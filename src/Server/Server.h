@@ -1,11 +1,15 @@
 #ifndef SERVER_H
 #define SERVER_H
-#include <AsyncEventSource.h>
+#include <ESPAsyncWebServer.h>
 
 class AudioPlayer;  // Forward declaration - tells compiler the class exists
 
 extern AsyncEventSource events;
+extern AsyncWebSocket ws;
 
 void initServer(AudioPlayer* player);
 
+// Call regularly from loop(): pushes player state changes to SSE clients.
+void serverLoop();
+
 #endif
\ No newline at end of file
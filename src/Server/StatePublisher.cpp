@@ -0,0 +1,190 @@
+#include "StatePublisher.h"
+#include "WsProtocol.h"
+
+StatePublisher::StatePublisher(AsyncEventSource& events, const char* eventName, uint32_t windowMs)
+    : _events(events), _ws(nullptr), _eventName(eventName), _windowMs(windowMs),
+      _state{}, _hasState(false), _lastSendMs(0), _progressSentMs(0), _progressSentPosition(0),
+      _progressSentBitrate(0),
+      _eventsSent(0), _updatesCoalesced(0) {
+    // Random start so a browser that kept its Last-Event-ID across a
+    // reboot is recognised as stale and gets the full state.
+    _firstId = (esp_random() & 0x7FFFFFFF) | 1;
+    _lastId = _firstId - 1;
+    for (int i = 0; i < FIELD_COUNT; i++) {
+        _fieldIds[i] = 0;
+        _dirty[i] = false;
+    }
+}
+
+uint32_t StatePublisher::nextId() {
+    if (++_lastId == 0) ++_lastId;   // 0 means "no id" to EventSource
+    return _lastId;
+}
+
+size_t StatePublisher::format(char* out, size_t size, const bool* include) const {
+    size_t len = 0;
+    char sep = '{';
+
+    for (int i = 0; i < FIELD_COUNT; i++) {
+        if (!include[i]) continue;
+
+        int n = 0;
+        switch (i) {
+            case TRACK_INDEX:
+                n = snprintf(out + len, size - len, "%c\"trackIndex\":%d", sep, _state.trackIndex);
+                break;
+            case IS_PLAYING:
+                n = snprintf(out + len, size - len, "%c\"isPlaying\":%s", sep, _state.isPlaying ? "true" : "false");
+                break;
+            case VOLUME:
+                n = snprintf(out + len, size - len, "%c\"volume\":%d", sep, _state.volume);
+                break;
+            case POSITION:
+                n = snprintf(out + len, size - len, "%c\"positionMs\":%u", sep,
+                             (unsigned)_state.progress.positionMs);
+                break;
+            case DURATION:
+                n = snprintf(out + len, size - len, "%c\"durationMs\":%u", sep,
+                             (unsigned)_state.progress.durationMs);
+                break;
+            case BITRATE:
+                n = snprintf(out + len, size - len, "%c\"bitrate\":%u", sep,
+                             (unsigned)_state.progress.bitrate);
+                break;
+            case PLAY_MODE:
+                n = snprintf(out + len, size - len, "%c\"shuffle\":%s,\"repeat\":\"%s\"", sep,
+                             _state.shuffle ? "true" : "false", repeatModeName(_state.repeat));
+                break;
+        }
+        if (n < 0 || (size_t)n >= size - len) return 0;
+        len += n;
+        sep = ',';
+    }
+
+    if (len == 0 || len + 2 > size) return 0;
+    out[len++] = '}';
+    out[len] = '\0';
+    return len;
+}
+
+bool StatePublisher::progressDue(const PlayerState& state, uint32_t nowMs) const {
+    uint32_t elapsed = nowMs - _progressSentMs;
+    if (elapsed >= PROGRESS_PUBLISH_MS) return true;
+
+    uint32_t expected = _progressSentPosition + (_state.isPlaying ? elapsed : 0);
+    uint32_t position = state.progress.positionMs;
+    uint32_t drift = position > expected ? position - expected : expected - position;
+    return drift > PROGRESS_JUMP_MS;
+}
+
+void StatePublisher::update(const PlayerState& state, uint32_t nowMs) {
+    char json[192];
+    size_t len = 0;
+    uint32_t id = 0;
+    uint8_t frame[WS_STATE_MAX_SIZE];
+    size_t frameLen = 0;
+
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+
+        bool progress = !_hasState || progressDue(state, nowMs);
+        bool changed[FIELD_COUNT] = {
+            !_hasState || state.trackIndex != _state.trackIndex,
+            !_hasState || state.isPlaying != _state.isPlaying,
+            !_hasState || state.volume != _state.volume,
+            progress && state.progress.positionMs != _progressSentPosition,
+            !_hasState || state.progress.durationMs != _state.progress.durationMs,
+            progress && state.progress.bitrate != _progressSentBitrate,
+            !_hasState || state.shuffle != _state.shuffle || state.repeat != _state.repeat,
+        };
+
+        bool any = false;
+        bool pending = false;
+        for (int i = 0; i < FIELD_COUNT; i++) {
+            any |= changed[i];
+            _dirty[i] |= changed[i];
+            pending |= _dirty[i];
+        }
+        _state = state;
+        _hasState = true;
+
+        if (!pending) return;
+
+        if (nowMs - _lastSendMs < _windowMs && _eventsSent > 0) {
+            if (any) _updatesCoalesced++;
+            return;
+        }
+
+        id = nextId();
+        len = format(json, sizeof(json), _dirty);
+
+        uint8_t mask = 0;
+        for (int i = 0; i < FIELD_COUNT; i++) {
+            if (_dirty[i]) mask |= 1 << i;
+        }
+        if (_ws != nullptr && _ws->count() > 0) {
+            frameLen = wsEncodeState(frame, mask, _state);
+        }
+        if (_dirty[POSITION]) {
+            _progressSentMs = nowMs;
+            _progressSentPosition = _state.progress.positionMs;
+        }
+        if (_dirty[BITRATE]) {
+            _progressSentBitrate = _state.progress.bitrate;
+        }
+        for (int i = 0; i < FIELD_COUNT; i++) {
+            if (_dirty[i]) _fieldIds[i] = id;
+            _dirty[i] = false;
+        }
+        _lastSendMs = nowMs;
+        _eventsSent++;
+    }
+
+    // Sent outside the lock so a connecting client never waits on a broadcast.
+    if (len > 0) {
+        _events.send(json, _eventName, id);
+    }
+    if (frameLen > 0) {
+        _ws->binaryAll(frame, frameLen);
+    }
+}
+
+void StatePublisher::onConnect(AsyncEventSourceClient* client) {
+    char json[192];
+    size_t len = 0;
+    uint32_t id = 0;
+
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        if (!_hasState) return;
+
+        uint32_t lastId = client->lastId();
+        bool resumable = lastId != 0 && lastId - _firstId <= _lastId - _firstId;
+
+        bool include[FIELD_COUNT];
+        for (int i = 0; i < FIELD_COUNT; i++) {
+            // Pending fields are newer than anything the client has seen.
+            include[i] = !resumable || _dirty[i] || (int32_t)(_fieldIds[i] - lastId) > 0;
+        }
+
+        id = _lastId;
+        len = format(json, sizeof(json), include);
+    }
+
+    if (len > 0) {
+        client->send(json, _eventName, id);
+    }
+}
+
+void StatePublisher::onConnect(AsyncWebSocketClient* client) {
+    uint8_t frame[WS_STATE_MAX_SIZE];
+    size_t frameLen = 0;
+
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        if (!_hasState) return;
+        frameLen = wsEncodeState(frame, (1 << FIELD_COUNT) - 1, _state);
+    }
+
+    client->binary(frame, frameLen);
+}
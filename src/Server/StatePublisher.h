@@ -0,0 +1,83 @@
+#ifndef STATE_PUBLISHER_H
+#define STATE_PUBLISHER_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <mutex>
+#include "Audio/AudioPlayer.h"
+
+// Default coalescing window: at most one state event per this many ms.
+static constexpr uint32_t STATE_COALESCE_MS = 50;
+
+// Position and bitrate move all the time; they go out at most this often
+// (2 Hz) unless the position jumps by more than PROGRESS_JUMP_MS from where
+// steady playback would have put it (seek, track change).
+static constexpr uint32_t PROGRESS_PUBLISH_MS = 500;
+static constexpr uint32_t PROGRESS_JUMP_MS = 1000;
+
+// Keeps the last published player state and sends SSE events that carry
+// only the fields that changed since the previous event:
+//
+//   id: 1234
+//   event: audio_state
+//   data: {"volume":42}
+//
+// Changes arriving within the window are merged into the next event, so a
+// slider drag costs one small event per window instead of one full
+// document per step. Every field remembers the id of the event that last
+// changed it; a client reconnecting with Last-Event-ID only gets the
+// fields that changed after that id.
+//
+// The same diffs go to WebSocket clients in binary form (WsProtocol.h).
+class StatePublisher {
+public:
+    // Bit i of a WS_OP_STATE mask.
+    enum Field : uint8_t { TRACK_INDEX, IS_PLAYING, VOLUME, POSITION, DURATION, BITRATE, PLAY_MODE, FIELD_COUNT };
+
+    explicit StatePublisher(AsyncEventSource& events, const char* eventName = "audio_state",
+                            uint32_t windowMs = STATE_COALESCE_MS);
+
+    void setWindow(uint32_t windowMs) { _windowMs = windowMs; }
+
+    // Also broadcast every event to this socket's clients.
+    void attach(AsyncWebSocket& ws) { _ws = &ws; }
+
+    // Call regularly from one task with the player's current state.
+    void update(const PlayerState& state, uint32_t nowMs);
+
+    // From the event source's onConnect (AsyncTCP task).
+    void onConnect(AsyncEventSourceClient* client);
+    // WebSocket clients always start from the full state.
+    void onConnect(AsyncWebSocketClient* client);
+
+    uint32_t lastEventId() const { return _lastId; }
+    uint32_t eventsSent() const { return _eventsSent; }
+    uint32_t updatesCoalesced() const { return _updatesCoalesced; }
+
+private:
+    AsyncEventSource& _events;
+    AsyncWebSocket* _ws;
+    const char* _eventName;
+    uint32_t _windowMs;
+
+    std::mutex _lock;
+    PlayerState _state;
+    bool _hasState;
+    uint32_t _fieldIds[FIELD_COUNT];    // Event id that last changed each field
+    bool _dirty[FIELD_COUNT];
+
+    uint32_t _firstId;                  // Ids from before this boot fall outside
+    uint32_t _lastId;                   // [_firstId, _lastId]
+    uint32_t _lastSendMs;
+    uint32_t _progressSentMs;
+    uint32_t _progressSentPosition;
+    uint32_t _progressSentBitrate;
+    uint32_t _eventsSent;
+    uint32_t _updatesCoalesced;
+
+    uint32_t nextId();
+    bool progressDue(const PlayerState& state, uint32_t nowMs) const;
+    size_t format(char* out, size_t size, const bool* include) const;
+};
+
+#endif
@@ -0,0 +1,91 @@
+#include "WsProtocol.h"
+#include "StatePublisher.h"
+
+static void putU32(uint8_t* out, uint32_t value) {
+    out[0] = value;
+    out[1] = value >> 8;
+    out[2] = value >> 16;
+    out[3] = value >> 24;
+}
+
+static uint32_t getU32(const uint8_t* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+bool wsDecodeCommand(const uint8_t* data, size_t len, WsCommand& command) {
+    if (len != WS_COMMAND_SIZE || (data[0] & 0x80)) return false;
+
+    command.opcode = data[0];
+    command.seq = data[1];
+    command.value = (int32_t)getU32(data + 2);
+    return true;
+}
+
+bool wsToPlayerCommand(const WsCommand& command, PlayerCommand::Type& type) {
+    switch (command.opcode) {
+        case WS_OP_PLAY:     type = PlayerCommand::PLAY; return true;
+        case WS_OP_PAUSE:    type = PlayerCommand::PAUSE; return true;
+        case WS_OP_NEXT:     type = PlayerCommand::NEXT; return true;
+        case WS_OP_PREVIOUS: type = PlayerCommand::PREVIOUS; return true;
+        case WS_OP_SEEK:     type = PlayerCommand::SEEK; return command.value >= 0;
+        case WS_OP_VOLUME:   type = PlayerCommand::VOLUME; return command.value >= 0 && command.value <= 100;
+        case WS_OP_SELECT:   type = PlayerCommand::SELECT; return command.value >= 0;
+        case WS_OP_SHUFFLE:  type = PlayerCommand::SHUFFLE; return command.value == 0 || command.value == 1;
+        case WS_OP_REPEAT:   type = PlayerCommand::REPEAT; return command.value >= 0 && command.value < REPEAT_MODE_COUNT;
+        default:             return false;
+    }
+}
+
+size_t wsEncodeCommand(uint8_t* out, const WsCommand& command) {
+    out[0] = command.opcode;
+    out[1] = command.seq;
+    putU32(out + 2, (uint32_t)command.value);
+    return WS_COMMAND_SIZE;
+}
+
+size_t wsEncodeAck(uint8_t* out, uint8_t seq, uint8_t status) {
+    out[0] = WS_OP_ACK;
+    out[1] = seq;
+    out[2] = status;
+    return WS_ACK_SIZE;
+}
+
+size_t wsEncodePong(uint8_t* out, const WsCommand& ping) {
+    out[0] = WS_OP_PONG;
+    out[1] = ping.seq;
+    putU32(out + 2, (uint32_t)ping.value);
+    return WS_COMMAND_SIZE;
+}
+
+size_t wsEncodeState(uint8_t* out, uint8_t mask, const PlayerState& state) {
+    size_t len = 0;
+    out[len++] = WS_OP_STATE;
+    out[len++] = mask;
+
+    if (mask & (1 << StatePublisher::TRACK_INDEX)) {
+        putU32(out + len, (uint32_t)state.trackIndex);
+        len += 4;
+    }
+    if (mask & (1 << StatePublisher::IS_PLAYING)) {
+        out[len++] = state.isPlaying ? 1 : 0;
+    }
+    if (mask & (1 << StatePublisher::VOLUME)) {
+        out[len++] = (uint8_t)state.volume;
+    }
+    if (mask & (1 << StatePublisher::POSITION)) {
+        putU32(out + len, state.progress.positionMs);
+        len += 4;
+    }
+    if (mask & (1 << StatePublisher::DURATION)) {
+        putU32(out + len, state.progress.durationMs);
+        len += 4;
+    }
+    if (mask & (1 << StatePublisher::BITRATE)) {
+        putU32(out + len, state.progress.bitrate);
+        len += 4;
+    }
+    if (mask & (1 << StatePublisher::PLAY_MODE)) {
+        out[len++] = (state.shuffle ? 1 : 0) | (uint8_t)(state.repeat << 1);
+    }
+    return len;
+}
@@ -0,0 +1,68 @@
+#ifndef WS_PROTOCOL_H
+#define WS_PROTOCOL_H
+
+#include <Arduino.h>
+#include "Audio/AudioPlayer.h"
+
+// Binary framing for the /ws control channel. All integers little-endian.
+//
+// Client -> box, always WS_COMMAND_SIZE bytes:
+//   [opcode][seq][value:int32]
+//   seq is echoed back so the client can match replies; value is the
+//   volume (0-100), track index, seek position in seconds, shuffle (0/1)
+//   or repeat mode (0 off, 1 all, 2 one), else 0.
+//
+// Box -> client:
+//   ACK    [0x80][seq][status]
+//   STATE  [0x81][mask][fields...]   only the fields whose bit is set, in
+//          order: trackIndex:int32, isPlaying:u8, volume:u8,
+//          positionMs:u32, durationMs:u32, bitrate:u32,
+//          playMode:u8 (bit 0 shuffle, bits 1-2 repeat mode)
+//   PONG   [0x8F][seq][value:int32]  echo of a PING
+enum WsOpcode : uint8_t {
+    WS_OP_PLAY = 0x01,
+    WS_OP_PAUSE = 0x02,
+    WS_OP_NEXT = 0x03,
+    WS_OP_PREVIOUS = 0x04,
+    WS_OP_SEEK = 0x05,
+    WS_OP_VOLUME = 0x06,
+    WS_OP_SELECT = 0x07,
+    WS_OP_SHUFFLE = 0x08,
+    WS_OP_REPEAT = 0x09,
+    WS_OP_PING = 0x0F,
+
+    WS_OP_ACK = 0x80,
+    WS_OP_STATE = 0x81,
+    WS_OP_PONG = 0x8F,
+};
+
+enum WsStatus : uint8_t {
+    WS_STATUS_OK = 0,
+    WS_STATUS_BUSY = 1,         // Command queue full, try again
+    WS_STATUS_BAD_REQUEST = 2,
+};
+
+static constexpr size_t WS_COMMAND_SIZE = 6;
+static constexpr size_t WS_ACK_SIZE = 3;
+static constexpr size_t WS_STATE_MAX_SIZE = 21;
+
+struct WsCommand {
+    uint8_t opcode;
+    uint8_t seq;
+    int32_t value;
+};
+
+bool wsDecodeCommand(const uint8_t* data, size_t len, WsCommand& command);
+
+// Maps a control opcode onto the player's command queue. False for PING
+// and unknown opcodes.
+bool wsToPlayerCommand(const WsCommand& command, PlayerCommand::Type& type);
+
+size_t wsEncodeCommand(uint8_t* out, const WsCommand& command);
+size_t wsEncodeAck(uint8_t* out, uint8_t seq, uint8_t status);
+size_t wsEncodePong(uint8_t* out, const WsCommand& ping);
+
+// mask bit i selects StatePublisher field i.
+size_t wsEncodeState(uint8_t* out, uint8_t mask, const PlayerState& state);
+
+#endif
@@ -0,0 +1,105 @@
+// ============================================================================
+// ClockSync.cpp
+// ============================================================================
+#include "ClockSync.h"
+
+// Weight of each new skew measurement; slow, since one comes every window.
+static constexpr float SKEW_SMOOTHING = 0.3f;
+
+// Anything beyond this is a bad anchor pair, not a crystal (±500 ppm).
+static constexpr float SKEW_LIMIT = 500e-6f;
+
+ClockSync::ClockSync() {
+    reset();
+}
+
+void ClockSync::reset() {
+    _head = 0;
+    _count = 0;
+    _samples = 0;
+    _offset = 0;
+    _refLocal = 0;
+    _bestRtt = 0;
+    _skew = 0;
+    _anchorHead = 0;
+    _anchorCount = 0;
+    _sinceAnchor = 0;
+}
+
+void ClockSync::addSample(int64_t t1, int64_t t2, int64_t t3, int64_t t4) {
+    int64_t rtt = (t4 - t1) - (t3 - t2);
+    if (rtt < 0) rtt = 0;
+
+    Exchange& e = _window[_head];
+    e.offset = ((t2 - t1) + (t3 - t4)) / 2;
+    e.local = t4;
+    e.rtt = (uint32_t)rtt;
+    _head = (_head + 1) % CLOCK_SYNC_WINDOW;
+    if (_count < CLOCK_SYNC_WINDOW) _count++;
+    _samples++;
+
+    select();
+
+    // Once per window, record the estimate; the change in offset between
+    // the oldest and newest recorded is the skew.
+    if (++_sinceAnchor < CLOCK_SYNC_WINDOW) return;
+    _sinceAnchor = 0;
+
+    _anchors[_anchorHead] = Anchor{ _offset, _refLocal };
+    _anchorHead = (_anchorHead + 1) % CLOCK_SYNC_ANCHORS;
+    if (_anchorCount < CLOCK_SYNC_ANCHORS) _anchorCount++;
+    if (_anchorCount < 2) return;
+
+    const Anchor& oldest = _anchors[(_anchorHead + CLOCK_SYNC_ANCHORS - _anchorCount) % CLOCK_SYNC_ANCHORS];
+    if (_refLocal <= oldest.local) return;
+    float measured = (float)(_offset - oldest.offset) / (float)(_refLocal - oldest.local);
+    if (measured > -SKEW_LIMIT && measured < SKEW_LIMIT) {
+        _skew += SKEW_SMOOTHING * (measured - _skew);
+    }
+}
+
+// Averages the CLOCK_SYNC_BEST lowest round trips, each carried forward
+// by the skew to the newest of them.
+void ClockSync::select() {
+    const Exchange* best[CLOCK_SYNC_BEST] = {};
+    size_t n = 0;
+    for (size_t i = 0; i < _count; i++) {
+        const Exchange* e = &_window[i];
+        size_t at = n < CLOCK_SYNC_BEST ? n++ : CLOCK_SYNC_BEST;
+        while (at > 0 && best[at - 1]->rtt > e->rtt) {
+            if (at < CLOCK_SYNC_BEST) best[at] = best[at - 1];
+            at--;
+        }
+        if (at < CLOCK_SYNC_BEST) best[at] = e;
+    }
+
+    int64_t ref = best[0]->local;
+    for (size_t i = 1; i < n; i++) {
+        if (best[i]->local > ref) ref = best[i]->local;
+    }
+    int64_t sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        sum += best[i]->offset + (int64_t)(_skew * (float)(ref - best[i]->local));
+    }
+
+    int64_t target = sum / (int64_t)n;
+    int64_t current = offsetAt(ref);
+    int64_t change = target - current;
+    if (_samples <= 1 || change > CLOCK_SYNC_STEP_US || change < -CLOCK_SYNC_STEP_US) {
+        _offset = target;
+    } else {
+        _offset = current + change / (1 << CLOCK_SYNC_SLEW_SHIFT);
+    }
+    _refLocal = ref;
+    _bestRtt = best[0]->rtt;
+}
+
+int64_t ClockSync::offsetAt(int64_t localUs) const {
+    return _offset + (int64_t)(_skew * (float)(localUs - _refLocal));
+}
+
+int64_t ClockSync::toLocal(int64_t leaderUs) const {
+    // offset changes by ppm, so evaluating it at the uncorrected time is
+    // accurate to well under a microsecond.
+    return leaderUs - offsetAt(leaderUs - _offset);
+}
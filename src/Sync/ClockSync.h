@@ -0,0 +1,86 @@
+// ============================================================================
+// ClockSync.h
+// Follower-side estimate of the leader clock from NTP-style exchanges.
+// Each exchange gives offset = ((t2 - t1) + (t3 - t4)) / 2, which is only
+// as good as the path was symmetric; the exchanges with the smallest
+// round trips in a short window are the ones least disturbed by queueing,
+// so the estimate averages those. The result is slewed toward rather than
+// jumped to, since every jump the player sees is a cut or a pad. Crystal
+// drift between boxes is tracked as a skew so the estimate holds between
+// exchanges.
+// ============================================================================
+#ifndef CLOCK_SYNC_H
+#define CLOCK_SYNC_H
+
+#include <Arduino.h>
+
+// Exchanges remembered for the minimum-round-trip pick (~4 s at 250 ms).
+static constexpr size_t CLOCK_SYNC_WINDOW = 16;
+
+// Lowest-round-trip exchanges averaged into the estimate.
+static constexpr size_t CLOCK_SYNC_BEST = 4;
+
+// Window estimates kept for the skew; it is measured across all of them
+// (~30 s at 250 ms), as offset noise over a single window swamps ppm.
+static constexpr size_t CLOCK_SYNC_ANCHORS = 8;
+
+// Share of each new estimate taken (1/4); a change larger than the step
+// limit (leader restart, first lock) is taken at once.
+static constexpr int CLOCK_SYNC_SLEW_SHIFT = 2;
+static constexpr int64_t CLOCK_SYNC_STEP_US = 20000;
+
+// Exchanges needed before the estimate is trusted.
+static constexpr size_t CLOCK_SYNC_LOCK_SAMPLES = 4;
+
+class ClockSync {
+public:
+    ClockSync();
+
+    // One completed exchange; t4 is the local arrival time of the reply.
+    void addSample(int64_t t1, int64_t t2, int64_t t3, int64_t t4);
+    void reset();
+
+    bool isLocked() const { return _samples >= CLOCK_SYNC_LOCK_SAMPLES; }
+
+    // Leader minus local clock at the given local time.
+    int64_t offsetAt(int64_t localUs) const;
+    int64_t toLocal(int64_t leaderUs) const;
+    int64_t toLeader(int64_t localUs) const { return localUs + offsetAt(localUs); }
+
+    uint32_t bestRttUs() const { return _bestRtt; }
+    // How much faster the local clock runs than the leader's.
+    float skewPpm() const { return -_skew * 1e6f; }
+    uint32_t samples() const { return _samples; }
+
+private:
+    struct Exchange {
+        int64_t offset;
+        int64_t local;     // t4
+        uint32_t rtt;
+    };
+
+    Exchange _window[CLOCK_SYNC_WINDOW];
+    size_t _head;
+    size_t _count;
+    uint32_t _samples;
+
+    // Current estimate: offset(t) = _offset + _skew * (t - _refLocal).
+    int64_t _offset;
+    int64_t _refLocal;
+    uint32_t _bestRtt;
+    float _skew;
+
+    // One estimate per full window, oldest first once wrapped.
+    struct Anchor {
+        int64_t offset;
+        int64_t local;
+    };
+    Anchor _anchors[CLOCK_SYNC_ANCHORS];
+    size_t _anchorHead;
+    size_t _anchorCount;
+    uint32_t _sinceAnchor;
+
+    void select();
+};
+
+#endif
@@ -0,0 +1,115 @@
+// ============================================================================
+// JitterBuffer.cpp
+// ============================================================================
+#include "JitterBuffer.h"
+
+JitterBuffer::JitterBuffer()
+    : _slots(nullptr), _used(nullptr), _capacity(0),
+      _started(false), _next(0), _highest(0), _depth(0) {
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+JitterBuffer::~JitterBuffer() {
+    free(_slots);
+    free(_used);
+}
+
+bool JitterBuffer::begin(size_t slots) {
+    if (_slots != nullptr) return true;
+
+    size_t bytes = slots * sizeof(Packet);
+    _slots = psramFound() ? (Packet*)ps_malloc(bytes) : nullptr;
+    if (_slots == nullptr) _slots = (Packet*)malloc(bytes);
+    _used = (bool*)calloc(slots, sizeof(bool));
+    if (_slots == nullptr || _used == nullptr) {
+        Serial.println("ERROR: Not enough memory for the sync jitter buffer!");
+        free(_slots);
+        free(_used);
+        _slots = nullptr;
+        _used = nullptr;
+        return false;
+    }
+    _capacity = slots;
+    return true;
+}
+
+bool JitterBuffer::insert(const SyncAudioHeader& header, const uint8_t* payload, size_t bytes) {
+    if (_capacity == 0) return false;
+
+    size_t expected = (size_t)header.frames * header.channels * sizeof(int16_t);
+    if (header.frames > SYNC_PACKET_FRAMES || header.channels == 0 || header.channels > 2 ||
+        bytes < expected) {
+        return false;
+    }
+
+    if (!_started) {
+        _started = true;
+        _next = header.seq;
+        _highest = header.seq;
+    }
+
+    int16_t ahead = (int16_t)(header.seq - _next);
+    if (ahead < 0) {
+        _stats.late++;
+        return false;
+    }
+    if ((size_t)ahead >= _capacity) {
+        _stats.overflow++;
+        return false;
+    }
+
+    size_t slot = slotOf(header.seq);
+    if (_used[slot]) {
+        _stats.duplicate++;
+        return false;
+    }
+
+    if ((int16_t)(header.seq - _highest) < 0) {
+        _stats.reordered++;
+    } else {
+        _highest = header.seq;
+    }
+
+    _slots[slot].header = header;
+    memcpy(_slots[slot].samples, payload, expected);
+    _used[slot] = true;
+    _depth++;
+    _stats.received++;
+    return true;
+}
+
+const JitterBuffer::Packet* JitterBuffer::peek() const {
+    if (_depth == 0) return nullptr;
+    for (uint16_t seq = _next; ; seq++) {
+        size_t slot = slotOf(seq);
+        if (_used[slot]) return &_slots[slot];
+    }
+}
+
+uint16_t JitterBuffer::missingBefore() const {
+    const Packet* packet = peek();
+    return packet ? (uint16_t)(packet->header.seq - _next) : 0;
+}
+
+void JitterBuffer::pop() {
+    const Packet* packet = peek();
+    if (packet == nullptr) return;
+
+    uint16_t seq = packet->header.seq;
+    _stats.lost += (uint16_t)(seq - _next);
+    _used[slotOf(seq)] = false;
+    _depth--;
+    _next = seq + 1;
+}
+
+void JitterBuffer::reset() {
+    if (_used) memset(_used, 0, _capacity * sizeof(bool));
+    _started = false;
+    _depth = 0;
+}
+
+JitterBufferStats JitterBuffer::getStats() const {
+    JitterBufferStats stats = _stats;
+    stats.depth = _depth;
+    return stats;
+}
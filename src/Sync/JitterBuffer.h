@@ -0,0 +1,70 @@
+// ============================================================================
+// JitterBuffer.h
+// Reorders the leader's audio packets by sequence number and holds them
+// until their play time. Slots are indexed by seq modulo the capacity, so
+// insert and lookup never search or allocate.
+// ============================================================================
+#ifndef JITTER_BUFFER_H
+#define JITTER_BUFFER_H
+
+#include <Arduino.h>
+#include "SyncProtocol.h"
+
+// 64 packets of 6.5 ms: ~420 ms, more than the leader's ring lead.
+static constexpr size_t JITTER_SLOTS = 64;
+
+struct JitterBufferStats {
+    uint32_t received;     // Accepted into the buffer
+    uint32_t late;         // Arrived after their slot was played or skipped
+    uint32_t duplicate;
+    uint32_t reordered;    // Arrived after a higher seq, still in time
+    uint32_t lost;         // Never arrived; skipped over
+    uint32_t overflow;     // Too far ahead of the playout point
+    size_t depth;          // Packets currently held
+};
+
+class JitterBuffer {
+public:
+    struct Packet {
+        SyncAudioHeader header;
+        int16_t samples[SYNC_PACKET_FRAMES * 2];
+    };
+
+    JitterBuffer();
+    ~JitterBuffer();
+
+    // Slots go to PSRAM when the board has it.
+    bool begin(size_t slots = JITTER_SLOTS);
+
+    // Copies the packet in; false if it was dropped (see stats).
+    bool insert(const SyncAudioHeader& header, const uint8_t* payload, size_t bytes);
+
+    // Oldest packet held, or nullptr. missingBefore() is how many expected
+    // packets are absent ahead of it.
+    const Packet* peek() const;
+    uint16_t missingBefore() const;
+
+    // Drops the peeked packet, and everything missing before it as lost.
+    void pop();
+
+    // Forgets everything; the next insert starts a new sequence.
+    void reset();
+
+    JitterBufferStats getStats() const;
+
+private:
+    Packet* _slots;
+    bool* _used;
+    size_t _capacity;
+
+    bool _started;
+    uint16_t _next;       // Next seq to play
+    uint16_t _highest;    // Highest seq accepted
+    size_t _depth;
+
+    JitterBufferStats _stats;
+
+    size_t slotOf(uint16_t seq) const { return seq % _capacity; }
+};
+
+#endif
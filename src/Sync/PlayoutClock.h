@@ -0,0 +1,51 @@
+// ============================================================================
+// PlayoutClock.h
+// When the next queued frame will be clocked out, for a contiguous PCM
+// stream. Each measurement (now + AudioOutput::latencyUs()) is off by
+// however late the I2S task was to stamp its chunk; the frames queued
+// since the last one are exact. So the clock advances by frames and only
+// leans toward measurements, snapping to them after a real jump (discard,
+// underrun).
+// ============================================================================
+#ifndef PLAYOUT_CLOCK_H
+#define PLAYOUT_CLOCK_H
+
+#include <Arduino.h>
+
+// Beyond this the measurement is a jump in the stream, not noise.
+static constexpr int64_t PLAYOUT_SNAP_US = 5000;
+
+// Share of each measurement's disagreement taken (1/16): settles within
+// ~0.1 s at packet rate, and still tracks a DAC crystal off by 1000 ppm.
+static constexpr int PLAYOUT_SMOOTHING_SHIFT = 4;
+
+class PlayoutClock {
+public:
+    PlayoutClock() : _valid(false), _nextNs(0) {}
+
+    // Smoothed time for the frame measured at measuredUs.
+    int64_t update(int64_t measuredUs) {
+        int64_t measuredNs = measuredUs * 1000;
+        int64_t error = measuredNs - _nextNs;
+        if (!_valid || error > PLAYOUT_SNAP_US * 1000 || error < -PLAYOUT_SNAP_US * 1000) {
+            _nextNs = measuredNs;
+            _valid = true;
+        } else {
+            _nextNs += error / (1 << PLAYOUT_SMOOTHING_SHIFT);
+        }
+        return _nextNs / 1000;
+    }
+
+    // frames were queued behind the last updated one.
+    void advance(size_t frames, uint32_t sampleRate) {
+        if (sampleRate > 0) _nextNs += (int64_t)frames * 1000000000 / sampleRate;
+    }
+
+    void reset() { _valid = false; }
+
+private:
+    bool _valid;
+    int64_t _nextNs;
+};
+
+#endif
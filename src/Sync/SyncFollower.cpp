@@ -0,0 +1,209 @@
+// ============================================================================
+// SyncFollower.cpp
+// ============================================================================
+#include "SyncFollower.h"
+
+// Same slot as the decode task it replaces on a follower.
+static constexpr UBaseType_t SYNC_FOLLOWER_TASK_PRIORITY = 10;
+
+SyncFollower::SyncFollower(AudioOutput& output, SyncClockSource clock)
+    : _output(output), _now(clock), _task(nullptr),
+      _haveLeader(false), _clockSeq(0), _clockSentMs(0),
+      _haveStream(false), _stream(0), _streamSeenMs(0), _sampleRate(0) {
+    memset(_silence, 0, sizeof(_silence));
+    memset(&_stats, 0, sizeof(_stats));
+}
+
+bool SyncFollower::begin() {
+    if (_task != nullptr) return true;
+
+    if (!_jitter.begin()) return false;
+
+    IPAddress group(SYNC_MULTICAST_GROUP[0], SYNC_MULTICAST_GROUP[1],
+                    SYNC_MULTICAST_GROUP[2], SYNC_MULTICAST_GROUP[3]);
+    if (!_audioUdp.beginMulticast(group, SYNC_AUDIO_PORT) ||
+        !_clockUdp.begin(SYNC_CLOCK_REPLY_PORT)) {
+        Serial.println("ERROR: Sync follower could not open its sockets!");
+        return false;
+    }
+
+    if (xTaskCreatePinnedToCore(taskEntry, "sync_follow", 4096, this,
+                                SYNC_FOLLOWER_TASK_PRIORITY, &_task, AUDIO_TASK_CORE) != pdPASS) {
+        Serial.println("ERROR: Failed to start sync follower task!");
+        return false;
+    }
+
+    Serial.printf("✓ Sync follower: listening on %s:%u\n", group.toString().c_str(),
+                  (unsigned)SYNC_AUDIO_PORT);
+    return true;
+}
+
+void SyncFollower::taskEntry(void* param) {
+    static_cast<SyncFollower*>(param)->run();
+}
+
+void SyncFollower::run() {
+    for (;;) {
+        receiveClock();
+        requestClock();
+        receiveAudio();
+        drain();
+
+        _output.setPlaying(_haveStream && millis() - _streamSeenMs < SYNC_STREAM_TIMEOUT_MS);
+
+        int64_t now = _now();
+        _stats.locked = _clock.isLocked();
+        _stats.sampledAtUs = now;
+        _stats.offsetUs = _clock.offsetAt(now);
+        _stats.rttUs = _clock.bestRttUs();
+        _stats.skewPpm = _clock.skewPpm();
+        _stats.jitter = _jitter.getStats();
+        _published.write(_stats);
+
+        vTaskDelay(1);
+    }
+}
+
+// The leader's address is learned from its audio; until then there is
+// nobody to ask.
+void SyncFollower::requestClock() {
+    if (!_haveLeader) return;
+
+    uint32_t interval = _clock.samples() < CLOCK_SYNC_WINDOW ? SYNC_CLOCK_FAST_MS
+                                                             : SYNC_CLOCK_INTERVAL_MS;
+    uint32_t nowMs = millis();
+    if (nowMs - _clockSentMs < interval) return;
+    _clockSentMs = nowMs;
+
+    SyncClockPacket packet;
+    memset(&packet, 0, sizeof(packet));
+    packet.magic = SYNC_MAGIC;
+    packet.type = SYNC_CLOCK_REQUEST;
+    packet.seq = _clockSeq++;
+
+    _clockUdp.beginPacket(_leader, SYNC_CLOCK_PORT);
+    packet.t1 = _now();
+    _clockUdp.write((const uint8_t*)&packet, sizeof(packet));
+    _clockUdp.endPacket();
+}
+
+// t1 comes back in the reply, so an answer to any earlier request is as
+// good as one to the latest.
+void SyncFollower::receiveClock() {
+    while (_clockUdp.parsePacket() > 0) {
+        int64_t t4 = _now();
+
+        SyncClockPacket packet;
+        if (_clockUdp.read((uint8_t*)&packet, sizeof(packet)) != (int)sizeof(packet) ||
+            packet.magic != SYNC_MAGIC || packet.type != SYNC_CLOCK_REPLY) {
+            continue;
+        }
+        _clock.addSample(packet.t1, packet.t2, packet.t3, t4);
+    }
+}
+
+void SyncFollower::receiveAudio() {
+    int size;
+    while ((size = _audioUdp.parsePacket()) > 0) {
+        if (size > (int)sizeof(_rx)) continue;
+        int n = _audioUdp.read(_rx, sizeof(_rx));
+        if (n < (int)sizeof(SyncAudioHeader)) continue;
+
+        SyncAudioHeader header;
+        memcpy(&header, _rx, sizeof(header));
+        if (header.magic != SYNC_MAGIC || header.type != SYNC_AUDIO || header.sampleRate == 0) {
+            continue;
+        }
+
+        // Newer streams replace the current one at once; an older one is a
+        // straggler unless the current stream has gone quiet (leader restart).
+        uint32_t nowMs = millis();
+        if (!_haveStream || header.stream != _stream) {
+            bool newer = (int16_t)(header.stream - _stream) > 0;
+            bool stale = nowMs - _streamSeenMs >= SYNC_STREAM_TIMEOUT_MS;
+            if (_haveStream && !newer && !stale) continue;
+
+            if (_haveStream) {
+                _jitter.reset();
+                _output.discard();
+                _playout.reset();
+                _stats.streamChanges++;
+            }
+            _haveStream = true;
+            _stream = header.stream;
+        }
+        _streamSeenMs = nowMs;
+
+        if (!_haveLeader || !(_audioUdp.remoteIP() == _leader)) {
+            _leader = _audioUdp.remoteIP();
+            _haveLeader = true;
+            _clock.reset();
+        }
+
+        _jitter.insert(header, _rx + sizeof(header), n - sizeof(header));
+    }
+}
+
+void SyncFollower::drain() {
+    if (!_clock.isLocked()) return;
+
+    const JitterBuffer::Packet* packet;
+    while ((packet = _jitter.peek()) != nullptr) {
+        const SyncAudioHeader& header = packet->header;
+        uint32_t rate = header.sampleRate;
+        if (rate != _sampleRate) {
+            _output.setSampleRate(rate);
+            _sampleRate = rate;
+        }
+
+        // Keeps about the lead in the ring, far below its capacity, so
+        // write() never blocks the receive path.
+        int64_t now = _now();
+        int64_t playAt = _clock.toLocal(header.playAtUs);
+        if (playAt - now > (int64_t)SYNC_OUTPUT_LEAD_US) return;
+        int64_t outAt = _playout.update(now + _output.latencyUs(rate));
+
+        // Positive: the DAC would reach this packet late.
+        int64_t error = outAt - playAt;
+        const int16_t* samples = packet->samples;
+        size_t frames = header.frames;
+        bool concealing = _jitter.missingBefore() > 0;
+
+        if (error > (int64_t)SYNC_TOLERANCE_US) {
+            size_t cut = (size_t)(error * rate / 1000000);
+            if (cut >= frames) {
+                _stats.slipFrames += frames;
+                _jitter.pop();
+                continue;
+            }
+            samples += cut * header.channels;
+            frames -= cut;
+            _stats.slipFrames += cut;
+            error -= (int64_t)cut * 1000000 / rate;
+        } else if (error < -(int64_t)SYNC_TOLERANCE_US) {
+            size_t pad = (size_t)(-error * rate / 1000000);
+            writeSilence(pad, header.channels);
+            _playout.advance(pad, rate);
+            if (concealing) {
+                _stats.concealedFrames += pad;
+            } else {
+                _stats.padFrames += pad;
+            }
+            error += (int64_t)pad * 1000000 / rate;
+        }
+
+        _output.write(samples, frames, header.channels);
+        _playout.advance(frames, rate);
+        _stats.lastErrorUs = (int32_t)error;
+        _stats.packetsPlayed++;
+        _jitter.pop();
+    }
+}
+
+void SyncFollower::writeSilence(size_t frames, uint8_t channels) {
+    while (frames > 0) {
+        size_t n = frames < SYNC_PACKET_FRAMES ? frames : SYNC_PACKET_FRAMES;
+        _output.write(_silence, n, channels);
+        frames -= n;
+    }
+}
@@ -0,0 +1,104 @@
+// ============================================================================
+// SyncFollower.h
+// Plays the leader's stream on this box's DAC at the leader's schedule.
+// A task keeps the clock estimate fresh, files incoming packets into the
+// jitter buffer, and writes each one to the output once its play time
+// (in local time) is within SYNC_OUTPUT_LEAD_US. Just before a packet is
+// queued, the time its first frame will really be clocked out is compared
+// with when it should be; beyond SYNC_TOLERANCE_US the difference is cut
+// from the packet or padded with silence.
+// ============================================================================
+#ifndef SYNC_FOLLOWER_H
+#define SYNC_FOLLOWER_H
+
+#include <Arduino.h>
+#include <WiFiUdp.h>
+#include "SyncProtocol.h"
+#include "ClockSync.h"
+#include "JitterBuffer.h"
+#include "PlayoutClock.h"
+#include "Audio/AudioOutput.h"
+#include "Audio/Seqlock.h"
+
+// How far ahead of its play time a packet is queued for the DAC. Only
+// needs to cover the task's scheduling jitter; the rest of the network
+// slack sits in the jitter buffer.
+static constexpr uint32_t SYNC_OUTPUT_LEAD_US = 40000;
+
+// Scheduling error corrected by cutting or padding samples. Smaller than
+// the few ms at which rooms audibly echo, larger than clock estimate noise.
+static constexpr uint32_t SYNC_TOLERANCE_US = 1000;
+
+// Clock exchanges: quick until the window is full, then a steady trickle.
+static constexpr uint32_t SYNC_CLOCK_FAST_MS = 20;
+static constexpr uint32_t SYNC_CLOCK_INTERVAL_MS = 250;
+
+// A stream that has been silent this long may be replaced by any other.
+static constexpr uint32_t SYNC_STREAM_TIMEOUT_MS = 1000;
+
+typedef int64_t (*SyncClockSource)();
+
+struct SyncFollowerStats {
+    bool locked;
+    int64_t sampledAtUs;      // Local time the clock fields refer to
+    int64_t offsetUs;         // Leader minus local clock
+    uint32_t rttUs;           // Of the exchange in use
+    float skewPpm;
+    JitterBufferStats jitter;
+    uint32_t packetsPlayed;
+    uint32_t streamChanges;
+    uint32_t slipFrames;      // Cut to catch up
+    uint32_t padFrames;       // Silence inserted to wait
+    uint32_t concealedFrames; // Silence in place of lost packets
+    int32_t lastErrorUs;      // Left after correction; + means late
+};
+
+class SyncFollower {
+public:
+    // The clock source is replaceable so host tests can give the follower
+    // its own offset and drift.
+    explicit SyncFollower(AudioOutput& output, SyncClockSource clock = esp_timer_get_time);
+
+    // Opens the sockets and starts the follower task.
+    bool begin();
+
+    // Any task.
+    SyncFollowerStats getStats() const { return _published.read(); }
+
+private:
+    AudioOutput& _output;
+    SyncClockSource _now;
+    TaskHandle_t _task;
+
+    WiFiUDP _audioUdp;
+    WiFiUDP _clockUdp;
+    IPAddress _leader;
+    bool _haveLeader;
+
+    ClockSync _clock;
+    uint16_t _clockSeq;
+    uint32_t _clockSentMs;
+
+    JitterBuffer _jitter;
+    bool _haveStream;
+    uint16_t _stream;
+    uint32_t _streamSeenMs;
+    uint32_t _sampleRate;
+    PlayoutClock _playout;
+
+    uint8_t _rx[SYNC_AUDIO_MAX_PACKET];
+    int16_t _silence[SYNC_PACKET_FRAMES * 2];
+
+    SyncFollowerStats _stats;
+    Seqlock<SyncFollowerStats> _published;
+
+    static void taskEntry(void* param);
+    void run();
+    void requestClock();
+    void receiveClock();
+    void receiveAudio();
+    void drain();
+    void writeSilence(size_t frames, uint8_t channels);
+};
+
+#endif
@@ -0,0 +1,114 @@
+// ============================================================================
+// SyncLeader.cpp
+// ============================================================================
+#include "SyncLeader.h"
+
+// Above the decode task: the reply's t2 should be stamped as close to the
+// request's arrival as the 1 ms poll allows.
+static constexpr UBaseType_t SYNC_CLOCK_TASK_PRIORITY = 15;
+
+SyncLeader::SyncLeader()
+    : _group(SYNC_MULTICAST_GROUP[0], SYNC_MULTICAST_GROUP[1],
+             SYNC_MULTICAST_GROUP[2], SYNC_MULTICAST_GROUP[3]),
+      _clockTask(nullptr), _seq(0), _stream(0),
+      _packetsSent(0), _sendErrors(0), _clockReplies(0) {
+}
+
+bool SyncLeader::begin() {
+    if (_clockTask != nullptr) return true;
+
+    if (!_clockUdp.begin(SYNC_CLOCK_PORT)) {
+        Serial.println("ERROR: Sync leader could not open the clock port!");
+        return false;
+    }
+
+    // A restarted leader must not look like an old stream to followers.
+    _seq = (uint16_t)esp_random();
+    _stream = (uint16_t)esp_random();
+
+    if (xTaskCreatePinnedToCore(clockTaskEntry, "sync_clock", 3072, this,
+                                SYNC_CLOCK_TASK_PRIORITY, &_clockTask, 0) != pdPASS) {
+        Serial.println("ERROR: Failed to start sync clock task!");
+        return false;
+    }
+
+    Serial.printf("✓ Sync leader: audio to %s:%u, clock on %u\n", _group.toString().c_str(),
+                  (unsigned)SYNC_AUDIO_PORT, (unsigned)SYNC_CLOCK_PORT);
+    return true;
+}
+
+// Splits the decoder's chunk into MTU-sized packets; each carries the DAC
+// time of its own first frame.
+void SyncLeader::onPcm(const int16_t* samples, size_t frames, uint8_t channels,
+                       uint32_t sampleRate, int64_t playAtUs) {
+    SyncAudioHeader header;
+    header.magic = SYNC_MAGIC;
+    header.type = SYNC_AUDIO;
+    header.channels = channels;
+    header.stream = _stream.load(std::memory_order_relaxed);
+    header.sampleRate = sampleRate;
+    playAtUs = _playout.update(playAtUs);
+    _playout.advance(frames, sampleRate);
+
+    size_t done = 0;
+    while (done < frames) {
+        size_t n = frames - done < SYNC_PACKET_FRAMES ? frames - done : SYNC_PACKET_FRAMES;
+        size_t bytes = n * channels * sizeof(int16_t);
+
+        header.frames = (uint16_t)n;
+        header.seq = _seq++;
+        header.playAtUs = playAtUs + (int64_t)done * 1000000 / sampleRate;
+        memcpy(_packet, &header, sizeof(header));
+        memcpy(_packet + sizeof(header), samples + done * channels, bytes);
+
+        _audioUdp.beginPacket(_group, SYNC_AUDIO_PORT);
+        _audioUdp.write(_packet, sizeof(header) + bytes);
+        if (_audioUdp.endPacket()) {
+            _packetsSent++;
+        } else {
+            _sendErrors++;
+        }
+        done += n;
+    }
+}
+
+void SyncLeader::onDiscard() {
+    _playout.reset();
+    _stream++;
+}
+
+void SyncLeader::clockTaskEntry(void* param) {
+    static_cast<SyncLeader*>(param)->runClock();
+}
+
+void SyncLeader::runClock() {
+    for (;;) {
+        while (_clockUdp.parsePacket() > 0) {
+            int64_t t2 = esp_timer_get_time();
+
+            SyncClockPacket packet;
+            if (_clockUdp.read((uint8_t*)&packet, sizeof(packet)) != (int)sizeof(packet) ||
+                packet.magic != SYNC_MAGIC || packet.type != SYNC_CLOCK_REQUEST) {
+                continue;
+            }
+
+            packet.type = SYNC_CLOCK_REPLY;
+            packet.t2 = t2;
+            _clockUdp.beginPacket(_clockUdp.remoteIP(), _clockUdp.remotePort());
+            packet.t3 = esp_timer_get_time();
+            _clockUdp.write((const uint8_t*)&packet, sizeof(packet));
+            _clockUdp.endPacket();
+            _clockReplies++;
+        }
+        vTaskDelay(1);
+    }
+}
+
+SyncLeaderStats SyncLeader::getStats() const {
+    SyncLeaderStats stats;
+    stats.packetsSent = _packetsSent.load();
+    stats.sendErrors = _sendErrors.load();
+    stats.clockReplies = _clockReplies.load();
+    stats.stream = _stream.load();
+    return stats;
+}
@@ -0,0 +1,57 @@
+// ============================================================================
+// SyncLeader.h
+// Multicasts the player's PCM, stamped with its own DAC schedule, and
+// answers followers' clock requests. Plugs into the player as its
+// PcmListener, so the leader itself plays exactly as a stand-alone box.
+// ============================================================================
+#ifndef SYNC_LEADER_H
+#define SYNC_LEADER_H
+
+#include <Arduino.h>
+#include <WiFiUdp.h>
+#include <atomic>
+#include "SyncProtocol.h"
+#include "PlayoutClock.h"
+#include "Audio/AudioPlayer.h"
+
+struct SyncLeaderStats {
+    uint32_t packetsSent;
+    uint32_t sendErrors;
+    uint32_t clockReplies;
+    uint16_t stream;
+};
+
+class SyncLeader : public PcmListener {
+public:
+    SyncLeader();
+
+    // Opens the sockets and starts the clock-reply task.
+    bool begin();
+
+    // PcmListener, on the decode task.
+    void onPcm(const int16_t* samples, size_t frames, uint8_t channels,
+               uint32_t sampleRate, int64_t playAtUs) override;
+    void onDiscard() override;
+
+    SyncLeaderStats getStats() const;
+
+private:
+    WiFiUDP _audioUdp;
+    WiFiUDP _clockUdp;
+    IPAddress _group;
+    TaskHandle_t _clockTask;
+
+    uint16_t _seq;
+    std::atomic<uint16_t> _stream;
+    PlayoutClock _playout;
+    uint8_t _packet[SYNC_AUDIO_MAX_PACKET];
+
+    std::atomic<uint32_t> _packetsSent;
+    std::atomic<uint32_t> _sendErrors;
+    std::atomic<uint32_t> _clockReplies;
+
+    static void clockTaskEntry(void* param);
+    void runClock();
+};
+
+#endif
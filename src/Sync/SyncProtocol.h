@@ -0,0 +1,70 @@
+// ============================================================================
+// SyncProtocol.h
+// Wire format for multi-room playback. The leader multicasts the PCM it
+// feeds its own DAC, each packet stamped with the leader-clock time its
+// first frame reaches the DAC. Followers estimate the leader clock with
+// NTP-style request/reply exchanges and play every packet at that time.
+// All fields are little-endian (both ends are ESP32s).
+// ============================================================================
+#ifndef SYNC_PROTOCOL_H
+#define SYNC_PROTOCOL_H
+
+#include <Arduino.h>
+
+#define SYNC_ROLE_OFF 0
+#define SYNC_ROLE_LEADER 1
+#define SYNC_ROLE_FOLLOWER 2
+
+// Build with -DMUSICBOX_SYNC_ROLE=SYNC_ROLE_LEADER (or _FOLLOWER) to join
+// a group; a stand-alone box is the default.
+#ifndef MUSICBOX_SYNC_ROLE
+#define MUSICBOX_SYNC_ROLE SYNC_ROLE_OFF
+#endif
+
+static constexpr uint16_t SYNC_AUDIO_PORT = 5004;        // Leader -> group
+static constexpr uint16_t SYNC_CLOCK_PORT = 5005;        // Follower -> leader
+static constexpr uint16_t SYNC_CLOCK_REPLY_PORT = 5006;  // Leader -> follower
+static constexpr uint8_t SYNC_MULTICAST_GROUP[4] = { 239, 77, 66, 1 };
+
+static constexpr uint32_t SYNC_MAGIC = 0x434E5953;       // "SYNC"
+
+// 288 stereo frames = 1152 bytes of PCM (6.5 ms at 44.1 kHz): one
+// datagram stays under a 1500-byte MTU with the header.
+static constexpr uint16_t SYNC_PACKET_FRAMES = 288;
+
+enum SyncPacketType : uint8_t {
+    SYNC_CLOCK_REQUEST = 1,
+    SYNC_CLOCK_REPLY = 2,
+    SYNC_AUDIO = 3,
+};
+
+// t1: follower send, t2: leader receive, t3: leader send (microseconds,
+// each on its own clock). The follower stamps t4 on arrival.
+struct __attribute__((packed)) SyncClockPacket {
+    uint32_t magic;
+    uint8_t type;
+    uint8_t reserved;
+    uint16_t seq;
+    int64_t t1;
+    int64_t t2;
+    int64_t t3;
+};
+
+// Followed by frames * channels int16 samples. seq counts packets; stream
+// changes whenever the leader drops buffered audio (skip, seek, pause) so
+// followers flush theirs too.
+struct __attribute__((packed)) SyncAudioHeader {
+    uint32_t magic;
+    uint8_t type;
+    uint8_t channels;
+    uint16_t frames;
+    uint16_t seq;
+    uint16_t stream;
+    uint32_t sampleRate;
+    int64_t playAtUs;      // Leader clock
+};
+
+static constexpr size_t SYNC_AUDIO_MAX_PAYLOAD = SYNC_PACKET_FRAMES * 2 * sizeof(int16_t);
+static constexpr size_t SYNC_AUDIO_MAX_PACKET = sizeof(SyncAudioHeader) + SYNC_AUDIO_MAX_PAYLOAD;
+
+#endif
@@ -28,12 +28,23 @@
 // ============================================================================
 #include "Audio/AudioPlayer.h"
 #include "Server/Server.h"
+#include "Sync/SyncProtocol.h"
+#if MUSICBOX_SYNC_ROLE == SYNC_ROLE_LEADER
+#include "Sync/SyncLeader.h"
+#elif MUSICBOX_SYNC_ROLE == SYNC_ROLE_FOLLOWER
+#include "Sync/SyncFollower.h"
+#endif
 
 // REMOVED: #include "Audio/SDPlaylist.h"
 
 // Global Objects
 // REMOVED: SDPlaylist playlist;
 AudioPlayer audioPlayer; 
+#if MUSICBOX_SYNC_ROLE == SYNC_ROLE_LEADER
+SyncLeader syncLeader;
+#elif MUSICBOX_SYNC_ROLE == SYNC_ROLE_FOLLOWER
+SyncFollower* syncFollower = nullptr;
+#endif
 
 // REMOVED: int currentTrack = 1;
 
@@ -42,25 +53,68 @@ void setup() {
     delay(2000);
     
     Serial.println("--- ESP32 Jukebox System Starting ---");
+
+    // 0. Network and web server first, so the library scan in begin() can
+    //    report its progress; list requests get a 503 until it is done.
+    initServer(&audioPlayer);
     
     // 1. The AudioPlayer::begin() now handles all DAC and SD/Playlist initialization.
+    //    A missing SD card is not fatal: the card monitor loads it once it is in.
     if (!audioPlayer.begin()) {
         Serial.println("FATAL: System initialization failed.");
-        // The individual error messages (SD fail, DAC fail) are now printed inside AudioPlayer::begin()
+        // The individual error messages (DAC fail) are now printed inside AudioPlayer::begin()
         return;
     }
     
-    // 2. The AudioPlayer is ready to go.
-    initServer(&audioPlayer);
+#if MUSICBOX_SYNC_ROLE == SYNC_ROLE_LEADER
+    audioPlayer.setPcmListener(&syncLeader);
+#endif
 
-    // 3. Start Playing the First Track
+    // 2. Decoding and I2S output move onto their own pinned tasks.
+    if (!audioPlayer.startTasks()) {
+        Serial.println("FATAL: Could not start audio tasks.");
+        return;
+    }
+    // From here the SD card can come and go without a reboot.
+    audioPlayer.startCardMonitor();
+
+    // 3. Multi-room: needs the network that initServer() brought up.
+#if MUSICBOX_SYNC_ROLE == SYNC_ROLE_LEADER
+    syncLeader.begin();
+#elif MUSICBOX_SYNC_ROLE == SYNC_ROLE_FOLLOWER
+    // The DAC plays the leader's stream; nothing local is started.
+    syncFollower = new SyncFollower(audioPlayer.lendOutput());
+    syncFollower->begin();
+    return;
+#endif
+
+    // 4. Start Playing the First Track
     // Note: We no longer need to check getTrackCount() here, 
     // as AudioPlayer::begin() handles the fatal check, and play() handles the start.
-    audioPlayer.play();
+    audioPlayer.post(PlayerCommand::PLAY);
 }
 
 void loop() {
-    // CRITICAL: This MUST be called continuously. 
-    // It handles audio processing AND auto-advancing to the next track.
-    audioPlayer.loop();
+    // Audio processing and auto-advance run on the decode task started by
+    // AudioPlayer::startTasks(); nothing here is timing-critical anymore.
+    serverLoop();
+
+    static unsigned long lastReport = 0;
+    if (millis() - lastReport >= 60000) {
+        lastReport = millis();
+        AudioOutputStats stats = audioPlayer.getOutputStats();
+        Serial.printf("Audio: %u underruns (%u frames), %u/%u frames buffered, "
+                      "track gap last %.1f / max %.1f ms\n",
+                      (unsigned)stats.underrunEvents, (unsigned)stats.underrunFrames,
+                      (unsigned)stats.bufferedFrames, (unsigned)stats.capacityFrames,
+                      stats.lastGapUs / 1000.0, stats.maxGapUs / 1000.0);
+#if MUSICBOX_SYNC_ROLE == SYNC_ROLE_FOLLOWER
+        SyncFollowerStats sync = syncFollower ? syncFollower->getStats() : SyncFollowerStats{};
+        Serial.printf("Sync: %s, rtt %u us, skew %.1f ppm, %u lost / %u late packets, "
+                      "error %d us\n", sync.locked ? "locked" : "unlocked",
+                      (unsigned)sync.rttUs, sync.skewPpm, (unsigned)sync.jitter.lost,
+                      (unsigned)sync.jitter.late, (int)sync.lastErrorUs);
+#endif
+    }
+    delay(10);
 }
\ No newline at end of file